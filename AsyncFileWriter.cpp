@@ -0,0 +1,225 @@
+/*
+ *  AsyncFileWriter.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "AsyncFileWriter.h"
+#include "TimeWrapper.h"
+#include "Exception.h"
+#include "Log.h"
+
+#include <boost/bind.hpp>
+#include <cassert>
+
+using namespace std;
+
+#pragma mark *** FileWriterThread ***
+
+FileWriterThread::
+FileWriterThread(int numBuffers) :
+    mBuffers(numBuffers),
+    mShutdown(0)
+{
+    assert(numBuffers > 0);
+    for (int nn = 0; nn < mBuffers.size(); nn++)
+        mFreeBuffers.push_back(nn);
+    mThread = boost::thread(boost::bind(&FileWriterThread::writerLoop,
+        this));
+}
+
+FileWriterThread::
+~FileWriterThread()
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mShutdown = 1;
+    }
+    mQueuedCondition.notify_one();
+    mThread.join();
+}
+
+int FileWriterThread::
+takeBuffer(AsyncFileWriter* file)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    if (file->mWriteFailed)
+        throw(Exception("Could not write to output file."));
+    if (mFreeBuffers.empty())
+    {
+        double t0 = timeInMicroseconds();
+        while (mFreeBuffers.empty())
+            mFreeCondition.wait(lock);
+        file->mStallMicroseconds += timeInMicroseconds() - t0;
+    }
+    int bufferNum = mFreeBuffers.front();
+    mFreeBuffers.pop_front();
+    return bufferNum;
+}
+
+void FileWriterThread::
+queue(AsyncFileWriter* file, int bufferNum)
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mQueuedBuffers.push_back(make_pair(file, bufferNum));
+        file->mNumQueued++;
+    }
+    mQueuedCondition.notify_one();
+}
+
+void FileWriterThread::
+waitForFile(AsyncFileWriter* file)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    while (file->mNumQueued != 0)
+        mFreeCondition.wait(lock);
+}
+
+bool FileWriterThread::
+writeFailed(AsyncFileWriter* file)
+{
+    boost::mutex::scoped_lock lock(mMutex);
+    return file->mWriteFailed;
+}
+
+void FileWriterThread::
+writerLoop()
+{
+    while (1)
+    {
+        AsyncFileWriter* file;
+        int bufferNum;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            while (mQueuedBuffers.empty() && !mShutdown)
+                mQueuedCondition.wait(lock);
+            if (mQueuedBuffers.empty()) // and shutting down
+                return;
+            file = mQueuedBuffers.front().first;
+            bufferNum = mQueuedBuffers.front().second;
+            mQueuedBuffers.pop_front();
+        }
+
+        // Only this thread touches the files while they have samples queued.
+        bool wrote = file->writeBuffer(mBuffers[bufferNum]);
+
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            mFreeBuffers.push_back(bufferNum);
+            file->mNumQueued--;
+            if (!wrote)
+                file->mWriteFailed = 1;
+        }
+        mFreeCondition.notify_all();
+    }
+}
+
+#pragma mark *** AsyncFileWriter ***
+
+AsyncFileWriter::
+AsyncFileWriter(const string & fileName, FileWriterThreadPtr thread) :
+    mThread(thread),
+    mCurrentBuffer(-1),
+    mNumQueued(0),
+    mWriteFailed(0),
+    mStallMicroseconds(0.0)
+{
+    mFile.open(fileName.c_str(), ios::out | ios::binary);
+    if (!mFile.good())
+        throw(Exception(string("Could not open output file ") + fileName));
+}
+
+AsyncFileWriter::
+AsyncFileWriter(ChunkedFileWriterPtr chunkedFile, FileWriterThreadPtr thread) :
+    mChunkedFile(chunkedFile),
+    mThread(thread),
+    mCurrentBuffer(-1),
+    mNumQueued(0),
+    mWriteFailed(0),
+    mStallMicroseconds(0.0)
+{
+    assert(mChunkedFile != 0L);
+}
+
+AsyncFileWriter::
+~AsyncFileWriter()
+{
+    if (mThread != 0L)
+    {
+        mThread->waitForFile(this);
+        mWriteFailed = mThread->writeFailed(this);
+    }
+    if (mWriteFailed)
+        LOG << "Some output samples could not be written.\n";
+    mChunkedFile = 0L; // writes its index
+    mFile.close();
+}
+
+vector<float> & AsyncFileWriter::
+beginSample()
+{
+    assert(mCurrentBuffer == -1);
+
+    if (mThread == 0L)
+    {
+        if (mWriteFailed)
+            throw(Exception("Could not write to output file."));
+        mCurrentBuffer = 0;
+        mBuffer.clear();
+        return mBuffer;
+    }
+
+    // clear() keeps the capacity, so the buffers are allocated only once.
+    mCurrentBuffer = mThread->takeBuffer(this);
+    mThread->buffer(mCurrentBuffer).clear();
+    return mThread->buffer(mCurrentBuffer);
+}
+
+void AsyncFileWriter::
+endSample()
+{
+    assert(mCurrentBuffer != -1);
+
+    if (mThread == 0L)
+    {
+        mCurrentBuffer = -1;
+        if (!writeBuffer(mBuffer))
+        {
+            mWriteFailed = 1;
+            throw(Exception("Could not write to output file."));
+        }
+        return;
+    }
+
+    mThread->queue(this, mCurrentBuffer);
+    mCurrentBuffer = -1;
+}
+
+void AsyncFileWriter::
+flush()
+{
+    if (mThread != 0L)
+        mThread->waitForFile(this);
+    if (mChunkedFile == 0L)
+        mFile.flush();
+}
+
+bool AsyncFileWriter::
+writeBuffer(const vector<float> & buffer)
+{
+    if (mChunkedFile != 0L)
+    {
+        mChunkedFile->writeSample(buffer.size() > 0 ? &buffer[0] : 0L,
+            buffer.size());
+        return mChunkedFile->good();
+    }
+
+    if (buffer.size() > 0)
+        mFile.write((const char*)&buffer[0],
+            (std::streamsize)(buffer.size()*sizeof(float)));
+    return mFile.good();
+}
+
@@ -0,0 +1,136 @@
+/*
+ *  AsyncFileWriter.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _ASYNCFILEWRITER_
+#define _ASYNCFILEWRITER_
+
+#include "Pointer.h"
+#include "ChunkedFile.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class AsyncFileWriter;
+
+/**
+ * The writer thread and staging buffers shared by many AsyncFileWriters.
+ * However many output files there are, one thread puts their samples on disk
+ * in the order they were queued, and there are numBuffers staging buffers
+ * among all of them, so at most numBuffers samples are in memory at once.
+ *
+ * The thread is joined when the last AsyncFileWriter using it is deleted.
+ */
+class FileWriterThread
+{
+public:
+    FileWriterThread(int numBuffers);
+    ~FileWriterThread();
+
+    int numBuffers() const { return mBuffers.size(); }
+
+private:
+    friend class AsyncFileWriter;
+
+    // Wait for a free buffer and return its number.  The time spent waiting
+    // is added to the stall time of the file.
+    int takeBuffer(AsyncFileWriter* file);
+    std::vector<float> & buffer(int bufferNum) { return mBuffers[bufferNum]; }
+    void queue(AsyncFileWriter* file, int bufferNum);
+    void waitForFile(AsyncFileWriter* file);
+    bool writeFailed(AsyncFileWriter* file);
+
+    void writerLoop();
+
+    std::vector<std::vector<float> > mBuffers;
+    std::deque<int> mFreeBuffers;
+    std::deque<std::pair<AsyncFileWriter*, int> > mQueuedBuffers;
+    bool mShutdown;
+
+    boost::mutex mMutex;
+    boost::condition_variable mQueuedCondition;
+    boost::condition_variable mFreeCondition;
+    boost::thread mThread;
+};
+typedef Pointer<FileWriterThread> FileWriterThreadPtr;
+
+/**
+ * Binary float output file written on a background thread.  The timestep
+ * thread fills a staging buffer (beginSample(), then push values, then
+ * endSample()) and goes back to work while the writer thread puts the buffer
+ * on disk.
+ *
+ * The writer thread and its staging buffers belong to a FileWriterThread,
+ * which is usually shared by all the output files.  When all the buffers are
+ * waiting for the disk, beginSample() blocks until one is written; the time
+ * spent waiting is reported by stallMicroseconds().  With no FileWriterThread
+ * endSample() writes the sample itself, as the outputs used to.
+ *
+ * Samples go to a raw float file, or to a ChunkedFileWriter, which then also
+ * does its compression on the writer thread.
+ */
+class AsyncFileWriter
+{
+public:
+    AsyncFileWriter(const std::string & fileName, FileWriterThreadPtr thread);
+    AsyncFileWriter(ChunkedFileWriterPtr chunkedFile,
+        FileWriterThreadPtr thread);
+
+    /**
+     * Writes all queued samples and closes the file.
+     */
+    ~AsyncFileWriter();
+
+    /**
+     * @returns an empty staging buffer to fill with the next sample
+     */
+    std::vector<float> & beginSample();
+
+    /**
+     * Queue the buffer from beginSample() for writing.
+     */
+    void endSample();
+
+    /**
+     * Wait until every queued sample of this file is on disk.
+     */
+    void flush();
+
+    double stallMicroseconds() const { return mStallMicroseconds; }
+    
+    /**
+     * @returns the chunked file samples go to, or null for a raw file
+     */
+    ChunkedFileWriterPtr chunkedFile() const { return mChunkedFile; }
+
+private:
+    friend class FileWriterThread;
+
+    bool writeBuffer(const std::vector<float> & buffer);
+
+    std::ofstream mFile;
+    ChunkedFileWriterPtr mChunkedFile;
+    FileWriterThreadPtr mThread;
+    std::vector<float> mBuffer; // without a writer thread
+    int mCurrentBuffer;
+
+    // guarded by the mutex of mThread
+    int mNumQueued;
+    bool mWriteFailed;
+    double mStallMicroseconds;
+};
+typedef Pointer<AsyncFileWriter> AsyncFileWriterPtr;
+
+
+#endif
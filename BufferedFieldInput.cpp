@@ -8,13 +8,16 @@
  */
 
 #include "BufferedFieldInput.h"
+#include "YeeUtilities.h"
 
 #include "Log.h"
 
 using namespace std;
+using namespace YeeUtilities;
 
 BufferedFieldInput::
-BufferedFieldInput(CurrentSourceDescPtr sourceDescription)
+BufferedFieldInput(CurrentSourceDescPtr sourceDescription) :
+    mDt(0.0f)
     //mPolarizationFactor(1,1,1)
 {
     if (sourceDescription->formula() != "")
@@ -24,29 +27,16 @@ BufferedFieldInput(CurrentSourceDescPtr sourceDescription)
         mFormula = sourceDescription->formula();
         LOGF << "Formula is " << mFormula << endl;
         
-        mCalculator.set("n", 0);
-        mCalculator.set("t", 0);
-        
-        bool err = mCalculator.parse(mFormula);
-        if (err)
-        {
-            LOG << "Error found.";
-            cerr << "Calculator cannot parse\n"
-                << mFormula << "\n"
-                << "Error message:\n";
-            mCalculator.report_error(cerr);
-            cerr << "Quitting.\n";
-            assert(!"Assert death.");
-            exit(1);
-        }
+        SpaceTimeFormula::compile(mFormula, mCompiledFormula);
+        if (SpaceTimeFormula::dependsOnPosition(mCompiledFormula))
+            mFieldValueType = kSpaceTimeVaryingField;
     }
     else if (sourceDescription->timeFile() != "")
     {
         mType = FILETYPE;
         mFieldValueType = kTimeVaryingField;
         string fname = sourceDescription->timeFile();
-        mFile.open(fname.c_str(), ios::binary);
-        if (mFile.good())
+        if (mFile.open(fname))
             LOGF << "Opened binary file " << fname << ".\n";
         else
             throw(Exception(string("Could not open binary file ") + fname));
@@ -59,8 +49,7 @@ BufferedFieldInput(CurrentSourceDescPtr sourceDescription)
         mType = FILETYPE;
         mFieldValueType = kSpaceTimeVaryingField;
         string fname = sourceDescription->spaceTimeFile();
-        mFile.open(fname.c_str(), ios::binary);
-        if (mFile.good())
+        if (mFile.open(fname))
             LOGF << "Opened binary file " << fname << ".\n";
         else
             throw(Exception(string("Could not open binary file ") + fname));
@@ -101,6 +90,47 @@ BufferedFieldInput(CurrentSourceDescPtr sourceDescription)
                     numYee);
         }
     }
+    
+    if (sourceDescription->timeFile() != "")
+        startPrefetching(sourceDescription->timeFile());
+    else if (sourceDescription->spaceTimeFile() != "")
+        startPrefetching(sourceDescription->spaceTimeFile());
+}
+
+void BufferedFieldInput::
+startPrefetching(const string & fileName)
+{
+    // The J record and then the K record for each timestep, as prepareJ()
+    // and prepareK() ask for them.
+    vector<long> recordLengths;
+    long lengthE = 0, lengthH = 0;
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        if (mFieldValueType == kSpaceTimeVaryingField)
+        {
+            lengthE += mBufferE[xyz].length();
+            lengthH += mBufferH[xyz].length();
+        }
+        else
+        {
+            lengthE += (mBufferE[xyz].length() > 0);
+            lengthH += (mBufferH[xyz].length() > 0);
+        }
+    }
+    if (lengthE > 0)
+        recordLengths.push_back(lengthE);
+    if (lengthH > 0)
+        recordLengths.push_back(lengthH);
+    
+    int numBuffers = FilePrefetcher::numBuffers(recordLengths);
+    if (numBuffers > 0)
+    {
+        mPrefetcher = FilePrefetcherPtr(new FilePrefetcher(fileName,
+            recordLengths, numBuffers));
+        mFile.close();
+        LOGF << "Prefetching " << numBuffers << " records of " << fileName
+            << ".\n";
+    }
 }
 
 void BufferedFieldInput::
@@ -160,48 +190,110 @@ pointerMaskH(int fieldDirection, long offset) const
     return BufferPointer(mMaskBufferH[fieldDirection], offset);
 }
 
+void BufferedFieldInput::
+precomputeWaveform(long numTimesteps, float dt)
+{
+    mDt = dt;
+    if (mType != FORMULATYPE || mFieldValueType != kTimeVaryingField)
+        return;
+    
+    // The times are worked out as the callers of startHalfTimestepE() and
+    // startHalfTimestepH() work them out, so the lookups match exactly.
+    mWaveformE.resize(numTimesteps);
+    mWaveformH.resize(numTimesteps);
+    double inputs[SpaceTimeFormula::kNumInputs] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    for (long nn = 0; nn < numTimesteps; nn++)
+    {
+        inputs[SpaceTimeFormula::kTimestep] = nn;
+        inputs[SpaceTimeFormula::kTime] = float(nn*dt);
+        mWaveformE[nn] = mCompiledFormula.evaluate(inputs);
+        inputs[SpaceTimeFormula::kTime] = float((nn+0.5)*dt);
+        mWaveformH[nn] = mCompiledFormula.evaluate(inputs);
+    }
+    LOGF << "Tabulated formula for " << numTimesteps << " timesteps.\n";
+}
+
+float BufferedFieldInput::
+formulaValue(long timestep, float time, const vector<float> & waveform,
+    float tableTime) const
+{
+    if (timestep >= 0 && timestep < waveform.size() && time == tableTime)
+        return waveform[timestep];
+    
+    double inputs[SpaceTimeFormula::kNumInputs] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    inputs[SpaceTimeFormula::kTimestep] = timestep;
+    inputs[SpaceTimeFormula::kTime] = time;
+    return mCompiledFormula.evaluate(inputs);
+}
+
+void BufferedFieldInput::
+setCells(const vector<vector<Rect3i> > & yeeCellsJ,
+    const vector<vector<Rect3i> > & yeeCellsK, const Vector3i & originYee,
+    const Vector3f & dxyz)
+{
+    if (mType != FORMULATYPE || mFieldValueType != kSpaceTimeVaryingField)
+        return;
+    assert(yeeCellsJ.size() == 3 && yeeCellsK.size() == 3);
+    
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        if (mBufferE[xyz].length() > 0)
+        {
+            mSpaceTimeE[xyz] = SpaceTimeFormulaPtr(new SpaceTimeFormula(
+                mCompiledFormula, originYee, dxyz));
+            for (int nn = 0; nn < yeeCellsJ[xyz].size(); nn++)
+                mSpaceTimeE[xyz]->addCells(yeeCellsJ[xyz][nn],
+                    eFieldPosition(xyz));
+            assert(mSpaceTimeE[xyz]->numCells() <= mBufferE[xyz].length());
+        }
+        if (mBufferH[xyz].length() > 0)
+        {
+            mSpaceTimeH[xyz] = SpaceTimeFormulaPtr(new SpaceTimeFormula(
+                mCompiledFormula, originYee, dxyz));
+            for (int nn = 0; nn < yeeCellsK[xyz].size(); nn++)
+                mSpaceTimeH[xyz]->addCells(yeeCellsK[xyz][nn],
+                    hFieldPosition(xyz));
+            assert(mSpaceTimeH[xyz]->numCells() <= mBufferH[xyz].length());
+        }
+    }
+}
+
+void BufferedFieldInput::
+evaluateFormulas(SpaceTimeFormulaPtr* formulas, const MemoryBuffer* buffers,
+    long timestep, float time)
+{
+    for (int xyz = 0; xyz < 3; xyz++)
+    if (formulas[xyz] != 0L && formulas[xyz]->numCells() > 0)
+    {
+        mFormulaValues.resize(formulas[xyz]->numCells());
+        formulas[xyz]->evaluate(timestep, time, &mFormulaValues[0]);
+        copy(mFormulaValues.begin(), mFormulaValues.end(),
+            buffers[xyz].headPointer());
+    }
+}
+
 void BufferedFieldInput::
 startHalfTimestepE(long timestep, float time)
 {
-    if (mType == FORMULATYPE)
+    if (mType == FORMULATYPE && mFieldValueType == kSpaceTimeVaryingField)
+        evaluateFormulas(mSpaceTimeE, mBufferE, timestep, time);
+    else if (mType == FORMULATYPE)
     {
-        mCalculator.set("n", timestep);
-        mCalculator.set("t", time);
-        mCalculator.parse(mFormula);
-        
-        mCurrentValue = mCalculator.get_value();
+        mCurrentValue = formulaValue(timestep, time, mWaveformE,
+            float(timestep*mDt));
     }
     else //if (mType == FILETYPE)
     {
         if (mFieldValueType == kTimeVaryingField)
         {
-            for (int fieldDirection = 0; fieldDirection < 3; fieldDirection++)
-            if (mFile.good())
-            {
-                if (mBufferE[fieldDirection].length() > 0)
-                {
-                    mFile.read((char*)mBufferE[fieldDirection].headPointer(),
-                        (std::streamsize)sizeof(float));
-                }
-            }
-            else
+            if (!readRecord(mBufferE, 0))
                 throw(Exception("Buffered E cannot read further from file"
                     " (time-varying field)."));
         }
         else if (mFieldValueType == kSpaceTimeVaryingField)
         {
             // It should all be in order, right?  Read it in.
-            for (int fieldDirection = 0; fieldDirection < 3; fieldDirection++)
-            if (mFile.good())
-            {
-                if (mBufferE[fieldDirection].length() > 0)
-                {
-                    mFile.read((char*)mBufferE[fieldDirection].headPointer(),
-                        (std::streamsize)(mBufferE[fieldDirection].length() *
-                        sizeof(float)));
-                }
-            }
-            else
+            if (!readRecord(mBufferE, 1))
                 throw(Exception("Buffered E cannot read further from file"
                     " (space-time-varying field)."));
         }
@@ -210,49 +302,72 @@ startHalfTimestepE(long timestep, float time)
 void BufferedFieldInput::
 startHalfTimestepH(long timestep, float time)
 {
-    if (mType == FORMULATYPE)
+    if (mType == FORMULATYPE && mFieldValueType == kSpaceTimeVaryingField)
+        evaluateFormulas(mSpaceTimeH, mBufferH, timestep, time);
+    else if (mType == FORMULATYPE)
     {
-        mCalculator.set("n", timestep);
-        mCalculator.set("t", time);
-        mCalculator.parse(mFormula);
-        
-        mCurrentValue = mCalculator.get_value();
+        mCurrentValue = formulaValue(timestep, time, mWaveformH,
+            float((timestep+0.5)*mDt));
     }
     else //if (mType == FILETYPE)
     {
         if (mFieldValueType == kTimeVaryingField)
         {
-            for (int fieldDirection = 0; fieldDirection < 3; fieldDirection++)
-            if (mFile.good())
-            {
-                if (mBufferH[fieldDirection].length() > 0)
-                {
-                    mFile.read((char*)mBufferH[fieldDirection].headPointer(),
-                        (std::streamsize)sizeof(float));
-                }
-            }
-            else
+            if (!readRecord(mBufferH, 0))
                 throw(Exception("Buffered H cannot read further from file"
                     " (time-varying field)."));
         }
         else if (mFieldValueType == kSpaceTimeVaryingField)
         {
             // It should all be in order, right?  Read it in.
-            for (int fieldDirection = 0; fieldDirection < 3; fieldDirection++)
-            if (mFile.good())
-            {
-                if (mBufferH[fieldDirection].length() > 0)
-                    mFile.read((char*)mBufferH[fieldDirection].headPointer(),
-                        (std::streamsize)(mBufferH[fieldDirection].length() *
-                        sizeof(float)));
-            }
-            else
+            if (!readRecord(mBufferH, 1))
                 throw(Exception("Buffered H cannot read further from file"
                     " (space-time-varying field)."));
         }
     }
 }
 
+double BufferedFieldInput::
+stallMicroseconds() const
+{
+    if (mPrefetcher != 0L)
+        return mPrefetcher->stallMicroseconds();
+    return 0.0;
+}
+
+bool BufferedFieldInput::
+readRecord(const MemoryBuffer* buffers, bool isSpaceVarying)
+{
+    const vector<float>* record = 0L;
+    if (mPrefetcher != 0L)
+    {
+        record = mPrefetcher->beginRecord();
+        if (record == 0L)
+            return 0;
+    }
+    
+    long nn = 0;
+    for (int fieldDirection = 0; fieldDirection < 3; fieldDirection++)
+    if (buffers[fieldDirection].length() > 0)
+    {
+        long count = isSpaceVarying ? buffers[fieldDirection].length() : 1;
+        const float* floats;
+        if (record != 0L)
+        {
+            assert(nn + count <= record->size());
+            floats = &(*record)[nn];
+        }
+        else if ((floats = mFile.view(count)) == 0L)
+            return 0;
+        copy(floats, floats + count, buffers[fieldDirection].headPointer());
+        nn += count;
+    }
+    
+    if (mPrefetcher != 0L)
+        mPrefetcher->endRecord();
+    return 1;
+}
+
 void BufferedFieldInput::
 zeroBuffersE()
 {
@@ -290,8 +405,7 @@ loadMask(CurrentSourceDescPtr source)
     {
         mDataMaskE[direction].resize(volume);
         assert(maskFile.good());
-        maskFile.read((char*)&(mDataMaskE[direction][0]),
-            (std::streamsize)volume*sizeof(float));
+        readFieldValues(maskFile, &(mDataMaskE[direction][0]), volume);
     }
     
     // load H masks
@@ -300,7 +414,6 @@ loadMask(CurrentSourceDescPtr source)
     {
         mDataMaskE[direction].resize(volume);
         assert(maskFile.good());
-        maskFile.read((char*)&(mDataMaskH[direction][0]),
-            (std::streamsize)volume*sizeof(float));
+        readFieldValues(maskFile, &(mDataMaskH[direction][0]), volume);
     }
 }
@@ -15,8 +15,10 @@
 #include <string>
 #include <fstream>
 #include <vector>
-#include <calc.hh>
 #include "MemoryUtilities.h"
+#include "MappedFile.h"
+#include "FilePrefetcher.h"
+#include "SpaceTimeFormula.h"
 
 class BufferedFieldInput
 {
@@ -60,14 +62,57 @@ public:
     void startHalfTimestepE(long timestep, float time);
     void startHalfTimestepH(long timestep, float time);
     
+    /**
+     *  Evaluate a formula source for every timestep up front, so each half
+     *  timestep only looks its value up.  Sources that don't use a formula
+     *  ignore this.
+     *
+     *  @param numTimesteps     number of timesteps in the simulation
+     *  @param dt               timestep in seconds
+     */
+    void precomputeWaveform(long numTimesteps, float dt);
+    
+    /**
+     *  Tell a source whose formula uses x, y or z which cells its buffers
+     *  hold, in buffer order.  Other sources ignore this.
+     *
+     *  @param yeeCellsJ    rects of Yee cells for Jx, Jy and Jz
+     *  @param yeeCellsK    rects of Yee cells for Kx, Ky and Kz
+     *  @param originYee    Yee cell at position (0, 0, 0)
+     *  @param dxyz         cell size in meters
+     */
+    void setCells(const std::vector<std::vector<Rect3i> > & yeeCellsJ,
+        const std::vector<std::vector<Rect3i> > & yeeCellsK,
+        const Vector3i & originYee, const Vector3f & dxyz);
+    
+    /**
+     *  @returns true if the buffers hold one value per cell, false if they
+     *  hold one value for all cells
+     */
+    bool isSpaceVarying() const
+        { return mFieldValueType == kSpaceTimeVaryingField; }
+    
     /**
      *  Set the contents of the field buffers to zero.  This is useful when an
      *  input file only provides fields for a certain number of timesteps.
      */
     void zeroBuffersE();
     void zeroBuffersH();
+    
+    /**
+     *  Time the timestep thread has spent waiting for the prefetcher to read
+     *  data from the file.
+     */
+    double stallMicroseconds() const;
 
 private:
+    /**
+     *  @returns the value of the formula at this timestep, from the table if
+     *  there is one and the time is the usual one
+     */
+    float formulaValue(long timestep, float time,
+        const std::vector<float> & waveform, float tableTime) const;
+    
     /**
      *  If the CurrentSourceDescription indicates that the source has a mask
      *  (a space-varying prefactor), then allocate the mask buffers here and
@@ -77,19 +122,47 @@ private:
      */
     void loadMask(CurrentSourceDescPtr source);
     
-    std::ifstream mFile;
+    /**
+     *  Fill the used buffers with the next half timestep's data, one value
+     *  per buffer or one value per cell if isSpaceVarying.
+     *
+     *  @returns false if the file has run out
+     */
+    bool readRecord(const MemoryBuffer* buffers, bool isSpaceVarying);
+    
+    /**
+     *  Evaluate a space-time formula at all the cells of one half timestep
+     *  into the buffers.
+     */
+    void evaluateFormulas(SpaceTimeFormulaPtr* formulas,
+        const MemoryBuffer* buffers, long timestep, float time);
+    
+    /**
+     *  Start reading the data file ahead on a loader thread, if the
+     *  FilePrefetcher settings allow it.
+     */
+    void startPrefetching(const std::string & fileName);
+    
+    MappedFile mFile;
+    FilePrefetcherPtr mPrefetcher;
     std::string mFormula;
-	calc_defs::Calculator<float> mCalculator;
+    CompiledFormula mCompiledFormula;
+    float mDt;
+    std::vector<float> mWaveformE;
+    std::vector<float> mWaveformH;
+    SpaceTimeFormulaPtr mSpaceTimeE[3];
+    SpaceTimeFormulaPtr mSpaceTimeH[3];
+    std::vector<float> mFormulaValues;
     
     MemoryBuffer mBufferE[3];
     MemoryBuffer mBufferH[3];
     MemoryBuffer mMaskBufferE[3];
     MemoryBuffer mMaskBufferH[3];
     
-    std::vector<float> mDataE[3];
-    std::vector<float> mDataH[3];
-    std::vector<float> mDataMaskE[3];
-    std::vector<float> mDataMaskH[3];
+    std::vector<FieldStorage> mDataE[3];
+    std::vector<FieldStorage> mDataH[3];
+    std::vector<FieldStorage> mDataMaskE[3];
+    std::vector<FieldStorage> mDataMaskH[3];
     
     enum FieldValueType
     {
@@ -18,10 +18,98 @@
 #include "TimeWrapper.h"
 
 #include <cmath>
+#include <algorithm>
 
 using namespace std;
 using namespace YeeUtilities;
 
+static bool sIsSampled(const vector<Duration> & durations, long timestep);
+static bool sIsOn(const vector<Duration> & durations, long timestep);
+
+// Each thread updates its share of the runlines of each material, for all three
+// field directions.  The Ex, Ey and Ez updates depend only on H (and vice
+// versa), so no barrier is needed until the whole E or H phase is done.
+class MaterialUpdateTask : public WorkerTask
+{
+public:
+    MaterialUpdateTask(vector<UpdateEquationPtr> & materials,
+        bool isE, long firstMaterial, long endMaterial, int numTiles = 1) :
+        mMaterials(materials),
+        mIsE(isE),
+        mFirstMaterial(firstMaterial),
+        mEndMaterial(endMaterial),
+        mNumTiles(numTiles)
+    {
+    }
+    
+    virtual void execute(int threadNum, int numThreads)
+    {
+        // With tiles, each thread takes a contiguous run of whole tiles, the
+        // same slab of memory it zeroed if the fields were first-touched (see
+        // FieldArray).
+        if (mNumTiles > 1)
+        {
+            int firstTile = (mNumTiles*threadNum)/numThreads;
+            int endTile = (mNumTiles*(threadNum+1))/numThreads;
+            for (int tile = firstTile; tile < endTile; tile++)
+            for (int xyz = 0; xyz < 3; xyz++)
+            for (long nn = mFirstMaterial; nn < mEndMaterial; nn++)
+            {
+                if (mIsE)
+                    mMaterials[nn]->calcETile(xyz, tile, mNumTiles);
+                else
+                    mMaterials[nn]->calcHTile(xyz, tile, mNumTiles);
+            }
+            return;
+        }
+        
+        for (int xyz = 0; xyz < 3; xyz++)
+        for (long nn = mFirstMaterial; nn < mEndMaterial; nn++)
+        {
+            if (mIsE)
+                mMaterials[nn]->calcEPhase(xyz, threadNum, numThreads);
+            else
+                mMaterials[nn]->calcHPhase(xyz, threadNum, numThreads);
+        }
+    }
+private:
+    vector<UpdateEquationPtr> & mMaterials;
+    bool mIsE;
+    long mFirstMaterial;
+    long mEndMaterial;
+    int mNumTiles;
+};
+
+// The two stages of CalculationPartition::updateBlock().  Each thread takes
+// whole segments (or the seams after them); they touch disjoint planes.
+class TimeBlockTask : public WorkerTask
+{
+public:
+    TimeBlockTask(CalculationPartition & partition, bool seams,
+        int numTimesteps) :
+        mPartition(partition),
+        mSeams(seams),
+        mNumTimesteps(numTimesteps)
+    {
+    }
+    
+    virtual void execute(int threadNum, int numThreads)
+    {
+        for (int segment = threadNum; segment < mPartition.mNumSegments;
+            segment += numThreads)
+        {
+            if (mSeams)
+                mPartition.calcSeam(segment, mNumTimesteps);
+            else
+                mPartition.calcSegment(segment, mNumTimesteps);
+        }
+    }
+private:
+    CalculationPartition & mPartition;
+    bool mSeams;
+    int mNumTimesteps;
+};
+
 CalculationPartition::
 CalculationPartition(const VoxelizedPartition & vp, Vector3f dxyz, float dt,
     long numT) :
@@ -29,8 +117,12 @@ CalculationPartition(const VoxelizedPartition & vp, Vector3f dxyz, float dt,
     m_dxyz(dxyz),
     m_dt(dt),
     m_numT(numT),
+    mCalcHalfCells(vp.calcHalfCells()),
     mHuygensSurfaces(vp.huygensSurfaces()),
-    mLattice(vp.getLattice())
+    mLattice(vp.getLattice()),
+    mNumTiles(1),
+    mTimeBlockTimesteps(0),
+    mNumSegments(1)
 {
 //    LOG << "New calc partition.\n";
     unsigned int nn;
@@ -131,6 +223,217 @@ allocateAuxBuffers()
         mCurrentSources[nn]->allocateAuxBuffers();
 }
 
+void CalculationPartition::
+setWorkerPool(WorkerPoolPtr pool)
+{
+    mWorkerPool = pool;
+    
+    unsigned int nn;
+    for (nn = 0; nn < mMaterials.size(); nn++)
+        mMaterials[nn]->divideRunlines(mWorkerPool->numThreads());
+}
+
+void CalculationPartition::
+fuseRunlines()
+{
+    unsigned int nn;
+    for (nn = 0; nn < mMaterials.size(); nn++)
+        mMaterials[nn]->fuseRunlines(*mLattice);
+}
+
+void CalculationPartition::
+divideIntoTiles(long tileBytes)
+{
+    // Each tile holds a slab of all six field components.  Tiles are at
+    // least one plane thick along the slowest memory direction.
+    const int slowDirection = (mLattice->runlineDirection()+2)%3;
+    long latticeBytes = 6*mLattice->fieldLength()*sizeof(FieldStorage);
+    long numPlanes = mLattice->numYeeCells()[slowDirection];
+    
+    mNumTiles = 1;
+    if (tileBytes > 0)
+        mNumTiles = std::min((latticeBytes + tileBytes - 1)/tileBytes,
+            numPlanes);
+    if (mNumTiles < 1)
+        mNumTiles = 1;
+    
+    if (mNumTiles > 1)
+    {
+        unsigned int nn;
+        for (nn = 0; nn < mMaterials.size(); nn++)
+            mMaterials[nn]->divideRunlinesIntoTiles(*mLattice, mNumTiles);
+    }
+}
+
+void CalculationPartition::
+setUpTimeBlocks(int maxTimesteps)
+{
+    mTimeBlockTimesteps = 0;
+    
+    // Anything that reaches into the fields between updates, or across the
+    // edge of the lattice, needs every timestep.
+    if (mHaloExchange != 0L || mHuygensSurfaces.size() != 0 ||
+        mCurrentSources.size() != 0)
+        return;
+    
+    unsigned int nn;
+    for (nn = 0; nn < mMaterials.size(); nn++)
+    if (!mMaterials[nn]->tilesByPlanes(*mLattice))
+    {
+        LOG << mMaterials[nn]->substanceName() << " has runlines that cross "
+            "planes; no temporal blocking.\n";
+        return;
+    }
+    
+    // Every segment must be at least 2*numTimesteps+1 planes thick, so the
+    // seams on its two sides don't meet.
+    const int slowDirection = (mLattice->runlineDirection()+2)%3;
+    long numPlanes = mLattice->numYeeCells()[slowDirection];
+    long numTimesteps = std::min(long(maxTimesteps), (numPlanes-1)/2);
+    if (numTimesteps < 2)
+        return;
+    
+    long numThreads = 1;
+    if (mWorkerPool != 0L)
+        numThreads = mWorkerPool->numThreads();
+    mNumSegments = std::max(1L, std::min(numThreads,
+        numPlanes/(2*numTimesteps+1)));
+    
+    mNumTiles = numPlanes;
+    for (nn = 0; nn < mMaterials.size(); nn++)
+        mMaterials[nn]->divideRunlinesIntoTiles(*mLattice, mNumTiles);
+    mTimeBlockTimesteps = numTimesteps;
+}
+
+long CalculationPartition::
+quietTimesteps(long firstTimestep, long maxTimesteps) const
+{
+    long numTimesteps = std::min(maxTimesteps, long(mTimeBlockTimesteps));
+    for (long tt = 0; tt < numTimesteps; tt++)
+    if (!isQuiet(firstTimestep + tt))
+        return tt;
+    return numTimesteps;
+}
+
+bool CalculationPartition::
+isQuiet(long timestep) const
+{
+    unsigned int nn;
+    
+    // Outputs may keep fields from the timestep before a sample or look at
+    // the one after it (e.g. FluxOutput keeps H to average it in time).
+    for (nn = 0; nn < mOutputs.size(); nn++)
+    {
+        const vector<Duration> & durations(
+            mOutputs[nn]->description()->durations());
+        for (long tt = timestep-1; tt <= timestep+1; tt++)
+        if (sIsSampled(durations, tt))
+            return 0;
+    }
+    
+    for (nn = 0; nn < mSoftSources.size(); nn++)
+    if (sIsOn(mSoftSources[nn]->durations(), timestep))
+        return 0;
+    for (nn = 0; nn < mHardSources.size(); nn++)
+    if (sIsOn(mHardSources[nn]->durations(), timestep))
+        return 0;
+    
+    return 1;
+}
+
+// A block of numTimesteps timesteps is done in two stages.  Number the planes
+// of the lattice along the slowest memory direction 0 to N-1.  E in plane k
+// needs H in planes k-1 and k, and H in plane k needs E in planes k and k+1,
+// all wrapping around at the ends.  Call the ss-th timestep of the block
+// level ss.
+//
+// First, each segment L...R of planes goes up as many levels as it can
+// without its neighbors: E on planes L+ss to R-ss and H on L+ss to R-ss-1 at
+// level ss.  Only E in plane L at level 0 reads from outside the segment, and
+// the H it reads there (plane L-1) is not touched in this stage.  A wave
+// sweeps the segment once and takes every level one plane further at each
+// step, so the few planes in flight stay in cache for all the levels.
+//
+// Then the seam between a segment ending at R and the next one is filled in
+// level by level: E on planes R+1-ss to R+ss and H on R-ss to R+ss.  The
+// first stage left each of these planes exactly one level behind, and the
+// planes around it at the levels they need to be at.
+void CalculationPartition::
+updateBlock(long firstTimestep, long numTimesteps)
+{
+    assert(numTimesteps <= mTimeBlockTimesteps);
+    
+    if (mWorkerPool != 0L)
+    {
+        TimeBlockTask segments(*this, false, numTimesteps);
+        mWorkerPool->run(segments);
+        TimeBlockTask seams(*this, true, numTimesteps);
+        mWorkerPool->run(seams);
+    }
+    else
+    {
+        int segment;
+        for (segment = 0; segment < mNumSegments; segment++)
+            calcSegment(segment, numTimesteps);
+        for (segment = 0; segment < mNumSegments; segment++)
+            calcSeam(segment, numTimesteps);
+    }
+}
+
+void CalculationPartition::
+calcSegment(int segment, int numTimesteps)
+{
+    const long firstPlane = (long(mNumTiles)*segment)/mNumSegments;
+    const long lastPlane = (long(mNumTiles)*(segment+1))/mNumSegments - 1;
+    
+    for (long front = firstPlane; front <= lastPlane; front++)
+    for (int ss = 0; ss < numTimesteps; ss++)
+    {
+        long plane = front - ss;
+        if (plane >= firstPlane + ss && plane <= lastPlane - ss)
+            calcPlanesE(plane, plane);
+        plane--;
+        if (plane >= firstPlane + ss && plane <= lastPlane - ss - 1)
+            calcPlanesH(plane, plane);
+    }
+}
+
+void CalculationPartition::
+calcSeam(int segment, int numTimesteps)
+{
+    const long lastPlane = (long(mNumTiles)*(segment+1))/mNumSegments - 1;
+    
+    for (int ss = 0; ss < numTimesteps; ss++)
+    {
+        calcPlanesE(lastPlane + 1 - ss, lastPlane + ss);
+        calcPlanesH(lastPlane - ss, lastPlane + ss);
+    }
+}
+
+void CalculationPartition::
+calcPlanesE(long firstPlane, long lastPlane)
+{
+    for (long plane = firstPlane; plane <= lastPlane; plane++)
+    {
+        int tile = (plane + mNumTiles)%mNumTiles;
+        for (int eNum = 0; eNum < 3; eNum++)
+        for (unsigned int nn = 0; nn < mMaterials.size(); nn++)
+            mMaterials[nn]->calcETile(eNum, tile, mNumTiles);
+    }
+}
+
+void CalculationPartition::
+calcPlanesH(long firstPlane, long lastPlane)
+{
+    for (long plane = firstPlane; plane <= lastPlane; plane++)
+    {
+        int tile = (plane + mNumTiles)%mNumTiles;
+        for (int hNum = 0; hNum < 3; hNum++)
+        for (unsigned int nn = 0; nn < mMaterials.size(); nn++)
+            mMaterials[nn]->calcHTile(hNum, tile, mNumTiles);
+    }
+}
+
 void CalculationPartition::
 updateE(long timestep)
 {
@@ -142,9 +445,25 @@ updateE(long timestep)
     for (nn = 0; nn < mCurrentSources.size(); nn++)
         mCurrentSources[nn]->prepareJ(timestep, timestep*m_dt);
     
-    for (int eNum = 0; eNum < 3; eNum++)
-    for (nn = 0; nn < mMaterials.size(); nn++)
-        mMaterials[nn]->calcEPhase(eNum);
+    if (mWorkerPool != 0L)
+    {
+        MaterialUpdateTask task(mMaterials, true, 0, mMaterials.size(),
+            mNumTiles);
+        mWorkerPool->run(task);
+    }
+    else if (mNumTiles > 1)
+    {
+        for (int tile = 0; tile < mNumTiles; tile++)
+        for (int eNum = 0; eNum < 3; eNum++)
+        for (nn = 0; nn < mMaterials.size(); nn++)
+            mMaterials[nn]->calcETile(eNum, tile, mNumTiles);
+    }
+    else
+    {
+        for (int eNum = 0; eNum < 3; eNum++)
+        for (nn = 0; nn < mMaterials.size(); nn++)
+            mMaterials[nn]->calcEPhase(eNum);
+    }
 }
 
 void CalculationPartition::
@@ -156,6 +475,9 @@ sourceE(long timestep)
         mSoftSources[nn]->sourceEPhase(*this, timestep);
     for (nn = 0; nn < mHardSources.size(); nn++)
         mHardSources[nn]->sourceEPhase(*this, timestep);
+    
+    if (mHaloExchange != 0L)
+        mHaloExchange->exchangeE(*mLattice);
 }
 
 void CalculationPartition::
@@ -185,9 +507,25 @@ updateH(long timestep)
     for (nn = 0; nn < mCurrentSources.size(); nn++)
         mCurrentSources[nn]->prepareK(timestep, (timestep+0.5)*m_dt);
     
-    for (int hNum = 0; hNum < 3; hNum++)
-    for (nn = 0; nn < mMaterials.size(); nn++)
-        mMaterials[nn]->calcHPhase(hNum);
+    if (mWorkerPool != 0L)
+    {
+        MaterialUpdateTask task(mMaterials, false, 0, mMaterials.size(),
+            mNumTiles);
+        mWorkerPool->run(task);
+    }
+    else if (mNumTiles > 1)
+    {
+        for (int tile = 0; tile < mNumTiles; tile++)
+        for (int hNum = 0; hNum < 3; hNum++)
+        for (nn = 0; nn < mMaterials.size(); nn++)
+            mMaterials[nn]->calcHTile(hNum, tile, mNumTiles);
+    }
+    else
+    {
+        for (int hNum = 0; hNum < 3; hNum++)
+        for (nn = 0; nn < mMaterials.size(); nn++)
+            mMaterials[nn]->calcHPhase(hNum);
+    }
 }
 
 void CalculationPartition::
@@ -199,6 +537,9 @@ sourceH(long timestep)
         mSoftSources[nn]->sourceHPhase(*this, timestep);
     for (nn = 0; nn < mHardSources.size(); nn++)
         mHardSources[nn]->sourceHPhase(*this, timestep);
+    
+    if (mHaloExchange != 0L)
+        mHaloExchange->exchangeH(*mLattice);
 }
 
 void CalculationPartition::
@@ -214,25 +555,43 @@ void CalculationPartition::
 timedUpdateE(long timestep)
 {
     unsigned int nn;
-    double t1, t2;
+    double t1, t2, stall;
     
     for (nn = 0; nn < mHuygensSurfaces.size(); nn++)
     {
+        stall = mHuygensSurfaces[nn]->inputStallMicroseconds();
         t1 = timeInMicroseconds();
         mHuygensSurfaces[nn]->updateH(*this, timestep); // H before E.
         t2 = timeInMicroseconds();
         mStatistics.addHuygensSurfaceMicroseconds(nn, t2-t1);
+        mStatistics.addHuygensSurfaceStallMicroseconds(nn,
+            mHuygensSurfaces[nn]->inputStallMicroseconds() - stall);
     }
     
     
     for (nn = 0; nn < mCurrentSources.size(); nn++)
     {
+        stall = mCurrentSources[nn]->inputStallMicroseconds();
         t1 = timeInMicroseconds();
         mCurrentSources[nn]->prepareJ(timestep, timestep*m_dt);
         t2 = timeInMicroseconds();
         mStatistics.addCurrentSourceMicroseconds(nn, t2-t1);
+        mStatistics.addCurrentSourceStallMicroseconds(nn,
+            mCurrentSources[nn]->inputStallMicroseconds() - stall);
     }
     
+    // With threads, each material gets its own pass through the pool so it can
+    // be timed separately.
+    if (mWorkerPool != 0L)
+    for (nn = 0; nn < mMaterials.size(); nn++)
+    {
+        t1 = timeInMicroseconds();
+        MaterialUpdateTask task(mMaterials, true, nn, nn+1);
+        mWorkerPool->run(task);
+        t2 = timeInMicroseconds();
+        mStatistics.addMaterialMicrosecondsE(nn, t2-t1);
+    }
+    else
     for (int eNum = 0; eNum < 3; eNum++)
     for (nn = 0; nn < mMaterials.size(); nn++)
     {
@@ -265,6 +624,9 @@ timedSourceE(long timestep)
         t2 = timeInMicroseconds();
         mStatistics.addHardSourceMicroseconds(nn, t2-t1);
     }
+    
+    if (mHaloExchange != 0L)
+        mHaloExchange->exchangeE(*mLattice);
 }
 
 void CalculationPartition::
@@ -294,25 +656,41 @@ timedUpdateH(long timestep)
 {
     //LOG << "Update H " << timestep << "\n";
     unsigned int nn;
-    double t1, t2;
+    double t1, t2, stall;
     
     // Update E fields in Huygens surfaces
     for (nn = 0; nn < mHuygensSurfaces.size(); nn++)
     {
+        stall = mHuygensSurfaces[nn]->inputStallMicroseconds();
         t1 = timeInMicroseconds();
         mHuygensSurfaces[nn]->updateE(*this, timestep); // E before H
         t2 = timeInMicroseconds();
         mStatistics.addHuygensSurfaceMicroseconds(nn, t2-t1);
+        mStatistics.addHuygensSurfaceStallMicroseconds(nn,
+            mHuygensSurfaces[nn]->inputStallMicroseconds() - stall);
     }
     
     for (nn = 0; nn < mCurrentSources.size(); nn++)
     {
+        stall = mCurrentSources[nn]->inputStallMicroseconds();
         t1 = timeInMicroseconds();
         mCurrentSources[nn]->prepareK(timestep, (timestep+0.5)*m_dt);
         t2 = timeInMicroseconds();
         mStatistics.addCurrentSourceMicroseconds(nn, t2-t1);
+        mStatistics.addCurrentSourceStallMicroseconds(nn,
+            mCurrentSources[nn]->inputStallMicroseconds() - stall);
     }
         
+    if (mWorkerPool != 0L)
+    for (nn = 0; nn < mMaterials.size(); nn++)
+    {
+        t1 = timeInMicroseconds();
+        MaterialUpdateTask task(mMaterials, false, nn, nn+1);
+        mWorkerPool->run(task);
+        t2 = timeInMicroseconds();
+        mStatistics.addMaterialMicrosecondsH(nn, t2-t1);
+    }
+    else
     for (int hNum = 0; hNum < 3; hNum++)
     for (nn = 0; nn < mMaterials.size(); nn++)
     {
@@ -344,6 +722,9 @@ timedSourceH(long timestep)
         t2 = timeInMicroseconds();
         mStatistics.addHardSourceMicroseconds(nn, t2-t1);
     }
+    
+    if (mHaloExchange != 0L)
+        mHaloExchange->exchangeH(*mLattice);
 }
 
 void CalculationPartition::
@@ -384,5 +765,19 @@ printPerformanceForMatlab(std::ostream & str, string prefix)
     mStatistics.printForMatlab(str, prefix, mMaterials, m_numT);
 }
 
+static bool sIsSampled(const vector<Duration> & durations, long timestep)
+{
+    for (unsigned int dd = 0; dd < durations.size(); dd++)
+    if (timestep >= durations[dd].first() && timestep <= durations[dd].last()
+        && (timestep - durations[dd].first())%durations[dd].period() == 0)
+        return 1;
+    return 0;
+}
 
-
+static bool sIsOn(const vector<Duration> & durations, long timestep)
+{
+    for (unsigned int dd = 0; dd < durations.size(); dd++)
+    if (timestep >= durations[dd].first() && timestep <= durations[dd].last())
+        return 1;
+    return 0;
+}
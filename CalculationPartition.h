@@ -17,6 +17,8 @@
 #include "HuygensSurface.h"
 #include "InterleavedLattice.h"
 #include "Performance.h"
+#include "WorkerPool.h"
+#include "HaloExchange.h"
 
 #include "Pointer.h"
 #include <vector>
@@ -40,10 +42,57 @@ public:
     const std::vector<UpdateEquationPtr> materials() const
         { return mMaterials; }
     
+    // used by GridScheduler to find links between grids
+    const std::vector<HuygensSurfacePtr> & huygensSurfaces() const
+        { return mHuygensSurfaces; }
+    
     // instruct all materials and outputs to allocate space for extra fields
     // and accumulation variables (e.g. for output interpolation, currents...)
     void allocateAuxBuffers();
     
+    // share the material updates among the threads of the pool.  Call after
+    // allocateAuxBuffers() and before the first timestep.
+    void setWorkerPool(WorkerPoolPtr pool);
+    
+    // update the grid a slab at a time, with all materials and components of
+    // one slab done together so its fields stay in cache.  Slabs hold about
+    // tileBytes of fields each; zero turns tiling off.  Call after
+    // allocateAuxBuffers().  Timed updates still sweep the whole grid once
+    // per material.
+    void divideIntoTiles(long tileBytes);
+    int numTiles() const { return mNumTiles; }
+    
+    // temporal blocking: run up to maxTimesteps timesteps at a time through
+    // the grid a plane at a time, as a wavefront, over stretches where no
+    // source or output does anything.  The grid must be on one node, without
+    // Huygens surfaces or current sources, and all its materials must keep
+    // their runlines within planes; otherwise blocking stays off.  Replaces
+    // any division into tiles.  Call after setWorkerPool(), if at all.
+    void setUpTimeBlocks(int maxTimesteps);
+    int timeBlockTimesteps() const { return mTimeBlockTimesteps; }
+    
+    // returns        how many timesteps from firstTimestep on, up to
+    //                maxTimesteps and the block size, updateBlock() may run
+    //                without calling the sources and outputs (0 if blocking
+    //                is off)
+    long quietTimesteps(long firstTimestep, long maxTimesteps) const;
+    
+    // updateE() and updateH() of numTimesteps timesteps from firstTimestep
+    // on, in cache-sized waves.  The fields come out exactly as if updated
+    // one timestep at a time.
+    void updateBlock(long firstTimestep, long numTimesteps);
+    
+    // update Ex, Ey and Ez (and Hx, Hy and Hz) together wherever one
+    // material covers the same run of Yee cells in all three components.
+    void fuseRunlines();
+    
+    // when the grid is split among nodes, trade ghost cells with the
+    // neighbors at the end of sourceE() and sourceH().
+    void setHaloExchange(HaloExchangePtr exchange) { mHaloExchange = exchange; }
+    
+    // the half cells updated by this partition (without ghost cells)
+    const Rect3i & calcHalfCells() const { return mCalcHalfCells; }
+    
     // returns        cell size in meters (same for all grids, all partitions)
     Vector3f dxyz() const { return m_dxyz; }
     
@@ -72,11 +121,24 @@ public:
     void printPerformanceForMatlab(std::ostream & str, std::string prefix);
     
 private:
+    bool isQuiet(long timestep) const;
+    
+    // E or H of every material in the given planes, counting modulo the
+    // number of planes so the bands of updateBlock() can wrap around.
+    void calcPlanesE(long firstPlane, long lastPlane);
+    void calcPlanesH(long firstPlane, long lastPlane);
+    
+    // the two stages of updateBlock(); see the .cpp
+    void calcSegment(int segment, int numTimesteps);
+    void calcSeam(int segment, int numTimesteps);
+    friend class TimeBlockTask;
+    
     const GridDescPtr mGridDescription;
     
     Vector3f m_dxyz;
     float m_dt;
     long m_numT;
+    Rect3i mCalcHalfCells;
     
     std::vector<UpdateEquationPtr> mMaterials;
     std::vector<OutputPtr> mOutputs;
@@ -88,6 +150,11 @@ private:
     PartitionStatistics mStatistics;
     
     InterleavedLatticePtr mLattice;
+    WorkerPoolPtr mWorkerPool;
+    HaloExchangePtr mHaloExchange;
+    int mNumTiles;
+    int mTimeBlockTimesteps; // 0: no temporal blocking
+    int mNumSegments; // slabs updated side by side in a block
 };
 typedef Pointer<CalculationPartition> CalculationPartitionPtr;
 
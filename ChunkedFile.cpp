@@ -0,0 +1,424 @@
+/*
+ *  ChunkedFile.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "ChunkedFile.h"
+#include "LZCodec.h"
+#include "Exception.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+
+using namespace std;
+
+static const char FILE_MAGIC[] = "TROGCHK1";
+static const char INDEX_MAGIC[] = "TROGIDX1";
+static const int MAGIC_BYTES = 8;
+static const long MIN_ARRAY_VALUES = 256;
+
+typedef unsigned int uint32;
+typedef unsigned long long uint64;
+
+static void
+write32(ostream & str, long value)
+{
+    uint32 v = (uint32)value;
+    str.write((const char*)&v, sizeof(v));
+}
+
+static void
+write64(ostream & str, long value)
+{
+    uint64 v = (uint64)value;
+    str.write((const char*)&v, sizeof(v));
+}
+
+static long
+read32(istream & str)
+{
+    uint32 v = 0;
+    str.read((char*)&v, sizeof(v));
+    return (long)v;
+}
+
+static long
+read64(istream & str)
+{
+    uint64 v = 0;
+    str.read((char*)&v, sizeof(v));
+    return (long)v;
+}
+
+#pragma mark *** Writer ***
+
+const long ChunkedFileWriter::DEFAULT_CHUNK_LENGTH;
+
+ChunkedFileWriter::
+ChunkedFileWriter(const string & fileName, const string & metadata,
+    long chunkLength) :
+    mChunkLength(chunkLength),
+    mErrorBound(0.0),
+    mIsErrorBoundRelative(0),
+    mRawBytes(0),
+    mStoredBytes(0),
+    mMaxError(0.0)
+{
+    assert(mChunkLength > 0);
+    mFile.open(fileName.c_str(), ios::out | ios::binary);
+    if (!mFile.good())
+        throw(Exception(string("Could not open output file ") + fileName));
+
+    mFile.write(FILE_MAGIC, MAGIC_BYTES);
+    write32(mFile, metadata.size());
+    mFile.write(metadata.c_str(), metadata.size());
+    write32(mFile, mChunkLength);
+
+    mShuffled.resize(mChunkLength*sizeof(float));
+    mCompressed.resize(max(
+        LZCodec::maxCompressedBytes(mChunkLength*sizeof(float)),
+        ErrorBoundedCodec::maxCompressedBytes(mChunkLength)));
+}
+
+ChunkedFileWriter::
+~ChunkedFileWriter()
+{
+    writeIndex();
+    mFile.close();
+}
+
+void ChunkedFileWriter::
+setErrorBound(double errorBound, bool isRelative)
+{
+    assert(errorBound >= 0);
+    mErrorBound = errorBound;
+    mIsErrorBoundRelative = isRelative;
+}
+
+void ChunkedFileWriter::
+setArrays(const vector<Vector3i> & arraySizes)
+{
+    mArraySizes = arraySizes;
+}
+
+void ChunkedFileWriter::
+writeSample(const float* values, long count)
+{
+    long sample = mSampleLength.size();
+    mSampleFirstChunk.push_back(mChunkOffsets.size());
+    mSampleLength.push_back(count);
+
+    double errorBound = mErrorBound;
+    if (mIsErrorBoundRelative)
+    {
+        float lo = FLT_MAX, hi = -FLT_MAX;
+        for (long nn = 0; nn < count; nn++)
+        {
+            lo = min(lo, values[nn]);
+            hi = max(hi, values[nn]);
+        }
+        if (hi > lo && hi <= FLT_MAX && lo >= -FLT_MAX)
+            errorBound = mErrorBound*((double)hi - lo);
+        else
+            errorBound = 0.0;
+    }
+
+    long arrayValues = 0;
+    for (int aa = 0; aa < mArraySizes.size(); aa++)
+        arrayValues += mArraySizes[aa][0]*mArraySizes[aa][1]*
+            mArraySizes[aa][2];
+    bool useArrays = arrayValues > 0 && count % arrayValues == 0 &&
+        arrayValues >= MIN_ARRAY_VALUES*mArraySizes.size();
+
+    for (long first = 0; first < count; first += mChunkLength)
+    {
+        long length = min(mChunkLength, count - first);
+        mSegments.clear();
+        if (!useArrays)
+            mSegments.push_back(ErrorBoundedCodec::Segment(length, count,
+                count, first));
+        else
+        {
+            // Cut [first, first+length) at the array boundaries.
+            long arrayStart = (first/arrayValues)*arrayValues;
+            for (int aa = 0; arrayStart < first + length;
+                aa = (aa+1)%mArraySizes.size())
+            {
+                const Vector3i & size = mArraySizes[aa];
+                long arrayEnd = arrayStart + size[0]*size[1]*size[2];
+                long lo = max(first, arrayStart);
+                long hi = min(first + length, arrayEnd);
+                if (lo < hi)
+                    mSegments.push_back(ErrorBoundedCodec::Segment(hi - lo,
+                        size[0], size[0]*size[1], lo - arrayStart));
+                arrayStart = arrayEnd;
+            }
+        }
+        writeChunk(sample, values + first, length, errorBound);
+    }
+}
+
+void ChunkedFileWriter::
+writeChunk(long sample, const float* values, long count, double errorBound)
+{
+    long rawBytes = count*sizeof(float);
+    long compressedBytes = 0;
+    Codec codec = kShuffleLZ;
+    double maxError = 0.0;
+
+    // A sample with a relative bound and one value all through is stored
+    // exactly; it compresses to nothing anyway.
+    if (errorBound > 0)
+    {
+        long maxBytes = ErrorBoundedCodec::maxCompressedBytes(count,
+            mSegments.size());
+        if (mCompressed.size() < maxBytes)
+            mCompressed.resize(maxBytes);
+        compressedBytes = ErrorBoundedCodec::compress(values, mSegments,
+            errorBound, &mCompressed[0], rawBytes - 1, maxError);
+        codec = kErrorBounded;
+    }
+    if (compressedBytes == 0)
+    {
+        LZCodec::shuffle((const unsigned char*)values, count, sizeof(float),
+            &mShuffled[0]);
+        compressedBytes = LZCodec::compress(&mShuffled[0], rawBytes,
+            &mCompressed[0], rawBytes - 1);
+        codec = kShuffleLZ;
+        maxError = 0.0;
+    }
+
+    mChunkOffsets.push_back(mFile.tellp());
+    write32(mFile, sample);
+    write32(mFile, count);
+    if (compressedBytes > 0)
+    {
+        write32(mFile, compressedBytes);
+        write32(mFile, codec);
+        mFile.write((const char*)&mCompressed[0], compressedBytes);
+        mStoredBytes += compressedBytes;
+        mMaxError = max(mMaxError, maxError);
+    }
+    else
+    {
+        write32(mFile, rawBytes);
+        write32(mFile, kStored);
+        mFile.write((const char*)values, rawBytes);
+        mStoredBytes += rawBytes;
+    }
+    mRawBytes += rawBytes;
+}
+
+void ChunkedFileWriter::
+writeIndex()
+{
+    long indexOffset = mFile.tellp();
+
+    write64(mFile, mSampleLength.size());
+    for (long nn = 0; nn < mSampleLength.size(); nn++)
+    {
+        write64(mFile, mSampleFirstChunk[nn]);
+        write64(mFile, mSampleLength[nn]);
+    }
+    write64(mFile, mChunkOffsets.size());
+    for (long nn = 0; nn < mChunkOffsets.size(); nn++)
+        write64(mFile, mChunkOffsets[nn]);
+
+    write64(mFile, indexOffset);
+    mFile.write(INDEX_MAGIC, MAGIC_BYTES);
+}
+
+#pragma mark *** Reader ***
+
+ChunkedFileReader::
+ChunkedFileReader(const string & fileName)
+{
+    mFile.open(fileName.c_str(), ios::in | ios::binary);
+    if (!mFile.good())
+        throw(Exception(string("Could not open ") + fileName));
+
+    char magic[MAGIC_BYTES];
+    mFile.read(magic, MAGIC_BYTES);
+    if (!mFile.good() || memcmp(magic, FILE_MAGIC, MAGIC_BYTES) != 0)
+        throw(Exception(fileName + " is not a chunked output file."));
+
+    long metadataBytes = read32(mFile);
+    mMetadata.resize(metadataBytes);
+    if (metadataBytes > 0)
+        mFile.read(&mMetadata[0], metadataBytes);
+    mChunkLength = read32(mFile);
+    if (!mFile.good())
+        throw(Exception(fileName + " is truncated."));
+
+    long firstChunkOffset = mFile.tellg();
+    if (!readIndex())
+        scanChunks(firstChunkOffset);
+}
+
+bool ChunkedFileReader::
+isChunkedFile(const string & fileName)
+{
+    ifstream file(fileName.c_str(), ios::in | ios::binary);
+    char magic[MAGIC_BYTES];
+    file.read(magic, MAGIC_BYTES);
+    return file.good() && memcmp(magic, FILE_MAGIC, MAGIC_BYTES) == 0;
+}
+
+bool ChunkedFileReader::
+readIndex()
+{
+    char magic[MAGIC_BYTES];
+    mFile.seekg(-(long)(sizeof(uint64) + MAGIC_BYTES), ios::end);
+    long indexOffset = read64(mFile);
+    mFile.read(magic, MAGIC_BYTES);
+    if (!mFile.good() || memcmp(magic, INDEX_MAGIC, MAGIC_BYTES) != 0)
+    {
+        mFile.clear();
+        return 0;
+    }
+
+    mFile.seekg(indexOffset);
+    long numSamples = read64(mFile);
+    mSampleFirstChunk.resize(numSamples);
+    mSampleLength.resize(numSamples);
+    for (long nn = 0; nn < numSamples; nn++)
+    {
+        mSampleFirstChunk[nn] = read64(mFile);
+        mSampleLength[nn] = read64(mFile);
+    }
+    long numChunks = read64(mFile);
+    mChunkOffsets.resize(numChunks);
+    for (long nn = 0; nn < numChunks; nn++)
+        mChunkOffsets[nn] = read64(mFile);
+
+    if (!mFile.good())
+        throw(Exception("Chunked output file has a bad index."));
+    return 1;
+}
+
+void ChunkedFileReader::
+scanChunks(long firstChunkOffset)
+{
+    // Walk the chunk headers until the end of the file or a chunk that was
+    // cut off when the run stopped.
+    mFile.seekg(0, ios::end);
+    long fileBytes = mFile.tellg();
+    long offset = firstChunkOffset;
+
+    while (offset + 4*sizeof(uint32) <= fileBytes)
+    {
+        mFile.seekg(offset);
+        long sample = read32(mFile);
+        long numValues = read32(mFile);
+        long storedBytes = read32(mFile);
+        read32(mFile); // codec
+        long next = offset + 4*sizeof(uint32) + storedBytes;
+        if (!mFile.good() || next > fileBytes ||
+            sample + 1 < (long)mSampleLength.size())
+            break;
+
+        // Empty samples have no chunks, so sample numbers can skip ahead.
+        while (sample >= (long)mSampleLength.size())
+        {
+            mSampleFirstChunk.push_back(mChunkOffsets.size());
+            mSampleLength.push_back(0);
+        }
+        mSampleLength[sample] += numValues;
+        mChunkOffsets.push_back(offset);
+        offset = next;
+    }
+    mFile.clear();
+
+    // Without the index there's no telling whether the last sample got all
+    // its chunks, so leave it out.
+    if (mSampleLength.size() > 0)
+    {
+        mChunkOffsets.resize(mSampleFirstChunk.back());
+        mSampleFirstChunk.pop_back();
+        mSampleLength.pop_back();
+    }
+}
+
+void ChunkedFileReader::
+read(long sample, long first, long count, vector<float> & values)
+{
+    if (sample < 0 || sample >= numSamples() || first < 0 ||
+        first + count > mSampleLength[sample])
+        throw(Exception("Chunked file read out of range."));
+
+    values.resize(count);
+    vector<float> chunkValues;
+    long chunk = mSampleFirstChunk[sample] + first/mChunkLength;
+    long chunkStart = (first/mChunkLength)*mChunkLength;
+    long done = 0;
+    while (done < count)
+    {
+        readChunk(chunk, chunkValues);
+        long from = first + done - chunkStart;
+        long num = min((long)chunkValues.size() - from, count - done);
+        copy(chunkValues.begin() + from, chunkValues.begin() + from + num,
+            values.begin() + done);
+        done += num;
+        chunk++;
+        chunkStart += mChunkLength;
+    }
+}
+
+void ChunkedFileReader::
+readSample(long sample, vector<float> & values)
+{
+    read(sample, 0, sampleLength(sample), values);
+}
+
+void ChunkedFileReader::
+readChunk(long chunk, vector<float> & values)
+{
+    mFile.seekg(mChunkOffsets.at(chunk));
+    ChunkHeader header;
+    header.sample = read32(mFile);
+    header.numValues = read32(mFile);
+    header.storedBytes = read32(mFile);
+    header.codec = read32(mFile);
+
+    long rawBytes = header.numValues*sizeof(float);
+    values.resize(header.numValues);
+    if (header.numValues == 0)
+        return;
+
+    if (header.codec == ChunkedFileWriter::kStored)
+    {
+        if (header.storedBytes != rawBytes)
+            throw(Exception("Chunked file has a bad chunk."));
+        mFile.read((char*)&values[0], rawBytes);
+    }
+    else if (header.codec == ChunkedFileWriter::kShuffleLZ)
+    {
+        mStored.resize(header.storedBytes);
+        mShuffled.resize(rawBytes);
+        mFile.read((char*)&mStored[0], header.storedBytes);
+        if (!mFile.good() || !LZCodec::decompress(&mStored[0],
+            header.storedBytes, &mShuffled[0], rawBytes))
+            throw(Exception("Chunked file has a bad chunk."));
+        LZCodec::unshuffle(&mShuffled[0], header.numValues, sizeof(float),
+            (unsigned char*)&values[0]);
+    }
+    else if (header.codec == ChunkedFileWriter::kErrorBounded)
+    {
+        mStored.resize(header.storedBytes);
+        mFile.read((char*)&mStored[0], header.storedBytes);
+        if (!mFile.good() || !ErrorBoundedCodec::decompress(&mStored[0],
+            header.storedBytes, &values[0], header.numValues))
+            throw(Exception("Chunked file has a bad chunk."));
+    }
+    else
+        throw(Exception("Chunked file uses an unknown codec."));
+
+    if (!mFile.good())
+        throw(Exception("Could not read chunked file."));
+}
+
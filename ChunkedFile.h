@@ -0,0 +1,178 @@
+/*
+ *  ChunkedFile.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _CHUNKEDFILE_
+#define _CHUNKEDFILE_
+
+#include "Pointer.h"
+#include "geometry.h"
+#include "ErrorBoundedCodec.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Self-describing, compressed container for output data.  An output writes
+// one sample (all its floats for one timestep) at a time; each sample is cut
+// into chunks of at most chunkLength floats, and each chunk is compressed on
+// its own so a reader can pull out any timestep, or any part of one, without
+// decompressing the rest.
+//
+// Layout, all integers in the machine's byte order like the floats:
+//
+//      "TROGCHK1"
+//      uint32 metadata bytes, metadata text (the output's spec file)
+//      uint32 chunk length
+//      chunks, each:
+//          uint32 sample, uint32 floats, uint32 stored bytes, uint32 codec
+//          stored bytes of data
+//      index:
+//          uint64 number of samples, then per sample uint64 first chunk and
+//              uint64 floats
+//          uint64 number of chunks, then per chunk uint64 file offset
+//      uint64 index offset, "TROGIDX1"
+//
+// With an error bound set, chunks are stored lossily by ErrorBoundedCodec,
+// which predicts each value from its neighbors in the 3D arrays given to
+// setArrays(); the reader needs nothing extra to read them back.
+//
+// The index is written when the file is closed.  If a run dies before that,
+// ChunkedFileReader rebuilds it from the chunk headers, dropping the last
+// sample since it may be incomplete.
+
+/**
+ * Writes a chunked container.  Not thread-safe; AsyncFileWriter calls it from
+ * its writer thread.
+ */
+class ChunkedFileWriter
+{
+public:
+    // How each chunk is stored.
+    enum Codec
+    {
+        kStored = 0,        // raw floats
+        kShuffleLZ = 1,     // LZCodec::shuffle, then LZCodec::compress
+        kErrorBounded = 2   // ErrorBoundedCodec::compress
+    };
+
+    static const long DEFAULT_CHUNK_LENGTH = 65536;
+
+    ChunkedFileWriter(const std::string & fileName,
+        const std::string & metadata,
+        long chunkLength = DEFAULT_CHUNK_LENGTH);
+
+    /**
+     * Writes the index and closes the file.
+     */
+    ~ChunkedFileWriter();
+
+    /**
+     * Store samples written from now on with error at most errorBound.  A
+     * relative bound is a fraction of each sample's range of values (max -
+     * min).  Zero, the default, stores samples exactly.
+     */
+    void setErrorBound(double errorBound, bool isRelative);
+
+    /**
+     * Each sample is these arrays one after the other, each stored x
+     * fastest, repeated (e.g. once per field component).  Only used to
+     * predict values for lossy storage.  Samples that aren't made of these
+     * arrays, or whose arrays are too small to be worth describing, are
+     * treated as one long row.
+     */
+    void setArrays(const std::vector<Vector3i> & arraySizes);
+
+    void writeSample(const float* values, long count);
+
+    bool good() const { return mFile.good(); }
+    long rawBytes() const { return mRawBytes; }
+    long storedBytes() const { return mStoredBytes; }
+
+    /**
+     * @returns the largest error of any value written so far
+     */
+    double maxError() const { return mMaxError; }
+
+private:
+    void writeChunk(long sample, const float* values, long count,
+        double errorBound);
+    void writeIndex();
+
+    std::ofstream mFile;
+    long mChunkLength;
+    double mErrorBound;
+    bool mIsErrorBoundRelative;
+    std::vector<Vector3i> mArraySizes;
+    std::vector<long> mSampleFirstChunk;
+    std::vector<long> mSampleLength;
+    std::vector<long> mChunkOffsets;
+    std::vector<ErrorBoundedCodec::Segment> mSegments;
+    std::vector<unsigned char> mShuffled;
+    std::vector<unsigned char> mCompressed;
+    long mRawBytes;
+    long mStoredBytes;
+    double mMaxError;
+};
+typedef Pointer<ChunkedFileWriter> ChunkedFileWriterPtr;
+
+/**
+ * Random access to the samples of a chunked container.
+ */
+class ChunkedFileReader
+{
+public:
+    ChunkedFileReader(const std::string & fileName);
+
+    /**
+     * @returns true if the file starts like a chunked container
+     */
+    static bool isChunkedFile(const std::string & fileName);
+
+    const std::string & metadata() const { return mMetadata; }
+    long chunkLength() const { return mChunkLength; }
+    long numSamples() const { return mSampleLength.size(); }
+    long sampleLength(long sample) const { return mSampleLength.at(sample); }
+
+    /**
+     * Replace values with floats [first, first+count) of the given sample.
+     * Only the chunks holding those floats are read and decompressed.
+     */
+    void read(long sample, long first, long count, std::vector<float> & values);
+
+    /**
+     * Replace values with the whole sample.
+     */
+    void readSample(long sample, std::vector<float> & values);
+
+private:
+    struct ChunkHeader
+    {
+        unsigned int sample;
+        unsigned int numValues;
+        unsigned int storedBytes;
+        unsigned int codec;
+    };
+
+    bool readIndex();
+    void scanChunks(long firstChunkOffset);
+    void readChunk(long chunk, std::vector<float> & values);
+
+    std::ifstream mFile;
+    std::string mMetadata;
+    long mChunkLength;
+    std::vector<long> mSampleFirstChunk;
+    std::vector<long> mSampleLength;
+    std::vector<long> mChunkOffsets;
+    std::vector<unsigned char> mStored;
+    std::vector<unsigned char> mShuffled;
+};
+typedef Pointer<ChunkedFileReader> ChunkedFileReaderPtr;
+
+
+
+#endif
@@ -17,6 +17,7 @@
 
 #include "YeeUtilities.h"
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -74,8 +75,8 @@ CurrentPolarizationSetupOutput(const OutputDescPtr & desc,
     assert(desc->regions().size() > 0);
     for (int rr = 0; rr < desc->regions().size(); rr++)
     {
-        Rect3i yeeCells(clip(desc->regions()[rr].yeeCells(),
-            vp.gridYeeCells()));
+        Rect3i yeeCells(intersection(desc->regions()[rr].yeeCells(),
+            vp.calcYeeCells()));
         
         for (int direction = 0; direction < 3; direction++)
         {
@@ -128,7 +129,7 @@ CurrentPolarizationOutput(OutputDescPtr description,
     const VoxelizedPartition & vp,
     const CalculationPartition & cp) :
     Output(description),
-    mDatafile(),
+    mSampleStream(ios::out | ios::binary),
     mCurrentSampleInterval(0),
     mWhichJ(description->whichJ()),
     mWhichP(description->whichP()),
@@ -143,9 +144,10 @@ CurrentPolarizationOutput(OutputDescPtr description,
     assert(description->regions().size() > 0);
     for (int rr = 0; rr < description->regions().size(); rr++)
     {
-        Rect3i outRect(clip(description->regions()[rr].yeeCells(),
-            vp.gridYeeCells()));        
-        mRegions.push_back(Region(outRect,description->regions()[rr].stride()));
+        Region outRegion(description->regions()[rr].within(
+            vp.calcYeeCells()));
+        if (!outRegion.isEmpty())
+            mRegions.push_back(outRegion);
     }
     LOGF << "Truncating durations to simulation duration.  This is in the "
         "wrong place; can't it be done earlier?\n";
@@ -161,13 +163,15 @@ CurrentPolarizationOutput(OutputDescPtr description,
     IODescriptionFile::write(specfile, description, vp, mRegions, mDurations);
     //writeDescriptionFile(vp, cp, specfile, datafile, materialfile);
     
-    mDatafile.open(datafile.c_str(), ios::out | ios::binary);
+    ostringstream spec;
+    IODescriptionFile::write(spec, specfile, description, vp, mRegions,
+        mDurations);
+    mWriter = openDataFile(datafile, spec.str());
 }
 
 CurrentPolarizationOutput::
 ~CurrentPolarizationOutput()
 {
-    mDatafile.close();
 }
 
 
@@ -262,15 +266,15 @@ writeJ(const CalculationPartition & cp)
         {
             for (int rr = 0; rr < mRunlinesE[outDir].size(); rr++)
             {
-                mRunlinesE[outDir][rr].material->writeJ(outDir, mDatafile,
+                mRunlinesE[outDir][rr].material->writeJ(outDir,
+                    mSampleStream,
                     mRunlinesE[outDir][rr].startingIndex,
                     mRunlinesE[outDir][rr].startingField,
                     mRunlinesE[outDir][rr].length);
             }
         }
     }
-    assert(mDatafile.good());
-    mDatafile << flush;
+    endSample();
 }
 
 void CurrentPolarizationOutput::
@@ -282,15 +286,29 @@ writeK(const CalculationPartition & cp)
         {
             for (int rr = 0; rr < mRunlinesE[outDir].size(); rr++)
             {
-                mRunlinesH[outDir][rr].material->writeK(outDir, mDatafile,
+                mRunlinesH[outDir][rr].material->writeK(outDir,
+                    mSampleStream,
                     mRunlinesH[outDir][rr].startingIndex,
                     mRunlinesH[outDir][rr].startingField,
                     mRunlinesH[outDir][rr].length);
             }
         }
     }
-    assert(mDatafile.good());
-    mDatafile << flush;
+    endSample();
+}
+
+void CurrentPolarizationOutput::
+endSample()
+{
+    // Hand the floats the materials wrote over to the file writer.
+    string bytes(mSampleStream.str());
+    mSampleStream.str("");
+    
+    vector<float> & sample(mWriter->beginSample());
+    sample.resize(bytes.size()/sizeof(float));
+    if (sample.size() > 0)
+        memcpy(&sample[0], bytes.data(), sample.size()*sizeof(float));
+    mWriter->endSample();
 }
 
 /*
@@ -16,7 +16,7 @@
 #include "MemoryUtilities.h"
 #include "geometry.h"
 #include <vector>
-#include <fstream>
+#include <sstream>
 
 class UpdateEquation;
 class VoxelizedPartition;
@@ -48,7 +48,7 @@ struct CPOutputRunline
 {
     UpdateEquation* material;
     long startingIndex;
-    float* startingField;
+    FieldStorage* startingField;
     long length;
 };
 
@@ -71,13 +71,15 @@ public:
 private:
     void writeJ(const CalculationPartition & cp);
     void writeK(const CalculationPartition & cp);
+    void endSample();
     /*
     void writeDescriptionFile(const VoxelizedPartition & vp,
         const CalculationPartition & cp,
         std::string specfile, std::string datafile, std::string materialfile)
         const;
     */
-    std::ofstream mDatafile;
+    AsyncFileWriterPtr mWriter;
+    std::ostringstream mSampleStream; // the materials write to a stream
     long mCurrentSampleInterval;
     
     Vector3i mWhichJ;
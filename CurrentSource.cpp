@@ -185,13 +185,15 @@ makeCurrentSource(const VoxelizedPartition & vp,
     const CalculationPartition & cp) const
 {
     return Pointer<CurrentSource>(new CurrentSource(mDescription,
-        mMaterialIDs, mNumCellsJ, mNumCellsK));
+        mMaterialIDs, mNumCellsJ, mNumCellsK, mRectsJ, mRectsK, vp, cp));
 }
 
 CurrentSource::
 CurrentSource(const CurrentSourceDescPtr & description,
     const vector<long> & materialIDs, const vector<Vector3i> & numCellsJ,
-    const vector<Vector3i> & numCellsK) :
+    const vector<Vector3i> & numCellsK, const vector<vector<Rect3i> > & rectsJ,
+    const vector<vector<Rect3i> > & rectsK, const VoxelizedPartition & vp,
+    const CalculationPartition & cp) :
     mDescription(description),
     mFieldInput(description),
     mMaterialIDs(materialIDs),
@@ -223,6 +225,10 @@ CurrentSource(const CurrentSourceDescPtr & description,
             offset += numCellsK[nn][xyz];
         }
     }
+    
+    mFieldInput.precomputeWaveform(cp.duration(), cp.dt());
+    mFieldInput.setCells(rectsJ, rectsK, vp.gridDescription()->originYee(),
+        vp.gridDescription()->dxyz());
 }
 
 CurrentSource::
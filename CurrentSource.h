@@ -128,11 +128,20 @@ public:
      *                      Jy and Jz; must be the same length as materialIDs
      *  @param numCellsK    the amount of the buffer for each material for Kx,
      *                      Ky and Kz; must be the same length as materialIDs
+     *  @param rectsJ       the cells of the Jx, Jy and Jz buffers in order,
+     *                      for formulas that depend on position
+     *  @param rectsK       the cells of the Kx, Ky and Kz buffers in order
+     *  @param vp           the grid, for the cell positions
+     *  @param cp           the grid, for the timestep and duration
      */
     CurrentSource(const CurrentSourceDescPtr & description,
         const std::vector<long> & materialIDs,
         const std::vector<Vector3i> & numCellsJ,
-        const std::vector<Vector3i> & numCellsK);
+        const std::vector<Vector3i> & numCellsK,
+        const std::vector<std::vector<Rect3i> > & rectsJ,
+        const std::vector<std::vector<Rect3i> > & rectsK,
+        const VoxelizedPartition & vp,
+        const CalculationPartition & cp);
     virtual ~CurrentSource();
     
     /**
@@ -144,6 +153,13 @@ public:
     void allocateAuxBuffers();
     
     CurrentSourceDescPtr description() const { return mDescription; }
+    
+    /**
+     *  @returns true if the buffers hold a value per cell (space-time data
+     *  files and formulas that use position), false if they hold one value
+     */
+    bool isSpaceVarying() const { return mFieldInput.isSpaceVarying(); }
+    
     BufferPointer pointerJ(int direction, long materialID);
     BufferPointer pointerK(int direction, long materialID);
     BufferPointer pointerMaskJ(int direction, long materialID);
@@ -151,6 +167,12 @@ public:
     
     void prepareJ(long timestep, float time);
     void prepareK(long timestep, float time);
+    
+    /**
+     * Time spent so far waiting for source data to be read ahead.
+     */
+    double inputStallMicroseconds() const
+        { return mFieldInput.stallMicroseconds(); }
 private:
     CurrentSourceDescPtr mDescription;
     BufferedFieldInput mFieldInput;
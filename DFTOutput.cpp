@@ -0,0 +1,235 @@
+/*
+ *  DFTOutput.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "DFTOutput.h"
+#include "SimulationDescription.h"
+#include "CalculationPartition.h"
+#include "VoxelizedPartition.h"
+#include "InterleavedLattice.h"
+#include "IODescriptionFile.h"
+#include "VectorKernels.h"
+#include <cmath>
+#include <sstream>
+
+using namespace std;
+
+#pragma mark *** Delegate ***
+
+DFTSetupOutput::
+DFTSetupOutput(const OutputDescPtr & desc) :
+    SetupOutput(desc)
+{
+}
+
+OutputPtr DFTSetupOutput::
+makeOutput(const VoxelizedPartition & vp, const CalculationPartition & cp)
+    const
+{
+    return OutputPtr(new DFTOutput(description(), vp, cp));
+}
+
+#pragma mark *** Output ***
+
+DFTOutput::
+DFTOutput(OutputDescPtr description,
+    const VoxelizedPartition & vp,
+    const CalculationPartition & cp) :
+    Output(description),
+    mCurrentSampleInterval(0),
+    mDt(cp.dt()),
+    mDurations(description->durations()),
+    mFrequencies(description->frequencies())
+{
+    assert(description->regions().size() > 0);
+    assert(mFrequencies.size() > 0);
+
+    // Clip the regions to the calc bounds, as SimpleEHOutput does.
+    long valuesPerField = 0;
+    vector<Vector3i> arraySizes;
+    for (int rr = 0; rr < description->regions().size(); rr++)
+    {
+        Region outRegion(description->regions()[rr].within(
+            vp.calcYeeCells()));
+        if (outRegion.isEmpty())
+            continue;
+        Rect3i outRect(outRegion.yeeCells());
+        Vector3i stride(outRegion.stride());
+        mRegions.push_back(outRegion);
+
+        Vector3i count((outRect.num(0)+stride[0]-1)/stride[0],
+            (outRect.num(1)+stride[1]-1)/stride[1],
+            (outRect.num(2)+stride[2]-1)/stride[2]);
+        valuesPerField += count[0]*count[1]*count[2];
+        arraySizes.push_back(count);
+    }
+    int numTimesteps = cp.duration();
+    for (int dd = 0; dd < mDurations.size(); dd++)
+    if (mDurations[dd].last() > (numTimesteps-1))
+        mDurations[dd].setLast(numTimesteps-1);
+
+    long numE = norm2(description->whichE())*valuesPerField;
+    long numH = norm2(description->whichH())*valuesPerField;
+    mRealE.resize(numE*mFrequencies.size(), 0.0);
+    mImagE.resize(numE*mFrequencies.size(), 0.0);
+    mRealH.resize(numH*mFrequencies.size(), 0.0);
+    mImagH.resize(numH*mFrequencies.size(), 0.0);
+
+    string specfile(description->file() + string(".txt"));
+    string datafile(description->file());
+
+    IODescriptionFile::write(specfile, description, vp, mRegions, mDurations);
+
+    ostringstream spec;
+    IODescriptionFile::write(spec, specfile, description, vp, mRegions,
+        mDurations);
+    mWriter = openDataFile(datafile, spec.str());
+    if (mWriter->chunkedFile() != 0L)
+        mWriter->chunkedFile()->setArrays(arraySizes);
+}
+
+DFTOutput::
+~DFTOutput()
+{
+    writeData();
+}
+
+void DFTOutput::
+outputEPhase(const CalculationPartition & cp, long timestep)
+{
+    if (norm2(description()->whichE()) == 0)
+        return;
+    if (isSampled(timestep))
+    {
+        gatherE(cp);
+        accumulate(timestep*mDt, mRealE, mImagE);
+    }
+}
+
+void DFTOutput::
+outputHPhase(const CalculationPartition & cp, long timestep)
+{
+    if (norm2(description()->whichH()) == 0)
+        return;
+    if (isSampled(timestep))
+    {
+        gatherH(cp);
+        accumulate((timestep + 0.5)*mDt, mRealH, mImagH);
+    }
+}
+
+bool DFTOutput::
+isSampled(long timestep)
+{
+    if (mCurrentSampleInterval >= mDurations.size())
+        return 0;
+    while (timestep > mDurations[mCurrentSampleInterval].last())
+    {
+        mCurrentSampleInterval++;
+        if (mCurrentSampleInterval >= mDurations.size())
+            return 0;
+    }
+
+    int firstT = mDurations[mCurrentSampleInterval].first();
+    int period = mDurations[mCurrentSampleInterval].period();
+
+    return (timestep >= firstT && (timestep - firstT)%period == 0);
+}
+
+void DFTOutput::
+gatherE(const CalculationPartition & cp)
+{
+    const InterleavedLattice & lattice(cp.lattice());
+    Vector3f interpPoint = description()->interpolationPoint();
+
+    mSample.clear();
+    for (int outDir = 0; outDir < 3; outDir++)
+    if (description()->whichE()[outDir] != 0)
+    for (unsigned int rr = 0; rr < mRegions.size(); rr++)
+    {
+        if (!description()->isInterpolated())
+            lattice.gatherE(outDir, mRegions[rr].yeeCells(),
+                mRegions[rr].stride(), mSample);
+        else
+            lattice.gatherInterpolatedE(outDir, mRegions[rr].yeeCells(),
+                mRegions[rr].stride(), interpPoint, mSample);
+    }
+}
+
+void DFTOutput::
+gatherH(const CalculationPartition & cp)
+{
+    const InterleavedLattice & lattice(cp.lattice());
+    Vector3f interpPoint = description()->interpolationPoint();
+
+    mSample.clear();
+    for (int outDir = 0; outDir < 3; outDir++)
+    if (description()->whichH()[outDir] != 0)
+    for (unsigned int rr = 0; rr < mRegions.size(); rr++)
+    {
+        if (!description()->isInterpolated())
+            lattice.gatherH(outDir, mRegions[rr].yeeCells(),
+                mRegions[rr].stride(), mSample);
+        else
+            lattice.gatherInterpolatedH(outDir, mRegions[rr].yeeCells(),
+                mRegions[rr].stride(), interpPoint, mSample);
+    }
+}
+
+void DFTOutput::
+accumulate(double time, vector<double> & real, vector<double> & imag)
+{
+    const long numValues = mSample.size();
+    const int numFrequencies = mFrequencies.size();
+    assert(real.size() == numValues*numFrequencies);
+    if (numValues == 0)
+        return;
+
+    double weight = mDt*mDurations[mCurrentSampleInterval].period();
+    vector<double> cosines(numFrequencies), sines(numFrequencies);
+    for (int ff = 0; ff < numFrequencies; ff++)
+    {
+        double phase = 2.0*M_PI*mFrequencies[ff]*time;
+        cosines[ff] = weight*cos(phase);
+        sines[ff] = -weight*sin(phase);
+    }
+
+    // Do all the frequencies for one block of values while it's in cache.
+    for (long first = 0; first < numValues;
+        first += VectorKernels::BLOCK_LENGTH)
+    {
+        int len = min((long)VectorKernels::BLOCK_LENGTH, numValues - first);
+        for (int ff = 0; ff < numFrequencies; ff++)
+            VectorKernels::dftAccumulate(&mSample[first], cosines[ff],
+                sines[ff], &real[ff*numValues + first],
+                &imag[ff*numValues + first], len);
+    }
+}
+
+void DFTOutput::
+writeData()
+{
+    const int numFrequencies = mFrequencies.size();
+    const long numE = mRealE.size()/numFrequencies;
+    const long numH = mRealH.size()/numFrequencies;
+
+    // The sums are written as float, like every other output.
+    for (int ff = 0; ff < numFrequencies; ff++)
+    {
+        vector<float> & sample(mWriter->beginSample());
+        sample.insert(sample.end(), mRealE.begin() + ff*numE,
+            mRealE.begin() + (ff+1)*numE);
+        sample.insert(sample.end(), mRealH.begin() + ff*numH,
+            mRealH.begin() + (ff+1)*numH);
+        sample.insert(sample.end(), mImagE.begin() + ff*numE,
+            mImagE.begin() + (ff+1)*numE);
+        sample.insert(sample.end(), mImagH.begin() + ff*numH,
+            mImagH.begin() + (ff+1)*numH);
+        mWriter->endSample();
+    }
+}
+
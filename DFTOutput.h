@@ -0,0 +1,80 @@
+/*
+ *  DFTOutput.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _DFTOUTPUT_
+#define _DFTOUTPUT_
+
+#include "SimulationDescription.h"
+#include "Output.h"
+#include "geometry.h"
+#include <vector>
+
+class DFTSetupOutput;
+typedef Pointer<DFTSetupOutput> DFTSetupOutputPtr;
+
+class DFTOutput;
+typedef Pointer<DFTOutput> DFTOutputPtr;
+
+class DFTSetupOutput : public SetupOutput
+{
+public:
+    DFTSetupOutput(const OutputDescPtr & desc);
+
+    virtual OutputPtr makeOutput(const VoxelizedPartition & vp,
+        const CalculationPartition & cp) const;
+};
+
+/**
+ * Frequency-domain E and H output.  Instead of writing every time sample,
+ * this keeps a running DFT of each field value at each of the description's
+ * frequencies,
+ *
+ *      X(f) = sum over sampled timesteps n of x(t_n) exp(-2 pi i f t_n) dt_n,
+ *
+ * where t_n is n*dt for E and (n + 1/2)*dt for H and dt_n is dt times the
+ * sampling period.  The durations choose the timesteps as usual.  Nothing is
+ * written until the output is destroyed at the end of the run; then each
+ * frequency is written as one sample, the real parts of all the fields and
+ * regions in the usual order and then the imaginary parts.
+ */
+class DFTOutput : public Output
+{
+public:
+    DFTOutput(OutputDescPtr description,
+        const VoxelizedPartition & vp,
+        const CalculationPartition & cp);
+    virtual ~DFTOutput();
+
+    virtual void outputEPhase(const CalculationPartition & cp, long timestep);
+    virtual void outputHPhase(const CalculationPartition & cp, long timestep);
+
+private:
+    bool isSampled(long timestep);
+    void gatherE(const CalculationPartition & cp);
+    void gatherH(const CalculationPartition & cp);
+    void accumulate(double time, std::vector<double> & real,
+        std::vector<double> & imag);
+    void writeData();
+
+    AsyncFileWriterPtr mWriter;
+    long mCurrentSampleInterval;
+    double mDt;
+
+    std::vector<Region> mRegions;
+    std::vector<Duration> mDurations;
+    std::vector<double> mFrequencies;
+
+    std::vector<float> mSample;
+    std::vector<double> mRealE; // [frequency][value]; float only when written
+    std::vector<double> mImagE;
+    std::vector<double> mRealH;
+    std::vector<double> mImagH;
+};
+
+
+#endif
@@ -28,6 +28,12 @@
 #include "Version.h"
 #include "STLOutput.h"
 #include "StructuralReports.h"
+#include "WorkerPool.h"
+#include "MemoryUtilities.h"
+#include "GridScheduler.h"
+#include "HaloExchange.h"
+#include "Output.h"
+#include "FilePrefetcher.h"
 
 #include <Magick++.h>
 
@@ -49,12 +55,24 @@ SimulationPreferences::
 SimulationPreferences()
 {
     numThreads = 1;
+    numNodes = Vector3i(1,1,1);
+    tileBytes = 0;
+    timeBlockTimesteps = 4;
+    fuseComponents = 0;
+    firstTouch = 0;
+    hugePages = 0;
+    alignFields = 0;
+    outputBuffers = 8;
+    chunkedOutput = 0;
+    prefetchRecords = 4;
+    prefetchBytes = 256*1024*1024;
     numTimestepsOverride = -1;
     output3D = 0;
     output2D = 0;
     dumpGrid = 0;
     runSim = 1;
     runlineDirection = 'x';
+    savePerformanceInfo = 0;
 }
 
 
@@ -66,9 +84,18 @@ runNew(string parameterFile, const SimulationPreferences & prefs)
 	Map<GridDescPtr, VoxelizedPartitionPtr> voxelizedGrids;
     Map<string, CalculationPartitionPtr> calculationGrids;
 	
+    if (prefs.numNodes[0]*prefs.numNodes[1]*prefs.numNodes[2] > 1)
+    {
+        LOGF << "Starting nodes..." << endl;
+        startNodes(prefs.numNodes);
+        LOGF << "Starting nodes done." << endl;
+    }
+    
     t0 = timeInMicroseconds();
     LOGF << "Loading simulation..." << endl;
 	SimulationDescPtr sim = loadSimulation(parameterFile);
+    if (mCommunicator != 0L)
+        renameOutputsForNode(sim);
     LOGF << "Loading simulation done." << endl;
     mNumT = sim->numTimesteps();
     t1 = timeInMicroseconds();
@@ -93,6 +120,12 @@ runNew(string parameterFile, const SimulationPreferences & prefs)
         throw(Exception("Bad fastaxis direction (should be x, y or z)."));
     if (prefs.numTimestepsOverride != -1)
         mNumT = prefs.numTimestepsOverride;
+    mNumThreads = prefs.numThreads;
+    InterleavedLattice::setAlignedLayout(prefs.alignFields);
+    
+    // Custom TFSF sources start reading ahead as soon as they are voxelized.
+    FilePrefetcher::setRecordsAhead(prefs.prefetchRecords);
+    FilePrefetcher::setMaxBytes(prefs.prefetchBytes);
     
     // this step includes making setup runlines
     LOGF << "Voxelizing grids..." << endl;
@@ -104,13 +137,17 @@ runNew(string parameterFile, const SimulationPreferences & prefs)
 	t1 = timeInMicroseconds();
     mPerformance.setVoxelizeMicroseconds(t1-t0);
     
-    LOGF << "Writing reports..." << endl;
-    writeReports(voxelizedGrids, prefs);
-    LOGF << "Writing reports done." << endl;
-    
-    LOGF << "Writing data requests..." << endl;
-    writeDataRequests(voxelizedGrids, prefs);
-    LOGF << "Writing data requests done." << endl;
+    // With many nodes, only the first one writes reports and data requests.
+    if (mCommunicator == 0L || mCommunicator->rank() == 0)
+    {
+        LOGF << "Writing reports..." << endl;
+        writeReports(voxelizedGrids, prefs);
+        LOGF << "Writing reports done." << endl;
+        
+        LOGF << "Writing data requests..." << endl;
+        writeDataRequests(voxelizedGrids, prefs);
+        LOGF << "Writing data requests done." << endl;
+    }
     
     if (prefs.runSim == 0)
     {
@@ -121,6 +158,7 @@ runNew(string parameterFile, const SimulationPreferences & prefs)
             reportPerformance(calculationGrids);
             LOGF << "Reporting performance done." << endl;
         }
+        mCommunicator = 0L;
         return;
     }
     
@@ -129,6 +167,22 @@ runNew(string parameterFile, const SimulationPreferences & prefs)
     trimVoxelizedGrids(voxelizedGrids); // delete VoxelGrid & PartitionCellCount
     LOGF << "Trimming voxelized grids done." << endl;
     
+    // The threads start before the fields are allocated so they can be the
+    // first to touch them, putting each page on the NUMA node that will
+    // update it.
+    WorkerPoolPtr pool;
+    if (prefs.numThreads > 1)
+    {
+        LOGF << "Starting " << prefs.numThreads << " threads..." << endl;
+        pool = WorkerPoolPtr(new WorkerPool(prefs.numThreads));
+        LOGF << "Starting threads done." << endl;
+        if (prefs.firstTouch)
+            FieldArray::setFirstTouchPool(pool);
+    }
+    FieldArray::setHugePages(prefs.hugePages);
+    Output::setWriteBuffers(prefs.outputBuffers);
+    Output::setChunkedFiles(prefs.chunkedOutput);
+    
     LOGF << "Making calculation grids..." << endl;
     makeCalculationGrids(sim, calculationGrids, voxelizedGrids);
     LOGF << "Making calculation grids done." << endl;
@@ -140,6 +194,38 @@ runNew(string parameterFile, const SimulationPreferences & prefs)
     LOGF << "Allocating aux buffers..." << endl;
     allocateAuxBuffers(calculationGrids);
     LOGF << "Allocating aux buffers done." << endl;
+    FieldArray::setFirstTouchPool(0L);
+    
+    if (prefs.fuseComponents)
+    {
+        LOGF << "Fusing runlines..." << endl;
+        fuseRunlines(calculationGrids);
+        LOGF << "Fusing runlines done." << endl;
+    }
+    
+    if (prefs.tileBytes > 0)
+    {
+        LOGF << "Dividing grids into tiles..." << endl;
+        divideIntoTiles(calculationGrids, prefs.tileBytes);
+        LOGF << "Dividing grids into tiles done." << endl;
+    }
+    
+    if (mCommunicator != 0L)
+    {
+        LOGF << "Connecting to neighbor nodes..." << endl;
+        startHaloExchanges(sim, calculationGrids);
+        LOGF << "Connecting to neighbor nodes done." << endl;
+    }
+    
+    if (pool != 0L)
+        startThreads(calculationGrids, pool);
+    
+    if (prefs.timeBlockTimesteps > 1 && !prefs.savePerformanceInfo)
+    {
+        LOGF << "Setting up temporal blocking..." << endl;
+        setUpTimeBlocks(calculationGrids, prefs.timeBlockTimesteps);
+        LOGF << "Setting up temporal blocking done." << endl;
+    }
     t1 = timeInMicroseconds();
     mPerformance.setSetupCalculationMicroseconds(t1-t0);
 	
@@ -178,7 +264,8 @@ runNew(string parameterFile, const SimulationPreferences & prefs)
     t1 = timeInMicroseconds();
     mPerformance.setRunCalculationMicroseconds(t1-t0);
     
-    if (prefs.savePerformanceInfo)
+    if (prefs.savePerformanceInfo &&
+        (mCommunicator == 0L || mCommunicator->rank() == 0))
     {
         LOGF << "Reporting performance..." << endl;
         reportPerformance(calculationGrids);
@@ -188,6 +275,9 @@ runNew(string parameterFile, const SimulationPreferences & prefs)
     LOGF << "Clearing palette..." << endl;
 	Paint::clearPalette(); // avert embarassing segfaults at the end
     LOGF << "Clearing palette done." << endl;
+    
+    // Disconnecting from the other nodes also waits for them to finish.
+    mCommunicator = 0L;
 }
 
 SimulationDescPtr FDTDApplication::
@@ -208,30 +298,72 @@ loadSimulation(string parameterFile)
 }
 
 
+void FDTDApplication::
+startNodes(Vector3i numNodes)
+{
+    mNumNodes = numNodes;
+    mCommunicator = NodeCommunicator::forkLocalNodes(
+        numNodes[0]*numNodes[1]*numNodes[2]);
+    
+    int rank = mCommunicator->rank();
+    mThisNode = Vector3i(rank%numNodes[0], (rank/numNodes[0])%numNodes[1],
+        rank/(numNodes[0]*numNodes[1]));
+    LOGF << "I am node " << mThisNode << " (rank " << rank << ").\n";
+}
+
+void FDTDApplication::
+renameOutputsForNode(const SimulationDescPtr sim)
+{
+    ostringstream suffix;
+    suffix << "_node" << mCommunicator->rank();
+    
+    for (unsigned int gg = 0; gg < sim->grids().size(); gg++)
+    {
+        vector<OutputDescPtr> outputs(sim->grids()[gg]->outputs());
+        for (unsigned int nn = 0; nn < outputs.size(); nn++)
+            outputs[nn]->setFile(outputs[nn]->file() + suffix.str());
+    }
+}
+
+Rect3i FDTDApplication::
+nodePartitionWalls(GridDescPtr grid) const
+{
+    Rect3i walls(-100000000, -100000000, -100000000, 100000000, 100000000,
+        100000000);
+    Vector3i numYeeCells(grid->numYeeCells());
+    
+    for (int mm = 0; mm < 3; mm++)
+    if (mNumNodes[mm] > 1 && numYeeCells[mm] > 1)
+    {
+        if (numYeeCells[mm] < mNumNodes[mm])
+        {
+            ostringstream str;
+            str << "Grid " << grid->name() << " has " << numYeeCells[mm]
+                << " cells along axis " << mm << ", which is too few to split"
+                " among " << mNumNodes[mm] << " nodes.";
+            throw(Exception(str.str()));
+        }
+        
+        // Walls fall on Yee cell boundaries.  The first and last nodes
+        // keep their infinite outer walls.
+        long firstYee = (long(numYeeCells[mm])*mThisNode[mm])/mNumNodes[mm];
+        long lastYee = (long(numYeeCells[mm])*(mThisNode[mm]+1))/
+            mNumNodes[mm] - 1;
+        if (mThisNode[mm] > 0)
+            walls.p1[mm] = 2*firstYee;
+        if (mThisNode[mm] < mNumNodes[mm]-1)
+            walls.p2[mm] = 2*lastYee+1;
+    }
+    return walls;
+}
+
 void FDTDApplication::
 voxelizeGrids(const SimulationDescPtr sim,
 	Map<GridDescPtr, VoxelizedPartitionPtr> & voxelizedGrids,
     int runlineDirection)
 {
-	static const int USE_MPI = 0;
-	Rect3i myPartition, myCalcRegion;
-    
     assert(runlineDirection >= 0 && runlineDirection < 3);
 	
-	if (USE_MPI)
-	{
-		LOG << "Voxelizing the main grid for MPI.\n";
-		LOG << "Determining partitions for each node.\n";
-		assert(sim->grids().size() == 1);
-		LOG << "Good, only one main grid present per MPI Trog. limitations.\n";
-		LOG << "Voxelizing per current grid's partition size.\n";
-		
-		myPartition = Rect3i(0,0,0,0,0,0); 
-		myCalcRegion = inset(myPartition, 1L,1L,1L,1L,1L,1L);
-		assert(!"Can't go further.");
-		//voxelizeGridRecursor(voxelizedGrids, sim->grids()[0], myPartition,
-		//	myCalcRegion);
-	}
 	GridDescPtr g;
     unsigned int ii;
     
@@ -243,14 +375,21 @@ voxelizeGrids(const SimulationDescPtr sim,
 		// the recursor paints the setup grid and creates new grids as needed
 		// to implement all TFSF sources.
 		
-//		LOG << "Determining non-MPI partition size.\n";
-		
 		Vector3i numNodes(1,1,1);
 		Vector3i thisNode(0,0,0);
-		
 		Rect3i partitionWallsHalf = Rect3i(-100000000, -100000000, -100000000, 
 			100000000, 100000000, 100000000);
 		
+        if (mCommunicator != 0L)
+        {
+            numNodes = mNumNodes;
+            thisNode = mThisNode;
+            partitionWallsHalf = nodePartitionWalls(g);
+            LOGF << "Node " << thisNode << " of " << numNodes << " has "
+                << clip(partitionWallsHalf, g->halfCellBounds())
+                << " of " << g->name() << ".\n";
+        }
+		
 		voxelizeGridRecursor(voxelizedGrids, sim, g, numNodes, thisNode,
 			partitionWallsHalf, runlineDirection);
 	}
@@ -354,7 +493,9 @@ voxelizeGridRecursor(Map<GridDescPtr, VoxelizedPartitionPtr> & voxelizedGrids,
 			GridDescPtr auxGridDescription = makeAuxGridDescription(collapsible,
 				currentGrid, surfs[nn], auxGridName.str());
 			
-			Rect3i auxPartitionWallsHalf(partitionWallsHalf);
+			// Aux grids are small, so every node runs the whole aux grid.
+			Rect3i auxPartitionWallsHalf = Rect3i(-100000000, -100000000,
+                -100000000, 100000000, 100000000, 100000000);
 			
 			for (int ll = 0; ll < 3; ll++)
 			if (collapsible[ll] != 0)
@@ -363,8 +504,8 @@ voxelizeGridRecursor(Map<GridDescPtr, VoxelizedPartitionPtr> & voxelizedGrids,
 				auxPartitionWallsHalf.p2[ll] = 1;
 			}
 			voxelizeGridRecursor(voxelizedGrids, simulationDescription,
-                auxGridDescription, numNodes, thisNode, auxPartitionWallsHalf,
-                runlineDirection);
+                auxGridDescription, Vector3i(1,1,1), Vector3i(0,0,0),
+                auxPartitionWallsHalf, runlineDirection);
 		}
 		else if (currentGrid->numDimensions() == 1 &&
             surfs[nn]->type() == kTFSFSource )
@@ -379,8 +520,9 @@ voxelizeGridRecursor(Map<GridDescPtr, VoxelizedPartitionPtr> & voxelizedGrids,
 			GridDescPtr auxGridDescription = makeSourceGridDescription(
 				currentGrid, surfs[nn], srcGridName.str());
 			voxelizeGridRecursor(voxelizedGrids, simulationDescription,
-                auxGridDescription, numNodes, thisNode, partitionWallsHalf,
-                runlineDirection);
+                auxGridDescription, Vector3i(1,1,1), Vector3i(0,0,0),
+                Rect3i(-100000000, -100000000, -100000000, 100000000,
+                    100000000, 100000000), runlineDirection);
 		}
 		else if (surfs[nn]->type() != kCustomTFSFSource)
 		{
@@ -511,6 +653,18 @@ makeAuxGridDescription(Vector3i collapsible, GridDescPtr parentGrid,
                     newSourceOmittedSides,
                     huygensSurface->isTotalField()));
     }
+	else if (huygensSurface->type() == kCustomTFSFSource &&
+        huygensSurface->formulas().size() > 0)
+	{
+		childSource = HuygensSurfaceDescPtr(HuygensSurfaceDescription::
+            newCustomTFSFFormulaSource(
+			huygensSurface->formulas(),
+			huygensSurface->symmetries(),
+            tfHalfCells,
+            huygensSurface->duration(),
+			huygensSurface->omittedSides(),
+            huygensSurface->isTotalField()));
+	}
 	else if (huygensSurface->type() == kCustomTFSFSource)
 	{
 		childSource = HuygensSurfaceDescPtr(HuygensSurfaceDescription::
@@ -769,6 +923,121 @@ allocateAuxBuffers(Map<string, CalculationPartitionPtr> & calcs)
         itr->second->allocateAuxBuffers();
 }
 
+void FDTDApplication::
+fuseRunlines(Map<string, CalculationPartitionPtr> & calcs)
+{
+    map<string, CalculationPartitionPtr>::iterator itr;
+    for (itr = calcs.begin(); itr != calcs.end(); itr++)
+        itr->second->fuseRunlines();
+}
+
+void FDTDApplication::
+divideIntoTiles(Map<string, CalculationPartitionPtr> & calcs, long tileBytes)
+{
+    map<string, CalculationPartitionPtr>::iterator itr;
+    for (itr = calcs.begin(); itr != calcs.end(); itr++)
+    {
+        itr->second->divideIntoTiles(tileBytes);
+        LOGF << itr->first << " has " << itr->second->numTiles()
+            << " tiles.\n";
+    }
+}
+
+void FDTDApplication::
+setUpTimeBlocks(Map<string, CalculationPartitionPtr> & calcs,
+    int maxTimesteps)
+{
+    if (runsGridsConcurrently(calcs))
+    {
+        LOGF << "Grids run concurrently; no temporal blocking.\n";
+        return;
+    }
+    
+    map<string, CalculationPartitionPtr>::iterator itr;
+    for (itr = calcs.begin(); itr != calcs.end(); itr++)
+    {
+        itr->second->setUpTimeBlocks(maxTimesteps);
+        if (itr->second->timeBlockTimesteps() > 1)
+            LOGF << itr->first << " runs up to "
+                << itr->second->timeBlockTimesteps()
+                << " timesteps at a time.\n";
+        else
+            LOGF << itr->first << " runs one timestep at a time.\n";
+    }
+}
+
+void FDTDApplication::
+startThreads(Map<string, CalculationPartitionPtr> & calcs, WorkerPoolPtr pool)
+{
+    map<string, CalculationPartitionPtr>::iterator itr;
+    
+    // Grids that take turns share one pool.  The partitions hold on to it,
+    // so the threads are joined when the last partition is deleted.
+    if (!runsGridsConcurrently(calcs))
+    {
+        for (itr = calcs.begin(); itr != calcs.end(); itr++)
+            itr->second->setWorkerPool(pool);
+        return;
+    }
+    
+    // The GridScheduler runs up to one grid per thread at once, so a shared
+    // pool would put the scheduler's threads on top of the pool's.  Instead
+    // split the threads between the grids: each gets one, and the rest go
+    // to the grids in proportion to their size.  With as many grids as
+    // threads every grid runs on its scheduler thread alone.
+    long totalCells = 0;
+    for (itr = calcs.begin(); itr != calcs.end(); itr++)
+    {
+        Vector3i numYee(itr->second->lattice().numYeeCells());
+        totalCells += long(numYee[0])*numYee[1]*numYee[2];
+    }
+    
+    int numSpare = max(mNumThreads - int(calcs.size()), 0);
+    int numGiven = 0;
+    long cellsSoFar = 0;
+    for (itr = calcs.begin(); itr != calcs.end(); itr++)
+    {
+        Vector3i numYee(itr->second->lattice().numYeeCells());
+        cellsSoFar += long(numYee[0])*numYee[1]*numYee[2];
+        int numExtra = totalCells ? int((numSpare*cellsSoFar)/totalCells)
+            - numGiven : 0;
+        numGiven += numExtra;
+        
+        if (numExtra > 0)
+        {
+            LOGF << itr->first << " gets " << numExtra+1 << " threads.\n";
+            itr->second->setWorkerPool(
+                WorkerPoolPtr(new WorkerPool(numExtra+1)));
+        }
+    }
+}
+
+bool FDTDApplication::
+runsGridsConcurrently(const Map<string, CalculationPartitionPtr> & calcs)
+    const
+{
+    // Grids on many nodes would share the sockets between nodes, so they take
+    // turns instead.
+    return (mNumThreads > 1 && calcs.size() > 1 && mCommunicator == 0L);
+}
+
+
+void FDTDApplication::
+startHaloExchanges(const SimulationDescPtr sim,
+    Map<string, CalculationPartitionPtr> & calcs)
+{
+    // Only the grids from the parameter file are partitioned; the aux grids
+    // run whole on every node.
+    for (unsigned int gg = 0; gg < sim->grids().size(); gg++)
+    {
+        GridDescPtr grid(sim->grids()[gg]);
+        CalculationPartitionPtr calc(calcs[grid->name()]);
+        
+        HaloExchangePtr halo(new HaloExchange(mCommunicator, mNumNodes,
+            mThisNode, calc->calcHalfCells(), grid->halfCellBounds()));
+        calc->setHaloExchange(halo);
+    }
+}
 
 void FDTDApplication::
 updateE(Map<string, CalculationPartitionPtr> & calcGrids, long timestep)
@@ -818,6 +1087,27 @@ outputH(Map<string, CalculationPartitionPtr> & calcGrids, long timestep)
         itr->second->outputH(timestep);
 }
 
+long FDTDApplication::
+quietTimesteps(Map<string, CalculationPartitionPtr> & calcGrids,
+    long firstTimestep)
+{
+    long numTimesteps = mNumT - firstTimestep;
+    map<string, CalculationPartitionPtr>::iterator itr;
+    for (itr = calcGrids.begin(); itr != calcGrids.end(); itr++)
+        numTimesteps = itr->second->quietTimesteps(firstTimestep,
+            numTimesteps);
+    return numTimesteps;
+}
+
+void FDTDApplication::
+updateBlock(Map<string, CalculationPartitionPtr> & calcGrids,
+    long firstTimestep, long numTimesteps)
+{
+    map<string, CalculationPartitionPtr>::iterator itr;
+    for (itr = calcGrids.begin(); itr != calcGrids.end(); itr++)
+        itr->second->updateBlock(firstTimestep, numTimesteps);
+}
+
 void FDTDApplication::
 updateETimed(Map<string, CalculationPartitionPtr> & calcGrids, long timestep)
 {
@@ -871,6 +1161,15 @@ outputHTimed(Map<string, CalculationPartitionPtr> & calcGrids, long timestep)
 void FDTDApplication::
 runUntimed(Map<string, CalculationPartitionPtr> & calculationGrids)
 {
+    // With threads to spare, let grids that don't share a TFSF link run at
+    // the same time, each with its share of the threads (see startThreads).
+    if (runsGridsConcurrently(calculationGrids))
+    {
+        GridScheduler scheduler(calculationGrids, mNumT, mNumThreads);
+        scheduler.run();
+        return;
+    }
+    
     sourceE(calculationGrids, 0);
     outputE(calculationGrids, 0);
     sourceH(calculationGrids, 0);
@@ -880,6 +1179,18 @@ runUntimed(Map<string, CalculationPartitionPtr> & calculationGrids)
         cout << "\r                                                          "
             << flush;
         cout << "\rTimestep " << tt << " of " << mNumT << flush;
+        
+        // Stretches with no sources or outputs go through in blocks.  Grids
+        // with a block don't interact (no Huygens surfaces), so each can
+        // take its block in turn.
+        long numQuiet = quietTimesteps(calculationGrids, tt);
+        if (numQuiet > 1)
+        {
+            updateBlock(calculationGrids, tt, numQuiet);
+            tt += numQuiet-1;
+            continue;
+        }
+        
         updateE(calculationGrids, tt);
         sourceE(calculationGrids, tt);
         outputE(calculationGrids, tt);
@@ -954,7 +1265,10 @@ FDTDApplication() :
 	m_dy(0.0),
 	m_dz(0.0),
 	m_dt(0.0),
-	mNumT(0)
+	mNumT(0),
+	mNumThreads(1),
+    mNumNodes(1,1,1),
+    mThisNode(0,0,0)
 {
 }
 
@@ -20,6 +20,9 @@
 #include "geometry.h"
 #include "tinyxml.h"
 #include "Pointer.h"
+#include "Map.h"
+#include "NodeCommunicator.h"
+#include "WorkerPool.h"
 #include <string>
 #include <vector>
 
@@ -44,6 +47,17 @@ public:
     SimulationPreferences();
     
     int numThreads;
+    Vector3i numNodes;
+    long tileBytes; // 0 to update each field component over the whole grid
+    int timeBlockTimesteps; // most timesteps per temporal block; 0 or 1: none
+    bool fuseComponents;
+    bool firstTouch; // zero fields and aux buffers on the worker threads
+    bool hugePages;
+    bool alignFields; // pad rows of the lattice to whole cache lines
+    int outputBuffers; // staging buffers for all outputs; 0: write inline
+    bool chunkedOutput; // compressed, chunked data files
+    int prefetchRecords; // source data read ahead per file; 0 to read inline
+    long prefetchBytes; // memory budget for each file's read-ahead
     long numTimestepsOverride;
     bool output3D;
     bool output2D;
@@ -75,9 +89,31 @@ public:
      *  and runSimulation().
      */
 	void runNew(std::string parameterFile, const SimulationPreferences & prefs);
+    
+    // Timings of the last run.
+    const GlobalStatistics & performance() const { return mPerformance; }
 
 private:
 	SimulationDescPtr loadSimulation(std::string parameterFile);
+    
+    /**
+     *  Split the simulation among numNodes[0]*numNodes[1]*numNodes[2] copies
+     *  of this process, one per node of the decomposition.  Each copy returns
+     *  from startNodes() knowing its own rank.
+     */
+    void startNodes(Vector3i numNodes);
+    
+    /**
+     *  Give each node's outputs a distinct file name, so the nodes don't
+     *  write over each other.
+     */
+    void renameOutputsForNode(const SimulationDescPtr sim);
+    
+    /**
+     *  Find the partition walls of this node for the given grid.  The grid is
+     *  split evenly into Yee cells along each axis with more than one node.
+     */
+    Rect3i nodePartitionWalls(GridDescPtr grid) const;
 	
 	void voxelizeGrids(const SimulationDescPtr sim,
 		Map<GridDescPtr, VoxelizedPartitionPtr> & voxelizedGrids,
@@ -128,6 +164,49 @@ private:
     void allocateAuxBuffers(Map<std::string, CalculationPartitionPtr>
         & calcs);
     
+    /**
+     *  Have every calculation partition update its fields in slabs of about
+     *  tileBytes each.
+     */
+    void divideIntoTiles(Map<std::string, CalculationPartitionPtr> & calcs,
+        long tileBytes);
+    
+    /**
+     *  Let every calculation partition that can run up to maxTimesteps
+     *  timesteps at a time through cache, where no source or output needs to
+     *  see the fields in between (see CalculationPartition::updateBlock).
+     *  Only runUntimed() does this, and not when it runs grids concurrently.
+     */
+    void setUpTimeBlocks(Map<std::string, CalculationPartitionPtr> & calcs,
+        int maxTimesteps);
+    
+    /**
+     *  Have every calculation partition update the three field components
+     *  together where it can.
+     */
+    void fuseRunlines(Map<std::string, CalculationPartitionPtr> & calcs);
+    
+    /**
+     *  Give the pool of worker threads to every calculation partition.  Each
+     *  material's runlines are split evenly among the threads.  When the
+     *  grids run concurrently the threads are split between them instead,
+     *  so no more than numThreads are ever busy.
+     */
+    void startThreads(Map<std::string, CalculationPartitionPtr> & calcs,
+        WorkerPoolPtr pool);
+    
+    /**
+     *  True if runUntimed() will hand the grids to a GridScheduler.
+     */
+    bool runsGridsConcurrently(
+        const Map<std::string, CalculationPartitionPtr> & calcs) const;
+    
+    /**
+     *  Connect each partitioned grid to its neighbors on the other nodes.
+     */
+    void startHaloExchanges(const SimulationDescPtr sim,
+        Map<std::string, CalculationPartitionPtr> & calcs);
+    
     void updateE(Map<std::string, CalculationPartitionPtr> & calcGrids,
         long timestep);
     void sourceE(Map<std::string, CalculationPartitionPtr> & calcGrids,
@@ -141,6 +220,13 @@ private:
     void outputH(Map<std::string, CalculationPartitionPtr> & calcGrids,
         long timestep);
     
+    // returns        how many timesteps from firstTimestep on every grid can
+    //                update in one block (0 or 1: step as usual)
+    long quietTimesteps(Map<std::string, CalculationPartitionPtr> & calcGrids,
+        long firstTimestep);
+    void updateBlock(Map<std::string, CalculationPartitionPtr> & calcGrids,
+        long firstTimestep, long numTimesteps);
+    
     void updateETimed(Map<std::string, CalculationPartitionPtr> & calcGrids,
         long timestep);
     void sourceETimed(Map<std::string, CalculationPartitionPtr> & calcGrids,
@@ -167,6 +253,11 @@ private:
     float m_dz;
     float m_dt;
     int mNumT;
+    int mNumThreads;
+    
+    NodeCommunicatorPtr mCommunicator; // null unless running on many nodes
+    Vector3i mNumNodes;
+    Vector3i mThisNode;
     
     GlobalStatistics mPerformance;
     
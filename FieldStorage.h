@@ -0,0 +1,231 @@
+/*
+ *  FieldStorage.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _FIELDSTORAGE_
+#define _FIELDSTORAGE_
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+// The type used to store fields, and usually auxiliary variables, in memory.
+// Curl terms and coefficients are float; the storage type decides how many
+// bytes each value takes in memory, which is what limits the speed of large
+// grids, and how precisely the fields accumulate over many timesteps.  Choose
+// it at compile time:
+//
+//      (default)               float
+//      TROGDOR_STORAGE_BF16    bfloat16, float's range with 8 bits of mantissa
+//      TROGDOR_STORAGE_FP16    IEEE half, 11 bits of mantissa but a range of
+//                              only about 6e-8 to 65504
+//      TROGDOR_STORAGE_DOUBLE  double, for long runs of high-Q resonators
+//                              where round-off in E += dE builds up; this is
+//                              the trogdor_double executable
+//
+// Both half-size types convert to float and back implicitly, so update code
+// reads and writes them as if they were floats.  Files are always read and
+// written as float; use readFieldValues() and writeFieldValues().
+
+#if defined(TROGDOR_STORAGE_FP16) && defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace FieldStorageDetail
+{
+    inline unsigned int floatBits(float f)
+    {
+        unsigned int bits;
+        memcpy(&bits, &f, sizeof(float));
+        return bits;
+    }
+
+    inline float bitsFloat(unsigned int bits)
+    {
+        float f;
+        memcpy(&f, &bits, sizeof(float));
+        return f;
+    }
+}
+
+/**
+ * bfloat16: the top 16 bits of a float, rounded to nearest even.
+ */
+class BFloat16
+{
+public:
+    BFloat16() {}
+    BFloat16(float f) : mBits(fromFloat(f)) {}
+
+    operator float() const
+        { return FieldStorageDetail::bitsFloat((unsigned int)mBits << 16); }
+
+    BFloat16 & operator+=(float rhs) { return *this = float(*this) + rhs; }
+    BFloat16 & operator-=(float rhs) { return *this = float(*this) - rhs; }
+    BFloat16 & operator*=(float rhs) { return *this = float(*this) * rhs; }
+    BFloat16 & operator/=(float rhs) { return *this = float(*this) / rhs; }
+
+private:
+    static unsigned short fromFloat(float f)
+    {
+        unsigned int bits = FieldStorageDetail::floatBits(f);
+        if ((bits & 0x7fffffff) > 0x7f800000) // NaN stays NaN
+            return (unsigned short)((bits >> 16) | 0x0040);
+        bits += 0x7fff + ((bits >> 16) & 1);
+        return (unsigned short)(bits >> 16);
+    }
+
+    unsigned short mBits;
+};
+
+/**
+ * IEEE 754 binary16, rounded to nearest even.  Uses the F16C instructions
+ * when the compiler has them.
+ */
+class Half
+{
+public:
+    Half() {}
+    Half(float f) : mBits(fromFloat(f)) {}
+
+    operator float() const { return toFloat(mBits); }
+
+    Half & operator+=(float rhs) { return *this = float(*this) + rhs; }
+    Half & operator-=(float rhs) { return *this = float(*this) - rhs; }
+    Half & operator*=(float rhs) { return *this = float(*this) * rhs; }
+    Half & operator/=(float rhs) { return *this = float(*this) / rhs; }
+
+private:
+    static unsigned short fromFloat(float f)
+    {
+#if defined(TROGDOR_STORAGE_FP16) && defined(__F16C__)
+        return _cvtss_sh(f, 0);
+#else
+        using namespace FieldStorageDetail;
+        unsigned int bits = floatBits(f);
+        unsigned int sign = (bits >> 16) & 0x8000;
+        unsigned int absBits = bits & 0x7fffffff;
+
+        if (absBits > 0x7f800000) // NaN
+            return sign | 0x7e00;
+        if (absBits >= 0x477ff000) // rounds past 65504: infinity
+            return sign | 0x7c00;
+        if (absBits < 0x38800000) // below 2^-14: subnormal or zero
+        {
+            // Adding 2^23 rounds a*2^24 to an integer in the low mantissa
+            // bits, to nearest even.
+            float scaled = bitsFloat(absBits)*16777216.0f + 8388608.0f;
+            return sign | (floatBits(scaled) - 0x4b000000);
+        }
+
+        // Round away the low 13 mantissa bits (to nearest even) and rebias
+        // the exponent from 127 to 15.
+        absBits += 0x0fff + ((absBits >> 13) & 1);
+        return sign | ((absBits - 0x38000000) >> 13);
+#endif
+    }
+
+    static float toFloat(unsigned short h)
+    {
+#if defined(TROGDOR_STORAGE_FP16) && defined(__F16C__)
+        return _cvtsh_ss(h);
+#else
+        using namespace FieldStorageDetail;
+        unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+        unsigned int exponent = (h >> 10) & 0x1f;
+        unsigned int mantissa = h & 0x3ff;
+
+        if (exponent == 0) // subnormal or zero
+        {
+            float value = mantissa * (1.0f/16777216.0f);
+            return sign ? -value : value;
+        }
+        if (exponent == 31) // infinity or NaN
+            return bitsFloat(sign | 0x7f800000 | (mantissa << 13));
+        return bitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+#endif
+    }
+
+    unsigned short mBits;
+};
+
+#if defined(TROGDOR_STORAGE_DOUBLE)
+typedef double FieldStorage;
+#define TROGDOR_STORAGE_NAME "double"
+#elif defined(TROGDOR_STORAGE_BF16)
+typedef BFloat16 FieldStorage;
+#define TROGDOR_STORAGE_NAME "bfloat16"
+#elif defined(TROGDOR_STORAGE_FP16)
+typedef Half FieldStorage;
+#define TROGDOR_STORAGE_NAME "half"
+#else
+typedef float FieldStorage;
+#define TROGDOR_STORAGE_NAME "float"
+#endif
+
+// The type used to store the auxiliary variables of the materials and the
+// PML: polarization currents, polarizations and convolution sums.  Their size
+// is set by the material constants, not by E and H; a Drude current is around
+// 1e7 times E and a Lorentz polarization around 1e-11 times E, both outside
+// the range of IEEE half.  bfloat16 has the range of float, but these sums
+// are recursive, each timestep adding a small term to a decaying total, and
+// with 8 bits of mantissa the small terms round away.  Both half-size builds
+// keep them in float, which is a small part of the memory next to E and H.
+#if defined(TROGDOR_STORAGE_FP16) || defined(TROGDOR_STORAGE_BF16)
+typedef float AuxStorage;
+#else
+typedef FieldStorage AuxStorage;
+#endif
+
+/**
+ * Read count floats from a binary stream into field storage.
+ */
+inline void
+readFieldValues(std::istream & binaryStream, FieldStorage* values, long count)
+{
+#if defined(TROGDOR_STORAGE_BF16) || defined(TROGDOR_STORAGE_FP16) || \
+    defined(TROGDOR_STORAGE_DOUBLE)
+    std::vector<float> floats(count);
+    if (count > 0)
+        binaryStream.read((char*)&floats[0], count*sizeof(float));
+    for (long nn = 0; nn < count; nn++)
+        values[nn] = floats[nn];
+#else
+    binaryStream.read((char*)values, count*sizeof(float));
+#endif
+}
+
+/**
+ * Write count values from field storage to a binary stream as floats.
+ */
+inline void
+writeFieldValues(std::ostream & binaryStream, const FieldStorage* values,
+    long count)
+{
+#if defined(TROGDOR_STORAGE_BF16) || defined(TROGDOR_STORAGE_FP16) || \
+    defined(TROGDOR_STORAGE_DOUBLE)
+    std::vector<float> floats(values, values + count);
+    if (count > 0)
+        binaryStream.write((char*)&floats[0], count*sizeof(float));
+#else
+    binaryStream.write((const char*)values, count*sizeof(float));
+#endif
+}
+
+#if defined(TROGDOR_STORAGE_FP16) || defined(TROGDOR_STORAGE_BF16)
+/**
+ * Write count auxiliary variables to a binary stream as floats.
+ */
+inline void
+writeFieldValues(std::ostream & binaryStream, const AuxStorage* values,
+    long count)
+{
+    binaryStream.write((const char*)values, count*sizeof(float));
+}
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ *  FilePrefetcher.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "FilePrefetcher.h"
+#include "TimeWrapper.h"
+#include "Exception.h"
+
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+int FilePrefetcher::sRecordsAhead = 4;
+long FilePrefetcher::sMaxBytes = 256*1024*1024;
+
+FilePrefetcher::
+FilePrefetcher(const string & fileName, const vector<long> & recordLengths,
+    int numBuffers) :
+    mRecordLengths(recordLengths),
+    mNextRecord(0),
+    mBuffers(numBuffers),
+    mCurrentBuffer(-1),
+    mShutdown(0),
+    mEndOfFile(0),
+    mStallMicroseconds(0.0),
+    mNumStalls(0)
+{
+    assert(numBuffers > 0);
+    assert(mRecordLengths.size() > 0);
+    if (!mFile.open(fileName))
+        throw(Exception(string("Could not open binary file ") + fileName));
+
+    for (int nn = 0; nn < mBuffers.size(); nn++)
+        mFreeBuffers.push_back(nn);
+    mThread = boost::thread(boost::bind(&FilePrefetcher::loaderLoop, this));
+}
+
+FilePrefetcher::
+~FilePrefetcher()
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mShutdown = 1;
+    }
+    mFreeCondition.notify_one();
+    mThread.join();
+}
+
+const vector<float>* FilePrefetcher::
+beginRecord()
+{
+    assert(mCurrentBuffer == -1);
+
+    boost::mutex::scoped_lock lock(mMutex);
+    if (mFilledBuffers.empty() && !mEndOfFile)
+    {
+        double t0 = timeInMicroseconds();
+        while (mFilledBuffers.empty() && !mEndOfFile)
+            mFilledCondition.wait(lock);
+        mStallMicroseconds += timeInMicroseconds() - t0;
+        mNumStalls++;
+    }
+    if (mFilledBuffers.empty()) // at the end of the file
+        return 0L;
+
+    mCurrentBuffer = mFilledBuffers.front();
+    mFilledBuffers.pop_front();
+    return &mBuffers[mCurrentBuffer];
+}
+
+void FilePrefetcher::
+endRecord()
+{
+    assert(mCurrentBuffer != -1);
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mFreeBuffers.push_back(mCurrentBuffer);
+        mCurrentBuffer = -1;
+    }
+    mFreeCondition.notify_one();
+}
+
+int FilePrefetcher::
+numBuffers(const vector<long> & recordLengths)
+{
+    if (recordLengths.size() == 0)
+        return 0;
+    long recordBytes = sizeof(float)*
+        (*max_element(recordLengths.begin(), recordLengths.end()));
+    if (recordBytes == 0)
+        return 0;
+    return int(min(long(sRecordsAhead), sMaxBytes/recordBytes));
+}
+
+void FilePrefetcher::
+loaderLoop()
+{
+    while (1)
+    {
+        int bufferNum;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            while (mFreeBuffers.empty() && !mShutdown)
+                mFreeCondition.wait(lock);
+            if (mShutdown)
+                return;
+            bufferNum = mFreeBuffers.front();
+            mFreeBuffers.pop_front();
+        }
+
+        // Only this thread touches the file.  The copy takes the page faults
+        // here instead of on the timestep thread.
+        vector<float> & buffer(mBuffers[bufferNum]);
+        buffer.resize(mRecordLengths[mNextRecord % mRecordLengths.size()]);
+        mNextRecord++;
+        bool didRead = buffer.size() == 0 ||
+            mFile.read(&buffer[0], buffer.size());
+
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            if (didRead)
+                mFilledBuffers.push_back(bufferNum);
+            else
+            {
+                mFreeBuffers.push_back(bufferNum);
+                mEndOfFile = 1;
+            }
+        }
+        mFilledCondition.notify_one();
+        if (!didRead)
+            return;
+    }
+}
+
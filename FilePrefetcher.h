@@ -0,0 +1,107 @@
+/*
+ *  FilePrefetcher.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _FILEPREFETCHER_
+#define _FILEPREFETCHER_
+
+#include "Pointer.h"
+#include "MappedFile.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * Binary float input file read ahead on its own thread.  The file is a
+ * series of records, e.g. the source data for successive half timesteps,
+ * whose lengths repeat in the pattern given to the constructor.  A loader
+ * thread copies records out of the file (see MappedFile) into a ring of
+ * numBuffers buffers while the timestep thread works, so the disk reads
+ * overlap the field updates.
+ *
+ * The timestep thread takes each record with beginRecord() and gives the
+ * buffer back with endRecord().  When the loader has fallen behind,
+ * beginRecord() blocks until the record is ready; the time spent waiting is
+ * reported by stallMicroseconds(), as in AsyncFileWriter.
+ */
+class FilePrefetcher
+{
+public:
+    FilePrefetcher(const std::string & fileName,
+        const std::vector<long> & recordLengths, int numBuffers);
+
+    /**
+     * Stops the loader thread and closes the file.
+     */
+    ~FilePrefetcher();
+
+    /**
+     * Wait for the next record.  The buffer is good until endRecord().
+     *
+     * @returns the record, or 0L if the file ended before it
+     */
+    const std::vector<float>* beginRecord();
+
+    /**
+     * Hand the buffer from beginRecord() back to the loader.
+     */
+    void endRecord();
+
+    double stallMicroseconds() const { return mStallMicroseconds; }
+    long numStalls() const { return mNumStalls; }
+
+    /**
+     * Number of records read ahead by prefetchers made from now on.  Zero
+     * turns prefetching off.  The default is 4.
+     */
+    static void setRecordsAhead(int numRecords)
+        { sRecordsAhead = numRecords; }
+
+    /**
+     * Memory each prefetcher made from now on may use for its buffers,
+     * which can cut the records read ahead down.  The default is 256 MB.
+     */
+    static void setMaxBytes(long maxBytes) { sMaxBytes = maxBytes; }
+
+    /**
+     * @returns the number of buffers to prefetch records of these lengths
+     *  with under the current settings, or 0 not to prefetch
+     */
+    static int numBuffers(const std::vector<long> & recordLengths);
+
+private:
+    void loaderLoop();
+
+    MappedFile mFile;
+    std::vector<long> mRecordLengths;
+    long mNextRecord;
+    std::vector<std::vector<float> > mBuffers;
+    std::deque<int> mFreeBuffers;
+    std::deque<int> mFilledBuffers;
+    int mCurrentBuffer;
+    bool mShutdown;
+    bool mEndOfFile;
+    double mStallMicroseconds;
+    long mNumStalls;
+
+    boost::mutex mMutex;
+    boost::condition_variable mFilledCondition;
+    boost::condition_variable mFreeCondition;
+    boost::thread mThread;
+
+    static int sRecordsAhead;
+    static long sMaxBytes;
+};
+typedef Pointer<FilePrefetcher> FilePrefetcherPtr;
+
+
+#endif
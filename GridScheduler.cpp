@@ -0,0 +1,159 @@
+/*
+ *  GridScheduler.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "GridScheduler.h"
+#include "SimulationDescription.h"
+#include "Log.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+GridScheduler::
+GridScheduler(Map<string, CalculationPartitionPtr> & calcGrids, long numT,
+    int numThreads) :
+    mNumT(numT),
+    mNumHalfSteps(2*numT),
+    mNumThreads(min(numThreads, int(calcGrids.size()))),
+    mNumGridsFinished(0),
+    mLastPrintedTimestep(0)
+{
+    Map<string, int> gridNumbers;
+    map<string, CalculationPartitionPtr>::iterator itr;
+    for (itr = calcGrids.begin(); itr != calcGrids.end(); itr++)
+    {
+        GridNode node;
+        node.grid = itr->second;
+        node.nextHalfStep = 0;
+        node.busy = 0;
+        gridNumbers[itr->first] = mGrids.size();
+        mGrids.push_back(node);
+    }
+
+    // Every HuygensLink is a dependency in both directions: the destination
+    // grid reads the source grid's fields, so neither may get ahead.
+    for (int nn = 0; nn < mGrids.size(); nn++)
+    {
+        const vector<HuygensSurfacePtr> & surfaces =
+            mGrids[nn].grid->huygensSurfaces();
+        for (int ss = 0; ss < surfaces.size(); ss++)
+        if (surfaces[ss]->description()->type() == kLink)
+        {
+            int source = gridNumbers[
+                surfaces[ss]->description()->sourceGrid()->name()];
+            mGrids[nn].neighbors.push_back(source);
+            mGrids[source].neighbors.push_back(nn);
+        }
+    }
+}
+
+void GridScheduler::
+run()
+{
+    boost::thread_group threads;
+
+    // The calling thread is one of the workers.
+    for (int nn = 1; nn < mNumThreads; nn++)
+        threads.create_thread(boost::bind(&GridScheduler::workerLoop, this));
+    workerLoop();
+    threads.join_all();
+}
+
+void GridScheduler::
+workerLoop()
+{
+    boost::mutex::scoped_lock lock(mMutex);
+
+    while (mNumGridsFinished < mGrids.size())
+    {
+        int gridNum = -1;
+        for (int nn = 0; nn < mGrids.size() && gridNum == -1; nn++)
+        if (isReady(nn))
+            gridNum = nn;
+
+        if (gridNum == -1)
+        {
+            mCondition.wait(lock);
+            continue;
+        }
+
+        GridNode & node(mGrids[gridNum]);
+        long halfStep = node.nextHalfStep;
+        node.busy = 1;
+
+        lock.unlock();
+        runHalfStep(*node.grid, halfStep);
+        lock.lock();
+
+        node.busy = 0;
+        node.nextHalfStep++;
+        if (node.nextHalfStep == mNumHalfSteps)
+            mNumGridsFinished++;
+        printProgress();
+        mCondition.notify_all();
+    }
+}
+
+bool GridScheduler::
+isReady(int gridNum) const
+{
+    const GridNode & node(mGrids[gridNum]);
+
+    if (node.busy || node.nextHalfStep == mNumHalfSteps)
+        return 0;
+
+    for (int nn = 0; nn < node.neighbors.size(); nn++)
+    if (mGrids[node.neighbors[nn]].nextHalfStep < node.nextHalfStep)
+        return 0;
+
+    return 1;
+}
+
+void GridScheduler::
+runHalfStep(CalculationPartition & grid, long halfStep)
+{
+    long timestep = halfStep/2;
+
+    // Timestep 0 is the initial condition: no update, only sources & outputs.
+    if (halfStep % 2 == 0)
+    {
+        if (timestep > 0)
+            grid.updateE(timestep);
+        grid.sourceE(timestep);
+        grid.outputE(timestep);
+    }
+    else
+    {
+        if (timestep > 0)
+            grid.updateH(timestep);
+        grid.sourceH(timestep);
+        grid.outputH(timestep);
+    }
+}
+
+void GridScheduler::
+printProgress()
+{
+    // Report the timestep that every grid has finished.
+    long slowest = mNumHalfSteps;
+    for (int nn = 0; nn < mGrids.size(); nn++)
+        slowest = min(slowest, mGrids[nn].nextHalfStep);
+    long timestep = slowest/2;
+
+    if (timestep > mLastPrintedTimestep && timestep < mNumT)
+    {
+        mLastPrintedTimestep = timestep;
+        cout << "\r                                                          "
+            << flush;
+        cout << "\rTimestep " << timestep << " of " << mNumT << flush;
+    }
+}
+
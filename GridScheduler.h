@@ -0,0 +1,75 @@
+/*
+ *  GridScheduler.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _GRIDSCHEDULER_
+#define _GRIDSCHEDULER_
+
+#include "CalculationPartition.h"
+#include "Map.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <string>
+#include <vector>
+
+/**
+ * Runs the timestep loop with several grids in flight at once.  Each grid
+ * advances one half-timestep at a time (the E half-step is updateE(), sourceE()
+ * and outputE(), and likewise for H).  The only coupling between grids is the
+ * HuygensLink, which reads the fields of a source grid into the buffers of a
+ * destination grid, so grids joined by a link are kept in lockstep: a grid may
+ * begin half-step k only when all of its linked neighbors have finished every
+ * half-step before k.  Grids with no link between them (e.g. the aux grids of
+ * two different TFSF sources) run freely in parallel.
+ */
+class GridScheduler
+{
+public:
+    /**
+     * Runs up to numThreads grids at once, one per thread.  A grid with a
+     * WorkerPool of its own uses those threads as well, so the pools should
+     * share out the same numThreads (see FDTDApplication::startThreads).
+     */
+    GridScheduler(Map<std::string, CalculationPartitionPtr> & calcGrids,
+        long numT, int numThreads);
+
+    /**
+     * Run every grid from timestep 0 up to numT-1, with the same priming of
+     * the pump at timestep 0 as FDTDApplication::runUntimed().  Returns when
+     * all grids are done.
+     */
+    void run();
+
+private:
+    struct GridNode
+    {
+        CalculationPartition* grid;
+        std::vector<int> neighbors;
+        long nextHalfStep;
+        bool busy;
+    };
+
+    void workerLoop();
+    bool isReady(int gridNum) const;
+    void runHalfStep(CalculationPartition & grid, long halfStep);
+    void printProgress();
+
+    std::vector<GridNode> mGrids;
+    long mNumT;
+    long mNumHalfSteps;
+    int mNumThreads;
+
+    long mNumGridsFinished;
+    long mLastPrintedTimestep;
+    boost::mutex mMutex;
+    boost::condition_variable mCondition;
+};
+
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ *  HaloExchange.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "HaloExchange.h"
+#include "YeeUtilities.h"
+
+using namespace std;
+using namespace YeeUtilities;
+
+HaloExchange::
+HaloExchange(NodeCommunicatorPtr communicator, Vector3i numNodes,
+    Vector3i thisNode, const Rect3i & calcHalfCells,
+    const Rect3i & gridHalfCells) :
+    mCommunicator(communicator),
+    mThisNode(thisNode)
+{
+    for (int faceNum = 0; faceNum < 6; faceNum++)
+    {
+        int xyz = faceNum/2;
+        
+        // Axes that are not split, or too thin to split, span the grid.
+        if (calcHalfCells.p1[xyz] <= gridHalfCells.p1[xyz] &&
+            calcHalfCells.p2[xyz] >= gridHalfCells.p2[xyz])
+        {
+            mNeighborRanks[faceNum] = -1;
+            continue;
+        }
+        
+        // The lattice of a whole grid wraps around at its edges, so the
+        // nodes at the ends of an axis are neighbors too.
+        Vector3i neighbor(thisNode + cardinal(faceNum));
+        neighbor[xyz] = (neighbor[xyz] + numNodes[xyz])%numNodes[xyz];
+        mNeighborRanks[faceNum] = rank(numNodes, neighbor);
+
+        // Send the last Yee cell inside the partition and receive the first
+        // Yee cell outside of it.
+        mSendHalfCells[faceNum] = calcHalfCells;
+        mReceiveHalfCells[faceNum] = calcHalfCells;
+        if (faceNum%2 == 0)
+        {
+            mSendHalfCells[faceNum].p2[xyz] = calcHalfCells.p1[xyz]+1;
+            mReceiveHalfCells[faceNum].p1[xyz] = calcHalfCells.p1[xyz]-2;
+            mReceiveHalfCells[faceNum].p2[xyz] = calcHalfCells.p1[xyz]-1;
+        }
+        else
+        {
+            mSendHalfCells[faceNum].p1[xyz] = calcHalfCells.p2[xyz]-1;
+            mReceiveHalfCells[faceNum].p1[xyz] = calcHalfCells.p2[xyz]+1;
+            mReceiveHalfCells[faceNum].p2[xyz] = calcHalfCells.p2[xyz]+2;
+        }
+    }
+}
+
+int HaloExchange::
+rank(Vector3i numNodes, Vector3i node)
+{
+    return node[0] + numNodes[0]*(node[1] + numNodes[1]*node[2]);
+}
+
+void HaloExchange::
+exchangeE(InterleavedLattice & lattice)
+{
+    exchange(lattice, true);
+}
+
+void HaloExchange::
+exchangeH(InterleavedLattice & lattice)
+{
+    exchange(lattice, false);
+}
+
+void HaloExchange::
+exchange(InterleavedLattice & lattice, bool isE)
+{
+    // Each face sends to the neighbor on its side and receives from the
+    // neighbor on the other side, so every node along an axis passes cells
+    // the same way at once.  Nodes at even positions send first and nodes at
+    // odd positions receive first; in a ring of odd length the two even
+    // nodes that meet across the wraparound still finish, because the odd
+    // node next to them receives first.
+    for (int faceNum = 0; faceNum < 6; faceNum++)
+    if (mNeighborRanks[faceNum] != -1)
+    {
+        int xyz = faceNum/2;
+        int oppositeFace = (faceNum%2 == 0) ? faceNum+1 : faceNum-1;
+        int sendRank = mNeighborRanks[faceNum];
+        int receiveRank = mNeighborRanks[oppositeFace];
+
+        pack(lattice, mSendHalfCells[faceNum], isE, mSendBuffer);
+        mReceiveBuffer.resize(mSendBuffer.size());
+        long numBytes = mSendBuffer.size()*sizeof(FieldStorage);
+
+        if (mThisNode[xyz]%2 == 0)
+        {
+            mCommunicator->send(sendRank, &mSendBuffer[0], numBytes);
+            mCommunicator->receive(receiveRank, &mReceiveBuffer[0],
+                numBytes);
+        }
+        else
+        {
+            mCommunicator->receive(receiveRank, &mReceiveBuffer[0],
+                numBytes);
+            mCommunicator->send(sendRank, &mSendBuffer[0], numBytes);
+        }
+
+        unpack(lattice, mReceiveHalfCells[oppositeFace], isE,
+            mReceiveBuffer);
+    }
+}
+
+void HaloExchange::
+pack(const InterleavedLattice & lattice, const Rect3i & halfCells, bool isE,
+    vector<FieldStorage> & buffer) const
+{
+    buffer.clear();
+    for (int direction = 0; direction < 3; direction++)
+    {
+        int octant = isE ? octantE(direction) : octantH(direction);
+        Rect3i yee(halfToYee(halfCells, octant));
+        Vector3i x;
+
+        for (x[2] = yee.p1[2]; x[2] <= yee.p2[2]; x[2]++)
+        for (x[1] = yee.p1[1]; x[1] <= yee.p2[1]; x[1]++)
+        for (x[0] = yee.p1[0]; x[0] <= yee.p2[0]; x[0]++)
+        {
+            // Send the stored values, not floats, so a double build doesn't
+            // round the fields at partition boundaries.
+            if (isE)
+                buffer.push_back(*lattice.pointerE(direction, x).pointer());
+            else
+                buffer.push_back(*lattice.pointerH(direction, x).pointer());
+        }
+    }
+}
+
+void HaloExchange::
+unpack(InterleavedLattice & lattice, const Rect3i & halfCells, bool isE,
+    const vector<FieldStorage> & buffer) const
+{
+    long nn = 0;
+    for (int direction = 0; direction < 3; direction++)
+    {
+        int octant = isE ? octantE(direction) : octantH(direction);
+        Rect3i yee(halfToYee(halfCells, octant));
+        Vector3i x;
+
+        for (x[2] = yee.p1[2]; x[2] <= yee.p2[2]; x[2]++)
+        for (x[1] = yee.p1[1]; x[1] <= yee.p2[1]; x[1]++)
+        for (x[0] = yee.p1[0]; x[0] <= yee.p2[0]; x[0]++)
+        {
+            assert(nn < buffer.size());
+            if (isE)
+                *lattice.pointerE(direction, x).pointer() = buffer[nn++];
+            else
+                *lattice.pointerH(direction, x).pointer() = buffer[nn++];
+        }
+    }
+    assert(nn == buffer.size());
+}
+
@@ -0,0 +1,71 @@
+/*
+ *  HaloExchange.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _HALOEXCHANGE_
+#define _HALOEXCHANGE_
+
+#include "NodeCommunicator.h"
+#include "InterleavedLattice.h"
+#include "FieldStorage.h"
+#include "Pointer.h"
+#include "geometry.h"
+#include <vector>
+
+/**
+ * Keeps the ghost cells of one node's partition of a grid up to date.  The
+ * grid is cut into numNodes[0] x numNodes[1] x numNodes[2] boxes along Yee
+ * cell boundaries, and each node allocates one extra Yee cell past each face
+ * of its box along the split axes (see
+ * FDTDApplication::voxelizeGridRecursor).  After every E or H half-step the
+ * outermost Yee cell of the box is sent to the neighbor, which stores it in
+ * its ghost cells.  At the edges of the grid the neighbor is the node at the
+ * other end of the axis, just as the lattice of an unsplit grid wraps around.
+ * The update equations never look diagonally, so faces are enough; edges and
+ * corners are not exchanged.
+ */
+class HaloExchange
+{
+public:
+    /**
+     * @param communicator Connection to the other nodes
+     * @param numNodes Number of nodes along x, y and z
+     * @param thisNode Position of this node; the rank is
+     *  thisNode[0] + numNodes[0]*(thisNode[1] + numNodes[1]*thisNode[2])
+     * @param calcHalfCells The part of the grid this node updates
+     * @param gridHalfCells The whole grid; axes along which calcHalfCells
+     *  spans it have no neighbors
+     */
+    HaloExchange(NodeCommunicatorPtr communicator, Vector3i numNodes,
+        Vector3i thisNode, const Rect3i & calcHalfCells,
+        const Rect3i & gridHalfCells);
+
+    void exchangeE(InterleavedLattice & lattice);
+    void exchangeH(InterleavedLattice & lattice);
+
+    static int rank(Vector3i numNodes, Vector3i node);
+
+private:
+    void exchange(InterleavedLattice & lattice, bool isE);
+    void pack(const InterleavedLattice & lattice, const Rect3i & halfCells,
+        bool isE, std::vector<FieldStorage> & buffer) const;
+    void unpack(InterleavedLattice & lattice, const Rect3i & halfCells,
+        bool isE, const std::vector<FieldStorage> & buffer) const;
+
+    NodeCommunicatorPtr mCommunicator;
+    Vector3i mThisNode;
+    int mNeighborRanks[6]; // -1 where there's no neighbor
+    Rect3i mSendHalfCells[6];
+    Rect3i mReceiveHalfCells[6];
+
+    std::vector<FieldStorage> mSendBuffer;
+    std::vector<FieldStorage> mReceiveBuffer;
+};
+typedef Pointer<HaloExchange> HaloExchangePtr;
+
+
+#endif
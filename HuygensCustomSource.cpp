@@ -18,11 +18,42 @@ using namespace YeeUtilities;
 using namespace std;
 
 HuygensCustomSource::
-HuygensCustomSource(const HuygensSurface & hs) :
+HuygensCustomSource(const HuygensSurface & hs,
+    const VoxelizedPartition & vp) :
     mDescription(hs.description()),
     mFieldInput(hs.description()),
     mDuration(hs.description()->duration())
 {
+    // Each timestep reads H (in updateH(), before the E update) and then E,
+    // one value per cell of each face.  The records always cover the whole
+    // surface; when the grid is split among nodes each node skips the values
+    // outside its own neighbor buffers.
+    long numE = 0, numH = 0;
+    vector<vector<Rect3i> > yeeCellsE(3), yeeCellsH(3);
+    for (int fieldDirection = 0; fieldDirection < 3; fieldDirection++)
+    for (int faceNum = 0; faceNum < 6; faceNum++)
+    if (hs.hasFace(faceNum))
+    {
+        yeeCellsE[fieldDirection].push_back(halfToYee(
+            hs.faceHalfCells(faceNum), octantE(fieldDirection)));
+        yeeCellsH[fieldDirection].push_back(halfToYee(
+            hs.faceHalfCells(faceNum), octantH(fieldDirection)));
+        numE += yeeCellsE[fieldDirection].back().count();
+        numH += yeeCellsH[fieldDirection].back().count();
+    }
+    
+    vector<long> recordLengths;
+    recordLengths.push_back(numH);
+    recordLengths.push_back(numE);
+    mFieldInput.prefetch(recordLengths);
+    mFieldInput.setCells(yeeCellsE, yeeCellsH,
+        vp.gridDescription()->originYee(), vp.gridDescription()->dxyz());
+}
+
+double HuygensCustomSource::
+inputStallMicroseconds() const
+{
+    return mFieldInput.stallMicroseconds();
 }
 
 void HuygensCustomSource::
@@ -37,63 +68,72 @@ updateE(HuygensSurface & hs, CalculationPartition & cp, long timestep)
     
     const std::vector<NeighborBufferPtr> & nbs(hs.neighborBuffers());
     InterleavedLatticePtr destLattice(hs.destLattice());
+    Vector3i destStride = destLattice->fieldStride();
     
     for (int fieldDirection = 0; fieldDirection < 3; fieldDirection++)
     {
         mFieldInput.restartMaskPointer(fieldDirection);
         for (int bufNum = 0; bufNum < nbs.size(); bufNum++)
-        if (nbs.at(bufNum) != 0L)
+        if (hs.hasFace(bufNum))
         {
-            InterleavedLatticePtr bufferLattice = nbs[bufNum]->lattice();
-            
-            Rect3i destYeeCells = halfToYee(nbs[bufNum]->destHalfCells(),
+            Rect3i faceYeeCells = halfToYee(hs.faceHalfCells(bufNum),
                 octantE(fieldDirection));
-            Rect3i sourceYeeCells = halfToYee(nbs[bufNum]->
-                sourceHalfCells(), octantE(fieldDirection));
-            
-            const float srcFactor =
-                nbs[bufNum]->sourceFactorE(fieldDirection);
-            const float destFactor =
-                nbs[bufNum]->destFactorE(fieldDirection);
             
-            Vector3i bufStride = bufferLattice->fieldStride();
-            Vector3i destStride = hs.destLattice()->fieldStride();
-            
-            BufferPointer destp = hs.destLattice()->wrappedPointerE(
-                fieldDirection, destYeeCells.p1);
-            BufferPointer bufp = bufferLattice->wrappedPointerE(
-                fieldDirection, destYeeCells.p1);
-            
-            float *pdest, *pbuf;
-            pdest = destp.pointer();
-            pbuf = bufp.pointer();
+            // Values for cells outside this node's buffer (or for the whole
+            // face, if the node has no buffer here) are read and dropped.
+            Rect3i destYeeCells(faceYeeCells.p1, faceYeeCells.p1 -
+                Vector3i(1,1,1));
+            InterleavedLatticePtr bufferLattice;
+            Vector3i bufStride;
+            float srcFactor = 0.0f, destFactor = 0.0f;
+            if (nbs.at(bufNum) != 0L)
+            {
+                destYeeCells = halfToYee(nbs[bufNum]->destHalfCells(),
+                    octantE(fieldDirection));
+                bufferLattice = nbs[bufNum]->lattice();
+                bufStride = bufferLattice->fieldStride();
+                srcFactor = nbs[bufNum]->sourceFactorE(fieldDirection);
+                destFactor = nbs[bufNum]->destFactorE(fieldDirection);
+            }
             
             float srcField, destField, bufField;
             Vector3i yee;
             
-            for (yee[2] = 0; yee[2] < destYeeCells.num(2); yee[2]++)
+            for (yee[2] = faceYeeCells.p1[2]; yee[2] <= faceYeeCells.p2[2];
+                yee[2]++)
+            for (yee[1] = faceYeeCells.p1[1]; yee[1] <= faceYeeCells.p2[1];
+                yee[1]++)
             {
-                float* desty = pdest;
-                float* bufy = pbuf;
-                for (yee[1] = 0; yee[1] < destYeeCells.num(1); yee[1]++)
+                if (yee[1] < destYeeCells.p1[1] || yee[1] > destYeeCells.p2[1]
+                    || yee[2] < destYeeCells.p1[2] ||
+                    yee[2] > destYeeCells.p2[2])
+                {
+                    for (int nn = 0; nn < faceYeeCells.num(0); nn++)
+                        mFieldInput.getFieldE(fieldDirection);
+                    continue;
+                }
+                
+                Vector3i rowStart(destYeeCells.p1[0], yee[1], yee[2]);
+                FieldStorage* destx = destLattice->wrappedPointerE(
+                    fieldDirection, rowStart).pointer();
+                FieldStorage* bufx = bufferLattice->wrappedPointerE(
+                    fieldDirection, rowStart).pointer();
+                
+                for (yee[0] = faceYeeCells.p1[0]; yee[0] <= faceYeeCells.p2[0];
+                    yee[0]++)
                 {
-                    float* destx = desty;
-                    float* bufx = bufy;
-                    for (yee[0] = 0; yee[0] < destYeeCells.num(0); yee[0]++)
-                    {
-                        srcField = mFieldInput.getFieldE(fieldDirection);
-                        destField = *destx;
-                        bufField = srcFactor*srcField + destFactor*destField;
-                        *bufx = bufField;
-                        
-                        bufx += bufStride[0];
-                        destx += destStride[0];
-                    }
-                    bufy += bufStride[1];
-                    desty += destStride[1];
+                    srcField = mFieldInput.getFieldE(fieldDirection);
+                    if (yee[0] < destYeeCells.p1[0] ||
+                        yee[0] > destYeeCells.p2[0])
+                        continue;
+                    
+                    destField = *destx;
+                    bufField = srcFactor*srcField + destFactor*destField;
+                    *bufx = bufField;
+                    
+                    bufx += bufStride[0];
+                    destx += destStride[0];
                 }
-                pdest += destStride[2];
-                pbuf += bufStride[2];
             }
         }
     }
@@ -111,64 +151,74 @@ updateH(HuygensSurface & hs, CalculationPartition & cp, long timestep)
     
     const std::vector<NeighborBufferPtr> & nbs(hs.neighborBuffers());
     InterleavedLatticePtr destLattice(hs.destLattice());
+    Vector3i destStride = destLattice->fieldStride();
     
     for (int fieldDirection = 0; fieldDirection < 3; fieldDirection++)
     {
         mFieldInput.restartMaskPointer(fieldDirection);
         for (int bufNum = 0; bufNum < nbs.size(); bufNum++)
-        if (nbs.at(bufNum) != 0L)
+        if (hs.hasFace(bufNum))
         {
-            InterleavedLatticePtr bufferLattice = nbs[bufNum]->lattice();
-            
-            Rect3i destYeeCells = halfToYee(nbs[bufNum]->destHalfCells(),
+            Rect3i faceYeeCells = halfToYee(hs.faceHalfCells(bufNum),
                 octantH(fieldDirection));
-            Rect3i sourceYeeCells = halfToYee(nbs[bufNum]->
-                sourceHalfCells(), octantH(fieldDirection));
-            
-            const float srcFactor =
-                nbs[bufNum]->sourceFactorH(fieldDirection);
-            const float destFactor =
-                nbs[bufNum]->destFactorH(fieldDirection);
-            
-            Vector3i bufStride = bufferLattice->fieldStride();
-            Vector3i destStride = hs.destLattice()->fieldStride();
             
-            BufferPointer destp = hs.destLattice()->wrappedPointerH(
-                fieldDirection, destYeeCells.p1);
-            BufferPointer bufp = bufferLattice->wrappedPointerH(
-                fieldDirection, destYeeCells.p1);
-            
-            float *pdest, *pbuf;
-            pdest = destp.pointer();
-            pbuf = bufp.pointer();
+            // Values for cells outside this node's buffer (or for the whole
+            // face, if the node has no buffer here) are read and dropped.
+            Rect3i destYeeCells(faceYeeCells.p1, faceYeeCells.p1 -
+                Vector3i(1,1,1));
+            InterleavedLatticePtr bufferLattice;
+            Vector3i bufStride;
+            float srcFactor = 0.0f, destFactor = 0.0f;
+            if (nbs.at(bufNum) != 0L)
+            {
+                destYeeCells = halfToYee(nbs[bufNum]->destHalfCells(),
+                    octantH(fieldDirection));
+                bufferLattice = nbs[bufNum]->lattice();
+                bufStride = bufferLattice->fieldStride();
+                srcFactor = nbs[bufNum]->sourceFactorH(fieldDirection);
+                destFactor = nbs[bufNum]->destFactorH(fieldDirection);
+            }
             
             float srcField, destField, bufField;
             Vector3i yee;
             
-            for (yee[2] = 0; yee[2] < destYeeCells.num(2); yee[2]++)
+            for (yee[2] = faceYeeCells.p1[2]; yee[2] <= faceYeeCells.p2[2];
+                yee[2]++)
+            for (yee[1] = faceYeeCells.p1[1]; yee[1] <= faceYeeCells.p2[1];
+                yee[1]++)
             {
-                float* desty = pdest;
-                float* bufy = pbuf;
-                for (yee[1] = 0; yee[1] < destYeeCells.num(1); yee[1]++)
+                if (yee[1] < destYeeCells.p1[1] || yee[1] > destYeeCells.p2[1]
+                    || yee[2] < destYeeCells.p1[2] ||
+                    yee[2] > destYeeCells.p2[2])
                 {
-                    float* destx = desty;
-                    float* bufx = bufy;
-                    for (yee[0] = 0; yee[0] < destYeeCells.num(0); yee[0]++)
-                    {
-                        srcField = mFieldInput.getFieldH(fieldDirection);
-                        destField = *destx;
-                        bufField = srcFactor*srcField + destFactor*destField;
-                        *bufx = bufField;
-                        
-                        bufx += bufStride[0];
-                        destx += destStride[0];
-                    }
-                    bufy += bufStride[1];
-                    desty += destStride[1];
+                    for (int nn = 0; nn < faceYeeCells.num(0); nn++)
+                        mFieldInput.getFieldH(fieldDirection);
+                    continue;
+                }
+                
+                Vector3i rowStart(destYeeCells.p1[0], yee[1], yee[2]);
+                FieldStorage* destx = destLattice->wrappedPointerH(
+                    fieldDirection, rowStart).pointer();
+                FieldStorage* bufx = bufferLattice->wrappedPointerH(
+                    fieldDirection, rowStart).pointer();
+                
+                for (yee[0] = faceYeeCells.p1[0]; yee[0] <= faceYeeCells.p2[0];
+                    yee[0]++)
+                {
+                    srcField = mFieldInput.getFieldH(fieldDirection);
+                    if (yee[0] < destYeeCells.p1[0] ||
+                        yee[0] > destYeeCells.p2[0])
+                        continue;
+                    
+                    destField = *destx;
+                    bufField = srcFactor*srcField + destFactor*destField;
+                    *bufx = bufField;
+                    
+                    bufx += bufStride[0];
+                    destx += destStride[0];
                 }
-                pdest += destStride[2];
-                pbuf += bufStride[2];
             }
         }
     }
 }
+
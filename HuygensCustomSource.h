@@ -19,18 +19,22 @@
  * Update equation for custom TFSF sources.  On every timestep, sums (with
  * appropriate signs) incident fields from a source file with total or scattered
  * fields from a main grid and stores the fields in NeighborBuffers.  All
- * required data is obtained from the HuygensSurface.
+ * required data is obtained from the HuygensSurface.  The incident fields may
+ * instead be given by formulas in n, t, x, y and z.
  */
 class HuygensCustomSource : public HuygensUpdate
 {
 public:
-    HuygensCustomSource(const HuygensSurface & hs);
+    HuygensCustomSource(const HuygensSurface & hs,
+        const VoxelizedPartition & vp);
     
     virtual void updateE(HuygensSurface & hs, CalculationPartition & cp,
         long timestep);
     virtual void updateH(HuygensSurface & hs, CalculationPartition & cp,
         long timestep);
     
+    virtual double inputStallMicroseconds() const;
+    
 private:
     HuygensSurfaceDescPtr mDescription;
     StreamedFieldInput mFieldInput;
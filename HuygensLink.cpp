@@ -59,7 +59,7 @@ updateE(HuygensSurface & hs, CalculationPartition & cp, long timestep)
             BufferPointer bufp = bufferLattice->wrappedPointerE(
                 fieldDirection, destYeeCells.p1);
             
-            float *psrc, *pdest, *pbuf;
+            FieldStorage *psrc, *pdest, *pbuf;
             psrc = srcp.pointer();
             pdest = destp.pointer();
             pbuf = bufp.pointer();
@@ -69,14 +69,14 @@ updateE(HuygensSurface & hs, CalculationPartition & cp, long timestep)
             
             for (yee[2] = 0; yee[2] < destYeeCells.num(2); yee[2]++)
             {
-                float* srcy = psrc;
-                float* desty = pdest;
-                float* bufy = pbuf;
+                FieldStorage* srcy = psrc;
+                FieldStorage* desty = pdest;
+                FieldStorage* bufy = pbuf;
                 for (yee[1] = 0; yee[1] < destYeeCells.num(1); yee[1]++)
                 {
-                    float* srcx = srcy;
-                    float* destx = desty;
-                    float* bufx = bufy;
+                    FieldStorage* srcx = srcy;
+                    FieldStorage* destx = desty;
+                    FieldStorage* bufx = bufy;
                     for (yee[0] = 0; yee[0] < destYeeCells.num(0); yee[0]++)
                     {
                         srcField = *srcx;
@@ -202,7 +202,7 @@ updateH(HuygensSurface & hs, CalculationPartition & cp, long timestep)
             BufferPointer bufp = bufferLattice->wrappedPointerH(
                 fieldDirection, destYeeCells.p1);
             
-            float *psrc, *pdest, *pbuf;
+            FieldStorage *psrc, *pdest, *pbuf;
             psrc = srcp.pointer();
             pdest = destp.pointer();
             pbuf = bufp.pointer();
@@ -212,14 +212,14 @@ updateH(HuygensSurface & hs, CalculationPartition & cp, long timestep)
             
             for (yee[2] = 0; yee[2] < destYeeCells.num(2); yee[2]++)
             {
-                float* srcy = psrc;
-                float* desty = pdest;
-                float* bufy = pbuf;
+                FieldStorage* srcy = psrc;
+                FieldStorage* desty = pdest;
+                FieldStorage* bufy = pbuf;
                 for (yee[1] = 0; yee[1] < destYeeCells.num(1); yee[1]++)
                 {
-                    float* srcx = srcy;
-                    float* destx = desty;
-                    float* bufx = bufy;
+                    FieldStorage* srcx = srcy;
+                    FieldStorage* destx = desty;
+                    FieldStorage* bufx = bufy;
                     for (yee[0] = 0; yee[0] < destYeeCells.num(0); yee[0]++)
                     {
                         srcField = *srcx;
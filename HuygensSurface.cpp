@@ -37,7 +37,7 @@ newHuygensSurface(string namePrefix,
     }
     else if (desc->type() == kCustomTFSFSource)
     {
-        update = HuygensUpdatePtr(new HuygensCustomSource(*hs));
+        update = HuygensUpdatePtr(new HuygensCustomSource(*hs, vp));
         hs->setUpdater(update);
     }
     else
@@ -66,27 +66,53 @@ HuygensSurface(string namePrefix, const VoxelizedPartition & vp,
         sourceHalfCells = surfaceDescription->fromHalfCells();
     }
     
+    // When the grid is split among nodes, each node keeps only the part of
+    // the surface that its own cells use.  The update of a cell reads the
+    // buffer on its side of the boundary and on the far side, which may be
+    // in the ghost cells, so keep one Yee cell beyond the calc region.  The
+    // buffer lattices must span whole Yee cells.
+    Rect3i nodeYeeCells(vp.calcYeeCells());
+    nodeYeeCells.p1 -= Vector3i(1,1,1);
+    nodeYeeCells.p2 += Vector3i(1,1,1);
+    Rect3i nodeHalfCells(yeeToHalf(nodeYeeCells));
+    
     for (int sideNum = 0; sideNum < 6; sideNum++)
+    if (hasFace(sideNum))
     {
+        Rect3i nodeFace(NeighborBuffer::nodeEdgeHalfCells(mHalfCells,
+            sideNum, nodeHalfCells));
+        if (nodeFace.num(0) <= 0 || nodeFace.num(1) <= 0 ||
+            nodeFace.num(2) <= 0)
+            continue;
+        
         ostringstream bufPrefix;
         bufPrefix << namePrefix << " side " << sideNum;
-        Vector3i sideVector(cardinal(sideNum));
-        if (!surfaceDescription->omittedSides().count(sideVector))
-        {
-            float incidentFieldFactor =
-                surfaceDescription->isTotalField() ? 1.0 : -1.0;
-            NeighborBufferPtr p(new NeighborBuffer(
-                bufPrefix.str(),
-                surfaceDescription->halfCells(),
-                sourceHalfCells,
-                sideNum,
-                incidentFieldFactor));
-            mNeighborBuffers[sideNum] = p;
-        }
+        float incidentFieldFactor =
+            surfaceDescription->isTotalField() ? 1.0 : -1.0;
+        NeighborBufferPtr p(new NeighborBuffer(
+            bufPrefix.str(),
+            surfaceDescription->halfCells(),
+            sourceHalfCells,
+            sideNum,
+            incidentFieldFactor,
+            nodeHalfCells));
+        mNeighborBuffers[sideNum] = p;
     }
     
 }
 
+bool HuygensSurface::
+hasFace(int side) const
+{
+    return !mDescription->omittedSides().count(cardinal(side));
+}
+
+Rect3i HuygensSurface::
+faceHalfCells(int side) const
+{
+    return NeighborBuffer::edgeHalfCells(mHalfCells, side);
+}
+
 void HuygensSurface::
 allocate()
 {
@@ -111,16 +137,24 @@ updateH(CalculationPartition & cp, long timestep)
     mUpdate->updateH(*this, cp, timestep);
 }
 
+double HuygensSurface::
+inputStallMicroseconds() const
+{
+    assert(mUpdate != 0L);
+    return mUpdate->inputStallMicroseconds();
+}
+
 NeighborBuffer::
 NeighborBuffer(string prefix,
     const Rect3i & huygensHalfCells, int sideNum,
-    float incidentFieldFactor) :
+    float incidentFieldFactor, const Rect3i & nodeHalfCells) :
     mDestFactorsE(3),
     mSourceFactorsE(3),
     mDestFactorsH(3),
     mSourceFactorsH(3)
 {
-    Rect3i destHalfRect(edgeHalfCells(huygensHalfCells, sideNum));
+    Rect3i destHalfRect(nodeEdgeHalfCells(huygensHalfCells, sideNum,
+        nodeHalfCells));
     initFactors(huygensHalfCells, sideNum, incidentFieldFactor);
     
     mLattice = InterleavedLatticePtr(new InterleavedLattice(
@@ -131,14 +165,19 @@ NeighborBuffer::
 NeighborBuffer(string prefix,
     const Rect3i & huygensHalfCells, const Rect3i & sourceHalfCells,
     int sideNum,
-    float incidentFieldFactor) :
+    float incidentFieldFactor,
+    const Rect3i & nodeHalfCells) :
     mDestFactorsE(3),
     mSourceFactorsE(3),
     mDestFactorsH(3),
     mSourceFactorsH(3)
 {
-    Rect3i destHalfRect(edgeHalfCells(huygensHalfCells, sideNum));
-    mSourceHalfCells = edgeHalfCells(sourceHalfCells, sideNum);
+    // The source rect moves with the dest rect when it is clipped.
+    Rect3i destHalfRect(nodeEdgeHalfCells(huygensHalfCells, sideNum,
+        nodeHalfCells));
+    mSourceHalfCells = destHalfRect +
+        (edgeHalfCells(sourceHalfCells, sideNum).p1 -
+        edgeHalfCells(huygensHalfCells, sideNum).p1);
     
     initFactors(huygensHalfCells, sideNum, incidentFieldFactor);
     
@@ -205,6 +244,21 @@ edgeHalfCells(const Rect3i & halfCells, int nSide)
     return outerHalfCells;
 }
 
+Rect3i NeighborBuffer::
+nodeEdgeHalfCells(const Rect3i & halfCells, int nSide,
+    const Rect3i & nodeHalfCells)
+{
+    Rect3i face(edgeHalfCells(halfCells, nSide));
+    Rect3i nodeFace(intersection(face, nodeHalfCells));
+    
+    if (nodeFace.num(nSide/2) > 0)
+    {
+        nodeFace.p1[nSide/2] = face.p1[nSide/2];
+        nodeFace.p2[nSide/2] = face.p2[nSide/2];
+    }
+    return nodeFace;
+}
+
 void NeighborBuffer::
 initFactors(const Rect3i & huygensHalfCells, int sideNum,
     float incidentFieldFactor)
@@ -83,6 +83,20 @@ public:
     
     HuygensSurfaceDescPtr description() const { return mDescription; }
     const Rect3i & halfCells() const { return mHalfCells; }
+    
+    /**
+     * True if the whole surface has this side, i.e. it is not omitted.  When
+     * the grid is split among nodes a node has buffers only for the sides
+     * that pass through it; see hasBuffer().
+     */
+    bool hasFace(int side) const;
+    
+    /**
+     * The half cells on both sides of one face of the whole surface, whether
+     * or not this node has a buffer for them.
+     */
+    Rect3i faceHalfCells(int side) const;
+    
     bool hasBuffer(int side) const { return mNeighborBuffers.at(side) != 0L; }
     NeighborBufferPtr buffer(int side) const
         { return mNeighborBuffers.at(side); }
@@ -114,6 +128,11 @@ public:
      * the boundary, this function calls updater->updateH().
      */
     void updateH(CalculationPartition & cp, long timestep);
+    
+    /**
+     * Time spent so far waiting for the updater's input data.
+     */
+    double inputStallMicroseconds() const;
 private:
     HuygensSurfaceDescPtr mDescription;
     Rect3i mHalfCells;
@@ -152,6 +171,12 @@ public:
      */
     virtual void updateH(HuygensSurface & hs, CalculationPartition & cp,
         long timestep) {}
+    
+    /**
+     * Time spent so far waiting for input data, e.g. for a prefetcher to
+     * read a source file.
+     */
+    virtual double inputStallMicroseconds() const { return 0.0; }
 };
 
 /**
@@ -167,14 +192,19 @@ public:
 class NeighborBuffer
 {
 public:
+    /**
+     * The buffer covers the part of the face within nodeHalfCells; it must
+     * not be empty (see edgeHalfCells()).
+     */
     NeighborBuffer(std::string prefix,
         const Rect3i & huygensHalfCells, int sideNum,
-        float incidentFieldFactor);
+        float incidentFieldFactor, const Rect3i & nodeHalfCells);
     NeighborBuffer(std::string prefix,
         const Rect3i & huygensHalfCells, 
         const Rect3i & sourceHalfCells,
         int sideNum,
-        float incidentFieldFactor);
+        float incidentFieldFactor,
+        const Rect3i & nodeHalfCells);
     
     const Rect3i & destHalfCells() const;
     const Rect3i & sourceHalfCells() const;
@@ -184,8 +214,21 @@ public:
     float sourceFactorH(int fieldDirection) const;
     
     InterleavedLatticePtr lattice() const { return mLattice; }
+    
+    /**
+     * The half cells on both sides of one face of a TFSF boundary.
+     */
+    static Rect3i edgeHalfCells(const Rect3i & halfCells, int nSide);
+    
+    /**
+     * The part of edgeHalfCells() within nodeHalfCells along the face.  The
+     * buffer stays two half cells thick across the face, which may straddle
+     * the Yee cells of a node boundary; it is empty if the node does not
+     * reach the face at all.
+     */
+    static Rect3i nodeEdgeHalfCells(const Rect3i & halfCells, int nSide,
+        const Rect3i & nodeHalfCells);
 private:
-    Rect3i edgeHalfCells(const Rect3i & halfCells, int nSide);
     void initFactors(const Rect3i & huygensHalfCells, int sideNum,
         float incidentFieldFactor);
     
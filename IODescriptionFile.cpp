@@ -27,10 +27,45 @@ write(std::string fileName, OutputDescPtr description,
     const vector<Duration> & outputDurations)
 {
     ofstream file(fileName.c_str());
+    write(file, fileName, description, vp, outputRegions, outputDurations);
+    file.close();
+}
+
+void IODescriptionFile::
+write(ostream & file, std::string fileName, OutputDescPtr description,
+    const VoxelizedPartition & vp,
+    const vector<Region> & outputRegions,
+    const vector<Duration> & outputDurations)
+{
     writeOutputHeader(file, vp, fileName);
     
     file << "datafile " << description->file() << "\n";
     //file << "materialfile " << description->file() << ".mat\n";
+    if (description->errorBound() > 0)
+    {
+        file << "errorBound " << description->errorBound()
+            << (description->isErrorBoundRelative() ? " relative\n" :
+                " absolute\n");
+    }
+    for (int ff = 0; ff < description->frequencies().size(); ff++)
+        file << "frequency " << description->frequencies()[ff] << "\n";
+    
+    // Flux and energy outputs have one value per sample and no fields.
+    if (description->reduction() != kNoReduction)
+    {
+        if (description->reduction() == kFluxReduction)
+        {
+            file << "reduction flux\n";
+            if (description->frequencies().size() > 0)
+                file << "spectrumfile " << description->file()
+                    << ".spectrum\n";
+        }
+        else
+            file << "reduction energy\n";
+        writeOutputRegions(file, vp, outputRegions);
+        writeOutputDurations(file, vp, outputDurations);
+        return;
+    }
     
     int nn;
     if (!description->isInterpolated())
@@ -105,7 +140,15 @@ write(std::string fileName, OutputDescPtr description,
     
     writeOutputRegions(file, vp, outputRegions);
     writeOutputDurations(file, vp, outputDurations);
-    
+}
+
+void IODescriptionFile::
+writeCompression(std::string fileName, double compressionRatio,
+    double maxError)
+{
+    ofstream file(fileName.c_str(), ios::app);
+    file << "compressionRatio " << compressionRatio << "\n";
+    file << "maxError " << maxError << "\n";
     file.close();
 }
 
@@ -317,17 +360,17 @@ write(std::string fileName, const HuygensSurface & huygensSurface,
         
         // Try to save materials on a non-omitted side of the TF box.  If
         // this is not possible, print a warning and pick arbitrarily.
-        if (huygensSurface.hasBuffer(2*direction+1) &&
-            !huygensSurface.hasBuffer(2*direction))
+        if (huygensSurface.hasFace(2*direction+1) &&
+            !huygensSurface.hasFace(2*direction))
         {
             sampleHalfCells.p1[direction] = sampleHalfCells.p2[direction];
         }
-        else if (huygensSurface.hasBuffer(2*direction) &&
-            !huygensSurface.hasBuffer(2*direction+1))
+        else if (huygensSurface.hasFace(2*direction) &&
+            !huygensSurface.hasFace(2*direction+1))
         {
             sampleHalfCells.p2[direction] = sampleHalfCells.p1[direction];
         }
-        else if (huygensSurface.hasBuffer(2*direction))
+        else if (huygensSurface.hasFace(2*direction))
             sampleHalfCells.p2[direction] = sampleHalfCells.p1[direction];
         else
         {
@@ -425,10 +468,10 @@ write(std::string fileName, const HuygensSurface & huygensSurface,
         file << "afp.yee" + fieldNames[field] << " = [ ...\n";
         
         for (int faceNum = 0; faceNum < 6; faceNum++)
-        if (huygensSurface.hasBuffer(faceNum))
+        if (huygensSurface.hasFace(faceNum))
         {
             Rect3i yee;
-            yee = halfToYee(huygensSurface.buffer(faceNum)->destHalfCells(),
+            yee = halfToYee(huygensSurface.faceHalfCells(faceNum),
                 octant(fieldOffsets[field]));
             for (int kk = yee.p1[2]; kk <= yee.p2[2]; kk++)
             for (int jj = yee.p1[1]; jj <= yee.p2[1]; jj++)
@@ -445,10 +488,10 @@ write(std::string fileName, const HuygensSurface & huygensSurface,
         file << "afp.pos" + fieldNames[field] << " = [ ...\n";
         
         for (int faceNum = 0; faceNum < 6; faceNum++)
-        if (huygensSurface.hasBuffer(faceNum))
+        if (huygensSurface.hasFace(faceNum))
         {
             Rect3i yee;
-            yee = halfToYee(huygensSurface.buffer(faceNum)->destHalfCells(),
+            yee = halfToYee(huygensSurface.faceHalfCells(faceNum),
                 octant(fieldOffsets[field])) -
                 vp.gridDescription()->originYee();
             Vector3f theOffset(0.5*fieldOffsets[field][0],
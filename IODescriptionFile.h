@@ -33,6 +33,22 @@ public:
         const std::vector<Region> & outputRegions,
         const std::vector<Duration> & outputDurations);
     
+    /**
+     *  Write the same spec to a stream, e.g. to embed it in a chunked data
+     *  file.  fileName is only used for the header.
+     */
+    static void write(std::ostream & file, std::string fileName,
+        OutputDescPtr description, const VoxelizedPartition & vp,
+        const std::vector<Region> & outputRegions,
+        const std::vector<Duration> & outputDurations);
+    
+    /**
+     *  Append the size and error of a finished chunked data file to its
+     *  output's spec file.
+     */
+    static void writeCompression(std::string fileName,
+        double compressionRatio, double maxError);
+    
     /**
      *  Write the data request file for a current source.  The data request file
      *  will be an m-file with a function that returns a useful data structure.
@@ -16,6 +16,8 @@
 using namespace std;
 using namespace YeeUtilities;
 
+const int InterleavedLattice::ALIGNMENT;
+bool InterleavedLattice::sAlignedLayout = 0;
 
 InterleavedLattice::
 InterleavedLattice(const string & bufferNamePrefix, Rect3i halfCellBounds,
@@ -44,8 +46,25 @@ InterleavedLattice(const string & bufferNamePrefix, Rect3i halfCellBounds,
         mOriginYeeH[xyz] = halfToYee(mHalfCells, octantH(xyz)).p1;
     }
     
+    // With the aligned layout each row along the runline direction is padded
+    // to a whole number of cache lines.  Rows then start on cache line (and
+    // SIMD register) boundaries, and the padding is never read or written.
+    int alloc0 = runlineDirection;
+    int alloc1 = (alloc0+1)%3;
+    int alloc2 = (alloc1+1)%3;
+    int rowPitch = mNumYeeCells[alloc0];
+    mComponentGap = 0;
+    if (sAlignedLayout)
+    {
+        rowPitch = ALIGNMENT*((rowPitch + ALIGNMENT - 1)/ALIGNMENT);
+        
+        // Components whose sizes are multiples of 4 kB would otherwise sit at
+        // the same 4 kB offset and alias each other in the L1 cache.
+        mComponentGap = ALIGNMENT;
+    }
+    
     // Create the buffers
-    int bufferSize = mNumYeeCells[0]*mNumYeeCells[1]*mNumYeeCells[2];
+    int bufferSize = rowPitch*mNumYeeCells[alloc1]*mNumYeeCells[alloc2];
     for (int xyz = 0; xyz < 3; xyz++)
     {
         mBuffersE[xyz] = MemoryBufferPtr(new MemoryBuffer(
@@ -68,11 +87,8 @@ InterleavedLattice(const string & bufferNamePrefix, Rect3i halfCellBounds,
     // set the memory stride equal to zero along dimensions which are not used
     // (e.g. the z direction for a 2D, XY-plane lattice).
     
-    int alloc0 = runlineDirection;
-    int alloc1 = (alloc0+1)%3;
-    int alloc2 = (alloc1+1)%3;
     mMemStride[alloc0] = STRIDE;
-    mMemStride[alloc1] = mNumYeeCells[alloc0]*mMemStride[alloc0];
+    mMemStride[alloc1] = rowPitch*mMemStride[alloc0];
     mMemStride[alloc2] = mNumYeeCells[alloc1]*mMemStride[alloc1];
     
     for (int xyz = 0; xyz < 3; xyz++)
@@ -127,7 +143,7 @@ linearYeeIndex(const Vector3i & halfCell) const
     Vector3i displacement(halfCell - mHalfCells.p1);
     int index = dot(displacement/2, mMemStride); // mMemStride == 0 for null dims
     assert(index >= 0);
-    assert(index < mNumYeeCells[0]*mNumYeeCells[1]*mNumYeeCells[2]);
+    assert(index < fieldLength());
     
     return index;
 }
@@ -138,7 +154,7 @@ wrappedLinearYeeIndex(const Vector3i & halfCell) const
     Vector3i displacement(wrap(halfCell) - mHalfCells.p1);
     int index = dot(displacement/2, mMemStride); // mMemStride == 0 for null dims
     assert(index >= 0);
-    assert(index < mNumYeeCells[0]*mNumYeeCells[1]*mNumYeeCells[2]);
+    assert(index < fieldLength());
     
     return index;
 }
@@ -205,22 +221,24 @@ allocate()
     
     for (nn = 0; nn < 3; nn++)
     {
-        bufsize += mBuffersE.at(nn)->length();
-        bufsize += mBuffersH.at(nn)->length();
+        bufsize += mBuffersE.at(nn)->length() + mComponentGap;
+        bufsize += mBuffersH.at(nn)->length() + mComponentGap;
     }
-    mData.resize(bufsize);
+    // The six components are the same size, so the first-touch threads can
+    // take the same slab of each of them.
+    mData.resize(bufsize, 6);
     
     for (nn = 0; nn < 3; nn++)
     {
-        mBuffersE.at(nn)->setHeadPointer(&(mData.at(offset)));
+        mBuffersE.at(nn)->setHeadPointer(&mData[offset]);
         mHeadE[nn] = mBuffersE.at(nn)->headPointer();
-        offset += mBuffersE.at(nn)->length();
+        offset += mBuffersE.at(nn)->length() + mComponentGap;
     }
     for (nn = 0; nn < 3; nn++)
     {
-        mBuffersH.at(nn)->setHeadPointer(&(mData.at(offset)));
+        mBuffersH.at(nn)->setHeadPointer(&mData[offset]);
         mHeadH[nn] = mBuffersH.at(nn)->headPointer();
-        offset += mBuffersH.at(nn)->length();
+        offset += mBuffersH.at(nn)->length() + mComponentGap;
     }
     mFieldsAreAllocated = 1;
 }
@@ -233,7 +251,7 @@ getE(int direction, const Vector3i & yeeCell) const
     assert(mFieldsAreAllocated);
     assert(mHalfCells.encloses(yeeToHalf(yeeCell, octantE(direction))));
     
-    float* ptr;
+    FieldStorage* ptr;
     ptr = mHeadE[direction] + dot(yeeCell-mOriginYeeE[direction], mMemStride);
     
     assert(mBuffersE[direction]->includes(ptr));
@@ -247,7 +265,7 @@ getH(int direction, const Vector3i & yeeCell) const
     assert(mFieldsAreAllocated);
     assert(mHalfCells.encloses(yeeToHalf(yeeCell, octantH(direction))));
     
-    float* ptr;
+    FieldStorage* ptr;
     ptr = mHeadH[direction] + dot(yeeCell-mOriginYeeH[direction], mMemStride);
     
     assert(mBuffersH[direction]->includes(ptr));
@@ -260,7 +278,7 @@ getWrappedE(int direction, const Vector3i & yeeCell) const
 {
     assert(mFieldsAreAllocated);
     
-    float* ptr;
+    FieldStorage* ptr;
     ptr = mHeadE[direction] +
         dot( (yeeCell-mOriginYeeE[direction]+mNumYeeCells)%mNumYeeCells,
             mMemStride);
@@ -274,7 +292,7 @@ getWrappedH(int direction, const Vector3i & yeeCell) const
 {
     assert(mFieldsAreAllocated);
     
-    float* ptr;
+    FieldStorage* ptr;
     ptr = mHeadH[direction] +
         dot( (yeeCell-mOriginYeeH[direction]+mNumYeeCells)%mNumYeeCells,
             mMemStride);
@@ -332,7 +350,7 @@ setE(int direction, const Vector3i & yeeCell, float value)
     assert(mFieldsAreAllocated);
     assert(mHalfCells.encloses(yeeToHalf(yeeCell, octantE(direction))));
     
-    float* ptr;
+    FieldStorage* ptr;
     ptr = mHeadE[direction] + dot(yeeCell-mOriginYeeE[direction], mMemStride);
     
     //LOG << MemoryBuffer::identify(ptr) << "\n";
@@ -347,7 +365,7 @@ setH(int direction, const Vector3i & yeeCell, float value)
     assert(mFieldsAreAllocated);
     assert(mHalfCells.encloses(yeeToHalf(yeeCell, octantH(direction))));
     
-    float* ptr;
+    FieldStorage* ptr;
     ptr = mHeadH[direction] + dot(yeeCell-mOriginYeeH[direction], mMemStride);
     
     assert(mBuffersH[direction]->includes(ptr));
@@ -356,6 +374,213 @@ setH(int direction, const Vector3i & yeeCell, float value)
 }
 
 
+void InterleavedLattice::
+gatherE(int direction, const Rect3i & yeeCells, const Vector3i & stride,
+    vector<float> & values) const
+{
+    gather(1, direction, yeeCells, stride, values);
+}
+
+void InterleavedLattice::
+gatherH(int direction, const Rect3i & yeeCells, const Vector3i & stride,
+    vector<float> & values) const
+{
+    gather(0, direction, yeeCells, stride, values);
+}
+
+void InterleavedLattice::
+gatherInterpolatedE(int direction, const Rect3i & yeeCells,
+    const Vector3i & stride, const Vector3f & interpolationPoint,
+    vector<float> & values) const
+{
+    gatherInterpolated(1, direction, yeeCells, stride, interpolationPoint,
+        values);
+}
+
+void InterleavedLattice::
+gatherInterpolatedH(int direction, const Rect3i & yeeCells,
+    const Vector3i & stride, const Vector3f & interpolationPoint,
+    vector<float> & values) const
+{
+    gatherInterpolated(0, direction, yeeCells, stride, interpolationPoint,
+        values);
+}
+
+void InterleavedLattice::
+scatterE(int direction, const Rect3i & yeeCells, const float* values)
+{
+    scatter(1, direction, yeeCells, values, 0);
+}
+
+void InterleavedLattice::
+scatterH(int direction, const Rect3i & yeeCells, const float* values)
+{
+    scatter(0, direction, yeeCells, values, 0);
+}
+
+void InterleavedLattice::
+addE(int direction, const Rect3i & yeeCells, const float* values)
+{
+    scatter(1, direction, yeeCells, values, 1);
+}
+
+void InterleavedLattice::
+addH(int direction, const Rect3i & yeeCells, const float* values)
+{
+    scatter(0, direction, yeeCells, values, 1);
+}
+
+void InterleavedLattice::
+gather(bool isE, int direction, const Rect3i & yeeCells,
+    const Vector3i & stride, vector<float> & values) const
+{
+    assert(mFieldsAreAllocated);
+    if (yeeCells.num(0) <= 0 || yeeCells.num(1) <= 0 || yeeCells.num(2) <= 0)
+        return;
+    
+    int octant = isE ? octantE(direction) : octantH(direction);
+    assert(mHalfCells.encloses(yeeToHalf(yeeCells, octant)));
+    
+    const FieldStorage* head = isE ? mHeadE[direction] : mHeadH[direction];
+    Vector3i origin = isE ? mOriginYeeE[direction] : mOriginYeeH[direction];
+    Vector3i step(stride[0]*mMemStride[0], stride[1]*mMemStride[1],
+        stride[2]*mMemStride[2]);
+    Vector3i count((yeeCells.num(0)+stride[0]-1)/stride[0],
+        (yeeCells.num(1)+stride[1]-1)/stride[1],
+        (yeeCells.num(2)+stride[2]-1)/stride[2]);
+    
+    values.reserve(values.size() + count[0]*count[1]*count[2]);
+    const FieldStorage* pz = head + dot(yeeCells.p1 - origin, mMemStride);
+    for (int kk = 0; kk < count[2]; kk++, pz += step[2])
+    {
+        const FieldStorage* py = pz;
+        for (int jj = 0; jj < count[1]; jj++, py += step[1])
+        {
+            const FieldStorage* px = py;
+            for (int ii = 0; ii < count[0]; ii++, px += step[0])
+                values.push_back(*px);
+        }
+    }
+}
+
+void InterleavedLattice::
+gatherInterpolated(bool isE, int direction, const Rect3i & yeeCells,
+    const Vector3i & stride, const Vector3f & interpolationPoint,
+    vector<float> & values) const
+{
+    assert(mFieldsAreAllocated);
+    if (yeeCells.num(0) <= 0 || yeeCells.num(1) <= 0 || yeeCells.num(2) <= 0)
+        return;
+    
+    const FieldStorage* head = isE ? mHeadE[direction] : mHeadH[direction];
+    Vector3i origin = isE ? mOriginYeeE[direction] : mOriginYeeH[direction];
+    Vector3f x = interpolationPoint -
+        (isE ? eFieldPosition(direction) : hFieldPosition(direction));
+    Vector3i step(stride[0]*mMemStride[0], stride[1]*mMemStride[1],
+        stride[2]*mMemStride[2]);
+    Vector3i count((yeeCells.num(0)+stride[0]-1)/stride[0],
+        (yeeCells.num(1)+stride[1]-1)/stride[1],
+        (yeeCells.num(2)+stride[2]-1)/stride[2]);
+    
+    // Every cell reads the same eight neighbors relative to itself, with the
+    // same weights.  The low corner is cell + low.
+    Vector3i low(int(floor(x[0])), int(floor(x[1])), int(floor(x[2])));
+    Vector3f frac(x[0]-floor(x[0]), x[1]-floor(x[1]), x[2]-floor(x[2]));
+    float weight[8];
+    long offset[8];
+    for (int corner = 0; corner < 8; corner++)
+    {
+        Vector3i c(corner%2, (corner/2)%2, corner/4);
+        weight[corner] = 1.0f;
+        for (int xyz = 0; xyz < 3; xyz++)
+            weight[corner] *= c[xyz] ? frac[xyz] : 1.0f-frac[xyz];
+        offset[corner] = dot(c, mMemStride);
+    }
+    
+    // Neighbors that fall off the lattice wrap around to the other side;
+    // leave those regions to getInterpolatedE() and getInterpolatedH().
+    Vector3i lastCell(yeeCells.p1 + (count - Vector3i(1,1,1))*stride);
+    bool inside = 1;
+    for (int xyz = 0; xyz < 3; xyz++)
+    if (mMemStride[xyz] != 0)
+    {
+        inside = inside && yeeCells.p1[xyz] + low[xyz] >= origin[xyz] &&
+            lastCell[xyz] + low[xyz] + 1 < origin[xyz] + mNumYeeCells[xyz];
+    }
+    
+    values.reserve(values.size() + count[0]*count[1]*count[2]);
+    if (!inside)
+    {
+        Vector3i p;
+        for (p[2] = yeeCells.p1[2]; p[2] <= yeeCells.p2[2]; p[2] += stride[2])
+        for (p[1] = yeeCells.p1[1]; p[1] <= yeeCells.p2[1]; p[1] += stride[1])
+        for (p[0] = yeeCells.p1[0]; p[0] <= yeeCells.p2[0]; p[0] += stride[0])
+        {
+            if (isE)
+                values.push_back(getInterpolatedE(direction,
+                    Vector3f(p)+interpolationPoint));
+            else
+                values.push_back(getInterpolatedH(direction,
+                    Vector3f(p)+interpolationPoint));
+        }
+        return;
+    }
+    
+    const FieldStorage* pz = head +
+        dot(yeeCells.p1 + low - origin, mMemStride);
+    for (int kk = 0; kk < count[2]; kk++, pz += step[2])
+    {
+        const FieldStorage* py = pz;
+        for (int jj = 0; jj < count[1]; jj++, py += step[1])
+        {
+            const FieldStorage* px = py;
+            for (int ii = 0; ii < count[0]; ii++, px += step[0])
+            {
+                float value = 0.0f;
+                for (int corner = 0; corner < 8; corner++)
+                    value += weight[corner]*px[offset[corner]];
+                values.push_back(value);
+            }
+        }
+    }
+}
+
+void InterleavedLattice::
+scatter(bool isE, int direction, const Rect3i & yeeCells,
+    const float* values, bool add)
+{
+    assert(mFieldsAreAllocated);
+    if (yeeCells.num(0) <= 0 || yeeCells.num(1) <= 0 || yeeCells.num(2) <= 0)
+        return;
+    
+    int octant = isE ? octantE(direction) : octantH(direction);
+    assert(mHalfCells.encloses(yeeToHalf(yeeCells, octant)));
+    
+    FieldStorage* head = isE ? mHeadE[direction] : mHeadH[direction];
+    Vector3i origin = isE ? mOriginYeeE[direction] : mOriginYeeH[direction];
+    
+    FieldStorage* pz = head + dot(yeeCells.p1 - origin, mMemStride);
+    for (int kk = 0; kk < yeeCells.num(2); kk++, pz += mMemStride[2])
+    {
+        FieldStorage* py = pz;
+        for (int jj = 0; jj < yeeCells.num(1); jj++, py += mMemStride[1])
+        {
+            FieldStorage* px = py;
+            if (add)
+            {
+                for (int ii = 0; ii < yeeCells.num(0); ii++)
+                    px[ii*mMemStride[0]] += *values++;
+            }
+            else
+            {
+                for (int ii = 0; ii < yeeCells.num(0); ii++)
+                    px[ii*mMemStride[0]] = *values++;
+            }
+        }
+    }
+}
+
+
 void InterleavedLattice::
 printE(std::ostream & str, int fieldDirection, float scale) const
 {
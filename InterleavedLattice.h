@@ -131,11 +131,39 @@ public:
     
     /**
      * Returns the integer value to add to a pointer to access the next field
-     * in the x, y and z directions.
+     * in the x, y and z directions.  With the aligned layout the strides
+     * include the padding at the end of each row.
      */
     Vector3i fieldStride() const { return mMemStride; }
     int runlineDirection() const { return mRunlineDirection; }
     
+    /**
+     * Each field component is stored contiguously, in memory order, starting
+     * at its head pointer; all components have the same length.
+     *
+     * @returns the first field of the given component (once allocated)
+     */
+    const FieldStorage* headE(int direction) const { return mHeadE[direction]; }
+    const FieldStorage* headH(int direction) const { return mHeadH[direction]; }
+    
+    /**
+     * @returns the length of each field component, counting padding
+     */
+    long fieldLength() const { return mBuffersE[0]->length(); }
+    
+    /**
+     * Choose the memory layout of lattices constructed from now on.  The
+     * aligned layout pads every row along the runline direction to a multiple
+     * of ALIGNMENT values, so each row starts on a cache line, and separates
+     * the six components by one cache line so they don't alias each other.
+     * The default is the dense layout.
+     */
+    static void setAlignedLayout(bool aligned) { sAlignedLayout = aligned; }
+    
+    // Values of FieldStorage in one 64-byte cache line, which is also a whole
+    // number of SIMD registers for SSE, AVX and AVX-512.
+    static const int ALIGNMENT = 64/sizeof(FieldStorage);
+    
     // Access to fields (once allocated)
     void allocate();
     
@@ -149,11 +177,55 @@ public:
     void setE(int direction, const Vector3i & yeeCell, float value);
     void setH(int direction, const Vector3i & yeeCell, float value);
     
+    // Bulk access to fields (once allocated).  The pointer offsets are worked
+    // out once per region, not once per cell as with getE() and setE().
+    
+    /**
+     * Append the fields in yeeCells, taking every stride[xyz]th cell along
+     * each axis, to values.  The order is x fastest, then y, then z, as in a
+     * triple loop over the region.
+     */
+    void gatherE(int direction, const Rect3i & yeeCells,
+        const Vector3i & stride, std::vector<float> & values) const;
+    void gatherH(int direction, const Rect3i & yeeCells,
+        const Vector3i & stride, std::vector<float> & values) const;
+    
+    /**
+     * Like gatherE(), but interpolate each field to the position
+     * cell + interpolationPoint as getInterpolatedE() does, wrapping around
+     * the edges of the lattice.
+     */
+    void gatherInterpolatedE(int direction, const Rect3i & yeeCells,
+        const Vector3i & stride, const Vector3f & interpolationPoint,
+        std::vector<float> & values) const;
+    void gatherInterpolatedH(int direction, const Rect3i & yeeCells,
+        const Vector3i & stride, const Vector3f & interpolationPoint,
+        std::vector<float> & values) const;
+    
+    /**
+     * Store one value per cell of yeeCells, in the order of gatherE() with
+     * unit stride, into the fields.  addE() and addH() add the values to the
+     * fields instead, as soft sources do.
+     */
+    void scatterE(int direction, const Rect3i & yeeCells, const float* values);
+    void scatterH(int direction, const Rect3i & yeeCells, const float* values);
+    void addE(int direction, const Rect3i & yeeCells, const float* values);
+    void addH(int direction, const Rect3i & yeeCells, const float* values);
+    
     void printE(std::ostream & str, int fieldDirection, float scale) const;
     void printH(std::ostream & str, int fieldDirection, float scale) const;
     
 private:
+    void gather(bool isE, int direction, const Rect3i & yeeCells,
+        const Vector3i & stride, std::vector<float> & values) const;
+    void gatherInterpolated(bool isE, int direction, const Rect3i & yeeCells,
+        const Vector3i & stride, const Vector3f & interpolationPoint,
+        std::vector<float> & values) const;
+    void scatter(bool isE, int direction, const Rect3i & yeeCells,
+        const float* values, bool add);
+    
     static const int STRIDE = 1;
+    static bool sAlignedLayout;
     
     Rect3i mHalfCells;
     Vector3i mNonZeroDimensions;
@@ -167,11 +239,12 @@ private:
     std::vector<MemoryBufferPtr> mOctantBuffers; // 8
     
     bool mFieldsAreAllocated;
-    float* mHeadE[3];
-    float* mHeadH[3];
+    FieldStorage* mHeadE[3];
+    FieldStorage* mHeadH[3];
     Vector3i mMemStride;
     int mRunlineDirection; // 0, 1 or 2
-    std::vector<float> mData;
+    int mComponentGap; // unused floats after each component
+    FieldArray mData; // six components, E first
 };
 typedef Pointer<InterleavedLattice> InterleavedLatticePtr;
 
@@ -15,10 +15,13 @@
 #include "YeeUtilities.h"
 #include "geometry.h"
 
+#include <sstream>
+
 // Headers for the materials we'll make
 #include "StaticDielectric.h"
 #include "StaticLossyDielectric.h"
 #include "DrudeModel1.h"
+#include "MultiPoleModel.h"
 #include "PerfectConductor.h"
 
 // Headers for the available current types
@@ -39,6 +42,12 @@ static SetupUpdateEquationPtr newMaterialCurrentPML(Paint* parentPaint,
         Map<Vector3i, Map<string, string> > pmlParams, Vector3f dxyz,
         float dt, int runlineDirection );
 
+// The number of poles of a MultiPoleModel is a template parameter.
+static SetupUpdateEquationPtr newMultiPole(Paint* parentPaint,
+    vector<long> numCellsE, vector<long> numCellsH, vector<Rect3i> pmlRects,
+        Map<Vector3i, Map<string, string> > pmlParams, Vector3f dxyz,
+        float dt, int runlineDirection );
+
 template<class MaterialT, class NonPMLRunlineT, class PMLRunlineT>
 static SetupUpdateEquationPtr newCurrentPML(Paint* parentPaint,
     vector<long> numCellsE, vector<long> numCellsH, vector<Rect3i> pmlHalfCells,
@@ -175,6 +184,11 @@ static SetupUpdateEquationPtr newMaterialCurrentPML(Paint* parentPaint,
                 parentPaint, numCellsE, numCellsH, pmlRects, pmlParams,
                 dxyz, dt, runlineDirection);
     }
+    else if (bulkMaterial->modelName() == "MultiPole")
+    {
+        setupMaterial = newMultiPole(parentPaint, numCellsE, numCellsH,
+            pmlRects, pmlParams, dxyz, dt, runlineDirection);
+    }
     else if (bulkMaterial->modelName() == "PerfectConductor")
     {
         setupMaterial = SetupUpdateEquationPtr(new SetupPerfectConductor(
@@ -189,6 +203,58 @@ static SetupUpdateEquationPtr newMaterialCurrentPML(Paint* parentPaint,
     return setupMaterial;
 }
 
+static SetupUpdateEquationPtr newMultiPole(Paint* parentPaint,
+    vector<long> numCellsE, vector<long> numCellsH, vector<Rect3i> pmlRects,
+        Map<Vector3i, Map<string, string> > pmlParams, Vector3f dxyz,
+        float dt, int runlineDirection )
+{
+    MaterialDescPtr bulkMaterial = parentPaint->bulkMaterial();
+    int numPoles = DispersivePole::numPoles(bulkMaterial->params());
+    
+    // Check the poles here, where the error can say which material it is.
+    try {
+        for (int pp = 1; pp <= numPoles; pp++)
+            DispersivePole::read(bulkMaterial->params(), pp, dt);
+    } catch (Exception & e) {
+        throw(Exception(string("Material ") + bulkMaterial->name() + ": " +
+            e.what()));
+    }
+    
+    switch (numPoles)
+    {
+        case 1:
+            return newCurrentPML<MultiPoleModel<1>, SimpleAuxRunline,
+                SimpleAuxPMLRunline>(parentPaint, numCellsE, numCellsH,
+                    pmlRects, pmlParams, dxyz, dt, runlineDirection);
+        case 2:
+            return newCurrentPML<MultiPoleModel<2>, SimpleAuxRunline,
+                SimpleAuxPMLRunline>(parentPaint, numCellsE, numCellsH,
+                    pmlRects, pmlParams, dxyz, dt, runlineDirection);
+        case 3:
+            return newCurrentPML<MultiPoleModel<3>, SimpleAuxRunline,
+                SimpleAuxPMLRunline>(parentPaint, numCellsE, numCellsH,
+                    pmlRects, pmlParams, dxyz, dt, runlineDirection);
+        case 4:
+            return newCurrentPML<MultiPoleModel<4>, SimpleAuxRunline,
+                SimpleAuxPMLRunline>(parentPaint, numCellsE, numCellsH,
+                    pmlRects, pmlParams, dxyz, dt, runlineDirection);
+        case 5:
+            return newCurrentPML<MultiPoleModel<5>, SimpleAuxRunline,
+                SimpleAuxPMLRunline>(parentPaint, numCellsE, numCellsH,
+                    pmlRects, pmlParams, dxyz, dt, runlineDirection);
+        case 6:
+            return newCurrentPML<MultiPoleModel<6>, SimpleAuxRunline,
+                SimpleAuxPMLRunline>(parentPaint, numCellsE, numCellsH,
+                    pmlRects, pmlParams, dxyz, dt, runlineDirection);
+    }
+    
+    ostringstream err;
+    err << "Material " << bulkMaterial->name() << " has " << numPoles
+        << " poles; MultiPole takes 1 to " << DispersivePole::MAXPOLES
+        << " (pole1, pole2, ...)";
+    throw(Exception(err.str()));
+}
+
 template<class MaterialT, class NonPMLRunlineT, class PMLRunlineT>
 static SetupUpdateEquationPtr newCurrentPML(Paint* parentPaint,
     vector<long> numCellsE, vector<long> numCellsH, vector<Rect3i> pmlHalfCells,
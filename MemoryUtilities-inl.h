@@ -0,0 +1,56 @@
+/*
+ *  MemoryUtilities-inl.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 __MyCompanyName__. All rights reserved.
+ *
+ */
+
+#include "Exception.h"
+#include <cstring>
+
+template<class T>
+void StorageArray<T>::
+resize(unsigned long length, unsigned long numSegments)
+{
+    release();
+    mData = 0L;
+    mLength = 0;
+    if (length == 0)
+        return;
+    
+    mData = (T*)map(length*sizeof(T), numSegments);
+    mLength = length;
+}
+
+template<class T>
+T & StorageArray<T>::
+at(unsigned long nn)
+{
+    if (nn >= mLength)
+        throw(Exception("FieldArray index out of range."));
+    return mData[nn];
+}
+
+template<class T>
+const T & StorageArray<T>::
+at(unsigned long nn) const
+{
+    if (nn >= mLength)
+        throw(Exception("FieldArray index out of range."));
+    return mData[nn];
+}
+
+template<class T>
+StorageArray<T> & StorageArray<T>::
+operator=(const StorageArray<T> & rhs)
+{
+    if (this == &rhs)
+        return *this;
+    
+    resize(rhs.mLength);
+    if (mLength > 0)
+        memcpy(mData, rhs.mData, mLength*sizeof(T));
+    return *this;
+}
+
@@ -8,10 +8,19 @@
  */
 
 #include "MemoryUtilities.h"
+#include "WorkerPool.h"
+#include "Exception.h"
+#include <sys/mman.h>
+#include <unistd.h>
 #include <cassert>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
 using namespace std;
 
 set<MemoryBuffer*> MemoryBuffer::sAllBuffers;
@@ -21,7 +30,8 @@ MemoryBuffer() :
 	mLength(0),
 	mStride(1),
 	mDescription("Empty buffer"),
-    mHeadPointer(0L)
+    mHeadPointer(0L),
+    mElementBytes(sizeof(FieldStorage))
 {
     sAllBuffers.insert(this);
 }
@@ -31,7 +41,8 @@ MemoryBuffer(unsigned long length, unsigned long stride) :
 	mLength(length),
 	mStride(stride),
 	mDescription(""),
-    mHeadPointer(0L)
+    mHeadPointer(0L),
+    mElementBytes(sizeof(FieldStorage))
 {
     sAllBuffers.insert(this);
 }
@@ -42,7 +53,8 @@ MemoryBuffer(const string & inDescription, unsigned long length,
 	mLength(length),
 	mStride(stride),
 	mDescription(inDescription),
-    mHeadPointer(0L)
+    mHeadPointer(0L),
+    mElementBytes(sizeof(FieldStorage))
 {
     sAllBuffers.insert(this);
 }
@@ -52,7 +64,8 @@ MemoryBuffer(const MemoryBuffer & copyMe) :
 	mLength(copyMe.mLength),
 	mStride(copyMe.mStride),
 	mDescription(copyMe.mDescription),
-    mHeadPointer(copyMe.mHeadPointer)
+    mHeadPointer(copyMe.mHeadPointer),
+    mElementBytes(copyMe.mElementBytes)
 {
     sAllBuffers.insert(this);
 }
@@ -63,27 +76,21 @@ MemoryBuffer::
     sAllBuffers.erase(this);
 }
 
-void MemoryBuffer::
-setHeadPointer(float* ptr)
-{
-    //LOG << "Setting head ptr for " << hex << this << dec << " to "
-    //    << hex << ptr << dec << "\n";
-    mHeadPointer = ptr;
-}
-
 bool MemoryBuffer::
-includes(float const* ptr) const
+includes(void const* ptr) const
 {
     long offset = long(ptr) - long(mHeadPointer);
-    offset /= sizeof(float);
+    if (offset < 0 || offset%mElementBytes != 0)
+        return 0;
+    offset /= mElementBytes;
     
-    if (offset >= 0 && offset/mStride < mLength && offset%mStride == 0)
+    if (offset/mStride < mLength && offset%mStride == 0)
         return 1;
     return 0;
 }
 
 string MemoryBuffer::
-identify(float const * ptr)
+identify(void const * ptr)
 {
     set<MemoryBuffer*>::const_iterator itr;
     for (itr = sAllBuffers.begin(); itr != sAllBuffers.end(); itr++)
@@ -93,7 +100,7 @@ identify(float const * ptr)
         {
             ostringstream str;
             str << (*itr)->description() << " offset " <<
-                (long(ptr)-long((*itr)->headPointer()))/sizeof(float);
+                (long(ptr)-long((*itr)->mHeadPointer))/(*itr)->mElementBytes;
             return str.str();
         }
     }
@@ -111,6 +118,7 @@ operator=(const MemoryBuffer & rhs)
     mStride = rhs.mStride;
     mDescription = rhs.mDescription;
     mHeadPointer = rhs.mHeadPointer;
+    mElementBytes = rhs.mElementBytes;
     return *this;
 }
 
@@ -124,6 +132,114 @@ operator<<(std::ostream & str, const MemoryBuffer & buffer)
 }
 
 
+WorkerPool* MappedArray::sFirstTouchPool = 0L;
+bool MappedArray::sHugePages = 0;
+
+// Each thread zeroes its slab of every segment of a new array.
+class FirstTouchTask : public WorkerTask
+{
+public:
+    FirstTouchTask(char* data, unsigned long bytes,
+        unsigned long numSegments) :
+        mData(data),
+        mBytes(bytes),
+        mNumSegments(numSegments)
+    {
+    }
+    
+    virtual void execute(int threadNum, int numThreads)
+    {
+        unsigned long segmentBytes = mBytes/mNumSegments;
+        for (unsigned long seg = 0; seg < mNumSegments; seg++)
+        {
+            unsigned long first = seg*segmentBytes +
+                (segmentBytes*threadNum)/numThreads;
+            unsigned long end = seg*segmentBytes +
+                (segmentBytes*(threadNum+1))/numThreads;
+            if (seg == mNumSegments-1 && threadNum == numThreads-1)
+                end = mBytes;
+            memset(mData + first, 0, end-first);
+        }
+    }
+private:
+    char* mData;
+    unsigned long mBytes;
+    unsigned long mNumSegments;
+};
+
+MappedArray::
+MappedArray() :
+    mMapping(0L),
+    mMappingBytes(0)
+{
+}
+
+MappedArray::
+~MappedArray()
+{
+    release();
+}
+
+void* MappedArray::
+map(unsigned long bytes, unsigned long numSegments)
+{
+    assert(numSegments > 0);
+    assert(mMapping == 0L);
+    
+    // Huge pages need 2 MB alignment, so map a little extra and start the
+    // array on a boundary.  Arrays smaller than one huge page (most aux
+    // arrays, neighbor buffers) keep normal pages; otherwise each would fault
+    // in a whole 2 MB.
+    const unsigned long HUGE_PAGE_BYTES = 2*1024*1024;
+    unsigned long pageBytes = sysconf(_SC_PAGESIZE);
+    const bool useHugePages = sHugePages && bytes >= HUGE_PAGE_BYTES;
+    unsigned long mappedBytes = bytes;
+    if (useHugePages)
+        mappedBytes += HUGE_PAGE_BYTES;
+    mMappingBytes = pageBytes*((mappedBytes + pageBytes - 1)/pageBytes);
+    
+    mMapping = mmap(0L, mMappingBytes, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mMapping == MAP_FAILED)
+    {
+        mMapping = 0L;
+        mMappingBytes = 0;
+        ostringstream str;
+        str << "Could not allocate " << bytes << " bytes.";
+        throw(Exception(str.str()));
+    }
+    
+    unsigned long head = (unsigned long)mMapping;
+    if (useHugePages)
+    {
+        head = HUGE_PAGE_BYTES*((head + HUGE_PAGE_BYTES - 1)/HUGE_PAGE_BYTES);
+#ifdef MADV_HUGEPAGE
+        madvise((void*)head, mMappingBytes - (head - (unsigned long)mMapping),
+            MADV_HUGEPAGE);
+#endif
+    }
+    
+    // The pages read as zero already; writing the zeros decides where they
+    // live.
+    FirstTouchTask task((char*)head, bytes, numSegments);
+    if (sFirstTouchPool != 0L)
+        sFirstTouchPool->run(task);
+    else
+        task.execute(0, 1);
+    
+    return (void*)head;
+}
+
+void MappedArray::
+release()
+{
+    if (mMapping != 0L)
+        munmap(mMapping, mMappingBytes);
+    mMapping = 0L;
+    mMappingBytes = 0;
+}
+
+
 BufferPointer::
 BufferPointer() :
 	mBuffer(0L),
@@ -159,7 +275,7 @@ BufferPointer(const BufferPointer & copyMe) :
     }
 }
 
-float* BufferPointer::
+FieldStorage* BufferPointer::
 pointer() const
 {
     assert(mBuffer->headPointer() != 0L);
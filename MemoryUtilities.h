@@ -14,8 +14,10 @@
 #include <iostream>
 #include <set>
 #include "Pointer.h"
+#include "FieldStorage.h"
 
 class BufferPointer;
+class WorkerPool;
 
 class MemoryBuffer
 {
@@ -32,15 +34,19 @@ public:
 	const std::string & description() const { return mDescription; }
 	void setDescription(const std::string & inDesc) { mDescription = inDesc; }
     
-    void setHeadPointer(float* ptr);
-    float* headPointer() const { return mHeadPointer; }
+    // The buffers of auxiliary variables get an AuxStorage head, which is
+    // only used to identify pointers.
+    template<class T>
+    void setHeadPointer(T* ptr)
+        { mHeadPointer = ptr; mElementBytes = sizeof(T); }
+    FieldStorage* headPointer() const { return (FieldStorage*)mHeadPointer; }
 	
     static const std::set<MemoryBuffer*> & allBuffers()
         { return sAllBuffers; }
     
-    bool includes(float const* ptr) const;
+    bool includes(void const* ptr) const;
     
-    static std::string identify(float const* ptr);
+    static std::string identify(void const* ptr);
     
     MemoryBuffer & operator=(const MemoryBuffer & rhs);
 private:
@@ -48,7 +54,8 @@ private:
 	unsigned long mStride;
 	std::string mDescription;
     
-    float* mHeadPointer;
+    void* mHeadPointer;
+    unsigned long mElementBytes;
     
     static std::set<MemoryBuffer*> sAllBuffers;
 	
@@ -57,6 +64,83 @@ private:
 typedef Pointer<MemoryBuffer> MemoryBufferPtr;
 std::ostream & operator<<(std::ostream & str, const MemoryBuffer & buffer);
 
+/**
+ * Zero-initialized array for fields and auxiliary variables, with the
+ * interface of the bit of std::vector that the update equations use.  The
+ * memory comes straight from mmap(), so no page is placed on a NUMA node
+ * until something writes to it.  Normally the allocating thread zeroes the
+ * whole array right away, as std::vector would.  With a first-touch pool set,
+ * the threads of the pool zero it instead, thread t taking the t-th of
+ * numThreads equal slabs of each segment, so each page starts out on the node
+ * of the thread that will update it (see CalculationPartition).
+ *
+ * MappedArray does the mapping in bytes; StorageArray gives it a type.  Fields
+ * are a FieldArray and the auxiliary variables of materials and the PML are an
+ * AuxArray, which differ in the fp16 build (see FieldStorage.h).
+ */
+class MappedArray
+{
+public:
+    /**
+     * Zero new arrays on the threads of this pool; pass 0L to go back to
+     * zeroing them on the allocating thread.  The pool must outlive the
+     * allocations made while it's set.
+     */
+    static void setFirstTouchPool(WorkerPool* pool) { sFirstTouchPool = pool; }
+    
+    /**
+     * Ask the kernel to back new arrays of 2 MB or more with transparent huge
+     * pages where it's able to (Linux madvise(MADV_HUGEPAGE)).
+     */
+    static void setHugePages(bool useHugePages) { sHugePages = useHugePages; }
+protected:
+    MappedArray();
+    ~MappedArray();
+    
+    // Map bytes of zeroes in numSegments equal parts and return the head.
+    void* map(unsigned long bytes, unsigned long numSegments);
+    void release();
+private:
+    MappedArray(const MappedArray & copyMe);
+    MappedArray & operator=(const MappedArray & rhs);
+    
+    void* mMapping;
+    unsigned long mMappingBytes;
+    
+    static WorkerPool* sFirstTouchPool;
+    static bool sHugePages;
+};
+
+template<class T>
+class StorageArray : public MappedArray
+{
+public:
+    StorageArray() : mData(0L), mLength(0) {}
+    StorageArray(const StorageArray<T> & copyMe) : mData(0L), mLength(0)
+        { *this = copyMe; }
+    ~StorageArray() {}
+    
+    /**
+     * Discard the contents and allocate length zeroed values.  The array is
+     * made of numSegments equal parts (e.g. the six field components of a
+     * lattice) which are divided among the first-touch threads separately.
+     */
+    void resize(unsigned long length, unsigned long numSegments = 1);
+    unsigned long size() const { return mLength; }
+    
+    T & operator[](unsigned long nn) { return mData[nn]; }
+    const T & operator[](unsigned long nn) const { return mData[nn]; }
+    T & at(unsigned long nn);
+    const T & at(unsigned long nn) const;
+    
+    StorageArray<T> & operator=(const StorageArray<T> & rhs);
+private:
+    T* mData;
+    unsigned long mLength;
+};
+typedef StorageArray<FieldStorage> FieldArray;
+typedef StorageArray<AuxStorage> AuxArray;
+
 
 class BufferPointer
 {
@@ -68,7 +152,7 @@ public:
 	
 	unsigned long offset() const { return mOffset; }
 	const MemoryBuffer * buffer() const { return mBuffer; }
-    float* pointer() const;// { return mBuffer->headPointer() + mOffset; }
+    FieldStorage* pointer() const;// { return mBuffer->headPointer()+mOffset; }
 	
 	void setOffset(unsigned long offset);
 	
@@ -92,6 +176,7 @@ operator += (BufferPointer & lhs, unsigned long rhs);
 BufferPointer &
 operator -= (BufferPointer & lhs, unsigned long rhs);
 
+#include "MemoryUtilities-inl.h"
 
 
 #endif
@@ -36,9 +36,68 @@ public:
     virtual long numRunlinesH() const;
     virtual long numHalfCellsE() const;
     virtual long numHalfCellsH() const;
+    
+    // Split the runlines in each direction into numThreads contiguous pieces
+    // with about the same number of half cells in each.
+    virtual void divideRunlines(int numThreads);
+    
+    // Split the runlines in each direction into numTiles contiguous pieces
+    // by position in memory.
+    virtual void divideRunlinesIntoTiles(const InterleavedLattice & lattice,
+        int numTiles);
+    
+    // True if no runline runs from one plane of the lattice into the next.
+    virtual bool tilesByPlanes(const InterleavedLattice & lattice) const;
 protected:
     std::vector<RunlineClass> mRunlinesE[3];
     std::vector<RunlineClass> mRunlinesH[3];
+    
+    // Thread nn updates runlines mThreadRunlinesE[dir][nn] up to but not
+    // including mThreadRunlinesE[dir][nn+1].  mThreadCellsE[dir][nn] is the
+    // number of half cells in the runlines before mThreadRunlinesE[dir][nn],
+    // which is needed by anything that walks a buffer cell by cell.
+    std::vector<long> mThreadRunlinesE[3];
+    std::vector<long> mThreadRunlinesH[3];
+    std::vector<long> mThreadCellsE[3];
+    std::vector<long> mThreadCellsH[3];
+    
+    // Tile nn has runlines mTileRunlinesE[dir][nn] up to but not including
+    // mTileRunlinesE[dir][nn+1], just like the thread pieces above.
+    std::vector<long> mTileRunlinesE[3];
+    std::vector<long> mTileRunlinesH[3];
+    std::vector<long> mTileCellsE[3];
+    std::vector<long> mTileCellsH[3];
+    
+    // Runlines of Ex, Ey and Ez (or Hx, Hy and Hz) that cover the same Yee
+    // cells, for the fused update.  mFusedE[dir][nn] is the index in
+    // mFusedRunlinesE of runline nn, or -1 if it is updated by itself; the
+    // vectors are empty unless matchRunlines() has been called.
+    struct FusedRunline
+    {
+        long runline[3];
+    };
+    std::vector<FusedRunline> mFusedRunlinesE;
+    std::vector<FusedRunline> mFusedRunlinesH;
+    std::vector<long> mFusedE[3];
+    std::vector<long> mFusedH[3];
+    
+    void matchRunlines(const InterleavedLattice & lattice);
+    bool isFusedE(int direction, long nn) const
+        { return !mFusedE[direction].empty() && mFusedE[direction][nn] != -1; }
+    bool isFusedH(int direction, long nn) const
+        { return !mFusedH[direction].empty() && mFusedH[direction][nn] != -1; }
+private:
+    static void match(const std::vector<RunlineClass> runlines[3],
+        const FieldStorage* heads[3],
+        std::vector<FusedRunline> & fusedRunlines, std::vector<long> fused[3]);
+    static void divide(const std::vector<RunlineClass> & runlines,
+        int numThreads, std::vector<long> & threadRunlines,
+        std::vector<long> & threadCells);
+    static void divideIntoTiles(const std::vector<RunlineClass> & runlines,
+        const FieldStorage* head, long fieldLength, int numTiles,
+        std::vector<long> & tileRunlines, std::vector<long> & tileCells);
+    static bool staysInPlanes(const std::vector<RunlineClass> & runlines,
+        const FieldStorage* head, long planeLength);
 };
 
 template<class MaterialClass>
@@ -49,13 +108,17 @@ public:
         std::vector<long> numCellsH, Vector3f dxyz, float dt);
         
     virtual void writeJ(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     virtual void writeP(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     virtual void writeK(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     virtual void writeM(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
         
     virtual std::string modelName() const;
 protected:
@@ -148,6 +211,197 @@ numHalfCellsH() const
     return total;
 }
 
+template<class RunlineClass>
+void ModularUpdateEquation_Runline<RunlineClass>::
+divideRunlines(int numThreads)
+{
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        divide(mRunlinesE[xyz], numThreads, mThreadRunlinesE[xyz],
+            mThreadCellsE[xyz]);
+        divide(mRunlinesH[xyz], numThreads, mThreadRunlinesH[xyz],
+            mThreadCellsH[xyz]);
+    }
+}
+
+template<class RunlineClass>
+void ModularUpdateEquation_Runline<RunlineClass>::
+divide(const std::vector<RunlineClass> & runlines, int numThreads,
+    std::vector<long> & threadRunlines, std::vector<long> & threadCells)
+{
+    long totalCells = 0;
+    for (long nn = 0; nn < runlines.size(); nn++)
+        totalCells += runlines[nn].length;
+    
+    threadRunlines.resize(numThreads+1);
+    threadCells.resize(numThreads+1);
+    threadRunlines[0] = 0;
+    threadCells[0] = 0;
+    
+    // Walk the runlines once, starting a new thread's piece whenever the
+    // running total of half cells passes the next even share.
+    long nRL = 0;
+    long cellsSoFar = 0;
+    for (int thread = 1; thread < numThreads; thread++)
+    {
+        long target = (totalCells*thread)/numThreads;
+        while (nRL < runlines.size() && cellsSoFar < target)
+        {
+            cellsSoFar += runlines[nRL].length;
+            nRL++;
+        }
+        threadRunlines[thread] = nRL;
+        threadCells[thread] = cellsSoFar;
+    }
+    threadRunlines[numThreads] = runlines.size();
+    threadCells[numThreads] = totalCells;
+}
+
+template<class RunlineClass>
+void ModularUpdateEquation_Runline<RunlineClass>::
+divideRunlinesIntoTiles(const InterleavedLattice & lattice, int numTiles)
+{
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        divideIntoTiles(mRunlinesE[xyz], lattice.headE(xyz),
+            lattice.fieldLength(), numTiles, mTileRunlinesE[xyz],
+            mTileCellsE[xyz]);
+        divideIntoTiles(mRunlinesH[xyz], lattice.headH(xyz),
+            lattice.fieldLength(), numTiles, mTileRunlinesH[xyz],
+            mTileCellsH[xyz]);
+    }
+}
+
+template<class RunlineClass>
+void ModularUpdateEquation_Runline<RunlineClass>::
+divideIntoTiles(const std::vector<RunlineClass> & runlines,
+    const FieldStorage* head, long fieldLength, int numTiles,
+    std::vector<long> & tileRunlines, std::vector<long> & tileCells)
+{
+    tileRunlines.resize(numTiles+1);
+    tileCells.resize(numTiles+1);
+    tileRunlines[0] = 0;
+    tileCells[0] = 0;
+    
+    // Runlines are made in memory order, so each tile is a contiguous run of
+    // them.  A runline belongs to the tile where it starts.
+    long nRL = 0;
+    long cellsSoFar = 0;
+    for (int tile = 1; tile < numTiles; tile++)
+    {
+        const FieldStorage* tileStart = head + (fieldLength*tile)/numTiles;
+        while (nRL < runlines.size() && runlines[nRL].fi < tileStart)
+        {
+            cellsSoFar += runlines[nRL].length;
+            nRL++;
+        }
+        tileRunlines[tile] = nRL;
+        tileCells[tile] = cellsSoFar;
+    }
+    while (nRL < runlines.size())
+        cellsSoFar += runlines[nRL++].length;
+    tileRunlines[numTiles] = runlines.size();
+    tileCells[numTiles] = cellsSoFar;
+}
+
+template<class RunlineClass>
+bool ModularUpdateEquation_Runline<RunlineClass>::
+tilesByPlanes(const InterleavedLattice & lattice) const
+{
+    const int slowDirection = (lattice.runlineDirection()+2)%3;
+    long numPlanes = lattice.numYeeCells()[slowDirection];
+    if (lattice.fieldLength()%numPlanes != 0)
+        return 0;
+    long planeLength = lattice.fieldLength()/numPlanes;
+    
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        if (!staysInPlanes(mRunlinesE[xyz], lattice.headE(xyz), planeLength))
+            return 0;
+        if (!staysInPlanes(mRunlinesH[xyz], lattice.headH(xyz), planeLength))
+            return 0;
+    }
+    return 1;
+}
+
+template<class RunlineClass>
+bool ModularUpdateEquation_Runline<RunlineClass>::
+staysInPlanes(const std::vector<RunlineClass> & runlines,
+    const FieldStorage* head, long planeLength)
+{
+    for (long nn = 0; nn < runlines.size(); nn++)
+    {
+        long firstIndex = runlines[nn].fi - head;
+        long lastIndex = firstIndex + runlines[nn].length - 1;
+        if (firstIndex/planeLength != lastIndex/planeLength)
+            return 0;
+    }
+    return 1;
+}
+
+template<class RunlineClass>
+void ModularUpdateEquation_Runline<RunlineClass>::
+matchRunlines(const InterleavedLattice & lattice)
+{
+    const FieldStorage* headsE[3] = { lattice.headE(0), lattice.headE(1),
+        lattice.headE(2) };
+    const FieldStorage* headsH[3] = { lattice.headH(0), lattice.headH(1),
+        lattice.headH(2) };
+    
+    match(mRunlinesE, headsE, mFusedRunlinesE, mFusedE);
+    match(mRunlinesH, headsH, mFusedRunlinesH, mFusedH);
+}
+
+template<class RunlineClass>
+void ModularUpdateEquation_Runline<RunlineClass>::
+match(const std::vector<RunlineClass> runlines[3],
+    const FieldStorage* heads[3], std::vector<FusedRunline> & fusedRunlines,
+    std::vector<long> fused[3])
+{
+    fusedRunlines.clear();
+    for (int xyz = 0; xyz < 3; xyz++)
+        fused[xyz].assign(runlines[xyz].size(), -1);
+    
+    // The runlines of each component are in memory order, so walk all three
+    // lists together.  Runlines match if they start at the same Yee cell and
+    // have the same length.
+    long nn[3] = {0, 0, 0};
+    while (nn[0] < runlines[0].size() && nn[1] < runlines[1].size() &&
+        nn[2] < runlines[2].size())
+    {
+        long offset[3];
+        for (int xyz = 0; xyz < 3; xyz++)
+            offset[xyz] = runlines[xyz][nn[xyz]].fi - heads[xyz];
+        long lastOffset = std::max(offset[0], std::max(offset[1], offset[2]));
+        
+        if (offset[0] == lastOffset && offset[1] == lastOffset &&
+            offset[2] == lastOffset)
+        {
+            long length = runlines[0][nn[0]].length;
+            if (runlines[1][nn[1]].length == length &&
+                runlines[2][nn[2]].length == length &&
+                length >= VectorKernels::MIN_RUNLINE_LENGTH)
+            {
+                FusedRunline fusedRunline;
+                for (int xyz = 0; xyz < 3; xyz++)
+                {
+                    fusedRunline.runline[xyz] = nn[xyz];
+                    fused[xyz][nn[xyz]] = fusedRunlines.size();
+                }
+                fusedRunlines.push_back(fusedRunline);
+            }
+            for (int xyz = 0; xyz < 3; xyz++)
+                nn[xyz]++;
+        }
+        else
+        {
+            for (int xyz = 0; xyz < 3; xyz++)
+            if (offset[xyz] < lastOffset)
+                nn[xyz]++;
+        }
+    }
+}
+
 #pragma mark *** ModularUpdateEquation_Material ***
 
 template<class MaterialT>
@@ -162,7 +416,8 @@ ModularUpdateEquation_Material(Paint* parentPaint, std::vector<long> numCellsE,
 template<class MaterialT>
 void ModularUpdateEquation_Material<MaterialT>::
 writeJ(int direction, std::ostream & binaryStream,
-    long startingIndex, const float* startingField, long length) const
+    long startingIndex, const FieldStorage* startingField, long length)
+    const
 {
     mMaterial.writeJ(direction, binaryStream, startingIndex, startingField,
         length);
@@ -171,7 +426,8 @@ writeJ(int direction, std::ostream & binaryStream,
 template<class MaterialT>
 void ModularUpdateEquation_Material<MaterialT>::
 writeP(int direction, std::ostream & binaryStream,
-    long startingIndex, const float* startingField, long length) const
+    long startingIndex, const FieldStorage* startingField, long length)
+    const
 {
     mMaterial.writeP(direction, binaryStream, startingIndex, startingField,
         length);
@@ -180,7 +436,8 @@ writeP(int direction, std::ostream & binaryStream,
 template<class MaterialT>
 void ModularUpdateEquation_Material<MaterialT>::
 writeK(int direction, std::ostream & binaryStream,
-    long startingIndex, const float* startingField, long length) const
+    long startingIndex, const FieldStorage* startingField, long length)
+    const
 {
     mMaterial.writeK(direction, binaryStream, startingIndex, startingField,
         length);
@@ -189,7 +446,8 @@ writeK(int direction, std::ostream & binaryStream,
 template<class MaterialT>
 void ModularUpdateEquation_Material<MaterialT>::
 writeM(int direction, std::ostream & binaryStream,
-    long startingIndex, const float* startingField, long length) const
+    long startingIndex, const FieldStorage* startingField, long length)
+    const
 {
     mMaterial.writeM(direction, binaryStream, startingIndex, startingField,
         length);
@@ -244,6 +502,80 @@ ModularUpdateEquation(Paint* parentPaint, std::vector<long> numCellsE,
 template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
 void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
 calcEPhase(int direction)
+{
+    long numRunlines =
+        ModularUpdateEquation_Runline<RunlineT>::mRunlinesE[direction].size();
+    calcERange(direction, 0, numRunlines, 0);
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcHPhase(int direction)
+{
+    long numRunlines =
+        ModularUpdateEquation_Runline<RunlineT>::mRunlinesH[direction].size();
+    calcHRange(direction, 0, numRunlines, 0);
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcEPhase(int direction, int threadNum, int numThreads)
+{
+    const std::vector<long> & threadRunlines(
+        ModularUpdateEquation_Runline<RunlineT>::mThreadRunlinesE[direction]);
+    const std::vector<long> & threadCells(
+        ModularUpdateEquation_Runline<RunlineT>::mThreadCellsE[direction]);
+    assert(threadRunlines.size() == numThreads+1); // call divideRunlines()!
+    
+    calcERange(direction, threadRunlines[threadNum],
+        threadRunlines[threadNum+1], threadCells[threadNum]);
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcHPhase(int direction, int threadNum, int numThreads)
+{
+    const std::vector<long> & threadRunlines(
+        ModularUpdateEquation_Runline<RunlineT>::mThreadRunlinesH[direction]);
+    const std::vector<long> & threadCells(
+        ModularUpdateEquation_Runline<RunlineT>::mThreadCellsH[direction]);
+    assert(threadRunlines.size() == numThreads+1); // call divideRunlines()!
+    
+    calcHRange(direction, threadRunlines[threadNum],
+        threadRunlines[threadNum+1], threadCells[threadNum]);
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcETile(int direction, int tileNum, int numTiles)
+{
+    const std::vector<long> & tileRunlines(
+        ModularUpdateEquation_Runline<RunlineT>::mTileRunlinesE[direction]);
+    const std::vector<long> & tileCells(
+        ModularUpdateEquation_Runline<RunlineT>::mTileCellsE[direction]);
+    assert(tileRunlines.size() == numTiles+1); // call divideRunlinesIntoTiles()
+    
+    calcERange(direction, tileRunlines[tileNum], tileRunlines[tileNum+1],
+        tileCells[tileNum]);
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcHTile(int direction, int tileNum, int numTiles)
+{
+    const std::vector<long> & tileRunlines(
+        ModularUpdateEquation_Runline<RunlineT>::mTileRunlinesH[direction]);
+    const std::vector<long> & tileCells(
+        ModularUpdateEquation_Runline<RunlineT>::mTileCellsH[direction]);
+    assert(tileRunlines.size() == numTiles+1); // call divideRunlinesIntoTiles()
+    
+    calcHRange(direction, tileRunlines[tileNum], tileRunlines[tileNum+1],
+        tileCells[tileNum]);
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcERange(int direction, long firstRunline, long endRunline, long firstCell)
 {
     // If the memory direction is 0 (x), then Ex updates use calcE<0>
     // If the memory direction is 1 (y), then Ex updates use calcE<2>
@@ -253,16 +585,16 @@ calcEPhase(int direction)
     assert(pmlFieldDirection < 3);
     
     if (pmlFieldDirection == 0)
-        calcE<0>(direction);
+        calcE<0>(direction, firstRunline, endRunline, firstCell);
     else if (pmlFieldDirection == 1)
-        calcE<1>(direction);
+        calcE<1>(direction, firstRunline, endRunline, firstCell);
     else
-        calcE<2>(direction);
+        calcE<2>(direction, firstRunline, endRunline, firstCell);
 }
 
 template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
 void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
-calcHPhase(int direction)
+calcHRange(int direction, long firstRunline, long endRunline, long firstCell)
 {
     // If the memory direction is 0 (x), then Hx updates use calcH<0>
     // If the memory direction is 1 (y), then Hx updates use calcH<2>
@@ -272,20 +604,30 @@ calcHPhase(int direction)
     assert(pmlFieldDirection < 3);
     
     if (pmlFieldDirection == 0)
-        calcH<0>(direction);
+        calcH<0>(direction, firstRunline, endRunline, firstCell);
     else if (pmlFieldDirection == 1)
-        calcH<1>(direction);
+        calcH<1>(direction, firstRunline, endRunline, firstCell);
     else
-        calcH<2>(direction);
+        calcH<2>(direction, firstRunline, endRunline, firstCell);
 }
 
 
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+fuseRunlines(const InterleavedLattice & lattice)
+{
+    // Only the block path has a fused version.
+    if (VECTORIZED)
+        ModularUpdateEquation_Runline<RunlineT>::matchRunlines(lattice);
+}
+
 template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
 void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
 allocateAuxBuffers()
 {
     ModularUpdateEquation_Material<MaterialT>::mMaterial.allocateAuxBuffers();
-    mPML.allocateAuxBuffers();
+    mPML.allocateAuxBuffers(ModularUpdateEquation_Runline<RunlineT>::mRunlinesE,
+        ModularUpdateEquation_Runline<RunlineT>::mRunlinesH);
 }
 
 
@@ -305,11 +647,12 @@ setCurrentSource(CurrentSource* source)
 template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
 template<int FIELD_DIRECTION_PML>
 void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
-calcE(int fieldDirection)
+calcE(int fieldDirection, long firstRunline, long endRunline,
+    long firstCell)
 {
     std::vector<RunlineT> & runlines =
         ModularUpdateEquation_Runline<RunlineT>::runlinesE(fieldDirection);
-    if (runlines.size() == 0)
+    if (firstRunline == endRunline)
         return;
     
     const int STRIDE = 1;
@@ -333,17 +676,27 @@ calcE(int fieldDirection)
     ModularUpdateEquation_Material<MaterialT>::mMaterial.initLocalE(materialData);
     //mPML.initLocalE(pmlData);
     mCurrent.initLocalE(currentData, dir0);
+    mCurrent.skipCellsE(currentData, firstCell);
     
     //LOG << "Update id " << UpdateEquation::id() << "\n";
     
-    for (long nRL = 0; nRL < runlines.size(); nRL++)
+    for (long nRL = firstRunline; nRL < endRunline; nRL++)
     {
+        // Fused runlines are all done along with the x component.
+        if (ModularUpdateEquation_Runline<RunlineT>::isFusedE(dir0, nRL))
+        {
+            if (dir0 == 0)
+                calcFusedE<FIELD_DIRECTION_PML>(nRL,
+                    VectorKernels::Path<VECTORIZED>());
+            continue;
+        }
+        
         RunlineT & rl(runlines[nRL]);
-        float* fi(rl.fi);               // e.g. Ex
-        const float* gjLow(rl.gj[0]);   // e.g. Hy(z-1/2)
-        const float* gjHigh(rl.gj[1]);  // e.g. Hy(z+1/2)
-        const float* gkLow(rl.gk[0]);   // e.g. Hz(y-1/2)
-        const float* gkHigh(rl.gk[1]);  // e.g. Hz(y+1/2)
+        FieldStorage* fi(rl.fi);              // e.g. Ex
+        const FieldStorage* gjLow(rl.gj[0]);   // e.g. Hy(z-1/2)
+        const FieldStorage* gjHigh(rl.gj[1]);  // e.g. Hy(z+1/2)
+        const FieldStorage* gkLow(rl.gk[0]);   // e.g. Hz(y-1/2)
+        const FieldStorage* gkHigh(rl.gk[1]);  // e.g. Hz(y+1/2)
         
 //        LOG << rl << "\n";
         ModularUpdateEquation_Material<MaterialT>::mMaterial.onStartRunlineE(
@@ -352,6 +705,13 @@ calcE(int fieldDirection)
         mCurrent.onStartRunlineE(currentData, rl);
         
         const int len(rl.length);
+        if (VECTORIZED && len >= VectorKernels::MIN_RUNLINE_LENGTH)
+        {
+            calcRunlineE(materialData, pmlData, fieldDirection, rl, dj_inv,
+                dk_inv, VectorKernels::Path<VECTORIZED>());
+            continue;
+        }
+        
         for (int mm = 0; mm < len; mm++)
         {
             float dHj = (*gjHigh - *gjLow)*dk_inv;
@@ -386,11 +746,12 @@ calcE(int fieldDirection)
 template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
 template<int FIELD_DIRECTION_PML>
 void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
-calcH(int fieldDirection)
+calcH(int fieldDirection, long firstRunline, long endRunline,
+    long firstCell)
 {
     std::vector<RunlineT> & runlines =
         ModularUpdateEquation_Runline<RunlineT>::runlinesH(fieldDirection);
-    if (runlines.size() == 0)
+    if (firstRunline == endRunline)
         return;
     
     const int STRIDE = 1;
@@ -409,15 +770,24 @@ calcH(int fieldDirection)
     ModularUpdateEquation_Material<MaterialT>::mMaterial.initLocalH(materialData);
     //mPML.initLocalH(pmlData);
     mCurrent.initLocalH(currentData, dir0);
+    mCurrent.skipCellsH(currentData, firstCell);
     
-    for (long nRL = 0; nRL < runlines.size(); nRL++)
+    for (long nRL = firstRunline; nRL < endRunline; nRL++)
     {
+        if (ModularUpdateEquation_Runline<RunlineT>::isFusedH(dir0, nRL))
+        {
+            if (dir0 == 0)
+                calcFusedH<FIELD_DIRECTION_PML>(nRL,
+                    VectorKernels::Path<VECTORIZED>());
+            continue;
+        }
+        
         RunlineT & rl(runlines[nRL]);
-        float* fi(rl.fi);               // e.g. Ex
-        const float* gjLow(rl.gj[0]);   // e.g. Hy(z-1/2)
-        const float* gjHigh(rl.gj[1]);  // e.g. Hy(z+1/2)
-        const float* gkLow(rl.gk[0]);   // e.g. Hz(y-1/2)
-        const float* gkHigh(rl.gk[1]);  // e.g. Hz(y+1/2)
+        FieldStorage* fi(rl.fi);              // e.g. Ex
+        const FieldStorage* gjLow(rl.gj[0]);   // e.g. Hy(z-1/2)
+        const FieldStorage* gjHigh(rl.gj[1]);  // e.g. Hy(z+1/2)
+        const FieldStorage* gkLow(rl.gk[0]);   // e.g. Hz(y-1/2)
+        const FieldStorage* gkHigh(rl.gk[1]);  // e.g. Hz(y+1/2)
         
 //        LOG << rl << "\n";
         ModularUpdateEquation_Material<MaterialT>::mMaterial.onStartRunlineH(
@@ -426,6 +796,13 @@ calcH(int fieldDirection)
         mCurrent.onStartRunlineH(currentData, rl);
         
         const int len(rl.length);
+        if (VECTORIZED && len >= VectorKernels::MIN_RUNLINE_LENGTH)
+        {
+            calcRunlineH(materialData, pmlData, fieldDirection, rl, dj_inv,
+                dk_inv, VectorKernels::Path<VECTORIZED>());
+            continue;
+        }
+        
         for (int mm = 0; mm < len; mm++)
         {
             float dEj = (*gjHigh - *gjLow)*dk_inv;
@@ -456,6 +833,170 @@ calcH(int fieldDirection)
 }
 
 
+// Block versions of the runline loops in calcE and calcH.  The curl goes into
+// a small buffer, then the PML fills in J (or K) for the block, then the
+// material updates the field; each step is one pass of a vector kernel.
+// (The current source is always NullCurrent here.)
 
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+template<class PMLDataT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcBlockE(typename MaterialT::LocalDataE & materialData,
+    PMLDataT & pmlData, int fieldDirection, RunlineT & rl, long firstCell,
+    int blockLength, float dj_inv, float dk_inv)
+{
+    float dHj[VectorKernels::BLOCK_LENGTH];
+    float dHk[VectorKernels::BLOCK_LENGTH];
+    float Ji[VectorKernels::BLOCK_LENGTH];
+    assert(blockLength <= VectorKernels::BLOCK_LENGTH);
+    
+    VectorKernels::difference(rl.gj[0]+firstCell, rl.gj[1]+firstCell, dk_inv,
+        dHj, blockLength);
+    VectorKernels::difference(rl.gk[0]+firstCell, rl.gk[1]+firstCell, dj_inv,
+        dHk, blockLength);
+    mPML.updateJ(pmlData, dHj, dHk, Ji, blockLength);
+    ModularUpdateEquation_Material<MaterialT>::mMaterial.updateE(
+        materialData, fieldDirection, rl.fi+firstCell, dHj, dHk, Ji,
+        blockLength);
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+template<class PMLDataT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcBlockH(typename MaterialT::LocalDataH & materialData,
+    PMLDataT & pmlData, int fieldDirection, RunlineT & rl, long firstCell,
+    int blockLength, float dj_inv, float dk_inv)
+{
+    float dEj[VectorKernels::BLOCK_LENGTH];
+    float dEk[VectorKernels::BLOCK_LENGTH];
+    float Ki[VectorKernels::BLOCK_LENGTH];
+    assert(blockLength <= VectorKernels::BLOCK_LENGTH);
+    
+    VectorKernels::difference(rl.gj[0]+firstCell, rl.gj[1]+firstCell, dk_inv,
+        dEj, blockLength);
+    VectorKernels::difference(rl.gk[0]+firstCell, rl.gk[1]+firstCell, dj_inv,
+        dEk, blockLength);
+    mPML.updateK(pmlData, dEj, dEk, Ki, blockLength);
+    ModularUpdateEquation_Material<MaterialT>::mMaterial.updateH(
+        materialData, fieldDirection, rl.fi+firstCell, dEj, dEk, Ki,
+        blockLength);
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+template<class PMLDataT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcRunlineE(typename MaterialT::LocalDataE & materialData,
+    PMLDataT & pmlData, int fieldDirection, RunlineT & rl,
+    float dj_inv, float dk_inv, VectorKernels::Path<true>)
+{
+    const long len(rl.length);
+    for (long mm = 0; mm < len; mm += VectorKernels::BLOCK_LENGTH)
+    {
+        int blockLength = std::min(long(VectorKernels::BLOCK_LENGTH), len-mm);
+        calcBlockE(materialData, pmlData, fieldDirection, rl, mm, blockLength,
+            dj_inv, dk_inv);
+    }
+}
+
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+template<class PMLDataT>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcRunlineH(typename MaterialT::LocalDataH & materialData,
+    PMLDataT & pmlData, int fieldDirection, RunlineT & rl,
+    float dj_inv, float dk_inv, VectorKernels::Path<true>)
+{
+    const long len(rl.length);
+    for (long mm = 0; mm < len; mm += VectorKernels::BLOCK_LENGTH)
+    {
+        int blockLength = std::min(long(VectorKernels::BLOCK_LENGTH), len-mm);
+        calcBlockH(materialData, pmlData, fieldDirection, rl, mm, blockLength,
+            dj_inv, dk_inv);
+    }
+}
+
+// The fused update does Ex, Ey and Ez (or Hx, Hy and Hz) of one run of Yee
+// cells block by block, so each block of the curl fields is read from memory
+// once for all three components.  The PML template parameters of the three
+// components are consecutive, starting from that of the x component.
 
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+template<int FIELD_DIRECTION_PML>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcFusedE(long xRunline, VectorKernels::Path<true>)
+{
+    typedef ModularUpdateEquation_Runline<RunlineT> Runlines;
+    const typename Runlines::FusedRunline & fused(Runlines::mFusedRunlinesE[
+        Runlines::mFusedE[0][xRunline]]);
+    RunlineT & rl0(Runlines::mRunlinesE[0][fused.runline[0]]);
+    RunlineT & rl1(Runlines::mRunlinesE[1][fused.runline[1]]);
+    RunlineT & rl2(Runlines::mRunlinesE[2][fused.runline[2]]);
+    
+    MaterialT & material(ModularUpdateEquation_Material<MaterialT>::mMaterial);
+    typename MaterialT::LocalDataE materialData0, materialData1, materialData2;
+    typename PMLT::template LocalDataE<FIELD_DIRECTION_PML> pmlData0;
+    typename PMLT::template LocalDataE<(FIELD_DIRECTION_PML+1)%3> pmlData1;
+    typename PMLT::template LocalDataE<(FIELD_DIRECTION_PML+2)%3> pmlData2;
+    
+    material.initLocalE(materialData0);
+    material.initLocalE(materialData1);
+    material.initLocalE(materialData2);
+    material.onStartRunlineE(materialData0, rl0, 0);
+    material.onStartRunlineE(materialData1, rl1, 1);
+    material.onStartRunlineE(materialData2, rl2, 2);
+    mPML.onStartRunlineE(pmlData0, rl0, 0, 1, 2);
+    mPML.onStartRunlineE(pmlData1, rl1, 1, 2, 0);
+    mPML.onStartRunlineE(pmlData2, rl2, 2, 0, 1);
+    
+    const long len(rl0.length);
+    for (long mm = 0; mm < len; mm += VectorKernels::BLOCK_LENGTH)
+    {
+        int blockLength = std::min(long(VectorKernels::BLOCK_LENGTH), len-mm);
+        calcBlockE(materialData0, pmlData0, 0, rl0, mm, blockLength,
+            mDxyz_inverse[1], mDxyz_inverse[2]);
+        calcBlockE(materialData1, pmlData1, 1, rl1, mm, blockLength,
+            mDxyz_inverse[2], mDxyz_inverse[0]);
+        calcBlockE(materialData2, pmlData2, 2, rl2, mm, blockLength,
+            mDxyz_inverse[0], mDxyz_inverse[1]);
+    }
+}
 
+template<class MaterialT, class RunlineT, class PMLT, class CurrentT>
+template<int FIELD_DIRECTION_PML>
+void ModularUpdateEquation<MaterialT, RunlineT, PMLT, CurrentT>::
+calcFusedH(long xRunline, VectorKernels::Path<true>)
+{
+    typedef ModularUpdateEquation_Runline<RunlineT> Runlines;
+    const typename Runlines::FusedRunline & fused(Runlines::mFusedRunlinesH[
+        Runlines::mFusedH[0][xRunline]]);
+    RunlineT & rl0(Runlines::mRunlinesH[0][fused.runline[0]]);
+    RunlineT & rl1(Runlines::mRunlinesH[1][fused.runline[1]]);
+    RunlineT & rl2(Runlines::mRunlinesH[2][fused.runline[2]]);
+    
+    MaterialT & material(ModularUpdateEquation_Material<MaterialT>::mMaterial);
+    typename MaterialT::LocalDataH materialData0, materialData1, materialData2;
+    typename PMLT::template LocalDataH<FIELD_DIRECTION_PML> pmlData0;
+    typename PMLT::template LocalDataH<(FIELD_DIRECTION_PML+1)%3> pmlData1;
+    typename PMLT::template LocalDataH<(FIELD_DIRECTION_PML+2)%3> pmlData2;
+    
+    material.initLocalH(materialData0);
+    material.initLocalH(materialData1);
+    material.initLocalH(materialData2);
+    material.onStartRunlineH(materialData0, rl0, 0);
+    material.onStartRunlineH(materialData1, rl1, 1);
+    material.onStartRunlineH(materialData2, rl2, 2);
+    mPML.onStartRunlineH(pmlData0, rl0, 0, 1, 2);
+    mPML.onStartRunlineH(pmlData1, rl1, 1, 2, 0);
+    mPML.onStartRunlineH(pmlData2, rl2, 2, 0, 1);
+    
+    const long len(rl0.length);
+    for (long mm = 0; mm < len; mm += VectorKernels::BLOCK_LENGTH)
+    {
+        int blockLength = std::min(long(VectorKernels::BLOCK_LENGTH), len-mm);
+        calcBlockH(materialData0, pmlData0, 0, rl0, mm, blockLength,
+            mDxyz_inverse[1], mDxyz_inverse[2]);
+        calcBlockH(materialData1, pmlData1, 1, rl1, mm, blockLength,
+            mDxyz_inverse[2], mDxyz_inverse[0]);
+        calcBlockH(materialData2, pmlData2, 2, rl2, mm, blockLength,
+            mDxyz_inverse[0], mDxyz_inverse[1]);
+    }
+}
@@ -14,7 +14,10 @@
 #include "geometry.h"
 #include "Runline.h"
 #include "Paint.h"
+#include "InterleavedLattice.h"
+#include "VectorKernels.h"
 #include <vector>
+#include <algorithm>
 
 // TEMPLATE REQUIREMENTS:
 //  Material must have constructor with appropriate arguments (TBD?)
@@ -61,15 +64,75 @@ public:
     
     virtual void calcEPhase(int direction);
     virtual void calcHPhase(int direction);
+    virtual void calcEPhase(int direction, int threadNum, int numThreads);
+    virtual void calcHPhase(int direction, int threadNum, int numThreads);
+    virtual void calcETile(int direction, int tileNum, int numTiles);
+    virtual void calcHTile(int direction, int tileNum, int numTiles);
+    virtual void fuseRunlines(const InterleavedLattice & lattice);
     virtual void setCurrentSource(CurrentSource* source);
     virtual void allocateAuxBuffers();
     
 private:
+    // Update runlines firstRunline up to but not including endRunline.
+    // firstCell is the total length of all the runlines before firstRunline.
+    void calcERange(int direction, long firstRunline, long endRunline,
+        long firstCell);
+    void calcHRange(int direction, long firstRunline, long endRunline,
+        long firstCell);
+    
+    template<int FIELD_DIRECTION_PML>
+    void calcE(int fieldDirection, long firstRunline, long endRunline,
+        long firstCell);
+    
     template<int FIELD_DIRECTION_PML>
-    void calcE(int fieldDirection);
+    void calcH(int fieldDirection, long firstRunline, long endRunline,
+        long firstCell);
+    
+    // Long runlines are updated a block of cells at a time with the vector
+    // kernels when the material, PML and current all support it.  This is
+    // decided at compile time for each combination of templates.
+    static const bool VECTORIZED = MaterialT::VECTORIZED &&
+        PMLT::VECTORIZED && CurrentT::VECTORIZED;
+    
+    template<class PMLDataT>
+    void calcRunlineE(typename MaterialT::LocalDataE & materialData,
+        PMLDataT & pmlData, int fieldDirection, RunlineT & rl,
+        float dj_inv, float dk_inv, VectorKernels::Path<true>);
+    template<class PMLDataT>
+    void calcRunlineE(typename MaterialT::LocalDataE & materialData,
+        PMLDataT & pmlData, int fieldDirection, RunlineT & rl,
+        float dj_inv, float dk_inv, VectorKernels::Path<false>) {}
     
+    template<class PMLDataT>
+    void calcRunlineH(typename MaterialT::LocalDataH & materialData,
+        PMLDataT & pmlData, int fieldDirection, RunlineT & rl,
+        float dj_inv, float dk_inv, VectorKernels::Path<true>);
+    template<class PMLDataT>
+    void calcRunlineH(typename MaterialT::LocalDataH & materialData,
+        PMLDataT & pmlData, int fieldDirection, RunlineT & rl,
+        float dj_inv, float dk_inv, VectorKernels::Path<false>) {}
+    
+    // Update all three components of a fused runline; xRunline is the index
+    // of its x component.
+    template<int FIELD_DIRECTION_PML>
+    void calcFusedE(long xRunline, VectorKernels::Path<true>);
+    template<int FIELD_DIRECTION_PML>
+    void calcFusedE(long xRunline, VectorKernels::Path<false>) {}
     template<int FIELD_DIRECTION_PML>
-    void calcH(int fieldDirection);
+    void calcFusedH(long xRunline, VectorKernels::Path<true>);
+    template<int FIELD_DIRECTION_PML>
+    void calcFusedH(long xRunline, VectorKernels::Path<false>) {}
+    
+    // One block of at most VectorKernels::BLOCK_LENGTH cells of a runline,
+    // starting firstCell cells in.
+    template<class PMLDataT>
+    void calcBlockE(typename MaterialT::LocalDataE & materialData,
+        PMLDataT & pmlData, int fieldDirection, RunlineT & rl, long firstCell,
+        int blockLength, float dj_inv, float dk_inv);
+    template<class PMLDataT>
+    void calcBlockH(typename MaterialT::LocalDataH & materialData,
+        PMLDataT & pmlData, int fieldDirection, RunlineT & rl, long firstCell,
+        int blockLength, float dj_inv, float dk_inv);
     
     Vector3f mDxyz;
     Vector3f mDxyz_inverse;
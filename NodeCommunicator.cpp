@@ -0,0 +1,171 @@
+/*
+ *  NodeCommunicator.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "NodeCommunicator.h"
+#include "Exception.h"
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cassert>
+#include <sstream>
+
+using namespace std;
+
+NodeCommunicatorPtr NodeCommunicator::
+forkLocalNodes(int numNodes)
+{
+    assert(numNodes >= 1);
+
+    // One socket pair for every pair of nodes ii < jj, stored at
+    // ends[ii*numNodes+jj].  Node ii keeps end 0 and node jj keeps end 1.
+    vector<vector<int> > ends(numNodes*numNodes, vector<int>(2, -1));
+    for (int ii = 0; ii < numNodes; ii++)
+    for (int jj = ii+1; jj < numNodes; jj++)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            throw(Exception("Could not create sockets between nodes."));
+        ends[ii*numNodes+jj][0] = fds[0];
+        ends[ii*numNodes+jj][1] = fds[1];
+    }
+
+    int myRank = 0;
+    vector<pid_t> children;
+    for (int rank = 1; rank < numNodes && myRank == 0; rank++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+            throw(Exception("Could not fork a new node."));
+        else if (pid == 0)
+        {
+            myRank = rank;
+            children.clear();
+        }
+        else
+            children.push_back(pid);
+    }
+
+    // Keep my end of each of my pairs and close everything else.
+    vector<int> sockets(numNodes, -1);
+    for (int ii = 0; ii < numNodes; ii++)
+    for (int jj = ii+1; jj < numNodes; jj++)
+    {
+        const vector<int> & pair(ends[ii*numNodes+jj]);
+        if (ii == myRank)
+        {
+            sockets[jj] = pair[0];
+            close(pair[1]);
+        }
+        else if (jj == myRank)
+        {
+            sockets[ii] = pair[1];
+            close(pair[0]);
+        }
+        else
+        {
+            close(pair[0]);
+            close(pair[1]);
+        }
+    }
+
+    return NodeCommunicatorPtr(new NodeCommunicator(myRank, numNodes, sockets,
+        children));
+}
+
+NodeCommunicator::
+NodeCommunicator(int rank, int numNodes, const vector<int> & sockets,
+    const vector<pid_t> & children) :
+    mRank(rank),
+    mNumNodes(numNodes),
+    mSockets(sockets),
+    mChildren(children)
+{
+}
+
+NodeCommunicator::
+~NodeCommunicator()
+{
+    for (int nn = 0; nn < mSockets.size(); nn++)
+    if (mSockets[nn] != -1)
+        close(mSockets[nn]);
+
+    for (int nn = 0; nn < mChildren.size(); nn++)
+    {
+        int status;
+        waitpid(mChildren[nn], &status, 0);
+    }
+}
+
+void NodeCommunicator::
+send(int toRank, const void* data, long numBytes)
+{
+    assert(toRank >= 0 && toRank < mNumNodes && toRank != mRank);
+
+    const char* bytes = (const char*)data;
+    while (numBytes > 0)
+    {
+        ssize_t numSent = ::send(mSockets[toRank], bytes, numBytes,
+            MSG_NOSIGNAL);
+        if (numSent < 0 && errno == EINTR)
+            continue;
+        if (numSent <= 0)
+        {
+            ostringstream str;
+            str << "Node " << mRank << " could not send to node " << toRank
+                << ".";
+            throw(Exception(str.str()));
+        }
+        bytes += numSent;
+        numBytes -= numSent;
+    }
+}
+
+void NodeCommunicator::
+receive(int fromRank, void* data, long numBytes)
+{
+    assert(fromRank >= 0 && fromRank < mNumNodes && fromRank != mRank);
+
+    char* bytes = (char*)data;
+    while (numBytes > 0)
+    {
+        ssize_t numRead = ::recv(mSockets[fromRank], bytes, numBytes, 0);
+        if (numRead < 0 && errno == EINTR)
+            continue;
+        if (numRead <= 0)
+        {
+            ostringstream str;
+            str << "Node " << mRank << " could not receive from node "
+                << fromRank << ".";
+            throw(Exception(str.str()));
+        }
+        bytes += numRead;
+        numBytes -= numRead;
+    }
+}
+
+void NodeCommunicator::
+barrier()
+{
+    // Everybody checks in with rank 0, then rank 0 lets everybody go.
+    char token = 0;
+    if (mRank == 0)
+    {
+        for (int nn = 1; nn < mNumNodes; nn++)
+            receive(nn, &token, 1);
+        for (int nn = 1; nn < mNumNodes; nn++)
+            send(nn, &token, 1);
+    }
+    else
+    {
+        send(0, &token, 1);
+        receive(0, &token, 1);
+    }
+}
+
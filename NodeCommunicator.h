@@ -0,0 +1,63 @@
+/*
+ *  NodeCommunicator.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _NODECOMMUNICATOR_
+#define _NODECOMMUNICATOR_
+
+#include "Pointer.h"
+#include <vector>
+#include <sys/types.h>
+
+class NodeCommunicator;
+typedef Pointer<NodeCommunicator> NodeCommunicatorPtr;
+
+/**
+ * Point-to-point messaging between the nodes of a partitioned simulation.
+ * This is a small stand-in for MPI: forkLocalNodes() starts the nodes as
+ * copies of the current process on one machine, joined pairwise by Unix
+ * domain sockets.  Messages are raw bytes; the sender and receiver must agree
+ * on the size.  Every method throws an Exception if the connection fails.
+ */
+class NodeCommunicator
+{
+public:
+    /**
+     * Start numNodes-1 more copies of this process with fork().  Each copy
+     * returns from this function with its own communicator; rank 0 is the
+     * original process.  Call this before starting any threads.
+     */
+    static NodeCommunicatorPtr forkLocalNodes(int numNodes);
+
+    /**
+     * Close all connections.  Rank 0 also waits for the other ranks to exit.
+     */
+    ~NodeCommunicator();
+
+    int rank() const { return mRank; }
+    int numNodes() const { return mNumNodes; }
+
+    void send(int toRank, const void* data, long numBytes);
+    void receive(int fromRank, void* data, long numBytes);
+
+    /**
+     * Wait until every node has called barrier().
+     */
+    void barrier();
+
+private:
+    NodeCommunicator(int rank, int numNodes, const std::vector<int> & sockets,
+        const std::vector<pid_t> & children);
+
+    int mRank;
+    int mNumNodes;
+    std::vector<int> mSockets; // mSockets[r] connects to rank r
+    std::vector<pid_t> mChildren; // only rank 0 has children
+};
+
+
+#endif
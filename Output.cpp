@@ -14,6 +14,8 @@
 #include "SimulationDescription.h"
 
 #include "SimpleEHOutput.h"
+#include "DFTOutput.h"
+#include "ReductionOutput.h"
 #include "CurrentPolarizationOutput.h"
 
 #include "Version.h"
@@ -28,7 +30,11 @@ newSetupOutput(const VoxelizedPartition & vp, const OutputDescPtr & desc)
 {
     Vector3i threeFalses(0,0,0);
     
-    if (desc->whichJ() == threeFalses && desc->whichP() == threeFalses &&
+    if (desc->reduction() != kNoReduction)
+        return SetupOutputPtr(new ReductionSetupOutput(desc));
+    else if (desc->frequencies().size() > 0)
+        return SetupOutputPtr(new DFTSetupOutput(desc));
+    else if (desc->whichJ() == threeFalses && desc->whichP() == threeFalses &&
         desc->whichP() == threeFalses && desc->whichM() == threeFalses)
         return SetupOutputPtr(new SimpleEHSetupOutput(desc));
     else if (desc->whichH() == threeFalses &&
@@ -42,6 +48,10 @@ newSetupOutput(const VoxelizedPartition & vp, const OutputDescPtr & desc)
 }
 
 
+int Output::sNumWriteBuffers = 8;
+FileWriterThreadPtr Output::sWriterThread(0L);
+bool Output::sChunkedFiles = 0;
+
 Output::
 Output(OutputDescPtr description) :
     mDescription(description)
@@ -71,4 +81,29 @@ allocateAuxBuffers()
 //    LOG << "Not allocating output buffer.  (What buffer?)\n";
 }
 
+void Output::
+setWriteBuffers(int numBuffers)
+{
+    // Outputs already made keep the old thread until they are deleted.
+    sNumWriteBuffers = numBuffers;
+    sWriterThread = 0L;
+}
+
+AsyncFileWriterPtr Output::
+openDataFile(const string & fileName, const string & spec) const
+{
+    if (sNumWriteBuffers > 0 && sWriterThread == 0L)
+        sWriterThread = FileWriterThreadPtr(
+            new FileWriterThread(sNumWriteBuffers));
+    
+    if (sChunkedFiles || mDescription->errorBound() > 0)
+    {
+        ChunkedFileWriterPtr chunked(new ChunkedFileWriter(fileName, spec));
+        chunked->setErrorBound(mDescription->errorBound(),
+            mDescription->isErrorBoundRelative());
+        return AsyncFileWriterPtr(new AsyncFileWriter(chunked,
+            sWriterThread));
+    }
+    return AsyncFileWriterPtr(new AsyncFileWriter(fileName, sWriterThread));
+}
 
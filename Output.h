@@ -12,6 +12,8 @@
 
 #include "Pointer.h"
 #include "SimulationDescriptionPredeclarations.h"
+#include "AsyncFileWriter.h"
+#include <string>
 
 class VoxelizedPartition;
 class CalculationPartition;
@@ -66,8 +68,37 @@ public:
     
     virtual void allocateAuxBuffers();
     
+    /**
+     * Number of staging buffers shared by all the outputs made from now on.
+     * Samples are copied into a buffer and written by one background thread,
+     * and the timestep waits only when all the buffers are still queued for
+     * writing, so the outputs together hold at most this many samples in
+     * memory.  Zero writes every sample on the timestep thread.  The default
+     * is 8.
+     */
+    static void setWriteBuffers(int numBuffers);
+    
+    /**
+     * Write the data files of outputs made from now on as compressed
+     * chunked files (see ChunkedFile.h) instead of raw floats.
+     */
+    static void setChunkedFiles(bool chunked) { sChunkedFiles = chunked; }
+    
+protected:
+    /**
+     * Open the data file with the current settings.  A chunked file carries
+     * the given spec text with it.  Outputs with an error bound are always
+     * chunked, since only chunked files can be stored lossily.
+     */
+    AsyncFileWriterPtr openDataFile(const std::string & fileName,
+        const std::string & spec) const;
+    
 private:
     OutputDescPtr mDescription;
+    
+    static int sNumWriteBuffers;
+    static FileWriterThreadPtr sWriterThread; // made by the first output
+    static bool sChunkedFiles;
 };
 typedef Pointer<Output> OutputPtr;
 
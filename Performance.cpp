@@ -130,11 +130,13 @@ void PartitionStatistics::
 setNumCurrentSources(int num)
 {
     mCurrentSourceMicroseconds.resize(num, 0.0);
+    mCurrentSourceStallMicroseconds.resize(num, 0.0);
 }
 void PartitionStatistics::
 setNumHuygensSurfaces(int num)
 {
     mHuygensSurfaceMicroseconds.resize(num, 0.0);
+    mHuygensSurfaceStallMicroseconds.resize(num, 0.0);
 }
 
 void PartitionStatistics::
@@ -172,6 +174,16 @@ addHuygensSurfaceMicroseconds(int source, double us)
 {
     mHuygensSurfaceMicroseconds.at(source) += us;
 }
+void PartitionStatistics::
+addCurrentSourceStallMicroseconds(int source, double us)
+{
+    mCurrentSourceStallMicroseconds.at(source) += us;
+}
+void PartitionStatistics::
+addHuygensSurfaceStallMicroseconds(int source, double us)
+{
+    mHuygensSurfaceStallMicroseconds.at(source) += us;
+}
 
 
 void PartitionStatistics::
@@ -196,6 +208,12 @@ printForMatlab(std::ostream & str, const string & prefix,
     double totalHuygensSurface_us = accumulate(
         mHuygensSurfaceMicroseconds.begin(), mHuygensSurfaceMicroseconds.end(),
         0.0);
+    double totalCurrentSourceStall_us = accumulate(
+        mCurrentSourceStallMicroseconds.begin(),
+        mCurrentSourceStallMicroseconds.end(), 0.0);
+    double totalHuygensSurfaceStall_us = accumulate(
+        mHuygensSurfaceStallMicroseconds.begin(),
+        mHuygensSurfaceStallMicroseconds.end(), 0.0);
     
     str << prefix << "calcETime = " << totalMatE_us*1e-6 << ";\n";
     str << prefix << "calcHTime = " << totalMatH_us*1e-6 << ";\n";
@@ -210,6 +228,10 @@ printForMatlab(std::ostream & str, const string & prefix,
         *1e-6 << ";\n";
     str << prefix << "huygensSurfaceTime = " << totalHuygensSurface_us*1e-6
         << ";\n";
+    str << prefix << "currentSourceStallTime = "
+        << totalCurrentSourceStall_us*1e-6 << ";\n";
+    str << prefix << "huygensSurfaceStallTime = "
+        << totalHuygensSurfaceStall_us*1e-6 << ";\n";
     
     for (int nn = 0; nn < mMaterialMicrosecondsE.size(); nn++)
     {
@@ -29,6 +29,9 @@ public:
     
     void setTimestepMicroseconds(long timestep, double us);
     
+    double runCalculationMicroseconds() const
+        { return mRunCalculationMicroseconds; }
+    
     void printForMatlab(std::ostream & str);
 private:
     double mReadDescriptionMicroseconds;
@@ -59,6 +62,10 @@ public:
     void addCurrentSourceMicroseconds(int source, double us);
     void addHuygensSurfaceMicroseconds(int source, double us);
     
+    // Time spent waiting for source data files to be read ahead
+    void addCurrentSourceStallMicroseconds(int source, double us);
+    void addHuygensSurfaceStallMicroseconds(int source, double us);
+    
     void printForMatlab(std::ostream & str, const std::string & prefix,
         const std::vector<UpdateEquationPtr> & materials, long numT);
 private:
@@ -69,6 +76,8 @@ private:
     std::vector<double> mSoftSourceMicroseconds;
     std::vector<double> mCurrentSourceMicroseconds;
 	std::vector<double> mHuygensSurfaceMicroseconds;
+    std::vector<double> mCurrentSourceStallMicroseconds;
+    std::vector<double> mHuygensSurfaceStallMicroseconds;
 };
 
 
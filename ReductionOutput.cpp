@@ -0,0 +1,459 @@
+/*
+ *  ReductionOutput.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "ReductionOutput.h"
+#include "SimulationDescription.h"
+#include "CalculationPartition.h"
+#include "VoxelizedPartition.h"
+#include "InterleavedLattice.h"
+#include "IODescriptionFile.h"
+#include "PhysicalConstants.h"
+#include "VectorKernels.h"
+#include "YeeUtilities.h"
+#include "Paint.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace YeeUtilities;
+
+// Relative permittivity and permeability seen by the field update in a
+// material; returns false for dispersive materials, whose polarization
+// energy is not in epsr E^2.
+static bool sRelativeConstants(const MaterialDescPtr & material, float & epsr,
+    float & mur);
+
+#pragma mark *** Delegate ***
+
+ReductionSetupOutput::
+ReductionSetupOutput(const OutputDescPtr & desc) :
+    SetupOutput(desc)
+{
+}
+
+OutputPtr ReductionSetupOutput::
+makeOutput(const VoxelizedPartition & vp, const CalculationPartition & cp)
+    const
+{
+    if (description()->reduction() == kFluxReduction)
+        return OutputPtr(new FluxOutput(description(), vp, cp));
+    assert(description()->reduction() == kEnergyReduction);
+    return OutputPtr(new EnergyOutput(description(), vp, cp));
+}
+
+#pragma mark *** Output ***
+
+ReductionOutput::
+ReductionOutput(OutputDescPtr description,
+    const VoxelizedPartition & vp,
+    const CalculationPartition & cp) :
+    Output(description),
+    mDt(cp.dt()),
+    mDxyz(cp.dxyz()),
+    mDurations(description->durations())
+{
+    int numTimesteps = cp.duration();
+    for (int dd = 0; dd < mDurations.size(); dd++)
+    if (mDurations[dd].last() > (numTimesteps-1))
+        mDurations[dd].setLast(numTimesteps-1);
+
+    vector<Region> regions;
+    for (int rr = 0; rr < description->regions().size(); rr++)
+    {
+        Region nodeRegion(description->regions()[rr].within(
+            vp.calcYeeCells()));
+        if (!nodeRegion.isEmpty())
+            regions.push_back(nodeRegion);
+    }
+
+    string specfile(description->file() + string(".txt"));
+    string datafile(description->file());
+
+    IODescriptionFile::write(specfile, description, vp, regions, mDurations);
+
+    ostringstream spec;
+    IODescriptionFile::write(spec, specfile, description, vp, regions,
+        mDurations);
+    mSpec = spec.str();
+    mWriter = openDataFile(datafile, mSpec);
+}
+
+ReductionOutput::
+~ReductionOutput()
+{
+}
+
+int ReductionOutput::
+sampleInterval(long timestep) const
+{
+    for (int dd = 0; dd < mDurations.size(); dd++)
+    {
+        if (timestep >= mDurations[dd].first() &&
+            timestep <= mDurations[dd].last() &&
+            (timestep - mDurations[dd].first())%mDurations[dd].period() == 0)
+            return dd;
+    }
+    return -1;
+}
+
+void ReductionOutput::
+writeValue(double value)
+{
+    vector<float> & sample(mWriter->beginSample());
+    sample.push_back(value);
+    mWriter->endSample();
+}
+
+#pragma mark *** Flux ***
+
+FluxOutput::
+FluxOutput(OutputDescPtr description,
+    const VoxelizedPartition & vp,
+    const CalculationPartition & cp) :
+    ReductionOutput(description, vp, cp),
+    mFrequencies(description->frequencies()),
+    mLastHTimestep(-2)
+{
+    // The tangential fields are interpolated from the cells on both sides of
+    // each face and of each face cell, which may be ghost cells from another
+    // node but must not be past the edge of the grid, where they would wrap
+    // around to the far side.
+    Rect3i interpolableYee(vp.calcYeeCells());
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        if (interpolableYee.p1[xyz] == vp.gridYeeCells().p1[xyz])
+            interpolableYee.p1[xyz]++;
+        if (interpolableYee.p2[xyz] == vp.gridYeeCells().p2[xyz])
+            interpolableYee.p2[xyz]--;
+    }
+    
+    for (int rr = 0; rr < description->regions().size(); rr++)
+    {
+        Rect3i box(description->regions()[rr].yeeCells());
+
+        int planeNormal = -1;
+        for (int xyz = 2; xyz >= 0; xyz--)
+        if (box.num(xyz) == 1)
+            planeNormal = xyz;
+
+        for (int normal = 0; normal < 3; normal++)
+        for (int side = 0; side < 2; side++)
+        {
+            if (planeNormal != -1 && (normal != planeNormal || side == 0))
+                continue;
+
+            Face face;
+            face.normal = normal;
+            face.yeeCells = box;
+            if (planeNormal != -1)
+                face.area = 1.0;
+            else if (side == 0)
+            {
+                face.yeeCells.p2[normal] = box.p1[normal];
+                face.area = -1.0;
+            }
+            else
+            {
+                face.yeeCells.p1[normal] = box.p2[normal] + 1;
+                face.yeeCells.p2[normal] = box.p2[normal] + 1;
+                face.area = 1.0;
+            }
+            face.area *= mDxyz[(normal+1)%3]*mDxyz[(normal+2)%3];
+
+            // Faces on another node are that node's to count.
+            Rect3i nodeFace(intersection(face.yeeCells, vp.calcYeeCells()));
+            if (!vec_ge(nodeFace.num(), 1))
+                continue;
+            
+            face.yeeCells = intersection(nodeFace, interpolableYee);
+            if (!vec_ge(face.yeeCells.num(), 1))
+            {
+                LOG << "Flux face " << nodeFace << " in " <<
+                    description->file() << " is on the edge of the grid; "
+                    "skipping it.\n";
+                continue;
+            }
+            if (face.yeeCells.p1 != nodeFace.p1 ||
+                face.yeeCells.p2 != nodeFace.p2)
+                LOG << "Flux face " << nodeFace << " in " <<
+                    description->file() << " touches the edge of the grid; "
+                    "clipping it to " << face.yeeCells << ".\n";
+
+            long numValues = face.yeeCells.count();
+            for (int tt = 0; tt < 2; tt++)
+            {
+                face.realE[tt].resize(numValues*mFrequencies.size(), 0.0);
+                face.imagE[tt].resize(numValues*mFrequencies.size(), 0.0);
+                face.realH[tt].resize(numValues*mFrequencies.size(), 0.0);
+                face.imagH[tt].resize(numValues*mFrequencies.size(), 0.0);
+            }
+            mFaces.push_back(face);
+        }
+    }
+    
+    if (mFrequencies.size() > 0)
+        mSpectrumWriter = openDataFile(description->file() +
+            string(".spectrum"), spec());
+}
+
+FluxOutput::
+~FluxOutput()
+{
+    if (mFrequencies.size() > 0)
+        writeSpectrum();
+}
+
+void FluxOutput::
+outputHPhase(const CalculationPartition & cp, long timestep)
+{
+    int interval = sampleInterval(timestep);
+    bool keepH = isSampled(timestep+1);
+    if (interval == -1 && !keepH)
+        return;
+
+    const InterleavedLattice & lattice(cp.lattice());
+    const Vector3i unitStride(1,1,1);
+    double flux = 0.0;
+
+    for (int ff = 0; ff < mFaces.size(); ff++)
+    {
+        Face & face(mFaces[ff]);
+        Vector3f faceCenter(0.5f, 0.5f, 0.5f);
+        faceCenter[face.normal] = 0.0f;
+
+        for (int tt = 0; tt < 2; tt++)
+        {
+            face.h[tt].clear();
+            lattice.gatherInterpolatedH((face.normal+tt+1)%3, face.yeeCells,
+                unitStride, faceCenter, face.h[tt]);
+        }
+
+        if (interval != -1)
+        {
+            for (int tt = 0; tt < 2; tt++)
+            {
+                face.e[tt].clear();
+                lattice.gatherInterpolatedE((face.normal+tt+1)%3,
+                    face.yeeCells, unitStride, faceCenter, face.e[tt]);
+            }
+
+            // H at timestep n is the mean of H at n - 1/2 and n + 1/2.
+            const vector<float> & e1(face.e[0]);
+            const vector<float> & e2(face.e[1]);
+            const vector<float> & h1(face.h[0]);
+            const vector<float> & h2(face.h[1]);
+            const vector<float> & lastH1(mLastHTimestep == timestep-1 ?
+                face.lastH[0] : face.h[0]);
+            const vector<float> & lastH2(mLastHTimestep == timestep-1 ?
+                face.lastH[1] : face.h[1]);
+
+            double faceFlux = 0.0;
+            for (long nn = 0; nn < e1.size(); nn++)
+                faceFlux += e1[nn]*(h2[nn] + lastH2[nn]) -
+                    e2[nn]*(h1[nn] + lastH1[nn]);
+            flux += 0.5*faceFlux*face.area;
+
+            if (mFrequencies.size() > 0)
+            {
+                double weight = mDt*durations()[interval].period();
+                for (int tt = 0; tt < 2; tt++)
+                {
+                    accumulate(timestep*mDt, face.e[tt], face.realE[tt],
+                        face.imagE[tt], weight);
+                    accumulate((timestep+0.5)*mDt, face.h[tt],
+                        face.realH[tt], face.imagH[tt], weight);
+                }
+            }
+        }
+
+        if (keepH)
+        for (int tt = 0; tt < 2; tt++)
+            face.lastH[tt].swap(face.h[tt]);
+    }
+
+    if (keepH)
+        mLastHTimestep = timestep;
+    if (interval != -1)
+        writeValue(flux);
+}
+
+void FluxOutput::
+accumulate(double time, const vector<float> & values, vector<double> & real,
+    vector<double> & imag, double weight)
+{
+    const long numValues = values.size();
+    const int numFrequencies = mFrequencies.size();
+    assert(real.size() == numValues*numFrequencies);
+
+    for (int ff = 0; ff < numFrequencies; ff++)
+    {
+        double phase = 2.0*M_PI*mFrequencies[ff]*time;
+        VectorKernels::dftAccumulate(&values[0], weight*cos(phase),
+            -weight*sin(phase), &real[ff*numValues], &imag[ff*numValues],
+            numValues);
+    }
+}
+
+void FluxOutput::
+writeSpectrum()
+{
+    // The whole spectrum is one sample.
+    vector<float> & spectrum(mSpectrumWriter->beginSample());
+    
+    // Re(E x H*) . n = Re(E1 H2* - E2 H1*)
+    for (int ff = 0; ff < mFrequencies.size(); ff++)
+    {
+        double flux = 0.0;
+        for (int face = 0; face < mFaces.size(); face++)
+        {
+            const Face & f(mFaces[face]);
+            long numValues = f.yeeCells.count();
+            long first = ff*numValues;
+            double faceFlux = 0.0;
+            for (long nn = first; nn < first + numValues; nn++)
+                faceFlux += f.realE[0][nn]*f.realH[1][nn] +
+                    f.imagE[0][nn]*f.imagH[1][nn] -
+                    f.realE[1][nn]*f.realH[0][nn] -
+                    f.imagE[1][nn]*f.imagH[0][nn];
+            flux += faceFlux*f.area;
+        }
+        spectrum.push_back(flux);
+    }
+    mSpectrumWriter->endSample();
+}
+
+#pragma mark *** Energy ***
+
+EnergyOutput::
+EnergyOutput(OutputDescPtr description,
+    const VoxelizedPartition & vp,
+    const CalculationPartition & cp) :
+    ReductionOutput(description, vp, cp),
+    mLastHTimestep(-2)
+{
+    for (int rr = 0; rr < description->regions().size(); rr++)
+    {
+        Region nodeRegion(description->regions()[rr].within(
+            vp.calcYeeCells()));
+        if (!nodeRegion.isEmpty())
+            mRegions.push_back(nodeRegion);
+    }
+    
+    // Look up the material at each field point in the order that
+    // InterleavedLattice::gatherE and gatherH visit them.
+    const VoxelGrid & voxels(vp.voxels());
+    bool warnDispersive = 0;
+    for (int xyz = 0; xyz < 3; xyz++)
+    for (int rr = 0; rr < mRegions.size(); rr++)
+    {
+        const Rect3i & yeeCells(mRegions[rr].yeeCells());
+        const Vector3i & stride(mRegions[rr].stride());
+        const float strideVolume = stride[0]*stride[1]*stride[2];
+        
+        Vector3i p;
+        for (p[2] = yeeCells.p1[2]; p[2] <= yeeCells.p2[2]; p[2] += stride[2])
+        for (p[1] = yeeCells.p1[1]; p[1] <= yeeCells.p2[1]; p[1] += stride[1])
+        for (p[0] = yeeCells.p1[0]; p[0] <= yeeCells.p2[0]; p[0] += stride[0])
+        {
+            float epsr, mur, unused;
+            Paint* paintE = voxels(yeeToHalf(p, octantE(xyz)));
+            Paint* paintH = voxels(yeeToHalf(p, octantH(xyz)));
+            if (!sRelativeConstants(paintE->bulkMaterial(), epsr, unused))
+                warnDispersive = 1;
+            if (!sRelativeConstants(paintH->bulkMaterial(), unused, mur))
+                warnDispersive = 1;
+            mEpsr[xyz].push_back(epsr*strideVolume);
+            mMur[xyz].push_back(mur*strideVolume);
+        }
+    }
+    
+    if (warnDispersive)
+        LOG << "Energy output " << description->file() << " covers "
+            "dispersive materials; their polarization energy is not "
+            "counted.\n";
+}
+
+EnergyOutput::
+~EnergyOutput()
+{
+}
+
+void EnergyOutput::
+outputHPhase(const CalculationPartition & cp, long timestep)
+{
+    bool isSampledNow = isSampled(timestep);
+    bool keepH = isSampled(timestep+1);
+    if (!isSampledNow && !keepH)
+        return;
+
+    const InterleavedLattice & lattice(cp.lattice());
+    const double cellVolume = mDxyz[0]*mDxyz[1]*mDxyz[2];
+
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        mH[xyz].clear();
+        for (int rr = 0; rr < mRegions.size(); rr++)
+            lattice.gatherH(xyz, mRegions[rr].yeeCells(),
+                mRegions[rr].stride(), mH[xyz]);
+    }
+
+    if (isSampledNow)
+    {
+        double electric = 0.0, magnetic = 0.0;
+        for (int xyz = 0; xyz < 3; xyz++)
+        {
+            mE.clear();
+            for (int rr = 0; rr < mRegions.size(); rr++)
+                lattice.gatherE(xyz, mRegions[rr].yeeCells(),
+                    mRegions[rr].stride(), mE);
+            assert(mE.size() == mEpsr[xyz].size());
+
+            const vector<float> & lastH(mLastHTimestep == timestep-1 ?
+                mLastH[xyz] : mH[xyz]);
+            for (long nn = 0; nn < mE.size(); nn++)
+            {
+                electric += mE[nn]*mE[nn]*mEpsr[xyz][nn];
+                magnetic += mH[xyz][nn]*lastH[nn]*mMur[xyz][nn];
+            }
+        }
+        writeValue(0.5*cellVolume*(Constants::eps0*electric +
+            Constants::mu0*magnetic));
+    }
+
+    if (keepH)
+    {
+        for (int xyz = 0; xyz < 3; xyz++)
+            mLastH[xyz].swap(mH[xyz]);
+        mLastHTimestep = timestep;
+    }
+}
+
+
+
+#pragma mark *** Helpers ***
+
+static bool sRelativeConstants(const MaterialDescPtr & material, float & epsr,
+    float & mur)
+{
+    epsr = 1.0f;
+    mur = 1.0f;
+    if (material == 0L)
+        return 1;
+    
+    const Map<string, string> & params(material->params());
+    string model(material->modelName());
+    bool isDispersive = (model == "DrudeMetal1" || model == "MultiPole");
+    
+    const char* epsName = isDispersive ? "epsinf" : "epsr";
+    if (params.count(epsName))
+        istringstream(params[epsName]) >> epsr;
+    if (params.count("mur"))
+        istringstream(params["mur"]) >> mur;
+    return !isDispersive;
+}
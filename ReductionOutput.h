@@ -0,0 +1,158 @@
+/*
+ *  ReductionOutput.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _REDUCTIONOUTPUT_
+#define _REDUCTIONOUTPUT_
+
+#include "SimulationDescription.h"
+#include "Output.h"
+#include "geometry.h"
+#include <vector>
+
+class ReductionSetupOutput;
+typedef Pointer<ReductionSetupOutput> ReductionSetupOutputPtr;
+
+class ReductionOutput;
+typedef Pointer<ReductionOutput> ReductionOutputPtr;
+
+class ReductionSetupOutput : public SetupOutput
+{
+public:
+    ReductionSetupOutput(const OutputDescPtr & desc);
+
+    virtual OutputPtr makeOutput(const VoxelizedPartition & vp,
+        const CalculationPartition & cp) const;
+};
+
+/**
+ * Base for outputs that boil the fields down to one number per sampled
+ * timestep, worked out in the H phase when E is at timestep n and H at
+ * n + 1/2.  Quantities that want H at timestep n use the average of the
+ * last two H fields; the H field of timestep n - 1 is kept only when n will
+ * be sampled.  If it was not kept (the first timestep of a duration with a
+ * period other than 1), H at n + 1/2 stands in for it.
+ */
+class ReductionOutput : public Output
+{
+public:
+    ReductionOutput(OutputDescPtr description,
+        const VoxelizedPartition & vp,
+        const CalculationPartition & cp);
+    virtual ~ReductionOutput();
+
+protected:
+    /**
+     * @returns the index of the duration that samples this timestep, or -1
+     *  if no duration does
+     */
+    int sampleInterval(long timestep) const;
+    bool isSampled(long timestep) const { return sampleInterval(timestep)>=0; }
+    const std::vector<Duration> & durations() const { return mDurations; }
+
+    void writeValue(double value);
+    
+    // the spec text of the data file, for chunked files
+    const std::string & spec() const { return mSpec; }
+
+    double mDt;
+    Vector3f mDxyz;
+
+private:
+    AsyncFileWriterPtr mWriter;
+    std::string mSpec;
+    std::vector<Duration> mDurations;
+};
+
+/**
+ * Poynting flux, E x H . n dA, out of each region.  A region that is one
+ * cell thick along some axis is a plane and the flux is counted along the
+ * positive axis; any other region is a closed box whose faces lie on the
+ * lower and upper Yee cell boundaries, and the flux is counted outwards.
+ * The tangential E and H are interpolated to the center of each face's
+ * cells, so faces need a cell to spare on each side within the grid: a face
+ * on the first or last cell of the grid is skipped, and the edges of faces
+ * across it are clipped.  Strides are ignored.
+ *
+ * If the description has frequencies, the DFTs of the tangential E and H
+ * on the faces are kept as in DFTOutput, and at the end of the run the
+ * spectral flux Re(E(f) x H(f)*) . n dA at each frequency is written as one
+ * sample of floats to the file named by the spec file's spectrumfile line.
+ * It is in J/Hz, so very weak fields may underflow.
+ */
+class FluxOutput : public ReductionOutput
+{
+public:
+    FluxOutput(OutputDescPtr description,
+        const VoxelizedPartition & vp,
+        const CalculationPartition & cp);
+    virtual ~FluxOutput();
+
+    virtual void outputHPhase(const CalculationPartition & cp, long timestep);
+
+private:
+    void accumulate(double time, const std::vector<float> & values,
+        std::vector<double> & real, std::vector<double> & imag,
+        double weight);
+    void writeSpectrum();
+
+    // The fields on one face, transverse components in cyclic order after
+    // the normal direction.
+    struct Face
+    {
+        Rect3i yeeCells;
+        int normal;
+        double area; // signed by the direction of the flux
+        std::vector<float> e[2];
+        std::vector<float> h[2];
+        std::vector<float> lastH[2];
+        std::vector<double> realE[2]; // [frequency][value]
+        std::vector<double> imagE[2];
+        std::vector<double> realH[2];
+        std::vector<double> imagH[2];
+    };
+
+    std::vector<Face> mFaces;
+    std::vector<double> mFrequencies;
+    long mLastHTimestep;
+    AsyncFileWriterPtr mSpectrumWriter;
+};
+
+/**
+ * Electromagnetic energy in the regions, the sum over the Yee lattice
+ * points of each field component of
+ *
+ *      (eps E^2 + mu H(n - 1/2) H(n + 1/2)) dV / 2,
+ *
+ * which is the energy conserved by the Yee update in a static dielectric.
+ * eps and mu are those of the material painted at each field point: epsr
+ * and mur of the static dielectrics, and epsinf and mur of the dispersive
+ * materials, whose polarization energy is not counted (the output logs a
+ * warning).  dV is scaled up by the region's stride.
+ */
+class EnergyOutput : public ReductionOutput
+{
+public:
+    EnergyOutput(OutputDescPtr description,
+        const VoxelizedPartition & vp,
+        const CalculationPartition & cp);
+    virtual ~EnergyOutput();
+
+    virtual void outputHPhase(const CalculationPartition & cp, long timestep);
+
+private:
+    std::vector<Region> mRegions;
+    std::vector<float> mEpsr[3]; // times the stride volume, in gather order
+    std::vector<float> mMur[3];
+    std::vector<float> mE;
+    std::vector<float> mH[3];
+    std::vector<float> mLastH[3];
+    long mLastHTimestep;
+};
+
+
+#endif
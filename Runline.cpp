@@ -41,6 +41,7 @@ SimpleAuxPMLRunline(const SBPMRunline & setupRunline) :
     SimpleAuxRunline(setupRunline),
     PMLRunline(setupRunline)
 {
+    accumIndex[0] = accumIndex[1] = auxIndex;
 }
 
 #pragma mark *** Output ***
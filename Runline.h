@@ -39,9 +39,9 @@ struct SimpleRunline
     SimpleRunline() {}
     SimpleRunline(const SBMRunline & setupRunline);
     
-    float* fi;
-    float* gj[2];
-    float* gk[2];
+    FieldStorage* fi;
+    FieldStorage* gj[2];
+    FieldStorage* gk[2];
     unsigned long length;
 };
 
@@ -59,6 +59,11 @@ struct PMLRunline
     PMLRunline(const SBPMRunline & setupRunline);
     
     unsigned long pmlIndex[3];
+    
+    // Index of the first cell of the runline in the PML accumulators of its
+    // j and k terms, or -1 where a term is zero all along the runline and
+    // has no accumulator.  Set by the PML when it allocates them.
+    long accumIndex[2];
 };
 
 struct SimpleAuxPMLRunline : public SimpleAuxRunline, public PMLRunline
@@ -17,6 +17,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "Version.h"
 
@@ -46,7 +47,6 @@ SimpleEHOutput(OutputDescPtr description,
     const VoxelizedPartition & vp,
     const CalculationPartition & cp) :
     Output(description),
-    mDatafile(),
 //    mShadowFile(),
     mCurrentSampleInterval(0),
     mDurations(description->durations())
@@ -58,9 +58,10 @@ SimpleEHOutput(OutputDescPtr description,
     assert(description->regions().size() > 0);
     for (int rr = 0; rr < description->regions().size(); rr++)
     {
-        Rect3i outRect(clip(description->regions()[rr].yeeCells(),
-            vp.gridYeeCells()));        
-        mRegions.push_back(Region(outRect, description->regions()[rr].stride()));
+        Region outRegion(description->regions()[rr].within(
+            vp.calcYeeCells()));
+        if (!outRegion.isEmpty())
+            mRegions.push_back(outRegion);
     }
 //    LOG << "Truncating durations to simulation duration.  This is in the "
 //        "wrong place; can't it be done earlier?\n";
@@ -77,14 +78,47 @@ SimpleEHOutput(OutputDescPtr description,
     IODescriptionFile::write(specfile, description, vp, mRegions, mDurations);
     //writeDescriptionFile(vp, cp, specfile, datafile, materialfile);
     
-    mDatafile.open(datafile.c_str(), ios::out | ios::binary);
+    ostringstream spec;
+    IODescriptionFile::write(spec, specfile, description, vp, mRegions,
+        mDurations);
+    mWriter = openDataFile(datafile, spec.str());
+    
+    // Each sample is one array per region for each field, x fastest.
+    if (mWriter->chunkedFile() != 0L)
+    {
+        vector<Vector3i> arraySizes;
+        for (int rr = 0; rr < mRegions.size(); rr++)
+        {
+            Rect3i outRect = mRegions[rr].yeeCells();
+            Vector3i stride = mRegions[rr].stride();
+            arraySizes.push_back(Vector3i(
+                (outRect.num(0)+stride[0]-1)/stride[0],
+                (outRect.num(1)+stride[1]-1)/stride[1],
+                (outRect.num(2)+stride[2]-1)/stride[2]));
+        }
+        mWriter->chunkedFile()->setArrays(arraySizes);
+    }
 //    mShadowFile.open(shadowfile.c_str());
 }
 
 SimpleEHOutput::
 ~SimpleEHOutput()
 {
-    mDatafile.close();
+    if (mWriter->stallMicroseconds() > 0)
+        LOG << description()->file() << " waited "
+            << mWriter->stallMicroseconds()*1e-6 << " s for the disk.\n";
+    
+    ChunkedFileWriterPtr chunked(mWriter->chunkedFile());
+    if (chunked != 0L)
+    {
+        mWriter->flush();
+        double ratio = chunked->storedBytes() > 0 ?
+            double(chunked->rawBytes())/chunked->storedBytes() : 1.0;
+        LOG << description()->file() << " compressed " << ratio
+            << " times, max error " << chunked->maxError() << ".\n";
+        IODescriptionFile::writeCompression(description()->file() + ".txt",
+            ratio, chunked->maxError());
+    }
 }
 
 
@@ -134,106 +168,52 @@ void SimpleEHOutput::
 writeE(const CalculationPartition & cp)
 {   
     const InterleavedLattice & lattice(cp.lattice());
+    vector<float> & sample(mWriter->beginSample());
     
     Vector3f interpPoint = description()->interpolationPoint();
     
     for (int outDir = 0; outDir < 3; outDir++)
+    if (description()->whichE()[outDir] != 0)
     {   
         for (unsigned int rr = 0; rr < mRegions.size(); rr++)
         {
             // The regions have been counter-rotated
             Rect3i outRect = mRegions[rr].yeeCells();
             Vector3i outStride = mRegions[rr].stride();
-            Vector3i p;
             
-            if (description()->whichE()[outDir] != 0)
-            {
-                if (!description()->isInterpolated())
-                {
-                    for (p[2] = outRect.p1[2]; p[2] <= outRect.p2[2];
-                        p[2] += outStride[2])
-                    for (p[1] = outRect.p1[1]; p[1] <= outRect.p2[1];
-                        p[1] += outStride[1])
-                    for (p[0] = outRect.p1[0]; p[0] <= outRect.p2[0];
-                        p[0] += outStride[0])
-                    {
-                        float val = lattice.getE(outDir, p);
-                        mDatafile.write((char*)(&val),
-                            (std::streamsize)sizeof(float));
-//                        mShadowFile << val << "\n";
-                    }
-                }
-                else
-                {
-                    for (p[2] = outRect.p1[2]; p[2] <= outRect.p2[2];
-                        p[2] += outStride[2])
-                    for (p[1] = outRect.p1[1]; p[1] <= outRect.p2[1];
-                        p[1] += outStride[1])
-                    for (p[0] = outRect.p1[0]; p[0] <= outRect.p2[0];
-                        p[0] += outStride[0])
-                    {
-                        float val = lattice.getInterpolatedE(
-                            outDir, Vector3f(p)+interpPoint);
-                        mDatafile.write((char*)(&val),
-                            (std::streamsize)sizeof(float));
-//                        mShadowFile << val << "\n";
-                    }
-                }
-            }
+            if (!description()->isInterpolated())
+                lattice.gatherE(outDir, outRect, outStride, sample);
+            else
+                lattice.gatherInterpolatedE(outDir, outRect, outStride,
+                    interpPoint, sample);
         }
     }
-    mDatafile << flush;
+    mWriter->endSample();
 }
 
 void SimpleEHOutput::
 writeH(const CalculationPartition & cp)
 {
-    const InterleavedLattice& lattice(cp.lattice());
+    const InterleavedLattice & lattice(cp.lattice());
+    vector<float> & sample(mWriter->beginSample());
     
     Vector3f interpPoint = description()->interpolationPoint();
     
     for (int outDir = 0; outDir < 3; outDir++)
+    if (description()->whichH()[outDir] != 0)
     {
         for (unsigned int rr = 0; rr < mRegions.size(); rr++)
         {
             Rect3i outRect = mRegions[rr].yeeCells();
             Vector3i outStride = mRegions[rr].stride();
-            Vector3i p;
             
-            if (description()->whichH()[outDir] != 0)
-            {
-                if (!description()->isInterpolated())
-                {
-                    for (p[2] = outRect.p1[2]; p[2] <= outRect.p2[2];
-                        p[2] += outStride[2])
-                    for (p[1] = outRect.p1[1]; p[1] <= outRect.p2[1];
-                        p[1] += outStride[1])
-                    for (p[0] = outRect.p1[0]; p[0] <= outRect.p2[0];
-                        p[0] += outStride[0])
-                    {
-                        float val = lattice.getH(outDir, p);
-                        mDatafile.write((char*)(&val),
-                            (std::streamsize)sizeof(float));
-                    }
-                }
-                else
-                {
-                    for (p[2] = outRect.p1[2]; p[2] <= outRect.p2[2];
-                        p[2] += outStride[2])
-                    for (p[1] = outRect.p1[1]; p[1] <= outRect.p2[1];
-                        p[1] += outStride[1])
-                    for (p[0] = outRect.p1[0]; p[0] <= outRect.p2[0];
-                        p[0] += outStride[0])
-                    {
-                        float val = lattice.getInterpolatedH(
-                            outDir, Vector3f(p)+interpPoint);
-                        mDatafile.write((char*)(&val),
-                            (std::streamsize)sizeof(float));
-                    }
-                }
-            }
+            if (!description()->isInterpolated())
+                lattice.gatherH(outDir, outRect, outStride, sample);
+            else
+                lattice.gatherInterpolatedH(outDir, outRect, outStride,
+                    interpPoint, sample);
         }
     }
-    mDatafile << flush;
+    mWriter->endSample();
 }
 
@@ -52,7 +52,7 @@ private:
         std::string specfile, std::string datafile, std::string materialfile)
         const;
     */
-    std::ofstream mDatafile;
+    AsyncFileWriterPtr mWriter;
 //    std::ofstream mShadowFile;
     long mCurrentSampleInterval;
     
@@ -198,6 +198,22 @@ numDimensions() const
 	return nDim;
 }
 
+#pragma mark *** Region ***
+
+Region Region::
+within(const Rect3i & yeeCells) const
+{
+    Rect3i rect(intersection(mYeeCells, yeeCells));
+    
+    // Start on the stride of the whole region.
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        int offset = rect.p1[xyz] - mYeeCells.p1[xyz];
+        rect.p1[xyz] += (mStride[xyz] - offset%mStride[xyz])%mStride[xyz];
+    }
+    return Region(rect, mStride);
+}
+
 #pragma mark *** Output ***
 
 OutputDescription::
@@ -206,7 +222,10 @@ OutputDescription(std::string fields, std::string file) throw(Exception) :
     mIsInterpolated(0),
     mInterpolationPoint(0.0,0.0,0.0), // specified but not used
     mRegions(vector<Region>(1,Region())),
-    mDurations(vector<Duration>(1,Duration()))
+    mDurations(vector<Duration>(1,Duration())),
+    mErrorBound(0.0),
+    mIsErrorBoundRelative(0),
+    mReduction(kNoReduction)
 {
     determineWhichFields(fields);
 }
@@ -218,7 +237,10 @@ OutputDescription(std::string fields, std::string file,
     mIsInterpolated(0),
     mInterpolationPoint(0.0,0.0,0.0), // specified but not used
     mRegions(vector<Region>(1,region)),
-    mDurations(vector<Duration>(1,duration))
+    mDurations(vector<Duration>(1,duration)),
+    mErrorBound(0.0),
+    mIsErrorBoundRelative(0),
+    mReduction(kNoReduction)
 {
     determineWhichFields(fields);
     if (!vec_ge(region.yeeCells().p1, 0))
@@ -233,7 +255,10 @@ OutputDescription(std::string fields, std::string file,
     mIsInterpolated(0),
     mInterpolationPoint(0.0,0.0,0.0), // specified but not used
     mRegions(regions),
-    mDurations(durations)
+    mDurations(durations),
+    mErrorBound(0.0),
+    mIsErrorBoundRelative(0),
+    mReduction(kNoReduction)
 {
     determineWhichFields(fields);
     
@@ -256,7 +281,10 @@ OutputDescription(std::string fields, std::string file,
     mIsInterpolated(1),
     mInterpolationPoint(interpolationPoint),
     mRegions(regions),
-    mDurations(durations)
+    mDurations(durations),
+    mErrorBound(0.0),
+    mIsErrorBoundRelative(0),
+    mReduction(kNoReduction)
 {
     determineWhichFields(fields);
 }
@@ -266,6 +294,14 @@ OutputDescription::
 {
 }
 
+void OutputDescription::
+setErrorBound(double errorBound, bool isRelative)
+{
+    assert(errorBound >= 0);
+    mErrorBound = errorBound;
+    mIsErrorBoundRelative = isRelative;
+}
+
 void OutputDescription::
 determineWhichFields(std::string fields) throw(Exception)
 {
@@ -728,6 +764,21 @@ newCustomTFSFSource(string file, Vector3i symmetries, Rect3i halfCells,
     return hs2;
 }
 
+HuygensSurfaceDescription* HuygensSurfaceDescription::
+newCustomTFSFFormulaSource(const vector<string> & formulas,
+    Vector3i symmetries, Rect3i halfCells, Duration duration,
+    set<Vector3i> omittedSides, bool isTF)
+{
+    if (formulas.size() != 6)
+        throw(Exception("Custom TFSF source needs six formulas"));
+    
+    HuygensSurfaceDescription* hs2 = newCustomTFSFSource("", symmetries,
+        halfCells, duration, omittedSides, isTF);
+    hs2->mFormulas = formulas;
+    
+    return hs2;
+}
+
 HuygensSurfaceDescription* HuygensSurfaceDescription::
 newLink(string sourceGrid, Rect3i fromHalfCells, Rect3i toHalfCells,
     set<Vector3i> omittedSides, bool isTF)
@@ -187,12 +187,27 @@ public:
     void setStride(const Vector3i & stride) { mStride = stride; }
     const Rect3i & yeeCells() const { return mYeeCells; }
     const Vector3i & stride() const { return mStride; }
+    
+    // The part of this region within yeeCells, sampling the same cells as the
+    // whole region does.  It may be empty; see isEmpty().
+    Region within(const Rect3i & yeeCells) const;
+    bool isEmpty() const { return !vec_ge(mYeeCells.num(), 1); }
 private:
     Rect3i mYeeCells;
     Vector3i mStride;
 };
 //std::ostream & operator<<(std::ostream & str, const Region & reg);
 
+/**
+ * Outputs may write a single number per timestep in place of the fields.
+ */
+enum OutputReduction
+{
+    kNoReduction,
+    kFluxReduction,
+    kEnergyReduction
+};
+
 class OutputDescription
 {
 public:
@@ -208,6 +223,7 @@ public:
         const std::vector<Duration> & durations) throw(Exception);
     ~OutputDescription();
     
+    void setFile(const std::string & file) { mFile = file; }
     const std::string & file() const { return mFile; }
     Vector3i whichE() const { return mWhichE; }
     Vector3i whichH() const { return mWhichH; }
@@ -220,6 +236,30 @@ public:
     const std::vector<Region> & regions() const { return mRegions; }
     const std::vector<Duration> & durations() const { return mDurations; }
     
+    /**
+     * Allow each output value to be off by up to errorBound, or by that
+     * fraction of each sample's range of values if isRelative, in exchange
+     * for much smaller data files.  Zero, the default, writes exact values.
+     */
+    void setErrorBound(double errorBound, bool isRelative);
+    double errorBound() const { return mErrorBound; }
+    bool isErrorBoundRelative() const { return mIsErrorBoundRelative; }
+    
+    /**
+     * Accumulate the DFT of the fields at these frequencies, in cycles per
+     * unit of dt, and write only that, instead of writing time samples.
+     */
+    void setFrequencies(const std::vector<double> & frequencies)
+        { mFrequencies = frequencies; }
+    const std::vector<double> & frequencies() const { return mFrequencies; }
+    
+    /**
+     * Write the Poynting flux out of the regions or the electromagnetic
+     * energy inside them, instead of the fields.
+     */
+    void setReduction(OutputReduction reduction) { mReduction = reduction; }
+    OutputReduction reduction() const { return mReduction; }
+    
 private:
     void determineWhichFields(std::string fields) throw(Exception);
     std::string mFile;
@@ -233,6 +273,10 @@ private:
     Vector3f mInterpolationPoint;
     std::vector<Region> mRegions;
     std::vector<Duration> mDurations;
+    double mErrorBound;
+    bool mIsErrorBoundRelative;
+    std::vector<double> mFrequencies;
+    OutputReduction mReduction;
 };
 
 class MaterialOutputDescription
@@ -419,6 +463,16 @@ public:
         Vector3i symmetries, Rect3i halfCells, Duration duration,
         std::set<Vector3i> omittedSides, bool isTF = 1);
     
+    /**
+     * Custom TFSF source whose incident fields are given by formulas in n, t,
+     * x, y and z, one per component in the order Ex, Ey, Ez, Hx, Hy, Hz.
+     * Empty formulas mean zero.
+     */
+    static HuygensSurfaceDescription*
+    newCustomTFSFFormulaSource(const std::vector<std::string> & formulas,
+        Vector3i symmetries, Rect3i halfCells, Duration duration,
+        std::set<Vector3i> omittedSides, bool isTF = 1);
+    
     static HuygensSurfaceDescription*
     newLink(std::string sourceGrid,
         Rect3i fromHalfCells, Rect3i toHalfCells,
@@ -459,6 +513,8 @@ public:
     // Custom source accessors
     std::string file() const
         { assert(mType == kCustomTFSFSource); return mFile; }
+    const std::vector<std::string> & formulas() const
+        { assert(mType == kCustomTFSFSource); return mFormulas; }
     
     // Link accessors
     std::string sourceGridName() const
@@ -486,6 +542,7 @@ private:
     
     // Custom source data
     std::string mFile;
+    std::vector<std::string> mFormulas;
     
     // Link data
     std::string mSourceGridName;
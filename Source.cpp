@@ -47,13 +47,31 @@ Source(const SourceDescPtr sourceDescription,
 {
     for (int rr = 0; rr < mRegions.size(); rr++)
     {
-        Rect3i rect(clip(vp.gridYeeCells(), mRegions[rr].yeeCells()));
-        mRegions[rr].setYeeCells(rect);
+        mRegions[rr] = mRegions[rr].within(vp.calcYeeCells());
     }
     
     for (int dd = 0; dd < mDurations.size(); dd++)
     if (mDurations[dd].last() > (cp.duration()-1))
         mDurations[dd].setLast(cp.duration()-1);
+    
+    mFieldInput.precomputeWaveform(cp.duration(), cp.dt());
+    
+    // Cells in the order doSourceE() and doSourceH() visit them, for formulas
+    // that depend on position.
+    std::vector<std::vector<Rect3i> > yeeCellsE(3), yeeCellsH(3);
+    for (int xyz = 0; xyz < 3; xyz++)
+    for (int rr = 0; rr < mRegions.size(); rr++)
+    {
+        Rect3i rect = mRegions[rr].yeeCells();
+        if (rect.num(0) <= 0 || rect.num(1) <= 0 || rect.num(2) <= 0)
+            continue;
+        if (mFields.whichE()[xyz] != 0)
+            yeeCellsE[xyz].push_back(rect);
+        if (mFields.whichH()[xyz] != 0)
+            yeeCellsH[xyz].push_back(rect);
+    }
+    mFieldInput.setCells(yeeCellsE, yeeCellsH,
+        vp.gridDescription()->originYee(), vp.gridDescription()->dxyz());
 }
 
 Source::
@@ -108,7 +126,6 @@ sourceHPhase(CalculationPartition & cp, long timestep)
 void Source::
 doSourceE(CalculationPartition & cp, long timestep)
 {
-    float val;
     InterleavedLattice& lattice(cp.lattice());
     
     mFieldInput.startHalfTimestepE(timestep, cp.dt()*timestep);
@@ -121,29 +138,18 @@ doSourceE(CalculationPartition & cp, long timestep)
         for (unsigned int rr = 0; rr < mRegions.size(); rr++)
         {
             Rect3i rect = mRegions[rr].yeeCells();
-            {
-                Vector3i xx;
-                if (!mIsSoft)
-                {
-                    for (xx[2] = rect.p1[2]; xx[2] <= rect.p2[2]; xx[2]++)
-                    for (xx[1] = rect.p1[1]; xx[1] <= rect.p2[1]; xx[1]++)
-                    for (xx[0] = rect.p1[0]; xx[0] <= rect.p2[0]; xx[0]++)
-                    {
-                        val = mFieldInput.getFieldE(xyz);
-                        lattice.setE(xyz, xx, val);
-                    }
-                }
-                else
-                {
-                    for (xx[2] = rect.p1[2]; xx[2] <= rect.p2[2]; xx[2]++)
-                    for (xx[1] = rect.p1[1]; xx[1] <= rect.p2[1]; xx[1]++)
-                    for (xx[0] = rect.p1[0]; xx[0] <= rect.p2[0]; xx[0]++)
-                    {
-                        val = mFieldInput.getFieldE(xyz);
-                        lattice.setE(xyz, xx, lattice.getE(xyz, xx) + val);
-                    }
-                }
-            }
+            if (rect.num(0) <= 0 || rect.num(1) <= 0 || rect.num(2) <= 0)
+                continue;
+            
+            // Read the whole region, then write it in one pass.
+            mValues.resize(rect.count());
+            for (long nn = 0; nn < mValues.size(); nn++)
+                mValues[nn] = mFieldInput.getFieldE(xyz);
+            
+            if (!mIsSoft)
+                lattice.scatterE(xyz, rect, &mValues[0]);
+            else
+                lattice.addE(xyz, rect, &mValues[0]);
         }
     }
 }
@@ -151,7 +157,6 @@ doSourceE(CalculationPartition & cp, long timestep)
 void Source::
 doSourceH(CalculationPartition & cp, long timestep)
 {
-    float val;
     InterleavedLattice& lattice(cp.lattice());
     
     mFieldInput.startHalfTimestepH(timestep, cp.dt()*(timestep+0.5));
@@ -164,29 +169,18 @@ doSourceH(CalculationPartition & cp, long timestep)
         for (unsigned int rr = 0; rr < mRegions.size(); rr++)
         {
             Rect3i rect = mRegions[rr].yeeCells();
-            {
-                Vector3i xx;
-                if (!mIsSoft)
-                {
-                    for (xx[2] = rect.p1[2]; xx[2] <= rect.p2[2]; xx[2]++)
-                    for (xx[1] = rect.p1[1]; xx[1] <= rect.p2[1]; xx[1]++)
-                    for (xx[0] = rect.p1[0]; xx[0] <= rect.p2[0]; xx[0]++)
-                    {
-                        val = mFieldInput.getFieldH(xyz);
-                        lattice.setH(xyz, xx, val);
-                    }
-                }
-                else
-                {
-                    for (xx[2] = rect.p1[2]; xx[2] <= rect.p2[2]; xx[2]++)
-                    for (xx[1] = rect.p1[1]; xx[1] <= rect.p2[1]; xx[1]++)
-                    for (xx[0] = rect.p1[0]; xx[0] <= rect.p2[0]; xx[0]++)
-                    {
-                        val = mFieldInput.getFieldH(xyz);
-                        lattice.setH(xyz, xx, lattice.getH(xyz, xx) + val);
-                    }
-                }
-            }
+            if (rect.num(0) <= 0 || rect.num(1) <= 0 || rect.num(2) <= 0)
+                continue;
+            
+            // Read the whole region, then write it in one pass.
+            mValues.resize(rect.count());
+            for (long nn = 0; nn < mValues.size(); nn++)
+                mValues[nn] = mFieldInput.getFieldH(xyz);
+            
+            if (!mIsSoft)
+                lattice.scatterH(xyz, rect, &mValues[0]);
+            else
+                lattice.addH(xyz, rect, &mValues[0]);
         }
     }
 }
@@ -44,6 +44,9 @@ public:
     
     void sourceEPhase(CalculationPartition & cp, long timestep);
     void sourceHPhase(CalculationPartition & cp, long timestep);
+    
+    // the timesteps when the source is on, clipped to the simulation
+    const std::vector<Duration> & durations() const { return mDurations; }
 private:
     void doSourceE(CalculationPartition & cp, long timestep);
     void doSourceH(CalculationPartition & cp, long timestep);
@@ -56,6 +59,8 @@ private:
     SourceFields mFields;
     std::vector<Region> mRegions;
     std::vector<Duration> mDurations;
+    
+    std::vector<float> mValues; // one region's worth of source fields
 };
 typedef Pointer<Source> SourcePtr;
 
@@ -0,0 +1,147 @@
+/*
+ *  SpaceTimeFormula.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "SpaceTimeFormula.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+void SpaceTimeFormula::
+compile(const string & formula, CompiledFormula & compiledFormula)
+    throw(Exception)
+{
+    vector<string> inputNames(kNumInputs);
+    inputNames[kTimestep] = "n";
+    inputNames[kTime] = "t";
+    inputNames[kX] = "x";
+    inputNames[kY] = "y";
+    inputNames[kZ] = "z";
+
+    try {
+        compiledFormula.compile(formula, inputNames);
+    } catch (Exception & e) {
+        throw(Exception(string("Cannot parse source formula: ") + e.what()));
+    }
+}
+
+bool SpaceTimeFormula::
+dependsOnPosition(const CompiledFormula & compiledFormula)
+{
+    return compiledFormula.dependsOn(kX) || compiledFormula.dependsOn(kY) ||
+        compiledFormula.dependsOn(kZ);
+}
+
+SpaceTimeFormula::
+SpaceTimeFormula(const CompiledFormula & compiledFormula,
+    const Vector3i & originYee, const Vector3f & dxyz) :
+    mFormula(compiledFormula),
+    mDependsOnPosition(dependsOnPosition(compiledFormula)),
+    mOriginYee(originYee),
+    mDxyz(dxyz),
+    mNumCells(0),
+    mHasProfiles(0)
+{
+    assert(mFormula.numInputs() == kNumInputs);
+
+    vector<bool> isStatic(kNumInputs, 0);
+    isStatic[kX] = isStatic[kY] = isStatic[kZ] = 1;
+    mFormula.split(isStatic, mStaticPart, mDynamicPart);
+}
+
+void SpaceTimeFormula::
+addCells(const Rect3i & yeeCells, const Vector3f & fieldPosition)
+{
+    assert(!mHasProfiles);
+    if (yeeCells.num(0) <= 0 || yeeCells.num(1) <= 0 || yeeCells.num(2) <= 0)
+        return;
+    mYeeCells.push_back(yeeCells);
+    mFieldPositions.push_back(fieldPosition);
+    mNumCells += yeeCells.count();
+}
+
+void SpaceTimeFormula::
+cacheProfiles()
+{
+    vector<double> position[3];
+    for (int xyz = 0; xyz < 3; xyz++)
+        position[xyz].reserve(mNumCells);
+
+    Vector3i yee;
+    for (int rr = 0; rr < mYeeCells.size(); rr++)
+    {
+        const Rect3i & r(mYeeCells[rr]);
+        for (yee[2] = r.p1[2]; yee[2] <= r.p2[2]; yee[2]++)
+        for (yee[1] = r.p1[1]; yee[1] <= r.p2[1]; yee[1]++)
+        for (yee[0] = r.p1[0]; yee[0] <= r.p2[0]; yee[0]++)
+        for (int xyz = 0; xyz < 3; xyz++)
+            position[xyz].push_back(mDxyz[xyz]*(double(yee[xyz] -
+                mOriginYee[xyz]) + mFieldPositions[rr][xyz]));
+    }
+
+    mProfiles.resize(mStaticPart.numOutputs());
+    vector<double*> outputs(mProfiles.size());
+    for (int nn = 0; nn < mProfiles.size(); nn++)
+    {
+        mProfiles[nn].resize(mNumCells);
+        outputs[nn] = &mProfiles[nn][0];
+    }
+
+    // The static part works out the time-dependent parts too, at n = t = 0,
+    // but the values are thrown away.
+    if (mNumCells > 0 && mProfiles.size() > 0)
+    {
+        const double zero = 0.0;
+        const double* inputs[kNumInputs] = { &zero, &zero, &position[0][0],
+            &position[1][0], &position[2][0] };
+        const int strides[kNumInputs] = { 0, 0, 1, 1, 1 };
+        mStaticPart.evaluate(mNumCells, inputs, strides, 0L, &outputs[0]);
+    }
+
+    mHasProfiles = 1;
+    LOGF << "Cached " << mProfiles.size() << " spatial profiles of "
+        << mNumCells << " cells for " << mFormula.text() << ".\n";
+}
+
+void SpaceTimeFormula::
+evaluate(long timestep, float time, float* values)
+{
+    if (!mDependsOnPosition)
+    {
+        double inputs[kNumInputs] = { double(timestep), time, 0.0, 0.0, 0.0 };
+        fill(values, values + mNumCells, float(mFormula.evaluate(inputs)));
+        return;
+    }
+    if (!mHasProfiles)
+        cacheProfiles();
+
+    // The dynamic part takes n and t, the positions (which it doesn't use),
+    // and then the spatial profiles.
+    const int numInputs = mDynamicPart.numInputs();
+    const double n = timestep, t = time, zero = 0.0;
+    vector<const double*> inputs(numInputs, &zero);
+    vector<int> strides(numInputs, 0);
+    inputs[kTimestep] = &n;
+    inputs[kTime] = &t;
+    for (int nn = kNumInputs; nn < numInputs; nn++)
+        strides[nn] = 1;
+
+    mValues.resize(min(mNumCells, long(BATCHSIZE)));
+    for (long first = 0; first < mNumCells; first += BATCHSIZE)
+    {
+        long count = min(mNumCells - first, long(BATCHSIZE));
+        for (int nn = kNumInputs; nn < numInputs; nn++)
+            inputs[nn] = &mProfiles[nn - kNumInputs][first];
+        mDynamicPart.evaluate(count, &inputs[0], &strides[0], &mValues[0]);
+        copy(mValues.begin(), mValues.begin() + count, values + first);
+    }
+}
+
+
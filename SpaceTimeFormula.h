@@ -0,0 +1,112 @@
+/*
+ *  SpaceTimeFormula.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _SPACETIMEFORMULA_
+#define _SPACETIMEFORMULA_
+
+#include "CompiledFormula.h"
+#include "Pointer.h"
+#include "geometry.h"
+
+#include <string>
+#include <vector>
+
+/**
+ *  Source formula evaluated over a list of cells, for formulas that depend on
+ *  the position x, y, z of each field component as well as on n and t.  The
+ *  positions are in meters, as in the data requests written by
+ *  IODescriptionFile.
+ *
+ *  The formula is split (see CompiledFormula::split()) into the parts that
+ *  depend only on position, which are worked out for every cell on the first
+ *  call to evaluate() and kept, and the parts that depend on time, which are
+ *  worked out in batches of cells on every call.  A Gaussian beam profile
+ *  times a pulse costs one multiply per cell per timestep.
+ */
+class SpaceTimeFormula
+{
+public:
+    /**
+     *  Indices of the inputs of a source formula.
+     */
+    enum FormulaInput
+    {
+        kTimestep,
+        kTime,
+        kX,
+        kY,
+        kZ,
+        kNumInputs
+    };
+
+    /**
+     *  Compile a source formula with the inputs n, t, x, y and z.  Throws an
+     *  Exception if the formula can't be parsed.
+     */
+    static void compile(const std::string & formula,
+        CompiledFormula & compiledFormula) throw(Exception);
+
+    /**
+     *  @returns true if a formula from compile() uses x, y or z
+     */
+    static bool dependsOnPosition(const CompiledFormula & compiledFormula);
+
+    /**
+     *  @param compiledFormula  formula from compile()
+     *  @param originYee        Yee cell at position (0, 0, 0)
+     *  @param dxyz             cell size in meters
+     */
+    SpaceTimeFormula(const CompiledFormula & compiledFormula,
+        const Vector3i & originYee, const Vector3f & dxyz);
+
+    /**
+     *  Add cells to evaluate the formula at.  Values come out in the order
+     *  the cells were added, x fastest within each rect.
+     *
+     *  @param yeeCells         Yee cells, in the grid's coordinates
+     *  @param fieldPosition    position of the field component within its
+     *                          Yee cell, e.g. eFieldPosition(0) for Ex
+     */
+    void addCells(const Rect3i & yeeCells, const Vector3f & fieldPosition);
+
+    long numCells() const { return mNumCells; }
+
+    /**
+     *  Write the value of the formula at each cell.
+     *
+     *  @param timestep     value of n
+     *  @param time         value of t
+     *  @param values       room for numCells() values
+     */
+    void evaluate(long timestep, float time, float* values);
+
+private:
+    void cacheProfiles();
+
+    CompiledFormula mFormula;
+    CompiledFormula mStaticPart;
+    CompiledFormula mDynamicPart;
+    bool mDependsOnPosition;
+
+    Vector3i mOriginYee;
+    Vector3f mDxyz;
+    std::vector<Rect3i> mYeeCells;
+    std::vector<Vector3f> mFieldPositions;
+    long mNumCells;
+
+    bool mHasProfiles;
+    std::vector<std::vector<double> > mProfiles; // one per static output
+    std::vector<double> mValues; // one batch of cells
+
+    static const long BATCHSIZE = 4096;
+};
+typedef Pointer<SpaceTimeFormula> SpaceTimeFormulaPtr;
+
+
+
+#endif
@@ -8,12 +8,17 @@
  */
 
 #include "StreamedFieldInput.h"
+#include "YeeUtilities.h"
 #include "Log.h"
 
 using namespace std;
+using namespace YeeUtilities;
 
 StreamedFieldInput::
 StreamedFieldInput(SourceDescPtr sourceDescription) :
+    mRecord(0L),
+    mRecordIndex(0),
+    mDt(0.0f),
     mHasMask(0),
     mUsesPolarization(0),
     mPolarizationFactor(1,1,1),
@@ -27,20 +32,11 @@ StreamedFieldInput(SourceDescPtr sourceDescription) :
         mFormula = sourceDescription->formula();
         LOGF << "Formula is " << mFormula << endl;
         
-        mCalculator.set("n", 0);
-        mCalculator.set("t", 0);
-        
-        bool err = mCalculator.parse(mFormula);
-        if (err)
+        SpaceTimeFormula::compile(mFormula, mCompiledFormula);
+        if (SpaceTimeFormula::dependsOnPosition(mCompiledFormula))
         {
-            LOG << "Error found.";
-            cerr << "Calculator cannot parse\n"
-                << mFormula << "\n"
-                << "Error message:\n";
-            mCalculator.report_error(cerr);
-            cerr << "Quitting.\n";
-            assert(!"Assert death.");
-            exit(1);
+            mFieldValueType = kSpaceTimeVaryingField;
+            mFieldFormulas.assign(6, mCompiledFormula);
         }
     }
     else if (sourceDescription->timeFile() != "")
@@ -48,8 +44,7 @@ StreamedFieldInput(SourceDescPtr sourceDescription) :
         mType = FILETYPE;
         mFieldValueType = kTimeVaryingField;
         string fname = sourceDescription->timeFile();
-        mFile.open(fname.c_str(), ios::binary);
-        if (mFile.good())
+        if (mFile.open(fname))
             LOGF << "Opened binary file " << fname << ".\n";
         else
             throw(Exception(string("Could not open binary file ") + fname));
@@ -62,8 +57,8 @@ StreamedFieldInput(SourceDescPtr sourceDescription) :
         mType = FILETYPE;
         mFieldValueType = kSpaceTimeVaryingField;
         string fname = sourceDescription->spaceTimeFile();
-        mFile.open(fname.c_str(), ios::binary);
-        if (mFile.good())
+        mFileName = fname;
+        if (mFile.open(fname))
             LOGF << "Opened binary file " << fname << ".\n";
         else
             throw(Exception(string("Could not open binary file ") + fname));
@@ -84,6 +79,9 @@ StreamedFieldInput(SourceDescPtr sourceDescription) :
 
 StreamedFieldInput::
 StreamedFieldInput(HuygensSurfaceDescPtr huygensSurfaceDescription) :
+    mRecord(0L),
+    mRecordIndex(0),
+    mDt(0.0f),
     mFieldValueType(kSpaceTimeVaryingField),
     mHasMask(0),
     mUsesPolarization(0),
@@ -92,9 +90,25 @@ StreamedFieldInput(HuygensSurfaceDescPtr huygensSurfaceDescription) :
     mWhichE(1,1,1),
     mWhichH(1,1,1)
 {
+    const vector<string> & formulas(huygensSurfaceDescription->formulas());
+    if (formulas.size() > 0)
+    {
+        assert(formulas.size() == 6);
+        mType = FORMULATYPE;
+        mFieldFormulas.resize(6);
+        for (int nn = 0; nn < 6; nn++)
+        {
+            if (formulas[nn] != "")
+                LOGF << "Formula is " << formulas[nn] << endl;
+            SpaceTimeFormula::compile(formulas[nn] == "" ? "0" : formulas[nn],
+                mFieldFormulas[nn]);
+        }
+        return;
+    }
+    
     string fname = huygensSurfaceDescription->file();
-    mFile.open(fname.c_str(), ios::binary);
-    if (mFile.good())
+    mFileName = fname;
+    if (mFile.open(fname))
         LOGF << "Opened binary file " << fname << ".\n";
     else
         LOGF << "Could not open binary file " << fname << ".\n";
@@ -106,48 +120,174 @@ StreamedFieldInput(HuygensSurfaceDescPtr huygensSurfaceDescription) :
 StreamedFieldInput::
 ~StreamedFieldInput()
 {
+    if (mRecord != 0L && mPrefetcher != 0L)
+        mPrefetcher->endRecord();
+}
+
+void StreamedFieldInput::
+prefetch(const vector<long> & recordLengths)
+{
+    if (mType != FILETYPE || !mFile.isOpen())
+        return;
+    assert(mFieldValueType == kSpaceTimeVaryingField);
+    
+    int numBuffers = FilePrefetcher::numBuffers(recordLengths);
+    if (numBuffers > 0)
+    {
+        mPrefetcher = FilePrefetcherPtr(new FilePrefetcher(mFileName,
+            recordLengths, numBuffers));
+        mFile.close();
+        LOGF << "Prefetching " << numBuffers << " records of " << mFileName
+            << ".\n";
+    }
+}
+
+double StreamedFieldInput::
+stallMicroseconds() const
+{
+    if (mPrefetcher != 0L)
+        return mPrefetcher->stallMicroseconds();
+    return 0.0;
+}
+
+void StreamedFieldInput::
+nextRecord()
+{
+    if (mRecord != 0L)
+        mPrefetcher->endRecord();
+    mRecord = mPrefetcher->beginRecord();
+    mRecordIndex = 0;
+    if (mRecord == 0L)
+        throw(Exception("Cannot read further from file."));
+}
+
+void StreamedFieldInput::
+precomputeWaveform(long numTimesteps, float dt)
+{
+    mDt = dt;
+    if (mType != FORMULATYPE || mFieldValueType != kTimeVaryingField)
+        return;
+    
+    // The times are worked out as the callers of startHalfTimestepE() and
+    // startHalfTimestepH() work them out, so the lookups match exactly.
+    mWaveformE.resize(numTimesteps);
+    mWaveformH.resize(numTimesteps);
+    double inputs[SpaceTimeFormula::kNumInputs] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    for (long nn = 0; nn < numTimesteps; nn++)
+    {
+        inputs[SpaceTimeFormula::kTimestep] = nn;
+        inputs[SpaceTimeFormula::kTime] = float(nn*dt);
+        mWaveformE[nn] = mCompiledFormula.evaluate(inputs);
+        inputs[SpaceTimeFormula::kTime] = float((nn+0.5)*dt);
+        mWaveformH[nn] = mCompiledFormula.evaluate(inputs);
+    }
+    LOGF << "Tabulated formula for " << numTimesteps << " timesteps.\n";
+}
+
+float StreamedFieldInput::
+formulaValue(long timestep, float time, const vector<float> & waveform,
+    float tableTime) const
+{
+    if (timestep >= 0 && timestep < waveform.size() && time == tableTime)
+        return waveform[timestep];
+    
+    double inputs[SpaceTimeFormula::kNumInputs] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    inputs[SpaceTimeFormula::kTimestep] = timestep;
+    inputs[SpaceTimeFormula::kTime] = time;
+    return mCompiledFormula.evaluate(inputs);
+}
+
+void StreamedFieldInput::
+setCells(const vector<vector<Rect3i> > & yeeCellsE,
+    const vector<vector<Rect3i> > & yeeCellsH, const Vector3i & originYee,
+    const Vector3f & dxyz)
+{
+    if (mType != FORMULATYPE || mFieldValueType != kSpaceTimeVaryingField)
+        return;
+    assert(yeeCellsE.size() == 3 && yeeCellsH.size() == 3);
+    
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        if (yeeCellsE[xyz].size() > 0)
+        {
+            mSpaceTimeE[xyz] = SpaceTimeFormulaPtr(new SpaceTimeFormula(
+                mFieldFormulas[xyz], originYee, dxyz));
+            for (int nn = 0; nn < yeeCellsE[xyz].size(); nn++)
+                mSpaceTimeE[xyz]->addCells(yeeCellsE[xyz][nn],
+                    eFieldPosition(xyz));
+        }
+        if (yeeCellsH[xyz].size() > 0)
+        {
+            mSpaceTimeH[xyz] = SpaceTimeFormulaPtr(new SpaceTimeFormula(
+                mFieldFormulas[3+xyz], originYee, dxyz));
+            for (int nn = 0; nn < yeeCellsH[xyz].size(); nn++)
+                mSpaceTimeH[xyz]->addCells(yeeCellsH[xyz][nn],
+                    hFieldPosition(xyz));
+        }
+    }
+}
+
+void StreamedFieldInput::
+evaluateFormulas(SpaceTimeFormulaPtr* formulas, long timestep,
+    float time)
+{
+    long numCells = 0;
+    for (int xyz = 0; xyz < 3; xyz++)
+    if (formulas[xyz] != 0L)
+        numCells += formulas[xyz]->numCells();
+    mFormulaRecord.resize(numCells);
+    
+    long offset = 0;
+    for (int xyz = 0; xyz < 3; xyz++)
+    if (formulas[xyz] != 0L && formulas[xyz]->numCells() > 0)
+    {
+        float* values = &mFormulaRecord[offset];
+        formulas[xyz]->evaluate(timestep, time, values);
+        if (mUsesPolarization)
+        for (long nn = 0; nn < formulas[xyz]->numCells(); nn++)
+            values[nn] *= mPolarizationFactor[xyz];
+        offset += formulas[xyz]->numCells();
+    }
+    mRecord = &mFormulaRecord;
+    mRecordIndex = 0;
 }
 
 void StreamedFieldInput::
 startHalfTimestepE(long timestep, float time)
 {
-    if (mType == FORMULATYPE)
+    if (mType == FORMULATYPE && mFieldValueType == kSpaceTimeVaryingField)
+        evaluateFormulas(mSpaceTimeE, timestep, time);
+    else if (mType == FORMULATYPE)
     {
-        mCalculator.set("n", timestep);
-        mCalculator.set("t", time);
-        mCalculator.parse(mFormula);
-        
-        float val = mCalculator.get_value();
+        float val = formulaValue(timestep, time, mWaveformE,
+            float(timestep*mDt));
         mCurrentValueVec = mPolarizationFactor * val;
     }
     else //if (mType == FILETYPE)
     {
-        //  Space-varying sources read from the file on calls to getField().
-        //  Otherwise we can read the value here and cache it.
-        if (mFieldValueType == kTimeVaryingField)
+        //  Space-varying sources read from the file on calls to getField(),
+        //  from a prefetched record if there is one.  Otherwise we can read the
+        //  value here and cache it.
+        if (mFieldValueType == kSpaceTimeVaryingField && mPrefetcher != 0L)
+            nextRecord();
+        else if (mFieldValueType == kTimeVaryingField)
         {
             //LOG << "TODO: Read 1 value if using polarization; read N values "
             //    "if not using polarization and using N fields.\n";
             
             if (mUsesPolarization)
             {
-                float val;
-                if (mFile.good())
-                    mFile.read((char*)&val,
-                        (std::streamsize)sizeof(float));
-                else
+                const float* val = mFile.view(1);
+                if (val == 0L)
                     throw(Exception("Cannot read further from file."));
-                mCurrentValueVec = mPolarizationFactor * val;
+                mCurrentValueVec = mPolarizationFactor * (*val);
             }
             else
             {
                 for (int direction = 0; direction < 3; direction++)
                 if (mWhichE[direction])
                 {
-                    if (mFile.good())
-                        mFile.read((char*)&mCurrentValueVec[direction],
-                            (std::streamsize)sizeof(float));
-                    else
+                    if (!mFile.read(&mCurrentValueVec[direction], 1))
                         throw(Exception("Cannot read further from file."));
                 }
                 
@@ -159,43 +299,39 @@ startHalfTimestepE(long timestep, float time)
 void StreamedFieldInput::
 startHalfTimestepH(long timestep, float time)
 {
-    if (mType == FORMULATYPE)
+    if (mType == FORMULATYPE && mFieldValueType == kSpaceTimeVaryingField)
+        evaluateFormulas(mSpaceTimeH, timestep, time);
+    else if (mType == FORMULATYPE)
     {
-        mCalculator.set("n", timestep);
-        mCalculator.set("t", time);
-        mCalculator.parse(mFormula);
-        
-        float val = mCalculator.get_value();
+        float val = formulaValue(timestep, time, mWaveformH,
+            float((timestep+0.5)*mDt));
         mCurrentValueVec = mPolarizationFactor * val;
     }
     else //if (mType == FILETYPE)
     {
-        //  Space-varying sources read from the file on calls to getField().
-        //  Otherwise we can read the value here and cache it.
-        if (mFieldValueType == kTimeVaryingField)
+        //  Space-varying sources read from the file on calls to getField(),
+        //  from a prefetched record if there is one.  Otherwise we can read the
+        //  value here and cache it.
+        if (mFieldValueType == kSpaceTimeVaryingField && mPrefetcher != 0L)
+            nextRecord();
+        else if (mFieldValueType == kTimeVaryingField)
         {
             //LOG << "TODO: Read 1 value if using polarization; read N values "
             //    "if not using polarization and using N fields.\n";
             
             if (mUsesPolarization)
             {
-                float val;
-                if (mFile.good())
-                    mFile.read((char*)&val,
-                        (std::streamsize)sizeof(float));
-                else
+                const float* val = mFile.view(1);
+                if (val == 0L)
                     throw(Exception("Cannot read further from file."));
-                mCurrentValueVec = mPolarizationFactor * val;
+                mCurrentValueVec = mPolarizationFactor * (*val);
             }
             else
             {
                 for (int direction = 0; direction < 3; direction++)
                 if (mWhichH[direction])
                 {
-                    if (mFile.good())
-                        mFile.read((char*)&mCurrentValueVec[direction],
-                            (std::streamsize)sizeof(float));
-                    else
+                    if (!mFile.read(&mCurrentValueVec[direction], 1))
                         throw(Exception("Cannot read further from file."));
                 }
             }
@@ -215,8 +351,18 @@ getFieldE(int direction)
     float fieldValue;
     if (mFieldValueType == kSpaceTimeVaryingField)
     {
-        assert(mFile.good());
-        mFile.read((char*)&fieldValue, (std::streamsize)sizeof(float));
+        if (mRecord != 0L)
+        {
+            assert(mRecordIndex < mRecord->size());
+            fieldValue = (*mRecord)[mRecordIndex++];
+        }
+        else
+        {
+            const float* value = mFile.view(1);
+            if (value == 0L)
+                throw(Exception("Cannot read further from file."));
+            fieldValue = *value;
+        }
     }
     else if (mFieldValueType == kTimeVaryingField)
     {
@@ -247,8 +393,18 @@ getFieldH(int direction)
     float fieldValue;
     if (mFieldValueType == kSpaceTimeVaryingField)
     {
-        assert(mFile.good());
-        mFile.read((char*)&fieldValue, (std::streamsize)sizeof(float));
+        if (mRecord != 0L)
+        {
+            assert(mRecordIndex < mRecord->size());
+            fieldValue = (*mRecord)[mRecordIndex++];
+        }
+        else
+        {
+            const float* value = mFile.view(1);
+            if (value == 0L)
+                throw(Exception("Cannot read further from file."));
+            fieldValue = *value;
+        }
     }
     else if (mFieldValueType == kTimeVaryingField)
     {
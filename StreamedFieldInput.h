@@ -15,8 +15,10 @@
 #include <string>
 #include <fstream>
 #include <vector>
-#include <calc.hh>
 #include "MemoryUtilities.h"
+#include "MappedFile.h"
+#include "FilePrefetcher.h"
+#include "SpaceTimeFormula.h"
 
 /**
  *  Unified source of E and H field data for hard sources, soft sources,
@@ -24,6 +26,14 @@
  *  analytical field propagation, whatnot).  Fields may be time or time-space
  *  varying, and fields with separable time and space dependencies can be
  *  specified in two parts to use less memory.
+ *
+ *  Data files are memory-mapped (see MappedFile), so space-time-varying
+ *  fields are read straight out of the page cache one value at a time
+ *  without a system call per value.
+ *
+ *  Formulas may use x, y and z as well as n and t; such sources are
+ *  space-time-varying and are worked out a half timestep at a time by a
+ *  SpaceTimeFormula, once setCells() has said where the cells are.
  */
 class StreamedFieldInput
 {
@@ -56,6 +66,31 @@ public:
     void startHalfTimestepE(long timestep, float time);
     void startHalfTimestepH(long timestep, float time);
     
+    /**
+     *  Evaluate a formula source for every timestep up front, so each half
+     *  timestep only looks its value up.  Sources that don't use a formula
+     *  ignore this.
+     *
+     *  @param numTimesteps     number of timesteps in the simulation
+     *  @param dt               timestep in seconds
+     */
+    void precomputeWaveform(long numTimesteps, float dt);
+    
+    /**
+     *  Tell a source whose formula uses x, y or z which cells it will be asked
+     *  for, in the order getFieldE() and getFieldH() will be called: each
+     *  field direction in turn, each rect in turn, x fastest.  Other sources
+     *  ignore this.
+     *
+     *  @param yeeCellsE    rects of Yee cells for Ex, Ey and Ez
+     *  @param yeeCellsH    rects of Yee cells for Hx, Hy and Hz
+     *  @param originYee    Yee cell at position (0, 0, 0)
+     *  @param dxyz         cell size in meters
+     */
+    void setCells(const std::vector<std::vector<Rect3i> > & yeeCellsE,
+        const std::vector<std::vector<Rect3i> > & yeeCellsH,
+        const Vector3i & originYee, const Vector3f & dxyz);
+    
     /**
      *  For sources that store a mask in a buffer, reset the pointer to the
      *  current mask position to zero.
@@ -90,7 +125,42 @@ public:
      */
     float getFieldH(int direction);
     
+    /**
+     *  Read the space-time data file ahead on a loader thread, if the
+     *  FilePrefetcher settings allow it.  Each half timestep reads one record;
+     *  the record lengths are the numbers of getFieldE() or getFieldH() calls
+     *  per half timestep, in the order the half timesteps come.
+     *
+     *  @param recordLengths    the repeating pattern of record lengths
+     */
+    void prefetch(const std::vector<long> & recordLengths);
+    
+    /**
+     *  Time the timestep thread has spent waiting for the prefetcher to read
+     *  data from the file.
+     */
+    double stallMicroseconds() const;
+    
 private:
+    /**
+     *  @returns the value of the formula at this timestep, from the table if
+     *  there is one and the time is the usual one
+     */
+    float formulaValue(long timestep, float time,
+        const std::vector<float> & waveform, float tableTime) const;
+    
+    /**
+     *  Give the last record back to the prefetcher and take the next.
+     */
+    void nextRecord();
+    
+    /**
+     *  Evaluate a space-time formula at all the cells of one half timestep
+     *  into the record that getFieldE() or getFieldH() will read.
+     */
+    void evaluateFormulas(SpaceTimeFormulaPtr* formulas, long timestep,
+        float time);
+    
     /**
      *  If the SourceDescription indicates that the source has a mask (a space-
      *  varying prefactor), then allocate the mask buffers here and load them.
@@ -99,9 +169,20 @@ private:
      */
     void loadMask(SourceDescPtr source);
     
-    std::ifstream mFile;
+    MappedFile mFile;
+    std::string mFileName;
+    FilePrefetcherPtr mPrefetcher;
+    const std::vector<float>* mRecord;
+    long mRecordIndex;
     std::string mFormula;
-	calc_defs::Calculator<float> mCalculator;
+    CompiledFormula mCompiledFormula;
+    float mDt;
+    std::vector<float> mWaveformE;
+    std::vector<float> mWaveformH;
+    std::vector<CompiledFormula> mFieldFormulas; // Ex, Ey, Ez, Hx, Hy, Hz
+    SpaceTimeFormulaPtr mSpaceTimeE[3];
+    SpaceTimeFormulaPtr mSpaceTimeH[3];
+    std::vector<float> mFormulaRecord;
     
     std::vector<float> mDataMaskE[3];
     std::vector<float> mDataMaskH[3];
@@ -597,7 +597,7 @@ saveGridReports(const GridDescription & grid, const VoxelizedPartition & vp)
         for (int mm = 0; mm < regions.size(); mm++)
         {
             Rect3i halfCells = yeeToHalf(regions[mm].yeeCells());
-            halfCells = clip(halfCells, vp.calcHalfCells());
+            halfCells = intersection(halfCells, vp.calcHalfCells());
             reportHalfCells.push_back(halfCells);
             assert(regions[mm].stride() == Vector3i(1,1,1));
             
@@ -22,7 +22,7 @@ UpdateEquation::
 
 void UpdateEquation::
 writeJ(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     float zero = 0.0f;
     for (long nn = 0; nn < length; nn++)
@@ -31,7 +31,7 @@ writeJ(int direction, std::ostream & binaryStream, long startingIndex,
 
 void UpdateEquation::
 writeP(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     float zero = 0.0f;
     for (long nn = 0; nn < length; nn++)
@@ -40,7 +40,7 @@ writeP(int direction, std::ostream & binaryStream, long startingIndex,
 
 void UpdateEquation::
 writeK(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     float zero = 0.0f;
     for (long nn = 0; nn < length; nn++)
@@ -49,7 +49,7 @@ writeK(int direction, std::ostream & binaryStream, long startingIndex,
 
 void UpdateEquation::
 writeM(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     float zero = 0.0f;
     for (long nn = 0; nn < length; nn++)
@@ -66,3 +66,52 @@ allocateAuxBuffers()
 {
 }
 
+
+void UpdateEquation::
+divideRunlines(int numThreads)
+{
+}
+
+void UpdateEquation::
+calcEPhase(int direction, int threadNum, int numThreads)
+{
+    if (threadNum == 0)
+        calcEPhase(direction);
+}
+
+void UpdateEquation::
+calcHPhase(int direction, int threadNum, int numThreads)
+{
+    if (threadNum == 0)
+        calcHPhase(direction);
+}
+
+void UpdateEquation::
+fuseRunlines(const InterleavedLattice & lattice)
+{
+}
+
+void UpdateEquation::
+divideRunlinesIntoTiles(const InterleavedLattice & lattice, int numTiles)
+{
+}
+
+void UpdateEquation::
+calcETile(int direction, int tileNum, int numTiles)
+{
+    if (tileNum == 0)
+        calcEPhase(direction);
+}
+
+void UpdateEquation::
+calcHTile(int direction, int tileNum, int numTiles)
+{
+    if (tileNum == 0)
+        calcHPhase(direction);
+}
+
+bool UpdateEquation::
+tilesByPlanes(const InterleavedLattice & lattice) const
+{
+    return 0;
+}
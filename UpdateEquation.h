@@ -12,12 +12,14 @@
 
 #include "Pointer.h"
 #include "geometry.h"
+#include "FieldStorage.h"
 
 #include <string>
 #include <iostream>
 
 class VoxelizedPartition;
 class CalculationPartition;
+class InterleavedLattice;
 class CurrentSource;
 
 class UpdateEquation
@@ -37,20 +39,55 @@ public:
     virtual void calcEPhase(int direction) = 0;
     virtual void calcHPhase(int direction) = 0;
     
+    // Multithreaded updates.  divideRunlines() is called once, before the
+    // simulation starts, to split the runlines among numThreads threads; then
+    // on each half-timestep, thread threadNum updates only its share.  The
+    // default implementation does all the work on thread 0.
+    virtual void divideRunlines(int numThreads);
+    virtual void calcEPhase(int direction, int threadNum, int numThreads);
+    virtual void calcHPhase(int direction, int threadNum, int numThreads);
+    
+    // Cache-blocked updates.  divideRunlinesIntoTiles() sorts the runlines
+    // into numTiles slabs by where their fields lie in the lattice (tile nn
+    // is the nn-th of numTiles equal pieces of each field component).  Then
+    // the partition can update every material and component in one tile
+    // while its fields are still in cache.  The default implementation does
+    // all the work in tile 0.
+    virtual void divideRunlinesIntoTiles(const InterleavedLattice & lattice,
+        int numTiles);
+    virtual void calcETile(int direction, int tileNum, int numTiles);
+    virtual void calcHTile(int direction, int tileNum, int numTiles);
+    
+    // Temporal blocking updates the grid a plane at a time, one tile per
+    // plane along the slowest memory direction, several timesteps deep.
+    // Return true only if then each calcETile() and calcHTile() writes
+    // nothing outside its own plane, i.e. no runline crosses a plane.
+    virtual bool tilesByPlanes(const InterleavedLattice & lattice) const;
+    
+    // Fused updates.  After fuseRunlines(), runlines of the three field
+    // components that cover the same Yee cells are updated together, all in
+    // the x-component pass, so the curl fields are read from memory once.
+    // Update equations without a fused update ignore this.
+    virtual void fuseRunlines(const InterleavedLattice & lattice);
+    
     virtual long numRunlinesE() const = 0;
     virtual long numRunlinesH() const = 0;
     virtual long numHalfCellsE() const = 0;
     virtual long numHalfCellsH() const = 0;
     
     virtual void writeJ(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     virtual void writeP(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     
     virtual void writeK(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     virtual void writeM(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
         
     virtual std::string modelName() const = 0;
     
@@ -367,6 +367,7 @@ void VoxelGrid::
 overlayHuygensSurface(const HuygensSurface & surf)
 {
 	int ii, jj, kk;
+	Vector3i images[27];
     
     //cout << *this << "\n";
 	for (int sideNum = 0; sideNum < 6; sideNum++)
@@ -384,8 +385,10 @@ overlayHuygensSurface(const HuygensSurface & surf)
 			for (jj = innerHalfRect.p1[1]; jj <= innerHalfRect.p2[1]; jj++)
 			for (ii = innerHalfRect.p1[0]; ii <= innerHalfRect.p2[0]; ii++)
 			{
-				Paint* p = (*this)(ii,jj,kk)->withCurlBuffer(sideNum, nb);
-				paintHalfCell(p, ii, jj, kk);
+				int numImages = allocatedImages(Vector3i(ii,jj,kk), images);
+				for (int nn = 0; nn < numImages; nn++)
+					(*this)(images[nn]) = (*this)(images[nn])->withCurlBuffer(
+						sideNum, nb);
 			}
 			
 			//LOG << "Huygens inner " << innerHalfRect << "\n";
@@ -396,9 +399,10 @@ overlayHuygensSurface(const HuygensSurface & surf)
 			for (jj = outerHalfRect.p1[1]; jj <= outerHalfRect.p2[1]; jj++)
 			for (ii = outerHalfRect.p1[0]; ii <= outerHalfRect.p2[0]; ii++)
 			{
-				Paint* q = (*this)(ii,jj,kk)->withCurlBuffer(oppositeSideNum,
-					nb);
-				paintHalfCell(q, ii, jj, kk);
+				int numImages = allocatedImages(Vector3i(ii,jj,kk), images);
+				for (int nn = 0; nn < numImages; nn++)
+					(*this)(images[nn]) = (*this)(images[nn])->withCurlBuffer(
+						oppositeSideNum, nb);
 			}
 			
 			//LOG << "Huygens outer " << outerHalfRect << "\n"; 
@@ -418,6 +422,7 @@ overlayCurrentSource(const CurrentSourceDescPtr & current)
     int fieldDirection;
     Rect3i yeeCells;
     int rr;
+    Vector3i images[27];
     
     //const CurrentSourceDescription & description = *current.description();
     
@@ -432,9 +437,11 @@ overlayCurrentSource(const CurrentSourceDescPtr & current)
             for (p[1] = yeeCells.p1[1]; p[1] <= yeeCells.p2[1]; p[1]++)
             for (p[0] = yeeCells.p1[0]; p[0] <= yeeCells.p2[0]; p[0]++)
             {
-                Paint* paint = (*this)(yeeToHalf(p, octantE(fieldDirection)))
-                    ->withCurrentSource(current);
-                paintHalfCell(paint, yeeToHalf(p, octantE(fieldDirection)));
+                int numImages = allocatedImages(
+                    yeeToHalf(p, octantE(fieldDirection)), images);
+                for (int nn = 0; nn < numImages; nn++)
+                    (*this)(images[nn]) = (*this)(images[nn])
+                        ->withCurrentSource(current);
             }
         }
     }
@@ -450,9 +457,11 @@ overlayCurrentSource(const CurrentSourceDescPtr & current)
             for (p[1] = yeeCells.p1[1]; p[1] <= yeeCells.p2[1]; p[1]++)
             for (p[0] = yeeCells.p1[0]; p[0] <= yeeCells.p2[0]; p[0]++)
             {
-                Paint* paint = (*this)(yeeToHalf(p, octantH(fieldDirection)))
-                    ->withCurrentSource(current);
-                paintHalfCell(paint, yeeToHalf(p, octantH(fieldDirection)));
+                int numImages = allocatedImages(
+                    yeeToHalf(p, octantH(fieldDirection)), images);
+                for (int nn = 0; nn < numImages; nn++)
+                    (*this)(images[nn]) = (*this)(images[nn])
+                        ->withCurrentSource(current);
             }
         }
     }
@@ -597,24 +606,10 @@ operator() (const Vector3i & pp) const
 void VoxelGrid::
 paintHalfCell(Paint* paint, int ii, int jj, int kk)
 {
-	//	 Paint the cell itself
-	if (mAllocRegion.encloses(ii,jj,kk))
-	{
-		(*this)(ii,jj,kk) = paint;
-	}
-	
-	// Now grid-symmetrical paints
-	for (int transDir = 0; transDir < 6; transDir++)
-	{
-		Vector3i translation(cardinal(transDir)*
-			(mGridHalfCells.size(transDir/2)+1));
-		if (mAllocRegion.encloses(ii+translation[0], jj+translation[1],
-			kk+translation[2]))
-		{
-			(*this)(ii+translation[0], jj+translation[1], kk+translation[2])
-				 = paint;
-		}
-	}
+	Vector3i images[27];
+	int numImages = allocatedImages(Vector3i(ii,jj,kk), images);
+	for (int nn = 0; nn < numImages; nn++)
+		(*this)(images[nn]) = paint;
 }
 
 void VoxelGrid::
@@ -655,21 +650,10 @@ paintPMC(Paint* paint, int iYee, int jYee, int kYee)
 void VoxelGrid::
 paintPML(Vector3i pmlDir, Vector3i pp)
 {
-	//	 Paint the cell itself
-	if (mAllocRegion.encloses(pp))
-		(*this)(pp) = (*this)(pp)->withPML(pmlDir);
-	
-	// Now grid-symmetrical paints
-	for (int transDir = 0; transDir < 6; transDir++)
-	{
-		Vector3i qq(pp + cardinal(transDir)*
-			(mGridHalfCells.size(transDir/2)+1));
-		
-		if (mAllocRegion.encloses(qq))
-		{
-			(*this)(qq) = (*this)(qq)->withPML(pmlDir);
-		}
-	}
+	Vector3i images[27];
+	int numImages = allocatedImages(pp, images);
+	for (int nn = 0; nn < numImages; nn++)
+		(*this)(images[nn]) = (*this)(images[nn])->withPML(pmlDir);
 }
 
 bool VoxelGrid::
@@ -691,6 +675,26 @@ clear()
     mMaterialHalfCells.resize(0);
 }
 
+int VoxelGrid::
+allocatedImages(const Vector3i & pp, Vector3i images[27]) const
+{
+	// The grid is periodic, so besides the cell itself a node may hold its
+	// translations by the grid size, including the diagonal images that fill
+	// the corners of the node's ghost cells.
+	Vector3i gridSize(mGridHalfCells.size() + Vector3i(1,1,1));
+	int numImages = 0;
+	for (int tz = -1; tz <= 1; tz++)
+	for (int ty = -1; ty <= 1; ty++)
+	for (int tx = -1; tx <= 1; tx++)
+	{
+		Vector3i qq(pp + Vector3i(tx*gridSize[0], ty*gridSize[1],
+			tz*gridSize[2]));
+		if (mAllocRegion.encloses(qq))
+			images[numImages++] = qq;
+	}
+	return numImages;
+}
+
 
 std::ostream &
 operator<< (std::ostream & out, const VoxelGrid & grid)
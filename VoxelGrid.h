@@ -92,6 +92,11 @@ public:
     void clear();
 	
 private:
+    // pp                global coordinate (half cell)
+    // images            filled with pp and its periodic images in the node
+    // returns           number of images filled in
+    int allocatedImages(const Vector3i & pp, Vector3i images[27]) const;
+    
     GridDescPtr mGridDescription;
 	std::vector<Paint*> mMaterialHalfCells;
 	
@@ -100,6 +100,12 @@ allocYeeCells() const
     return halfToYee(mFieldAllocHalfCells);
 }
 
+Rect3i VoxelizedPartition::
+calcYeeCells() const
+{
+    return halfToYee(mCalcHalfCells);
+}
+
 bool VoxelizedPartition::
 partitionHasPML(int faceNum) const
 {
@@ -261,7 +267,8 @@ writeDataRequests() const
     }
     
     for (int nn = 0; nn < mHuygensSurfaces.size(); nn++)
-    if (mHuygensSurfaces[nn]->description()->type() == kCustomTFSFSource)
+    if (mHuygensSurfaces[nn]->description()->type() == kCustomTFSFSource &&
+        mHuygensSurfaces[nn]->description()->formulas().size() == 0)
     {
         ostringstream str;
         str << "tfsfreq_" << nn << ".m";
@@ -429,7 +436,9 @@ paintFromAssembly(const GridDescription & gridDesc,
 		}
 	}
     
-    if (false == mVoxels.regionIsFilled(mVoxels.nonPMLRegion()))
+    // Only the calc region gets runlines; ghost cells may be off the grid.
+    if (false == mVoxels.regionIsFilled(intersection(mVoxels.nonPMLRegion(),
+        mCalcHalfCells)))
         throw(Exception("Some Yee cells have undefined materials!"));
 }
 
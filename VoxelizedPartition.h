@@ -62,6 +62,7 @@ public:
     const Rect3i & allocHalfCells() const { return mFieldAllocHalfCells; }
     Rect3i allocYeeCells() const;
     const Rect3i & calcHalfCells() const { return mCalcHalfCells; }
+    Rect3i calcYeeCells() const;
     Vector3i originYee() const { return mOriginYee; }
 	bool partitionHasPML(int faceNum) const;
 	Rect3i pmlHalfCellsOnFace(int faceNum) const;
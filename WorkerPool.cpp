@@ -0,0 +1,104 @@
+/*
+ *  WorkerPool.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "WorkerPool.h"
+
+#include <boost/bind.hpp>
+#include <cassert>
+
+using namespace std;
+
+WorkerPool::
+WorkerPool(int numThreads) :
+    mNumThreads(numThreads),
+    mTask(0L),
+    mGeneration(0),
+    mNumBusy(0),
+    mShutdown(0)
+{
+    assert(mNumThreads >= 1);
+
+    // Thread 0 is whoever calls run().
+    for (int nn = 1; nn < mNumThreads; nn++)
+        mThreads.create_thread(boost::bind(&WorkerPool::workerLoop, this, nn));
+}
+
+WorkerPool::
+~WorkerPool()
+{
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        mShutdown = 1;
+    }
+    mStartCondition.notify_all();
+    mThreads.join_all();
+}
+
+void WorkerPool::
+run(WorkerTask & task)
+{
+    if (mNumThreads == 1)
+    {
+        task.execute(0, 1);
+        return;
+    }
+
+    boost::mutex::scoped_try_lock runLock(mRunMutex);
+    if (!runLock)
+    {
+        for (int nn = 0; nn < mNumThreads; nn++)
+            task.execute(nn, mNumThreads);
+        return;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mMutex);
+        assert(mNumBusy == 0);
+        mTask = &task;
+        mNumBusy = mNumThreads-1;
+        mGeneration++;
+    }
+    mStartCondition.notify_all();
+
+    task.execute(0, mNumThreads);
+
+    boost::mutex::scoped_lock lock(mMutex);
+    while (mNumBusy != 0)
+        mDoneCondition.wait(lock);
+    mTask = 0L;
+}
+
+void WorkerPool::
+workerLoop(int threadNum)
+{
+    long lastGeneration = 0;
+
+    while (1)
+    {
+        WorkerTask* task;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            while (mGeneration == lastGeneration && !mShutdown)
+                mStartCondition.wait(lock);
+            if (mShutdown)
+                return;
+            lastGeneration = mGeneration;
+            task = mTask;
+        }
+
+        task->execute(threadNum, mNumThreads);
+
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            mNumBusy--;
+            if (mNumBusy == 0)
+                mDoneCondition.notify_one();
+        }
+    }
+}
+
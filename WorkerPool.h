@@ -0,0 +1,74 @@
+/*
+ *  WorkerPool.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _WORKERPOOL_
+#define _WORKERPOOL_
+
+#include "Pointer.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/**
+ * One unit of parallel work.  WorkerPool::run() calls execute() once on every
+ * thread in the pool, each time with a different thread number; the task is
+ * responsible for picking its share of the work from the thread number.
+ */
+class WorkerTask
+{
+public:
+    WorkerTask() {}
+    virtual ~WorkerTask() {}
+
+    virtual void execute(int threadNum, int numThreads) = 0;
+};
+
+/**
+ * Persistent pool of worker threads.  The threads are started once, in the
+ * constructor, and sleep between calls to run().  The thread calling run()
+ * participates as thread 0, so a pool of N threads starts only N-1 extra
+ * boost::threads.  run() returns only after every thread has finished the
+ * task, so each call is also a barrier.
+ */
+class WorkerPool
+{
+public:
+    WorkerPool(int numThreads);
+    ~WorkerPool();
+
+    int numThreads() const { return mNumThreads; }
+
+    /**
+     * Call task.execute(threadNum, numThreads) on every thread of the pool
+     * and wait for all of them to finish.  If another thread is already using
+     * the pool, all the pieces of the task are executed on the calling thread
+     * instead; the result is the same, only slower.
+     */
+    void run(WorkerTask & task);
+
+private:
+    void workerLoop(int threadNum);
+
+    int mNumThreads;
+    boost::thread_group mThreads;
+
+    boost::mutex mRunMutex;
+    boost::mutex mMutex;
+    boost::condition_variable mStartCondition;
+    boost::condition_variable mDoneCondition;
+
+    WorkerTask* mTask;
+    long mGeneration;
+    int mNumBusy;
+    bool mShutdown;
+};
+typedef Pointer<WorkerPool> WorkerPoolPtr;
+
+
+#endif
@@ -170,7 +170,7 @@ loadGrids(const TiXmlElement* parent, const SimulationDescription & sim) const
             Map<string, string> theseParams = sGetAttributes(pmlParamXML);
             theseParams.erase("direction");
             
-            if (sTryGetAttribute(elem, "direction", direction))
+            if (sTryGetAttribute(pmlParamXML, "direction", direction))
                 pmlParams[direction] = theseParams;
             else
             for (int sideNum = 0; sideNum < 6; sideNum++)
@@ -301,7 +301,7 @@ loadMaterials(const TiXmlElement* parent) const
             Map<string, string> theseParams = sGetAttributes(pmlParamXML);
             theseParams.erase("direction");
             
-            if (sTryGetAttribute(elem, "direction", direction))
+            if (sTryGetAttribute(pmlParamXML, "direction", direction))
                 pmlParams[direction] = theseParams;
             else
             for (int sideNum = 0; sideNum < 6; sideNum++)
@@ -354,9 +354,29 @@ loadAFieldOutput(const TiXmlElement* elem) const
     bool isInterpolated;
     Map<string,string> attribs = sGetAttributes(elem);
     Map<string,string> childAttribs;
-    sGetMandatoryAttribute(elem, "fields", fields);
+    string reduceString;
+    OutputReduction reduction = kNoReduction;
+    if (sTryGetAttribute(elem, "reduce", reduceString))
+    {
+        if (reduceString == "flux")
+            reduction = kFluxReduction;
+        else if (reduceString == "energy")
+            reduction = kEnergyReduction;
+        else
+            throw(Exception(sErr("Output reduce must be flux or energy",
+                elem)));
+    }
+    
+    // Reductions use E and H whatever the fields attribute says.
+    if (reduction == kNoReduction)
+        sGetMandatoryAttribute(elem, "fields", fields);
+    else
+        fields = "electric magnetic";
     sGetMandatoryAttribute(elem, "file", file);
     isInterpolated = sTryGetAttribute(elem, "interpolate", interpolationPoint);
+    if (isInterpolated && reduction != kNoReduction)
+        throw(Exception(sErr("Flux and energy outputs do their own "
+            "interpolation", elem)));
     
     vector<Region> regions;
     vector<Duration> durations;
@@ -379,12 +399,37 @@ loadAFieldOutput(const TiXmlElement* elem) const
     if (durations.size() == 0)
         durations.push_back(Duration());
     
+    // Lossy output: at most one of errorBound and relativeErrorBound
+    double errorBound = 0.0;
+    bool hasAbsoluteBound = sTryGetAttribute(elem, "errorBound", errorBound);
+    bool isRelativeBound = sTryGetAttribute(elem, "relativeErrorBound",
+        errorBound);
+    if (hasAbsoluteBound && isRelativeBound)
+        throw(Exception(sErr("Output may have errorBound or "
+            "relativeErrorBound but not both", elem)));
+    if (errorBound < 0)
+        throw(Exception(sErr("Output error bound must not be negative",
+            elem)));
+    
+    // Frequency-domain output
+    vector<double> frequencies;
+    if (elem->Attribute("frequencies") != 0L)
+    {
+        // (sTryGetAttribute would stop reading at the first space.)
+        istringstream istr(elem->Attribute("frequencies"));
+        double frequency;
+        while (istr >> frequency)
+            frequencies.push_back(frequency);
+        if (!istr.eof() || frequencies.size() == 0)
+            throw(Exception(sErr("Could not read frequencies", elem)));
+    }
+    
+    OutputDescPtr f;
     if (isInterpolated)
     {
         try {
-            OutputDescPtr f(new OutputDescription(
+            f = OutputDescPtr(new OutputDescription(
                 fields, file, interpolationPoint, regions, durations));
-            return f;
         } catch (Exception & e) {
             throw(Exception(sErr(e.what(), elem)));
         }
@@ -392,16 +437,27 @@ loadAFieldOutput(const TiXmlElement* elem) const
     else
     {
         try {
-            OutputDescPtr f(new OutputDescription(
+            f = OutputDescPtr(new OutputDescription(
                 fields, file, regions, durations));
-            return f;
         } catch (Exception & e) {
             throw(Exception(sErr(e.what(), elem)));
         }
     }
+    f->setErrorBound(errorBound, isRelativeBound);
+    f->setFrequencies(frequencies);
+    f->setReduction(reduction);
+    
+    if (frequencies.size() > 0 && reduction == kEnergyReduction)
+        throw(Exception(sErr("Energy outputs do not take frequencies",
+            elem)));
+    
+    if (frequencies.size() > 0 && (norm2(f->whichJ()) != 0 ||
+        norm2(f->whichK()) != 0 || norm2(f->whichP()) != 0 ||
+        norm2(f->whichM()) != 0))
+        throw(Exception(sErr("Frequency-domain outputs can only record "
+            "electric and magnetic fields", elem)));
     
-    LOG << "Shouldn't have gotten here.\n";
-    return OutputDescPtr(0L);
+    return f;
 }
 
 
@@ -762,7 +818,22 @@ loadCustomSources(const TiXmlElement* parent) const
         const TiXmlElement* durationXML;
         Duration duration;
 		
-		sGetMandatoryAttribute(elem, "file", file);
+        // The incident fields come from a file or from formulas in n, t, x,
+        // y and z for each component.
+        vector<string> formulas(6);
+        bool hasFormula = 0;
+        for (int nn = 0; nn < 6; nn++)
+        {
+            string attribute = string("formula") + (nn < 3 ? "E" : "H") +
+                char('x' + nn%3);
+            if (sTryGetAttribute(elem, attribute, formulas[nn]))
+                hasFormula = 1;
+        }
+        if (!hasFormula)
+            sGetMandatoryAttribute(elem, "file", file);
+        else if (elem->Attribute("file") != 0L)
+            throw(Exception(sErr("CustomTFSFSource needs a file or formulas, "
+                "not both.", elem)));
         sGetMandatoryAttribute(elem, "symmetries", symmetries);
         sGetOptionalAttribute(elem, "tfsfType", tfsfType, string("TF"));
         if (sTryGetAttribute(elem, "yeeCells", yeeCells))
@@ -783,9 +854,15 @@ loadCustomSources(const TiXmlElement* parent) const
         }
         
         try {
-            HuygensSurfaceDescPtr source(HuygensSurfaceDescription::
-                newCustomTFSFSource(file, symmetries, halfCells, duration,
-                omittedSides, tfsfType=="TF"));
+            HuygensSurfaceDescPtr source;
+            if (hasFormula)
+                source = HuygensSurfaceDescPtr(HuygensSurfaceDescription::
+                    newCustomTFSFFormulaSource(formulas, symmetries, halfCells,
+                    duration, omittedSides, tfsfType=="TF"));
+            else
+                source = HuygensSurfaceDescPtr(HuygensSurfaceDescription::
+                    newCustomTFSFSource(file, symmetries, halfCells, duration,
+                    omittedSides, tfsfType=="TF"));
             customSources.push_back(source);
 		} catch (Exception & e) {
 			throw(Exception(sErr(e.what(), elem)));
@@ -190,10 +190,10 @@ Vector3i hFieldOffset(int fieldNum)
 }
 
 
-// returns halfCell/2
+// returns halfCell/2, rounded down (ghost cells may be at negative indices)
 Vector3i halfToYee(const Vector3i & halfCell)
 {
-	return halfCell/2;
+	return (halfCell - mod2abs(halfCell))/2;
 }
 
 // returns  2*yeeCell + halfCellOffset
@@ -212,7 +212,7 @@ Vector3i yeeToHalf(const Vector3i & yeeCell, int octant)
 // returns smallest Yee rect containing all points in halfRect
 Rect3i halfToYee(const Rect3i & halfRect)
 {
-	return halfRect/2L;
+	return Rect3i(halfToYee(halfRect.p1), halfToYee(halfRect.p2));
 }
 
 // returns smallest Yee rect containing all points at given octant
@@ -232,10 +232,16 @@ Rect3i halfToYee(const Rect3i & halfRect, int octant)
 	// since elementwise != is not defined, I can instead use
 	// (offset%2 != halfRect.p1%2)  equiv to   (offset+halfRect.p1)%2
 	
+	//
+	// The first and last half cells at the offset are offset + 2*yee, so
+	// subtract the offset before dividing; then the division is exact even
+	// for negative half cells.
+	
 	const Vector3i & offset = halfCellOffset(octant);
     
-    return Rect3i( (halfRect.p1 + mod2abs(offset+halfRect.p1))/2,
-        (halfRect.p2 - mod2abs(offset+halfRect.p2))/2 );
+    return Rect3i(
+        (halfRect.p1 + mod2abs(offset+halfRect.p1) - offset)/2,
+        (halfRect.p2 - mod2abs(offset+halfRect.p2) - offset)/2 );
     /*
 	return Rect3i( (halfRect.p1 + Vector3i(offset+halfRect.p1)%2)/2,
 		(halfRect.p2 - Vector3i(offset+halfRect.p2)%2)/2 );
@@ -248,8 +254,9 @@ Rect3i halfToYee(const Rect3i & halfRect, int octant)
 Rect3i halfToYee(const Rect3i & halfRect, const Vector3i & halfCellOffset)
 {
 	// see above
-	return Rect3i( (halfRect.p1 + mod2abs(halfCellOffset+halfRect.p1))/2,
-		(halfRect.p2 - mod2abs(halfCellOffset+halfRect.p2))/2 );	
+	return Rect3i(
+        (halfRect.p1 + mod2abs(halfCellOffset+halfRect.p1) - halfCellOffset)/2,
+		(halfRect.p2 - mod2abs(halfCellOffset+halfRect.p2) - halfCellOffset)/2);
 }
 
 // returns smallest half cell rect containing all points in given Yee rect
@@ -37,7 +37,7 @@ Vector3f hFieldPosition(int fieldIndex);
 Vector3i eFieldOffset(int directionIndex);
 Vector3i hFieldOffset(int directionIndex);
 
-// returns halfCell/2
+// returns halfCell/2, rounded down (ghost cells may be at -1)
 Vector3i halfToYee(const Vector3i & halfCell);
 
 // returns  2*yeeCell + halfCellOffset
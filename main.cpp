@@ -48,6 +48,7 @@
 
 #include "FDTDApplication.h"
 #include "Version.h"
+#include "FieldStorage.h"
 #include "Log.h"
 
 #include "tinyxml.h"
@@ -59,6 +60,8 @@
 
 #include <iostream>
 #include <limits>
+#include <sstream>
+#include <algorithm>
 
 
 using namespace std;
@@ -88,13 +91,71 @@ int main (int argc, char * const argv[])
 	
 	LOGFMORE << "Trogdor version " << TROGDOR_VERSION_TEXT << endl;
 	LOGFMORE << "OS type: " << TROGDOR_OS << endl;
+	LOGFMORE << "Field storage: " << TROGDOR_STORAGE_NAME << endl;
 	LOGFMORE << "Compile date: " << __DATE__ << " " << __TIME__ << endl;
 	
 	// The number of timesteps is specified in the parameter file.  The value
 	// here is an override for debuggery.
 	paramFileName = variablesMap["input-file"].as<string>();
 	//directory = variablesMap["outputDirectory"].as<string>();
-	//prefs.numThreads = variablesMap["numthreads"].as<int>();
+	prefs.numThreads = variablesMap["numthreads"].as<int>();
+	if (prefs.numThreads < 1)
+	{
+		cerr << "Number of threads must be at least 1." << endl;
+		exit(1);
+	}
+	prefs.tileBytes = 1024*long(variablesMap["tilekb"].as<int>());
+	if (prefs.tileBytes < 0)
+	{
+		cerr << "Tile size must not be negative." << endl;
+		exit(1);
+	}
+	prefs.timeBlockTimesteps = variablesMap["timeblock"].as<int>();
+	if (prefs.timeBlockTimesteps < 0)
+	{
+		cerr << "Temporal block size must not be negative." << endl;
+		exit(1);
+	}
+	if (variablesMap.count("fuse"))
+		prefs.fuseComponents = 1;
+	if (variablesMap.count("firsttouch"))
+		prefs.firstTouch = 1;
+	if (variablesMap.count("hugepages"))
+		prefs.hugePages = 1;
+	if (variablesMap.count("alignfields"))
+		prefs.alignFields = 1;
+	prefs.outputBuffers = variablesMap["outputbuffers"].as<int>();
+	if (prefs.outputBuffers < 0)
+	{
+		cerr << "Number of output buffers must not be negative." << endl;
+		exit(1);
+	}
+	if (variablesMap.count("chunked"))
+		prefs.chunkedOutput = 1;
+	prefs.prefetchRecords = variablesMap["prefetch"].as<int>();
+	prefs.prefetchBytes = 1024*1024*long(variablesMap["prefetchmb"].as<int>());
+	if (prefs.prefetchRecords < 0 || prefs.prefetchBytes < 0)
+	{
+		cerr << "Source prefetching must not be negative." << endl;
+		exit(1);
+	}
+	if (variablesMap.count("numnodes"))
+	{
+		// Accept "4" or "2x2x1".
+		string nodes = variablesMap["numnodes"].as<string>();
+		replace(nodes.begin(), nodes.end(), 'x', ' ');
+		istringstream nodeStream(nodes);
+		Vector3i numNodes(1,1,1);
+		for (int xyz = 0; xyz < 3 && nodeStream >> numNodes[xyz]; xyz++)
+			;
+		if (numNodes[0] < 1 || numNodes[1] < 1 || numNodes[2] < 1)
+		{
+			cerr << "Number of nodes must be at least 1 along each axis."
+				<< endl;
+			exit(1);
+		}
+		prefs.numNodes = numNodes;
+	}
 	if (variablesMap.count("timesteps"))
 	{
 		prefs.numTimestepsOverride = variablesMap["timesteps"].as<int>();
@@ -140,8 +201,28 @@ handleArguments(int argc, char* const argv[])
 	// Options allowed on the command line or in a config file
 	po::options_description config("Configuration");
 	config.add_options()
-		//("numthreads,n", po::value<int>()->default_value(1),
-		//	"set number of concurrent threads")
+		("numthreads,n", po::value<int>()->default_value(1),
+			"set number of concurrent threads")
+		("tilekb", po::value<int>()->default_value(0),
+			"update fields in cache-sized slabs of this many kilobytes "
+			"(0: whole grid)")
+		("timeblock", po::value<int>()->default_value(4),
+			"update up to this many timesteps at a time between sources "
+			"and outputs (0 or 1: one at a time)")
+		("fuse", "update Ex, Ey and Ez together where possible")
+		("firsttouch", "zero each thread's fields on that thread (NUMA)")
+		("hugepages", "back fields with transparent huge pages if possible")
+		("alignfields", "pad field rows to whole cache lines")
+		("outputbuffers", po::value<int>()->default_value(8),
+			"samples all outputs together may queue for the writer thread "
+			"(0: none)")
+		("chunked", "write compressed, chunked output files")
+		("prefetch", po::value<int>()->default_value(4),
+			"half timesteps of source data to read ahead (0: none)")
+		("prefetchmb", po::value<int>()->default_value(256),
+			"memory each source file may use for reading ahead, in MB")
+		("numnodes", po::value<string>(),
+			"split the grids among local processes, e.g. 2x2x1")
 		("timesteps,t", po::value<int>(), "override number of timesteps")
 		("xsections,x", "write Output cross-section images")
 		("geometry,g", "write 3D geometry file")
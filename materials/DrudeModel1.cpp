@@ -68,7 +68,7 @@ modelName() const
 
 void DrudeModel1::
 writeJ(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     assert(startingIndex >= 0);
     assert(startingIndex + length <= mCurrents[direction].size());
@@ -76,8 +76,8 @@ writeJ(int direction, std::ostream & binaryStream, long startingIndex,
     //LOGMORE << "index " << startingIndex << " direction " << direction << "\n";
     //if (mCurrents[direction][startingIndex] != 0.0)
     //    int flab = 5;
-    binaryStream.write((char*)&mCurrents[direction][startingIndex],
-        (std::streamsize)(length*sizeof(float)) );
+    writeFieldValues(binaryStream, &mCurrents[direction][startingIndex],
+        length);
 }
 
 void DrudeModel1::
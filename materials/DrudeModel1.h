@@ -41,7 +41,8 @@ public:
     
     std::string modelName() const;
     void writeJ(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     void allocateAuxBuffers();
     
     struct LocalDataE
@@ -49,7 +50,7 @@ public:
         float cj1;
         float cj2;
         float ce;
-        float* Ji;
+        AuxStorage* Ji;
     };
     
     struct LocalDataH
@@ -84,7 +85,7 @@ private:
     
     float m_cj1, m_cj2, m_ce, m_ch;
     
-    std::vector<float> mCurrents[3];
+    AuxArray mCurrents[3];
     MemoryBufferPtr mCurrentBuffers[3];
 };
 
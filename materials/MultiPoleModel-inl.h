@@ -0,0 +1,221 @@
+/*
+ *  MultiPoleModel-inl.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "SimulationDescription.h"
+#include "PhysicalConstants.h"
+
+#include <cassert>
+#include <sstream>
+
+template<int NUMPOLES>
+MultiPoleModel<NUMPOLES>::
+MultiPoleModel(
+    const MaterialDescription & descrip,
+    std::vector<long> numCellsE, std::vector<long> numCellsH,
+    Vector3f dxyz, float dt) :
+    Material(),
+    mDxyz(dxyz),
+    mDt(dt),
+    m_epsrinf(1.0),
+    m_mur(1.0)
+{
+    if (descrip.params().count("epsinf"))
+        std::istringstream(descrip.params()["epsinf"]) >> m_epsrinf;
+    if (descrip.params().count("mur"))
+        std::istringstream(descrip.params()["mur"]) >> m_mur;
+    
+    assert(DispersivePole::numPoles(descrip.params()) == NUMPOLES);
+    for (int pp = 0; pp < NUMPOLES; pp++)
+        mPoles[pp] = DispersivePole::read(descrip.params(), pp+1, dt);
+    
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        mNumCellsE[xyz] = numCellsE[xyz];
+        mStateBuffers[xyz] = MemoryBufferPtr(new MemoryBuffer(
+            std::string("MultiPoleModel J/P")+char('x'+xyz),
+            2*NUMPOLES*numCellsE[xyz]));
+    }
+    
+    m_ce = dt/m_epsrinf/Constants::eps0;
+    m_ch = dt/m_mur/Constants::mu0;
+}
+
+template<int NUMPOLES>
+std::string MultiPoleModel<NUMPOLES>::
+modelName() const
+{
+    std::ostringstream str;
+    str << "MultiPoleModel<" << NUMPOLES << ">";
+    return str.str();
+}
+
+template<int NUMPOLES>
+void MultiPoleModel<NUMPOLES>::
+writeJ(int direction, std::ostream & binaryStream, long startingIndex,
+    const FieldStorage* startingField, long length) const
+{
+    writeSum(direction, 0, binaryStream, startingIndex, length);
+}
+
+template<int NUMPOLES>
+void MultiPoleModel<NUMPOLES>::
+writeP(int direction, std::ostream & binaryStream, long startingIndex,
+    const FieldStorage* startingField, long length) const
+{
+    writeSum(direction, 1, binaryStream, startingIndex, length);
+}
+
+// Write the J (firstRun = 0) or P (firstRun = 1) of all the poles added up.
+template<int NUMPOLES>
+void MultiPoleModel<NUMPOLES>::
+writeSum(int direction, int firstRun, std::ostream & binaryStream,
+    long startingIndex, long length) const
+{
+    assert(startingIndex >= 0);
+    assert(startingIndex + length <= mNumCellsE[direction]);
+    if (length <= 0)
+        return;
+    
+    const long stride = mNumCellsE[direction];
+    std::vector<float> sum(length, 0.0f);
+    for (int pp = 0; pp < NUMPOLES; pp++)
+    {
+        const AuxStorage* run = &mState[direction][
+            (2*pp + firstRun)*stride + startingIndex];
+        for (long nn = 0; nn < length; nn++)
+            sum[nn] += run[nn];
+    }
+    binaryStream.write((char*)&sum[0], length*sizeof(float));
+}
+
+template<int NUMPOLES>
+void MultiPoleModel<NUMPOLES>::
+allocateAuxBuffers()
+{
+    for (int xyz = 0; xyz < 3; xyz++)
+    {
+        mState[xyz].resize(mStateBuffers[xyz]->length(), 2*NUMPOLES);
+        if (mState[xyz].size() > 0)
+            mStateBuffers[xyz]->setHeadPointer(&(mState[xyz][0]));
+    }
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+initLocalE(LocalDataE & data)
+{
+    data.ce = m_ce;
+    data.dt = mDt;
+    for (int pp = 0; pp < NUMPOLES; pp++)
+    {
+        data.cJ[pp] = mPoles[pp].cJ();
+        data.cP[pp] = mPoles[pp].cP();
+        data.cE[pp] = mPoles[pp].cE();
+    }
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+onStartRunlineE(LocalDataE & data, const SimpleAuxRunline & rl, int dir)
+{
+    data.state = &(mState[dir][rl.auxIndex]);
+    data.stride = mNumCellsE[dir];
+}
+
+// The poles take E(n), so they go before the update.
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+beforeUpdateE(LocalDataE & data, float Ei, float dHj, float dHk)
+{
+    data.sumJ = 0.0f;
+    for (int pp = 0; pp < NUMPOLES; pp++)
+    {
+        AuxStorage & J(data.state[2*pp*data.stride]);
+        AuxStorage & P(data.state[(2*pp+1)*data.stride]);
+        float Jnew = data.cJ[pp]*J + data.cP[pp]*P + data.cE[pp]*Ei;
+        J = Jnew;
+        P = P + data.dt*Jnew;
+        data.sumJ += Jnew;
+    }
+    data.state++;
+}
+
+template<int NUMPOLES>
+inline float MultiPoleModel<NUMPOLES>::
+updateE(LocalDataE & data, int dir, float Ei, float dHj, float dHk, float Ji)
+{
+    return Ei + data.ce*(dHk - dHj - Ji - data.sumJ);
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+afterUpdateE(LocalDataE & data, float Ei, float dHj, float dHk)
+{
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+updateE(LocalDataE & data, int dir, FieldStorage* Ei, const float* dHj,
+    const float* dHk, const float* Ji, int len)
+{
+    float sumJ[VectorKernels::BLOCK_LENGTH];
+    assert(len <= VectorKernels::BLOCK_LENGTH);
+    
+    for (int mm = 0; mm < len; mm++)
+        sumJ[mm] = Ji[mm];
+    for (int pp = 0; pp < NUMPOLES; pp++)
+    {
+        VectorKernels::poleUpdate(data.state + 2*pp*data.stride,
+            data.state + (2*pp+1)*data.stride, Ei, data.cJ[pp], data.cP[pp],
+            data.cE[pp], data.dt, sumJ, len);
+    }
+    VectorKernels::staticUpdate(Ei, data.ce, dHk, dHj, sumJ, len);
+    data.state += len;
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+initLocalH(LocalDataH & data)
+{
+    data.ch = m_ch;
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+onStartRunlineH(LocalDataH & data, const SimpleAuxRunline & rl, int dir)
+{
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+beforeUpdateH(LocalDataH & data, float Hi, float dEj, float dEk)
+{
+}
+
+template<int NUMPOLES>
+inline float MultiPoleModel<NUMPOLES>::
+updateH(LocalDataH & data, int dir, float Hi, float dEj, float dEk, float Ki)
+{
+    return Hi + data.ch*(-dEk + dEj - Ki);
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+afterUpdateH(LocalDataH & data, float Hi, float dEj, float dEk)
+{
+}
+
+template<int NUMPOLES>
+inline void MultiPoleModel<NUMPOLES>::
+updateH(LocalDataH & data, int dir, FieldStorage* Hi, const float* dEj,
+    const float* dEk, const float* Ki, int len)
+{
+    VectorKernels::staticUpdate(Hi, data.ch, dEj, dEk, Ki, len);
+}
+
+
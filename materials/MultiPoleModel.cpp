@@ -0,0 +1,124 @@
+/*
+ *  MultiPoleModel.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "MultiPoleModel.h"
+#include "PhysicalConstants.h"
+
+#include <sstream>
+
+using namespace std;
+
+// Read the parameter named name+poleNum, e.g. gamma2, or throw.
+static float sPoleParam(const Map<string, string> & params,
+    const string & name, int poleNum) throw(Exception);
+
+DispersivePole::
+DispersivePole() :
+    mType(kDrude),
+    m_cJ(0.0f),
+    m_cP(0.0f),
+    m_cE(0.0f)
+{
+}
+
+DispersivePole::
+DispersivePole(PoleType type, float deltaEps, float omega, float gamma,
+    float tau, float dt) :
+    mType(type)
+{
+    // Drude and Lorentz poles: the J equation at time n, with J(n) the
+    // average of J(n-1/2) and J(n+1/2).
+    // Debye poles: the P equation at time n+1/2, with P(n+1/2) the average
+    // of P(n) and P(n+1).  It has no J term, so cJ = 0.
+    if (type == kDrude)
+    {
+        // Here omega is the plasma frequency.
+        double denom = 1.0/dt + 0.5*gamma;
+        m_cJ = (1.0/dt - 0.5*gamma)/denom;
+        m_cP = 0.0f;
+        m_cE = Constants::eps0*omega*omega/denom;
+    }
+    else if (type == kLorentz)
+    {
+        double denom = 1.0/dt + 0.5*gamma;
+        m_cJ = (1.0/dt - 0.5*gamma)/denom;
+        m_cP = -omega*omega/denom;
+        m_cE = Constants::eps0*deltaEps*omega*omega/denom;
+    }
+    else
+    {
+        double denom = tau + 0.5*dt;
+        m_cJ = 0.0f;
+        m_cP = -1.0/denom;
+        m_cE = Constants::eps0*deltaEps/denom;
+    }
+}
+
+DispersivePole DispersivePole::
+read(const Map<string, string> & params, int poleNum, float dt)
+    throw(Exception)
+{
+    ostringstream key;
+    key << "pole" << poleNum;
+    if (params.count(key.str()) == 0)
+        throw(Exception(string("Missing parameter ") + key.str()));
+    
+    string type = params[key.str()];
+    if (type == "Drude")
+    {
+        return DispersivePole(kDrude, 0.0f,
+            sPoleParam(params, "omegap", poleNum),
+            sPoleParam(params, "gamma", poleNum), 0.0f, dt);
+    }
+    else if (type == "Lorentz")
+    {
+        return DispersivePole(kLorentz,
+            sPoleParam(params, "deltaeps", poleNum),
+            sPoleParam(params, "omega", poleNum),
+            sPoleParam(params, "gamma", poleNum), 0.0f, dt);
+    }
+    else if (type == "Debye")
+    {
+        return DispersivePole(kDebye,
+            sPoleParam(params, "deltaeps", poleNum), 0.0f, 0.0f,
+            sPoleParam(params, "tau", poleNum), dt);
+    }
+    throw(Exception(string("Unknown pole type ") + type + " for " +
+        key.str() + "; use Drude, Lorentz or Debye"));
+}
+
+int DispersivePole::
+numPoles(const Map<string, string> & params)
+{
+    int poleNum = 1;
+    while (1)
+    {
+        ostringstream key;
+        key << "pole" << poleNum;
+        if (params.count(key.str()) == 0)
+            return poleNum - 1;
+        poleNum++;
+    }
+}
+
+static float sPoleParam(const Map<string, string> & params,
+    const string & name, int poleNum) throw(Exception)
+{
+    ostringstream key;
+    key << name << poleNum;
+    if (params.count(key.str()) == 0)
+        throw(Exception(string("Missing parameter ") + key.str()));
+    
+    float value;
+    istringstream str(params[key.str()]);
+    if (!(str >> value))
+        throw(Exception(string("Cannot read parameter ") + key.str()));
+    return value;
+}
+
+
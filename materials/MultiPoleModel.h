@@ -0,0 +1,188 @@
+/*
+ *  MultiPoleModel.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _MULTIPOLEMODEL_
+#define _MULTIPOLEMODEL_
+
+#include "Material.h"
+#include "Runline.h"
+#include "Map.h"
+#include "MemoryUtilities.h"
+#include "VectorKernels.h"
+#include "Exception.h"
+#include "geometry.h"
+#include <string>
+#include <vector>
+
+class MaterialDescription;
+
+/**
+ *  One Drude, Lorentz or Debye pole of a dispersive material, updated as an
+ *  auxiliary differential equation for its polarization P and polarization
+ *  current J = dP/dt:
+ *
+ *  \f[
+ *      \mbox{Drude:} \quad \dot{J} + \gamma J = \epsilon_0 \omega_p^2 E
+ *  \f]
+ *  \f[
+ *      \mbox{Lorentz:} \quad \dot{J} + \gamma J + \omega_0^2 P =
+ *          \epsilon_0 \Delta\epsilon \omega_0^2 E
+ *  \f]
+ *  \f[
+ *      \mbox{Debye:} \quad \tau \dot{P} + P = \epsilon_0 \Delta\epsilon E
+ *  \f]
+ *
+ *  P and E live on whole timesteps and J on half timesteps.  Every pole is
+ *  updated the same way,
+ *
+ *      J(n+1/2) = cJ*J(n-1/2) + cP*P(n) + cE*E(n)
+ *      P(n+1) = P(n) + dt*J(n+1/2)
+ *
+ *  and the J of all the poles goes into the update of E(n+1).  A Drude pole
+ *  has the same constants as DrudeModel1 with gamma = 1/tauc.
+ *
+ *  In the material params, pole N (counting from 1) is given by "poleN",
+ *  which is Drude, Lorentz or Debye, and its parameters with N on the end:
+ *
+ *      Drude       omegapN, gammaN         (rad/s)
+ *      Lorentz     deltaepsN, omegaN, gammaN
+ *      Debye       deltaepsN, tauN         (s)
+ */
+class DispersivePole
+{
+public:
+    enum PoleType
+    {
+        kDrude,
+        kLorentz,
+        kDebye
+    };
+    
+    DispersivePole();
+    DispersivePole(PoleType type, float deltaEps, float omega, float gamma,
+        float tau, float dt);
+    
+    /**
+     *  Read pole number poleNum from the params of a material.  Throws an
+     *  Exception if the type is unknown or a parameter is missing.
+     */
+    static DispersivePole read(const Map<std::string, std::string> & params,
+        int poleNum, float dt) throw(Exception);
+    
+    /**
+     *  @returns the number of poles in the params, i.e. the number of keys
+     *  pole1, pole2, ... in a row
+     */
+    static int numPoles(const Map<std::string, std::string> & params);
+    
+    // The most poles MaterialFactory will make a MultiPoleModel for.
+    static const int MAXPOLES = 6;
+    
+    PoleType type() const { return mType; }
+    float cJ() const { return m_cJ; }
+    float cP() const { return m_cP; }
+    float cE() const { return m_cE; }
+    
+private:
+    PoleType mType;
+    float m_cJ, m_cP, m_cE;
+};
+
+/**
+ *  Dispersive material with NUMPOLES Drude, Lorentz and Debye poles (see
+ *  DispersivePole) on top of a background permittivity epsinf, e.g. a metal
+ *  fitted over a wide band.  MaterialFactory makes one of these for each
+ *  number of poles up to DispersivePole::MAXPOLES.
+ *
+ *  The J and P of the poles for each field direction are kept in one array,
+ *  pole by pole, J then P, each as a run of all the cells of the material in
+ *  aux index order.  The block update goes down each run with the vector
+ *  kernels, so adding a pole adds two streams and no gathering.
+ */
+template<int NUMPOLES>
+class MultiPoleModel : public Material
+{
+public:
+    MultiPoleModel(
+        const MaterialDescription & descrip,
+        std::vector<long> numCellsE, std::vector<long> numCellsH,
+        Vector3f dxyz, float dt);
+    
+    virtual ~MultiPoleModel() {}
+    
+    std::string modelName() const;
+    void writeJ(int direction, std::ostream & binaryStream,
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
+    void writeP(int direction, std::ostream & binaryStream,
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
+    void allocateAuxBuffers();
+    
+    static const bool VECTORIZED = true;
+    
+    struct LocalDataE
+    {
+        float ce;
+        float dt;
+        float cJ[NUMPOLES];
+        float cP[NUMPOLES];
+        float cE[NUMPOLES];
+        AuxStorage* state; // J of the first pole at this cell
+        long stride; // from the J of one pole to its P, and to the next pole
+        float sumJ; // from beforeUpdateE, for updateE
+    };
+    
+    struct LocalDataH
+    {
+        float ch;
+    };
+    
+    void initLocalE(LocalDataE & data);
+    void onStartRunlineE(LocalDataE & data, const SimpleAuxRunline & rl,
+        int dir);
+    void beforeUpdateE(LocalDataE & data, float Ei, float dHj, float dHk);
+    float updateE(LocalDataE & data, int dir, float Ei, float dHj, float dHk,
+        float Ji);
+    void afterUpdateE(LocalDataE & data, float Ei, float dHj, float dHk);
+    
+    void updateE(LocalDataE & data, int dir, FieldStorage* Ei, const float* dHj,
+        const float* dHk, const float* Ji, int len);
+    
+    void initLocalH(LocalDataH & data);
+    void onStartRunlineH(LocalDataH & data, const SimpleAuxRunline & rl,
+        int dir);
+    void beforeUpdateH(LocalDataH & data, float Hi, float dEj, float dEk);
+    float updateH(LocalDataH & data, int dir, float Hi, float dEj, float dEk,
+        float Ki);
+    void afterUpdateH(LocalDataH & data, float Hi, float dEj, float dEk);
+    
+    void updateH(LocalDataH & data, int dir, FieldStorage* Hi, const float* dEj,
+        const float* dEk, const float* Ki, int len);
+    
+private:
+    void writeSum(int direction, int firstRun, std::ostream & binaryStream,
+        long startingIndex, long length) const;
+    
+    Vector3f mDxyz;
+    float mDt;
+    
+    float m_epsrinf;
+    float m_mur;
+    DispersivePole mPoles[NUMPOLES];
+    
+    float m_ce, m_ch;
+    
+    long mNumCellsE[3];
+    AuxArray mState[3];
+    MemoryBufferPtr mStateBuffers[3];
+};
+
+#include "MultiPoleModel-inl.h"
+
+#endif
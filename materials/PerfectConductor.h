@@ -33,6 +33,10 @@ public:
     virtual void calcEPhase(int phasePart = 0);
     virtual void calcHPhase(int phasePart = 0);
     
+    // there is nothing to update, in any plane.
+    virtual bool tilesByPlanes(const InterleavedLattice & lattice) const
+        { return 1; }
+    
     virtual long numRunlinesE() const { return mNumRunlinesE; }
     virtual long numRunlinesH() const { return mNumRunlinesH; }
     virtual long numHalfCellsE() const { return mNumHalfCellsE; }
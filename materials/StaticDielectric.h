@@ -13,6 +13,7 @@
 #include "Material.h"
 #include "BulkSetupMaterials.h"
 #include "SetupModularUpdateEquation.h"
+#include "VectorKernels.h"
 #include <string>
 #include "Log.h"
 
@@ -30,6 +31,8 @@ public:
     
     void allocateAuxBuffers();
     
+    static const bool VECTORIZED = true;
+    
     struct LocalDataE
     {
         float ce1;
@@ -47,6 +50,10 @@ public:
         float Ji);
     void afterUpdateE(LocalDataE & data, float Ei, float dHj, float dHk);
     
+    // Block update of len cells, used instead of the three functions above.
+    void updateE(LocalDataE & data, int dir, FieldStorage* Ei, const float* dHj,
+        const float* dHk, const float* Ji, int len);
+    
     void initLocalH(LocalDataH & data);
     void onStartRunlineH(LocalDataH & data, const SimpleRunline & rl, int dir);
     void beforeUpdateH(LocalDataH & data, float Hi, float dEj, float dEk);
@@ -54,6 +61,9 @@ public:
         float Ki);
     void afterUpdateH(LocalDataH & data, float Hi, float dEj, float dEk);
     
+    void updateH(LocalDataH & data, int dir, FieldStorage* Hi, const float* dEj,
+        const float* dEk, const float* Ki, int len);
+    
 private:
     Vector3f mDxyz;
     float mDt;
@@ -92,6 +102,13 @@ afterUpdateE(LocalDataE & data, float Ei, float dHj, float dHk)
 {
 }
 
+inline void StaticDielectric::
+updateE(LocalDataE & data, int dir, FieldStorage* Ei, const float* dHj,
+    const float* dHk, const float* Ji, int len)
+{
+    VectorKernels::staticUpdate(Ei, data.ce1, dHk, dHj, Ji, len);
+}
+
 inline void StaticDielectric::
 initLocalH(LocalDataH & data)
 {
@@ -119,6 +136,13 @@ afterUpdateH(LocalDataH & data, float Hi, float dEj, float dEk)
 {
 }
 
+inline void StaticDielectric::
+updateH(LocalDataH & data, int dir, FieldStorage* Hi, const float* dEj,
+    const float* dEk, const float* Ki, int len)
+{
+    VectorKernels::staticUpdate(Hi, data.ch1, dEj, dEk, Ki, len);
+}
+
 
 
 
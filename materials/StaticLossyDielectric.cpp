@@ -48,7 +48,7 @@ modelName() const
 
 void StaticLossyDielectric::
 writeJ(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     for (int rr = 0; rr < length; rr++)
     {
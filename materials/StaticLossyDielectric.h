@@ -35,9 +35,11 @@ public:
      * cotemporal with \f$E\f$.
      */
     void writeJ(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
 //    void writeP(int direction, std::ostream & binaryStream,
-//        long startingIndex, const float* startingField, long length) const;
+//        long startingIndex, const FieldStorage* startingField,
+//        long length) const;
     
     void allocateAuxBuffers() {}
     
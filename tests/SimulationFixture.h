@@ -0,0 +1,66 @@
+/*
+ *  SimulationFixture.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _SIMULATIONFIXTURE_
+#define _SIMULATIONFIXTURE_
+
+#include "FDTDApplication.h"
+#include "Exception.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Whole simulations for the tests and benchmarks: write a parameter file,
+ * run it through FDTDApplication and read back the binary float outputs.
+ * Each simulation writes its parameters to name + ".xml" in the working
+ * directory, so give tests that may run side by side different names.
+ */
+namespace SimulationFixture
+{
+
+inline void
+run(const std::string & xml, const std::string & name,
+    const SimulationPreferences & prefs = SimulationPreferences())
+{
+    std::string paramFile = name + ".xml";
+    std::ofstream file(paramFile.c_str());
+    file << xml;
+    file.close();
+    if (!file.good())
+        throw(Exception(std::string("Could not write ") + paramFile));
+
+    FDTDApplication::instance().runNew(paramFile, prefs);
+}
+
+inline std::vector<float>
+read(const std::string & fileName, long numValues)
+{
+    std::vector<float> values(numValues);
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    file.read((char*)&values[0], numValues*sizeof(float));
+    if (!file.good())
+        throw(Exception(std::string("Could not read ") + fileName));
+    return values;
+}
+
+// Run the simulation and return the first numValues floats of its output
+// file outputName.
+inline std::vector<float>
+run(const std::string & xml, const std::string & outputName,
+    long numValues,
+    const SimulationPreferences & prefs = SimulationPreferences())
+{
+    run(xml, outputName, prefs);
+    return read(outputName, numValues);
+}
+
+}; // namespace SimulationFixture
+
+#endif
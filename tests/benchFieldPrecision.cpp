@@ -0,0 +1,127 @@
+// Throughput of the update with the field storage type of the build, i.e.
+// what trogdor_double costs relative to trogdor.  tests/CMakeLists.txt builds
+// this file twice, as benchFieldPrecision (float) and
+// benchFieldPrecision_double (TROGDOR_STORAGE_DOUBLE); run both with the same
+// arguments and compare.
+//
+// It times the block kernels of VectorKernels.h that the update equations
+// call, over arrays too big for the cache, and then a whole simulation in
+// vacuum with a PML all round through FDTDApplication, which is
+// ModularUpdateEquation with StaticDielectric and CFSRIPML.
+//
+// usage: benchFieldPrecision [numYeeCells [numTimesteps]]
+
+#include "SimulationFixture.h"
+#include "FieldStorage.h"
+#include "VectorKernels.h"
+#include <sys/time.h>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+static double
+microseconds()
+{
+    timeval tv;
+    gettimeofday(&tv, 0L);
+    return 1e6*tv.tv_sec + tv.tv_usec;
+}
+
+// One component of the E update of a block-path runline in the PML: the two
+// curl differences, the PML current along one direction, and the update.
+// Returns millions of cells per second.
+static double
+runKernels(long numCells, int numT)
+{
+    const int BLOCK = VectorKernels::BLOCK_LENGTH;
+    vector<FieldStorage> E(numCells), Hj(numCells+1), Hk(numCells+1),
+        accum(numCells);
+    vector<float> cCurl(BLOCK, 0.5f), cAccumCurl(BLOCK, 0.1f),
+        cAccumJ(BLOCK, 0.2f);
+    float dHj[BLOCK], dHk[BLOCK], J[BLOCK];
+
+    for (long nn = 0; nn <= numCells; nn++)
+    {
+        Hj[nn] = float(nn%17)*1e-3f;
+        Hk[nn] = float(nn%13)*1e-3f;
+    }
+
+    double t0 = 0;
+    for (int n = -1; n < numT; n++) // the first pass touches all the pages
+    {
+        if (n == 0)
+            t0 = microseconds();
+        for (long start = 0; start < numCells; start += BLOCK)
+        {
+            int len = (numCells - start < BLOCK) ? numCells - start : BLOCK;
+            FieldStorage* a = &accum[start];
+            const float* c0 = &cCurl[0];
+            const float* c1 = &cAccumCurl[0];
+            const float* c2 = &cAccumJ[0];
+            VectorKernels::difference(&Hj[start], &Hj[start+1], 1.0f, dHj,
+                len);
+            VectorKernels::difference(&Hk[start], &Hk[start+1], 1.0f, dHk,
+                len);
+            VectorKernels::pmlUpdate(a, c0, c1, c2, dHk, 1.0f, J, len);
+            VectorKernels::staticUpdate(&E[start], 0.5f, dHk, dHj, J, len);
+        }
+    }
+    double t1 = microseconds();
+
+    return double(numCells)*numT/(t1-t0);
+}
+
+// A cube of vacuum, ten cells of PML on each side, with a source in the
+// middle.  Returns millions of Yee cells per second over the timesteps, not
+// counting setup.
+static double
+runSimulation(int numYee, int numT)
+{
+    int n = numYee - 1;
+    int c = numYee/2;
+
+    ostringstream xml;
+    xml << "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"" << numT + 1 << "\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Grid name=\"Main\" nx=\"" << numYee << "\" ny=\"" << numYee <<
+        "\" nz=\"" << numYee << "\" nonPML=\"10 10 10 " << n-10 << " " <<
+        n-10 << " " << n-10 << "\">\n"
+        "<AdditiveSource fields=\"ez\" formula=\"exp(-1*(n-20)^2/25)\">"
+        "<Region yeeCells=\"" << c << " " << c << " " << c << " " << c <<
+        " " << c << " " << c << "\"/></AdditiveSource>\n"
+        "<Assembly><Block yeeCells=\"0 0 0 " << n << " " << n << " " << n <<
+        "\" material=\"Vacuum\"/></Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n";
+    SimulationFixture::run(xml.str(), "benchFieldPrecision");
+
+    return double(numYee)*numYee*numYee*numT/
+        FDTDApplication::instance().performance().runCalculationMicroseconds();
+}
+
+int main(int argc, char* argv[])
+{
+    int numCells = 160;
+    int numT = 20;
+    if (argc > 1)
+        numCells = atoi(argv[1]);
+    if (argc > 2)
+        numT = atoi(argv[2]);
+
+    cout << numCells << "^3 Yee cells, " << numT << " timesteps, "
+        << sizeof(FieldStorage) << "-byte fields, vector width "
+        << TROGDOR_VECTOR_WIDTH << "\n";
+
+    double kernelRate = runKernels(long(numCells)*numCells*numCells, numT);
+    cout << "PML block kernels: " << kernelRate << " Mcells/s\n";
+
+    double simRate = runSimulation(numCells, numT);
+    cout << "whole simulation:  " << simRate << " Mcells/s\n";
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Cost of copying and releasing Pointers with many objects alive, as in setup
+// (voxelizing, building partitions) on models with thousands of Paints and
+// InstructionPtrs.  Compares Pointer.h with the map of reference counts it
+// used to keep, reproduced below as MapPointer.
+//
+// usage: benchPointer [numObjects [numPasses]]
+
+#include "Pointer.h"
+#include "Map.h"
+#include <boost/thread/mutex.hpp>
+#include <sys/time.h>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static double
+microseconds()
+{
+    timeval tv;
+    gettimeofday(&tv, 0L);
+    return 1e6*tv.tv_sec + tv.tv_usec;
+}
+
+// The old Pointer: reference counts in one map per type, behind a mutex.
+template<typename T>
+class MapPointer
+{
+public:
+    MapPointer() : mPtr(0L) {}
+    explicit MapPointer(T* ptr) : mPtr(ptr) { increment(); }
+    MapPointer(const MapPointer<T> & src) : mPtr(src.mPtr) { increment(); }
+    ~MapPointer() { decrement(); }
+    
+    MapPointer<T>& operator=(const MapPointer<T> & rhs)
+    {
+        if (rhs.mPtr == mPtr)
+            return *this;
+        decrement();
+        mPtr = rhs.mPtr;
+        increment();
+        return *this;
+    }
+    
+private:
+    void increment()
+    {
+        if (mPtr != 0L)
+        {
+            boost::mutex::scoped_lock lock(sMutex);
+            sReferenceCounts[mPtr]++;
+        }
+    }
+    
+    void decrement()
+    {
+        if (mPtr != 0L)
+        {
+            bool shouldDelete;
+            {
+                boost::mutex::scoped_lock lock(sMutex);
+                shouldDelete = (--sReferenceCounts[mPtr] == 0);
+            }
+            if (shouldDelete)
+                delete mPtr;
+        }
+    }
+    
+    T* mPtr;
+    static Map<T*, int> sReferenceCounts;
+    static boost::mutex sMutex;
+};
+
+template<typename T>
+Map<T*, int> MapPointer<T>::sReferenceCounts;
+
+template<typename T>
+boost::mutex MapPointer<T>::sMutex;
+
+struct Thing
+{
+    int mValue;
+};
+
+// Make the objects, then copy the whole list and assign over the copies
+// numPasses times, like handing lists of Paints and instructions around.
+template<class P>
+static double
+timePasses(int numObjects, int numPasses)
+{
+    double t0 = microseconds();
+    vector<P> things;
+    for (int nn = 0; nn < numObjects; nn++)
+        things.push_back(P(new Thing));
+    
+    for (int pass = 0; pass < numPasses; pass++)
+    {
+        vector<P> copies(things);
+        for (int nn = 0; nn < numObjects; nn++)
+            copies[nn] = things[numObjects-1-nn];
+    }
+    things.clear();
+    return microseconds() - t0;
+}
+
+int
+main(int argc, char* argv[])
+{
+    int numObjects = 10000;
+    int numPasses = 100;
+    if (argc > 1)
+        numObjects = atoi(argv[1]);
+    if (argc > 2)
+        numPasses = atoi(argv[2]);
+    
+    cout << numObjects << " objects, " << numPasses << " passes\n";
+    
+    double tMap = timePasses<MapPointer<Thing> >(numObjects, numPasses);
+    double tPointer = timePasses<Pointer<Thing> >(numObjects, numPasses);
+    
+    // Each pass is a copy, an assignment and a destruction per object.
+    double numOps = 3.0*numObjects*numPasses;
+    cout << "map of counts:   " << tMap*1e3/numOps << " ns per operation\n";
+    cout << "shared counts:   " << tPointer*1e3/numOps
+        << " ns per operation\n";
+    cout << "speedup:         " << tMap/tPointer << "\n";
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Throughput of temporal blocking against the untiled sweep, one timestep at
+// a time over the whole grid.
+//
+// The simulation is a cube of vacuum with ten cells of PML on each side and a
+// source in the middle that is on for the first 40 timesteps; the only output
+// is at the end.  It runs once stepped and then with blocks of a few sizes.
+// Besides Yee cells per second it prints the memory traffic the untiled sweep
+// would need for the same rate, counting each of the six field components
+// read and written once per timestep, which shows how far a blocked run gets
+// past the memory bandwidth.
+//
+// usage: benchTemporalBlocking [numYeeCells [numTimesteps [numThreads]]]
+
+#include "SimulationFixture.h"
+#include "FieldStorage.h"
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+// Returns millions of Yee cells per second over the timesteps, not counting
+// setup.
+static double
+runSimulation(int numYee, int numT, int timeBlock, int numThreads)
+{
+    int n = numYee - 1;
+    int c = numYee/2;
+
+    ostringstream xml;
+    xml << "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"" << numT + 1 << "\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Grid name=\"Main\" nx=\"" << numYee << "\" ny=\"" << numYee <<
+        "\" nz=\"" << numYee << "\" nonPML=\"10 10 10 " << n-10 << " " <<
+        n-10 << " " << n-10 << "\">\n"
+        "<AdditiveSource fields=\"ez\" formula=\"exp(-1*(n-20)^2/25)\">"
+        "<Region yeeCells=\"" << c << " " << c << " " << c << " " << c <<
+        " " << c << " " << c << "\"/>"
+        "<Duration firstTimestep=\"0\" lastTimestep=\"40\"/>"
+        "</AdditiveSource>\n"
+        "<FieldOutput fields=\"ez\" file=\"benchTemporalBlocking.ez\">"
+        "<Region yeeCells=\"" << c << " " << c << " " << c << " " << c <<
+        " " << c << " " << c << "\"/>"
+        "<Duration timestep=\"" << numT << "\"/></FieldOutput>\n"
+        "<Assembly><Block yeeCells=\"0 0 0 " << n << " " << n << " " << n <<
+        "\" material=\"Vacuum\"/></Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n";
+
+    SimulationPreferences prefs;
+    prefs.timeBlockTimesteps = timeBlock;
+    prefs.numThreads = numThreads;
+    SimulationFixture::run(xml.str(), "benchTemporalBlocking", prefs);
+
+    return double(numYee)*numYee*numYee*numT/
+        FDTDApplication::instance().performance().runCalculationMicroseconds();
+}
+
+static void
+report(const string & name, double rate)
+{
+    // Mcells/s times bytes per cell is MB/s; report GB/s.
+    double bytesPerCell = 12.0*sizeof(FieldStorage);
+    cout << name << rate << " Mcells/s, "
+        << rate*bytesPerCell*1e-3 << " GB/s untiled equivalent\n";
+}
+
+int main(int argc, char* argv[])
+{
+    int numCells = 128;
+    int numT = 200;
+    int numThreads = 1;
+    if (argc > 1)
+        numCells = atoi(argv[1]);
+    if (argc > 2)
+        numT = atoi(argv[2]);
+    if (argc > 3)
+        numThreads = atoi(argv[3]);
+
+    cout << numCells << "^3 Yee cells, " << numT << " timesteps, "
+        << numThreads << " threads, " << sizeof(FieldStorage)
+        << "-byte fields\n";
+
+    double stepped = runSimulation(numCells, numT, 0, numThreads);
+    report("untiled sweep:   ", stepped);
+
+    const int blockSizes[] = { 4, 8, 16 };
+    for (int bb = 0; bb < 3; bb++)
+    {
+        double blocked = runSimulation(numCells, numT, blockSizes[bb],
+            numThreads);
+        ostringstream name;
+        name << "blocks of " << blockSizes[bb] << ":    ";
+        if (blockSizes[bb] < 10)
+            name << " ";
+        report(name.str(), blocked);
+    }
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Test AsyncFileWriter.cpp
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test AsyncFileWriter
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "AsyncFileWriter.h"
+#include "Exception.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const int NUMSAMPLES = 50;
+static const int SAMPLELENGTH = 1000;
+
+static FileWriterThreadPtr
+writerThread(int numBuffers)
+{
+    if (numBuffers == 0)
+        return FileWriterThreadPtr(0L);
+    return FileWriterThreadPtr(new FileWriterThread(numBuffers));
+}
+
+// Read back a file written by writeSamples().
+static bool
+readBack(const string & fileName)
+{
+    ifstream file(fileName.c_str(), ios::binary);
+    vector<float> values(NUMSAMPLES*SAMPLELENGTH + 1);
+    file.read((char*)&values[0], values.size()*sizeof(float));
+    remove(fileName.c_str());
+
+    if (file.gcount() != NUMSAMPLES*SAMPLELENGTH*sizeof(float))
+        return 0;
+    for (int nn = 0; nn < NUMSAMPLES*SAMPLELENGTH; nn++)
+    if (values[nn] != nn)
+        return 0;
+    return 1;
+}
+
+// Write NUMSAMPLES samples with numBuffers staging buffers, then read them
+// back and check that they are all there in order.
+static bool
+writeAndReadBack(int numBuffers)
+{
+    const string fileName("testAsyncFileWriter.dat");
+    {
+        AsyncFileWriter writer(fileName, writerThread(numBuffers));
+        for (int nn = 0; nn < NUMSAMPLES; nn++)
+        {
+            vector<float> & sample(writer.beginSample());
+            BOOST_CHECK_EQUAL(sample.size(), 0);
+            for (int mm = 0; mm < SAMPLELENGTH; mm++)
+                sample.push_back(nn*SAMPLELENGTH + mm);
+            writer.endSample();
+        }
+    }
+    return readBack(fileName);
+}
+
+BOOST_AUTO_TEST_CASE(synchronous)
+{
+    BOOST_CHECK(writeAndReadBack(0));
+}
+
+BOOST_AUTO_TEST_CASE(doubleBuffered)
+{
+    BOOST_CHECK(writeAndReadBack(1));
+    BOOST_CHECK(writeAndReadBack(2));
+    BOOST_CHECK(writeAndReadBack(8));
+}
+
+BOOST_AUTO_TEST_CASE(sharedThread)
+{
+    // Three files take turns with the one buffer of one thread.
+    FileWriterThreadPtr thread(writerThread(1));
+    const string fileNames[3] = { "testAsyncFileWriter0.dat",
+        "testAsyncFileWriter1.dat", "testAsyncFileWriter2.dat" };
+    {
+        vector<AsyncFileWriterPtr> writers;
+        for (int ff = 0; ff < 3; ff++)
+            writers.push_back(AsyncFileWriterPtr(
+                new AsyncFileWriter(fileNames[ff], thread)));
+        for (int nn = 0; nn < NUMSAMPLES; nn++)
+        for (int ff = 0; ff < 3; ff++)
+        {
+            vector<float> & sample(writers[ff]->beginSample());
+            BOOST_CHECK_EQUAL(sample.size(), 0);
+            for (int mm = 0; mm < SAMPLELENGTH; mm++)
+                sample.push_back(nn*SAMPLELENGTH + mm);
+            writers[ff]->endSample();
+        }
+    }
+    BOOST_CHECK_EQUAL(thread->numBuffers(), 1);
+    for (int ff = 0; ff < 3; ff++)
+        BOOST_CHECK(readBack(fileNames[ff]));
+}
+
+BOOST_AUTO_TEST_CASE(flushQueue)
+{
+    const string fileName("testAsyncFileWriter.dat");
+    AsyncFileWriter writer(fileName, writerThread(4));
+    for (int nn = 0; nn < 3; nn++)
+    {
+        writer.beginSample().assign(SAMPLELENGTH, 1.0f);
+        writer.endSample();
+    }
+    writer.flush();
+
+    ifstream file(fileName.c_str(), ios::binary | ios::ate);
+    BOOST_CHECK_EQUAL(long(file.tellg()), 3*SAMPLELENGTH*sizeof(float));
+    remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(badFile)
+{
+    BOOST_CHECK_THROW(AsyncFileWriter("no/such/directory/file",
+        writerThread(2)),
+        Exception);
+}
+
+BOOST_AUTO_TEST_CASE(chunkedFile)
+{
+    const string fileName("testAsyncFileWriter.dat");
+    {
+        ChunkedFileWriterPtr chunked(new ChunkedFileWriter(fileName,
+            string("spec\n"), 300));
+        AsyncFileWriter writer(chunked, writerThread(2));
+        for (int nn = 0; nn < NUMSAMPLES; nn++)
+        {
+            vector<float> & sample(writer.beginSample());
+            for (int mm = 0; mm < SAMPLELENGTH; mm++)
+                sample.push_back(nn*SAMPLELENGTH + mm);
+            writer.endSample();
+        }
+    }
+
+    ChunkedFileReader reader(fileName);
+    BOOST_REQUIRE_EQUAL(reader.numSamples(), NUMSAMPLES);
+    vector<float> values;
+    bool same = 1;
+    for (int nn = 0; nn < NUMSAMPLES; nn++)
+    {
+        reader.readSample(nn, values);
+        same = same && values.size() == SAMPLELENGTH;
+        for (int mm = 0; mm < values.size(); mm++)
+            same = same && values[mm] == nn*SAMPLELENGTH + mm;
+    }
+    BOOST_CHECK(same);
+    remove(fileName.c_str());
+}
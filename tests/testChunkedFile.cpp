@@ -0,0 +1,306 @@
+// Test LZCodec.cpp, ErrorBoundedCodec.cpp and ChunkedFile.cpp
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test ChunkedFile
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "ChunkedFile.h"
+#include "LZCodec.h"
+#include "ErrorBoundedCodec.h"
+#include "Exception.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const string FILENAME("testChunkedFile.dat");
+
+// A smooth field with a zero background, like most output samples.
+static vector<float>
+fieldSample(long length, int timestep)
+{
+    vector<float> values(length, 0.0f);
+    for (long nn = length/4; nn < length/2; nn++)
+        values[nn] = sin(0.01f*nn + 0.3f*timestep);
+    return values;
+}
+
+static bool
+roundTrip(const vector<unsigned char> & data, long & compressedBytes)
+{
+    vector<unsigned char> compressed(
+        LZCodec::maxCompressedBytes(data.size()));
+    vector<unsigned char> decompressed(data.size());
+    compressedBytes = LZCodec::compress(data.size() ? &data[0] : 0L,
+        data.size(), &compressed[0], compressed.size());
+    return compressedBytes > 0 &&
+        LZCodec::decompress(&compressed[0], compressedBytes,
+            data.size() ? &decompressed[0] : 0L, data.size()) &&
+        decompressed == data;
+}
+
+BOOST_AUTO_TEST_CASE(codecRoundTrip)
+{
+    long compressedBytes;
+    vector<unsigned char> data;
+    BOOST_CHECK(roundTrip(data, compressedBytes));
+
+    // Long runs need the extra length bytes.
+    data.assign(100000, 0);
+    BOOST_CHECK(roundTrip(data, compressedBytes));
+    BOOST_CHECK(compressedBytes < 1000);
+
+    // Noise doesn't compress but must still round trip.
+    srand(1);
+    for (int nn = 0; nn < data.size(); nn++)
+        data[nn] = rand() & 0xff;
+    BOOST_CHECK(roundTrip(data, compressedBytes));
+
+    // Short repeats, with matches that overlap their own output.
+    for (int nn = 0; nn < data.size(); nn++)
+        data[nn] = "abcab"[nn%5] + (nn%997 == 0);
+    BOOST_CHECK(roundTrip(data, compressedBytes));
+    BOOST_CHECK(compressedBytes < data.size()/10);
+
+    // Corrupt blocks are refused.
+    unsigned char bad[] = { 0x0f, 0x01, 0x00 };
+    unsigned char out[32];
+    BOOST_CHECK(!LZCodec::decompress(bad, 3, out, 32));
+}
+
+BOOST_AUTO_TEST_CASE(shuffleBytes)
+{
+    vector<float> values(fieldSample(1000, 0));
+    vector<unsigned char> shuffled(values.size()*sizeof(float));
+    vector<float> unshuffled(values.size());
+    LZCodec::shuffle((unsigned char*)&values[0], values.size(), sizeof(float),
+        &shuffled[0]);
+    LZCodec::unshuffle(&shuffled[0], values.size(), sizeof(float),
+        (unsigned char*)&unshuffled[0]);
+    BOOST_CHECK(unshuffled == values);
+}
+
+// A smooth volume, like a field snapshot with a wave in it.
+static vector<float>
+volumeSample(int nx, int ny, int nz, int timestep)
+{
+    vector<float> values;
+    for (int kk = 0; kk < nz; kk++)
+    for (int jj = 0; jj < ny; jj++)
+    for (int ii = 0; ii < nx; ii++)
+        values.push_back(cos(0.07f*ii - 0.2f*timestep) *
+            exp(-0.002f*((jj-ny/2)*(jj-ny/2) + (kk-nz/2)*(kk-nz/2))));
+    return values;
+}
+
+static double
+maxDifference(const vector<float> & a, const vector<float> & b)
+{
+    double maxDiff = 0.0;
+    for (long nn = 0; nn < a.size(); nn++)
+        maxDiff = max(maxDiff, fabs((double)a[nn] - b[nn]));
+    return maxDiff;
+}
+
+BOOST_AUTO_TEST_CASE(errorBoundedCodec)
+{
+    vector<float> values(volumeSample(60, 40, 30, 0));
+    vector<unsigned char> compressed(
+        ErrorBoundedCodec::maxCompressedBytes(values.size(), 2));
+    vector<float> decompressed(values.size());
+    
+    // Two pieces of the volume, as if cut by a chunk boundary.
+    vector<ErrorBoundedCodec::Segment> segments;
+    segments.push_back(ErrorBoundedCodec::Segment(5000, 60, 2400, 0));
+    segments.push_back(ErrorBoundedCodec::Segment(values.size()-5000, 60,
+        2400, 5000));
+    
+    const double bounds[] = { 1e-2, 1e-4, 1e-6 };
+    for (int bb = 0; bb < 3; bb++)
+    {
+        double maxError;
+        long bytes = ErrorBoundedCodec::compress(&values[0], segments,
+            bounds[bb], &compressed[0], compressed.size(), maxError);
+        BOOST_REQUIRE(bytes > 0);
+        BOOST_REQUIRE(ErrorBoundedCodec::decompress(&compressed[0], bytes,
+            &decompressed[0], decompressed.size()));
+        BOOST_CHECK(maxDifference(values, decompressed) <= bounds[bb]);
+        BOOST_CHECK_EQUAL(maxDifference(values, decompressed), maxError);
+        BOOST_TEST_MESSAGE("bound " << bounds[bb] << " ratio " <<
+            double(values.size()*sizeof(float))/bytes);
+        if (bb == 0)
+            BOOST_CHECK(bytes*20 < values.size()*sizeof(float));
+    }
+    
+    // Values that can't be predicted are kept exactly.
+    values[10] = 1e30f;
+    values[11] = -FLT_MAX;
+    values[500] = 1.0f/0.0f;
+    double maxError;
+    long bytes = ErrorBoundedCodec::compress(&values[0], values.size(), 1e-3,
+        &compressed[0], compressed.size(), maxError);
+    BOOST_REQUIRE(bytes > 0);
+    BOOST_REQUIRE(ErrorBoundedCodec::decompress(&compressed[0], bytes,
+        &decompressed[0], decompressed.size()));
+    BOOST_CHECK_EQUAL(decompressed[10], values[10]);
+    BOOST_CHECK_EQUAL(decompressed[11], values[11]);
+    BOOST_CHECK_EQUAL(decompressed[500], values[500]);
+    BOOST_CHECK(maxError <= 1e-3);
+    values[10] = values[11] = values[500] = 0.0f;
+    decompressed[10] = decompressed[11] = decompressed[500] = 0.0f;
+    BOOST_CHECK(maxDifference(values, decompressed) <= 1e-3);
+    
+    // Truncated blocks are refused.
+    BOOST_CHECK(!ErrorBoundedCodec::decompress(&compressed[0], bytes/2,
+        &decompressed[0], decompressed.size()));
+}
+
+BOOST_AUTO_TEST_CASE(errorBoundedFile)
+{
+    const int numSamples = 4;
+    const double relativeBound = 1e-3;
+    double maxError;
+    long rawBytes, storedBytes;
+    {
+        ChunkedFileWriter writer(FILENAME, string(""), 10000);
+        writer.setErrorBound(relativeBound, 1);
+        writer.setArrays(vector<Vector3i>(1, Vector3i(50, 50, 50)));
+        for (int tt = 0; tt < numSamples; tt++)
+        {
+            vector<float> values(volumeSample(50, 50, 50, tt));
+            writer.writeSample(&values[0], values.size());
+        }
+        // All one value: no range, so it's stored exactly.
+        vector<float> flat(1000, 3.0f);
+        writer.writeSample(&flat[0], flat.size());
+        
+        maxError = writer.maxError();
+        rawBytes = writer.rawBytes();
+        storedBytes = writer.storedBytes();
+    }
+    BOOST_TEST_MESSAGE("lossy: compressed " << rawBytes << " to " <<
+        storedBytes << ", max error " << maxError);
+    BOOST_CHECK(storedBytes*10 < rawBytes);
+    
+    ChunkedFileReader reader(FILENAME);
+    BOOST_REQUIRE_EQUAL(reader.numSamples(), numSamples+1);
+    vector<float> values;
+    for (int tt = 0; tt < numSamples; tt++)
+    {
+        vector<float> original(volumeSample(50, 50, 50, tt));
+        float lo = *min_element(original.begin(), original.end());
+        float hi = *max_element(original.begin(), original.end());
+        reader.readSample(tt, values);
+        BOOST_CHECK(maxDifference(original, values) <=
+            relativeBound*((double)hi - lo));
+        BOOST_CHECK(maxDifference(original, values) <= maxError);
+    }
+    reader.readSample(numSamples, values);
+    BOOST_CHECK(values == vector<float>(1000, 3.0f));
+    remove(FILENAME.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(writeAndRead)
+{
+    const long chunkLength = 1000;
+    const int numSamples = 6;
+    const long lengths[numSamples] = { 5000, 2500, 0, 999, 1000, 1001 };
+    long rawBytes, storedBytes;
+    {
+        ChunkedFileWriter writer(FILENAME, string("spec text\n"),
+            chunkLength);
+        for (int tt = 0; tt < numSamples; tt++)
+        {
+            vector<float> values(fieldSample(lengths[tt], tt));
+            writer.writeSample(values.size() ? &values[0] : 0L,
+                values.size());
+        }
+        rawBytes = writer.rawBytes();
+        storedBytes = writer.storedBytes();
+    }
+    BOOST_TEST_MESSAGE("compressed " << rawBytes << " to " << storedBytes);
+    BOOST_CHECK(storedBytes < rawBytes/2);
+
+    BOOST_CHECK(ChunkedFileReader::isChunkedFile(FILENAME));
+    ChunkedFileReader reader(FILENAME);
+    BOOST_CHECK_EQUAL(reader.metadata(), string("spec text\n"));
+    BOOST_CHECK_EQUAL(reader.chunkLength(), chunkLength);
+    BOOST_REQUIRE_EQUAL(reader.numSamples(), numSamples);
+
+    vector<float> values;
+    for (int tt = 0; tt < numSamples; tt++)
+    {
+        BOOST_CHECK_EQUAL(reader.sampleLength(tt), lengths[tt]);
+        reader.readSample(tt, values);
+        BOOST_CHECK(values == fieldSample(lengths[tt], tt));
+    }
+
+    // Read across chunk boundaries, backwards through the file.
+    vector<float> whole(fieldSample(5000, 0));
+    reader.read(0, 1990, 1020, values);
+    BOOST_CHECK(values == vector<float>(whole.begin()+1990,
+        whole.begin()+3010));
+    reader.read(0, 4999, 1, values);
+    BOOST_CHECK_EQUAL(values[0], whole[4999]);
+
+    BOOST_CHECK_THROW(reader.read(0, 4999, 2, values), Exception);
+    remove(FILENAME.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(missingIndex)
+{
+    const long chunkLength = 100;
+    {
+        ChunkedFileWriter writer(FILENAME, string(""), chunkLength);
+        for (int tt = 0; tt < 4; tt++)
+        {
+            vector<float> values(fieldSample(250, tt));
+            writer.writeSample(&values[0], values.size());
+        }
+    }
+
+    // Cut the file off in the middle of the last sample, as if the run had
+    // been killed.
+    string contents;
+    {
+        ifstream file(FILENAME.c_str(), ios::binary);
+        contents.assign(istreambuf_iterator<char>(file),
+            istreambuf_iterator<char>());
+    }
+    ofstream truncated(FILENAME.c_str(), ios::binary);
+    truncated.write(contents.data(), contents.size()/2);
+    truncated.close();
+
+    ChunkedFileReader reader(FILENAME);
+    BOOST_CHECK(reader.numSamples() >= 1);
+    BOOST_CHECK(reader.numSamples() < 4);
+    vector<float> values;
+    for (int tt = 0; tt < reader.numSamples(); tt++)
+    {
+        reader.readSample(tt, values);
+        BOOST_CHECK(values == fieldSample(250, tt));
+    }
+    remove(FILENAME.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(notChunked)
+{
+    {
+        ofstream file(FILENAME.c_str(), ios::binary);
+        float raw[4] = { 1, 2, 3, 4 };
+        file.write((char*)raw, sizeof(raw));
+    }
+    BOOST_CHECK(!ChunkedFileReader::isChunkedFile(FILENAME));
+    BOOST_CHECK_THROW(ChunkedFileReader reader(FILENAME), Exception);
+    remove(FILENAME.c_str());
+}
@@ -0,0 +1,187 @@
+// Test CompiledFormula.cpp
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test CompiledFormula
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "CompiledFormula.h"
+#include "calc.hh"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static vector<string>
+sourceInputs()
+{
+    vector<string> names;
+    names.push_back("n");
+    names.push_back("t");
+    return names;
+}
+
+// Evaluate the formula both ways over a range of timesteps.
+static bool
+sameAsCalculator(const string & formula)
+{
+    CompiledFormula compiled;
+    compiled.compile(formula, sourceInputs());
+    
+    calc_defs::Calculator<double> calculator;
+    const double dt = 1.3e-17;
+    bool allSame = 1;
+    for (int nn = 0; nn < 200; nn++)
+    {
+        double inputs[2] = { double(nn), nn*dt };
+        calculator.set("n", inputs[0]);
+        calculator.set("t", inputs[1]);
+        BOOST_REQUIRE(!calculator.parse(formula));
+        
+        double expected = calculator.get_value();
+        double value = compiled.evaluate(inputs);
+        if (fabs(value - expected) > 1e-12*(1.0 + fabs(expected)))
+        {
+            BOOST_TEST_MESSAGE(formula << " at n = " << nn << ": " << value
+                << " vs " << expected);
+            allSame = 0;
+        }
+    }
+    return allSame;
+}
+
+BOOST_AUTO_TEST_CASE( matchesCalculator )
+{
+    BOOST_CHECK(sameAsCalculator("1"));
+    BOOST_CHECK(sameAsCalculator("n"));
+    BOOST_CHECK(sameAsCalculator("-n + 2*3 - 4/5"));
+    BOOST_CHECK(sameAsCalculator("2^3*n - n^2/7"));
+    BOOST_CHECK(sameAsCalculator("-(n-3)^2"));
+    BOOST_CHECK(sameAsCalculator("sin(2*pi*n/20)*exp(-((n-50)/15)^2)"));
+    BOOST_CHECK(sameAsCalculator(
+        "w = 2*pi*3e14; t0 = 60e-16 ; sin(w*t)*exp(-((t-t0)/20e-16)^2)"));
+    BOOST_CHECK(sameAsCalculator("max(n, 100) - min(n, 30) + atan2(n, 7)"));
+    BOOST_CHECK(sameAsCalculator("pow(1.5, n/50.0) + sqrt(n) + floor(n/3)"));
+    BOOST_CHECK(sameAsCalculator(
+        "# a comment\n a = n/10 # another\n; b = a*a; cosh(a) - b"));
+    BOOST_CHECK(sameAsCalculator("e^2 + +n + log10(n+1) + log(n+1)"));
+}
+
+BOOST_AUTO_TEST_CASE( batches )
+{
+    // Several blocks' worth of points, with t the same at every point.
+    const long count = 1000;
+    vector<double> n(count), values(count);
+    for (int nn = 0; nn < count; nn++)
+        n[nn] = nn;
+    double t = 3e-15;
+    const double* inputs[2] = { &n[0], &t };
+    int strides[2] = { 1, 0 };
+    
+    CompiledFormula compiled;
+    compiled.compile("a = n/100; sin(a)*exp(-a) + t*1e15 - max(a, 2)^2",
+        sourceInputs());
+    compiled.evaluate(count, inputs, strides, &values[0]);
+    
+    bool allSame = 1;
+    for (int nn = 0; nn < count; nn++)
+    {
+        double scalarInputs[2] = { n[nn], t };
+        if (values[nn] != compiled.evaluate(scalarInputs))
+            allSame = 0;
+    }
+    BOOST_CHECK(allSame);
+}
+
+BOOST_AUTO_TEST_CASE( splitting )
+{
+    // n is static here, t is dynamic.
+    vector<bool> isStatic(2, 0);
+    isStatic[0] = 1;
+    const char* formulas[] = {
+        "exp(-((n-50)/10)^2) * sin(t*1e15)",
+        "a = n*n; b = 2; c = b*a + t; c - a",
+        "k = 3; sin(k*n - 2*t) + (q = n + 1)*t + q",
+        "n + 1",
+        "t*2",
+        "p = t; p = n; p*t + p"
+    };
+    
+    for (int ff = 0; ff < sizeof(formulas)/sizeof(formulas[0]); ff++)
+    {
+        CompiledFormula compiled, staticPart, dynamicPart;
+        compiled.compile(formulas[ff], sourceInputs());
+        compiled.split(isStatic, staticPart, dynamicPart);
+        BOOST_CHECK_EQUAL(dynamicPart.numInputs(),
+            2 + staticPart.numOutputs());
+        BOOST_CHECK(!dynamicPart.dependsOn(0));
+        
+        const long count = 300;
+        vector<double> n(count), values(count);
+        vector<vector<double> > outputs(staticPart.numOutputs(),
+            vector<double>(count));
+        vector<double*> outputPointers;
+        for (int oo = 0; oo < outputs.size(); oo++)
+            outputPointers.push_back(&outputs[oo][0]);
+        for (int nn = 0; nn < count; nn++)
+            n[nn] = nn;
+        double t = 0.0;
+        
+        const double* staticInputs[2] = { &n[0], &t };
+        int staticStrides[2] = { 1, 0 };
+        if (outputs.size() > 0)
+            staticPart.evaluate(count, staticInputs, staticStrides, 0L,
+                &outputPointers[0]);
+        
+        bool allSame = 1;
+        for (t = 0.0; t < 5e-15; t += 1e-15)
+        {
+            vector<const double*> inputs(2 + outputs.size());
+            vector<int> strides(2 + outputs.size(), 1);
+            inputs[0] = &n[0];
+            inputs[1] = &t;
+            strides[1] = 0;
+            for (int oo = 0; oo < outputs.size(); oo++)
+                inputs[2+oo] = &outputs[oo][0];
+            dynamicPart.evaluate(count, &inputs[0], &strides[0], &values[0]);
+            
+            for (int nn = 0; nn < count; nn++)
+            {
+                double scalarInputs[2] = { n[nn], t };
+                double expected = compiled.evaluate(scalarInputs);
+                if (fabs(values[nn] - expected) > 1e-12*(1.0+fabs(expected)))
+                    allSame = 0;
+            }
+        }
+        BOOST_CHECK_MESSAGE(allSame, formulas[ff]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( dependencies )
+{
+    CompiledFormula compiled;
+    compiled.compile("sin(2*pi*t*1e15)", sourceInputs());
+    BOOST_CHECK(!compiled.dependsOn(0));
+    BOOST_CHECK(compiled.dependsOn(1));
+    
+    compiled.compile("a = n; a*a", sourceInputs());
+    BOOST_CHECK(compiled.dependsOn(0));
+    BOOST_CHECK(!compiled.dependsOn(1));
+}
+
+BOOST_AUTO_TEST_CASE( parseErrors )
+{
+    CompiledFormula compiled;
+    BOOST_CHECK_THROW(compiled.compile("sin(n", sourceInputs()), Exception);
+    BOOST_CHECK_THROW(compiled.compile("x + 1", sourceInputs()), Exception);
+    BOOST_CHECK_THROW(compiled.compile("n + * 2", sourceInputs()),
+        Exception);
+    BOOST_CHECK_THROW(compiled.compile("2 $ n", sourceInputs()), Exception);
+    BOOST_CHECK_THROW(compiled.compile("max(n)", sourceInputs()), Exception);
+    BOOST_CHECK_THROW(compiled.compile("3e", sourceInputs()), Exception);
+}
+
@@ -0,0 +1,81 @@
+// Test the running DFT kernel behind DFTOutput against a direct DFT.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test DFT accumulation
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "VectorKernels.h"
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using namespace std;
+
+BOOST_AUTO_TEST_CASE(runningDFT)
+{
+    const int numCells = 4*TROGDOR_VECTOR_WIDTH + 3;
+    const int numSteps = 2000;
+    const double dt = 0.01;
+    const double frequencies[] = { 0.5, 1.0, 3.7 };
+    const int numFrequencies = 3;
+    
+    vector<double> real(numCells*numFrequencies, 0.0);
+    vector<double> imag(numCells*numFrequencies, 0.0);
+    vector<complex<double> > exact(numCells*numFrequencies, 0.0);
+    vector<float> values(numCells);
+    
+    for (int tt = 0; tt < numSteps; tt++)
+    {
+        double time = tt*dt;
+        for (int cc = 0; cc < numCells; cc++)
+            values[cc] = cos(2*M_PI*(1.0 + 0.01*cc)*time + cc) *
+                exp(-0.5*(time-10)*(time-10)/4.0);
+        
+        for (int ff = 0; ff < numFrequencies; ff++)
+        {
+            double phase = 2*M_PI*frequencies[ff]*time;
+            VectorKernels::dftAccumulate(&values[0], dt*cos(phase),
+                -dt*sin(phase), &real[ff*numCells], &imag[ff*numCells],
+                numCells);
+            for (int cc = 0; cc < numCells; cc++)
+                exact[ff*numCells + cc] += (double)values[cc]*dt*
+                    polar(1.0, -phase);
+        }
+    }
+    
+    double maxError = 0.0, maxValue = 0.0;
+    for (int nn = 0; nn < exact.size(); nn++)
+    {
+        maxError = max(maxError,
+            abs(complex<double>(real[nn], imag[nn]) - exact[nn]));
+        maxValue = max(maxValue, abs(exact[nn]));
+    }
+    BOOST_TEST_MESSAGE("max error " << maxError << " of " << maxValue);
+    BOOST_CHECK(maxValue > 1.0);
+    BOOST_CHECK(maxError < 1e-9*maxValue);
+}
+
+BOOST_AUTO_TEST_CASE(longRun)
+{
+    // Two million small terms: once the sum is near 200, a float sum would
+    // round each one off by several percent.  Thirteen cells take both the
+    // vector loop and the scalar tail.
+    const int numCells = 13;
+    const long numSteps = 2000000;
+    vector<float> values(numCells, 1.0f);
+    vector<double> real(numCells, 0.0), imag(numCells, 0.0);
+    
+    for (long tt = 0; tt < numSteps; tt++)
+        VectorKernels::dftAccumulate(&values[0], 1e-4, -1e-4, &real[0],
+            &imag[0], numCells);
+    
+    for (int cc = 0; cc < numCells; cc++)
+    {
+        BOOST_CHECK(fabs(real[cc] - 200.0) < 1e-6);
+        BOOST_CHECK(fabs(imag[cc] + 200.0) < 1e-6);
+    }
+}
@@ -0,0 +1,103 @@
+// Test FieldStorage.h, and compare the accuracy of the half-size storage types
+// against float on a small FDTD problem.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test FieldStorage
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "FieldStorage.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+BOOST_AUTO_TEST_CASE(exactValues)
+{
+    // Small integers and powers of two survive both types exactly.
+    float values[] = { 0.0f, 1.0f, -2.0f, 0.5f, 3.0f, 256.0f, -0.125f };
+    for (int nn = 0; nn < 7; nn++)
+    {
+        BOOST_CHECK_EQUAL(float(BFloat16(values[nn])), values[nn]);
+        BOOST_CHECK_EQUAL(float(Half(values[nn])), values[nn]);
+    }
+
+    BOOST_CHECK_EQUAL(float(Half(65504.0f)), 65504.0f);
+    BOOST_CHECK_EQUAL(float(Half(1e5f)), numeric_limits<float>::infinity());
+    BOOST_CHECK_EQUAL(float(Half(5.9604645e-8f)), 5.9604645e-8f); // 2^-24
+    BOOST_CHECK(fabs(float(BFloat16(1e30f)) - 1e30f) < 1e30f/256.0f);
+}
+
+BOOST_AUTO_TEST_CASE(rounding)
+{
+    // Relative error of rounding to nearest is at most half an ulp.
+    for (float x = 1e-3f; x < 1e4f; x *= 1.01f)
+    {
+        BOOST_CHECK(fabs(float(BFloat16(x)) - x) <= x/256.0f);
+        BOOST_CHECK(fabs(float(Half(x)) - x) <= x/2048.0f);
+    }
+
+    // Ties go to even.
+    BOOST_CHECK_EQUAL(float(Half(1.0f + 1.0f/2048.0f)), 1.0f);
+    BOOST_CHECK_EQUAL(float(Half(1.0f + 3.0f/2048.0f)), 1.0f + 2.0f/1024.0f);
+    BOOST_CHECK_EQUAL(float(BFloat16(1.0f + 1.0f/256.0f)), 1.0f);
+}
+
+// A Gaussian pulse injected into a 1D Yee grid and stopped before it reaches
+// the ends.  Fields are stored as T and updated in float.
+template<class T>
+static void
+runPulse(vector<float> & finalE)
+{
+    const int NUMCELLS = 400;
+    const int NUMT = 300;
+    const float courant = 0.5f;
+    vector<T> E(NUMCELLS, 0.0f), H(NUMCELLS, 0.0f);
+
+    for (int n = 0; n < NUMT; n++)
+    {
+        for (int ii = 0; ii < NUMCELLS-1; ii++)
+            H[ii] += courant*(E[ii+1] - E[ii]);
+        for (int ii = 1; ii < NUMCELLS; ii++)
+            E[ii] += courant*(H[ii] - H[ii-1]);
+
+        float t = (n - 60)/15.0f;
+        E[50] += exp(-t*t);
+    }
+    finalE.assign(E.begin(), E.end());
+}
+
+static double
+relativeError(const vector<float> & test, const vector<float> & reference)
+{
+    double diff = 0.0, norm = 0.0;
+    for (int nn = 0; nn < reference.size(); nn++)
+    {
+        diff += (test[nn]-reference[nn])*(test[nn]-reference[nn]);
+        norm += reference[nn]*reference[nn];
+    }
+    return sqrt(diff/norm);
+}
+
+// Accuracy regression: keep the error of each storage type relative to float
+// storage from creeping up.  The limits are about twice what the types did
+// when this test was written.
+BOOST_AUTO_TEST_CASE(pulseAccuracy)
+{
+    vector<float> reference, bf16, fp16;
+    runPulse<float>(reference);
+    runPulse<BFloat16>(bf16);
+    runPulse<Half>(fp16);
+
+    double bf16Error = relativeError(bf16, reference);
+    double fp16Error = relativeError(fp16, reference);
+    BOOST_TEST_MESSAGE("bfloat16 relative error " << bf16Error);
+    BOOST_TEST_MESSAGE("half relative error " << fp16Error);
+
+    BOOST_CHECK(bf16Error < 0.06);
+    BOOST_CHECK(fp16Error < 0.015);
+}
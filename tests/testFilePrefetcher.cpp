@@ -0,0 +1,109 @@
+// Test FilePrefetcher.cpp
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test FilePrefetcher
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "FilePrefetcher.h"
+#include "Exception.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const string FILENAME("testFilePrefetcher.dat");
+static const int NUMTIMESTEPS = 40;
+static const long LENGTHE = 1000;
+static const long LENGTHH = 700;
+
+// An E record and then an H record for each timestep, counting up.
+static void
+writeSourceFile()
+{
+    ofstream file(FILENAME.c_str(), ios::binary);
+    float value = 0.0f;
+    for (int nn = 0; nn < NUMTIMESTEPS*(LENGTHE + LENGTHH); nn++)
+    {
+        file.write((char*)&value, sizeof(float));
+        value += 1.0f;
+    }
+}
+
+static bool
+readBack(int numBuffers)
+{
+    vector<long> recordLengths;
+    recordLengths.push_back(LENGTHE);
+    recordLengths.push_back(LENGTHH);
+
+    FilePrefetcher prefetcher(FILENAME, recordLengths, numBuffers);
+    float expected = 0.0f;
+    bool allSame = 1;
+    for (int nn = 0; nn < 2*NUMTIMESTEPS; nn++)
+    {
+        const vector<float>* record = prefetcher.beginRecord();
+        BOOST_REQUIRE(record != 0L);
+        BOOST_CHECK_EQUAL(record->size(), recordLengths[nn%2]);
+        for (int mm = 0; mm < record->size(); mm++)
+        {
+            if ((*record)[mm] != expected)
+                allSame = 0;
+            expected += 1.0f;
+        }
+        prefetcher.endRecord();
+    }
+
+    // The file is used up.
+    BOOST_CHECK(prefetcher.beginRecord() == 0L);
+    BOOST_CHECK(prefetcher.stallMicroseconds() >= 0.0);
+    return allSame;
+}
+
+BOOST_AUTO_TEST_CASE( recordsInOrder )
+{
+    writeSourceFile();
+    BOOST_CHECK(readBack(1));
+    BOOST_CHECK(readBack(4));
+    remove(FILENAME.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( stopEarly )
+{
+    // Destroying the prefetcher with records still queued must not hang.
+    writeSourceFile();
+    {
+        vector<long> recordLengths(1, LENGTHE);
+        FilePrefetcher prefetcher(FILENAME, recordLengths, 3);
+        BOOST_CHECK(prefetcher.beginRecord() != 0L);
+        prefetcher.endRecord();
+    }
+    remove(FILENAME.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( memoryBudget )
+{
+    vector<long> recordLengths;
+    recordLengths.push_back(1000);
+    recordLengths.push_back(4000);
+
+    FilePrefetcher::setRecordsAhead(8);
+    FilePrefetcher::setMaxBytes(3*4000*sizeof(float));
+    BOOST_CHECK_EQUAL(FilePrefetcher::numBuffers(recordLengths), 3);
+
+    FilePrefetcher::setMaxBytes(100*4000*sizeof(float));
+    BOOST_CHECK_EQUAL(FilePrefetcher::numBuffers(recordLengths), 8);
+
+    FilePrefetcher::setRecordsAhead(0);
+    BOOST_CHECK_EQUAL(FilePrefetcher::numBuffers(recordLengths), 0);
+
+    BOOST_CHECK_THROW(FilePrefetcher("noSuchFile.dat", recordLengths, 2),
+        Exception);
+}
+
+
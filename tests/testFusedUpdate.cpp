@@ -0,0 +1,84 @@
+// Compare a whole simulation with the Ex/Ey/Ez updates of matching runlines
+// fused against the same simulation with each component updated separately.
+//
+// Vacuum, PML and a Drude/Lorentz metal take the block update and get fused
+// where the runlines of all three components match and are long enough for
+// the block path; the grid is long along x, the runline direction, so there
+// are some.  An ellipsoid and a block that starts on an odd half cell leave
+// runlines that don't match, which stay unfused, and a StaticLossyDielectric
+// block takes the per-cell update, which is never fused.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test fused update
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "SimulationFixture.h"
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+static const int NX = 64, NY = 24, NZ = 24;
+
+// Run the simulation and return E and H everywhere at the last timestep.
+static vector<float>
+runSimulation(bool fuse)
+{
+    ostringstream xml;
+    xml << "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"120\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Material name=\"Glass\" model=\"StaticDielectric\">"
+        "<Params epsr=\"2.25\"/></Material>\n"
+        "<Material name=\"Lossy\" model=\"StaticLossyDielectric\">"
+        "<Params epsr=\"2\" sigma=\"1e5\"/></Material>\n"
+        "<Material name=\"Metal\" model=\"MultiPole\">"
+        "<Params epsinf=\"2\" pole1=\"Drude\" omegap1=\"1.37e16\" "
+        "gamma1=\"1e14\" pole2=\"Lorentz\" deltaeps2=\"1.5\" omega2=\"4e15\" "
+        "gamma2=\"1e15\"/></Material>\n"
+        "<Grid name=\"Main\" nx=\"64\" ny=\"24\" nz=\"24\" "
+        "nonPML=\"6 6 6 57 17 17\">\n"
+        "<AdditiveSource fields=\"ex ey ez\" "
+        "formula=\"exp(-1*((n-20)/6)^2)\">"
+        "<Region yeeCells=\"14 11 11 14 11 11\"/></AdditiveSource>\n"
+        "<FieldOutput fields=\"electric magnetic\" file=\"fusedUpdate.EH\">"
+        "<Region yeeCells=\"0 0 0 63 23 23\"/>"
+        "<Duration timestep=\"119\"/></FieldOutput>\n"
+        "<Assembly>"
+        "<Block yeeCells=\"0 0 0 63 23 23\" material=\"Vacuum\"/>"
+        "<Ellipsoid yeeCells=\"22 6 6 34 16 16\" material=\"Metal\"/>"
+        "<Block halfCells=\"41 13 13 100 31 31\" material=\"Glass\"/>"
+        "<Block yeeCells=\"40 2 2 50 4 4\" material=\"Lossy\"/>"
+        "</Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n";
+
+    SimulationPreferences prefs;
+    prefs.fuseComponents = fuse;
+    return SimulationFixture::run(xml.str(), "fusedUpdate.EH", 6*NX*NY*NZ,
+        prefs);
+}
+
+BOOST_AUTO_TEST_CASE( fusedMatchesUnfused )
+{
+    vector<float> unfused = runSimulation(0);
+    vector<float> fused = runSimulation(1);
+
+    double norm2 = 0.0;
+    for (long nn = 0; nn < unfused.size(); nn++)
+        norm2 += unfused[nn]*unfused[nn];
+    BOOST_CHECK(norm2 == norm2); // not NaN
+    BOOST_CHECK(norm2 > 0.0);
+
+    long numDifferent = 0;
+    for (long nn = 0; nn < unfused.size(); nn++)
+    if (memcmp(&unfused[nn], &fused[nn], sizeof(float)) != 0)
+        numDifferent++;
+    BOOST_CHECK_EQUAL(numDifferent, 0);
+}
@@ -0,0 +1,123 @@
+// Test HaloExchange.cpp and NodeCommunicator.cpp
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test HaloExchange
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "HaloExchange.h"
+#include "NodeCommunicator.h"
+#include "InterleavedLattice.h"
+#include "YeeUtilities.h"
+#include <unistd.h>
+#include <iostream>
+#include <string>
+
+using namespace YeeUtilities;
+using namespace std;
+
+// Ranks other than 0 can't report to Boost, so they send rank 0 one byte
+// saying whether their checks passed and then exit quietly.
+static void finishNode(NodeCommunicatorPtr comm, bool passed)
+{
+    char ok = passed;
+    if (comm->rank() == 0)
+    {
+        BOOST_CHECK(passed);
+        for (int nn = 1; nn < comm->numNodes(); nn++)
+        {
+            comm->receive(nn, &ok, 1);
+            BOOST_CHECK_MESSAGE(ok, "node " << nn << " failed");
+        }
+    }
+    else
+    {
+        comm->send(0, &ok, 1);
+        _exit(0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sendReceive)
+{
+    NodeCommunicatorPtr comm(NodeCommunicator::forkLocalNodes(3));
+
+    // Pass a number around the ring.
+    int next = (comm->rank()+1) % 3;
+    int prev = (comm->rank()+2) % 3;
+    long value = 100 + comm->rank();
+    long received;
+
+    if (comm->rank() == 0)
+    {
+        comm->send(next, &value, sizeof(long));
+        comm->receive(prev, &received, sizeof(long));
+    }
+    else
+    {
+        comm->receive(prev, &received, sizeof(long));
+        comm->send(next, &value, sizeof(long));
+    }
+    comm->barrier();
+
+    finishNode(comm, received == 100 + prev);
+}
+
+BOOST_AUTO_TEST_CASE(exchangeAlongX)
+{
+    // Twenty half cells along x, split into two nodes of five Yee cells.
+    // The grid is periodic, so each node has a ghost Yee cell on both sides.
+    const Rect3i gridHalfCells(0,0,0,19,1,1);
+    NodeCommunicatorPtr comm(NodeCommunicator::forkLocalNodes(2));
+    int rank = comm->rank();
+
+    Rect3i calcHalfCells(gridHalfCells);
+    if (rank == 0)
+        calcHalfCells.p2[0] = 9;
+    else
+        calcHalfCells.p1[0] = 10;
+    Rect3i allocHalfCells(calcHalfCells);
+    allocHalfCells.p1[0] -= 2;
+    allocHalfCells.p2[0] += 2;
+
+    InterleavedLattice lattice(string("halo"), allocHalfCells);
+    lattice.allocate();
+
+    Rect3i calcYee(halfToYee(calcHalfCells));
+    Vector3i x;
+    for (int direction = 0; direction < 3; direction++)
+    for (x[2] = calcYee.p1[2]; x[2] <= calcYee.p2[2]; x[2]++)
+    for (x[1] = calcYee.p1[1]; x[1] <= calcYee.p2[1]; x[1]++)
+    for (x[0] = calcYee.p1[0]; x[0] <= calcYee.p2[0]; x[0]++)
+    {
+        lattice.setE(direction, x, 1.0f + rank + x[0]);
+        lattice.setH(direction, x, -1.0f - rank - x[0]);
+    }
+
+    HaloExchange halo(comm, Vector3i(2,1,1), Vector3i(rank,0,0),
+        calcHalfCells, gridHalfCells);
+    halo.exchangeE(lattice);
+    halo.exchangeH(lattice);
+
+    // Each ghost Yee cell holds the other node's outermost Yee cell on that
+    // side, which past the edge of the grid is the one on the far side.
+    const int numYee = 10;
+    int other = 1-rank;
+    bool passed = 1;
+    for (int side = 0; side < 2; side++)
+    {
+        int ghost = side ? calcYee.p2[0]+1 : calcYee.p1[0]-1;
+        int source = (ghost + numYee) % numYee;
+        for (int direction = 0; direction < 3; direction++)
+        {
+            x = Vector3i(ghost, 0, 0);
+            passed = passed &&
+                lattice.getE(direction, x) == 1.0f + other + source &&
+                lattice.getH(direction, x) == -1.0f - other - source;
+        }
+    }
+
+    finishNode(comm, passed);
+}
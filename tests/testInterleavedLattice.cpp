@@ -243,3 +243,105 @@ BOOST_AUTO_TEST_CASE(yeeCellCalculations)
 
 
 
+
+BOOST_AUTO_TEST_CASE(alignedLayout)
+{
+    // Ten Yee cells along x get padded to one cache line.
+    InterleavedLattice::setAlignedLayout(1);
+    InterleavedLattice l(string("Temp"), Rect3i(0,0,0,19,5,3));
+    InterleavedLattice::setAlignedLayout(0);
+    l.allocate();
+    
+    BOOST_CHECK_EQUAL(InterleavedLattice::ALIGNMENT*sizeof(FieldStorage), 64);
+    
+    Vector3i stride(l.fieldStride());
+    BOOST_CHECK_EQUAL(stride[0], 1);
+    BOOST_CHECK_EQUAL(stride[1], InterleavedLattice::ALIGNMENT);
+    BOOST_CHECK_EQUAL(stride[2], 3*InterleavedLattice::ALIGNMENT);
+    
+    Vector3i v;
+    for (int fieldDir = 0; fieldDir < 3; fieldDir++)
+    {
+        BOOST_CHECK_EQUAL(long(l.headE(fieldDir)) % 64, 0);
+        BOOST_CHECK_EQUAL(long(l.headH(fieldDir)) % 64, 0);
+        
+        for (v[2] = 0; v[2] < 2; v[2]++)
+        for (v[1] = 0; v[1] < 3; v[1]++)
+        for (v[0] = 0; v[0] < 10; v[0]++)
+        {
+            l.setE(fieldDir, v, v[2] + 100*v[1] + 10000*v[0]);
+            l.setH(fieldDir, v, -(v[2] + 100*v[1] + 10000*v[0]));
+        }
+        
+        // Each row starts on a cache line.
+        v = Vector3i(0, 2, 1);
+        BufferPointer pE = l.pointerE(fieldDir, v);
+        BOOST_CHECK_EQUAL(long(pE.pointer()) % 64, 0);
+        BOOST_CHECK_EQUAL(*(pE.pointer() + stride[0]),
+            l.getE(fieldDir, v + Vector3i(1,0,0)));
+        BOOST_CHECK_EQUAL(*(pE.pointer() - stride[1]),
+            l.getE(fieldDir, v - Vector3i(0,1,0)));
+        BOOST_CHECK_EQUAL(*(pE.pointer() - stride[2]),
+            l.getE(fieldDir, v - Vector3i(0,0,1)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bulkGatherScatter)
+{
+    InterleavedLattice l(string("Temp"), Rect3i(0,0,0,15,11,9));
+    l.allocate();
+    
+    Vector3i v;
+    for (int fieldDir = 0; fieldDir < 3; fieldDir++)
+    for (v[2] = 0; v[2] < 5; v[2]++)
+    for (v[1] = 0; v[1] < 6; v[1]++)
+    for (v[0] = 0; v[0] < 8; v[0]++)
+    {
+        l.setE(fieldDir, v, fieldDir + v[0] + 10*v[1] + 100*v[2]);
+        l.setH(fieldDir, v, -(fieldDir + v[0] + 10*v[1] + 100*v[2]));
+    }
+    
+    // Gathering matches getE() and getInterpolatedE() in a triple loop,
+    // including where the interpolation wraps around the lattice.
+    Rect3i region(1,1,0,5,4,3);
+    Vector3i stride(2,1,2);
+    Vector3f interpPoints[] = { Vector3f(0.5, 0.5, 0.5), Vector3f(0,0,0) };
+    for (int fieldDir = 0; fieldDir < 3; fieldDir++)
+    {
+        vector<float> gathered, interpolated[2], expected, expectedInterp[2];
+        l.gatherE(fieldDir, region, stride, gathered);
+        for (int nn = 0; nn < 2; nn++)
+            l.gatherInterpolatedH(fieldDir, region, stride, interpPoints[nn],
+                interpolated[nn]);
+        
+        for (v[2] = region.p1[2]; v[2] <= region.p2[2]; v[2] += stride[2])
+        for (v[1] = region.p1[1]; v[1] <= region.p2[1]; v[1] += stride[1])
+        for (v[0] = region.p1[0]; v[0] <= region.p2[0]; v[0] += stride[0])
+        {
+            expected.push_back(l.getE(fieldDir, v));
+            for (int nn = 0; nn < 2; nn++)
+                expectedInterp[nn].push_back(l.getInterpolatedH(fieldDir,
+                    Vector3f(v) + interpPoints[nn]));
+        }
+        
+        BOOST_CHECK_EQUAL(gathered.size(), 3*4*2);
+        BOOST_CHECK(gathered == expected);
+        for (int nn = 0; nn < 2; nn++)
+        {
+            BOOST_REQUIRE_EQUAL(interpolated[nn].size(),
+                expectedInterp[nn].size());
+            for (int mm = 0; mm < interpolated[nn].size(); mm++)
+                BOOST_CHECK_CLOSE(interpolated[nn][mm],
+                    expectedInterp[nn][mm], 1e-3);
+        }
+    }
+    
+    // Scattering and adding write the same cells in the same order.
+    Rect3i small(2,1,1,4,2,2);
+    vector<float> ones(small.count(), 1.0f), after;
+    l.scatterE(0, small, &ones[0]);
+    l.addE(0, small, &ones[0]);
+    l.gatherE(0, small, Vector3i(1,1,1), after);
+    BOOST_CHECK(after == vector<float>(small.count(), 2.0f));
+    BOOST_CHECK_EQUAL(l.getE(0, Vector3i(1,1,1)), 0 + 1 + 10 + 100);
+}
@@ -0,0 +1,94 @@
+// Test MappedFile.cpp
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test MappedFile
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "MappedFile.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const string FILENAME("testMappedFile.dat");
+
+static void
+writeFloats(const vector<float> & values)
+{
+    ofstream file(FILENAME.c_str(), ios::binary);
+    if (values.size() > 0)
+        file.write((char*)&values[0], values.size()*sizeof(float));
+}
+
+BOOST_AUTO_TEST_CASE( sequentialViews )
+{
+    // Big enough to move the readahead window a few times.
+    const long numFloats = 3*MappedFile::WINDOW_BYTES/sizeof(float) + 5;
+    vector<float> values(numFloats);
+    for (long nn = 0; nn < numFloats; nn++)
+        values[nn] = 0.5f*nn;
+    writeFloats(values);
+
+    MappedFile file;
+    BOOST_REQUIRE(file.open(FILENAME));
+    BOOST_CHECK_EQUAL(file.bytes(), long(numFloats*sizeof(float)));
+
+    // One value, then slabs, as the field inputs read them.
+    const float* first = file.view(1);
+    BOOST_REQUIRE(first != 0L);
+    BOOST_CHECK_EQUAL(*first, 0.0f);
+
+    const long slab = 100000;
+    long nn = 1;
+    bool allSame = 1;
+    while (nn + slab <= numFloats)
+    {
+        const float* data = file.view(slab);
+        BOOST_REQUIRE(data != 0L);
+        for (long mm = 0; mm < slab; mm++)
+        if (data[mm] != values[nn+mm])
+            allSame = 0;
+        nn += slab;
+    }
+    BOOST_CHECK(allSame);
+
+    vector<float> tail(numFloats - nn);
+    BOOST_CHECK(file.read(&tail[0], tail.size()));
+    BOOST_CHECK_EQUAL(tail.back(), values.back());
+    BOOST_CHECK(file.good());
+
+    // Running off the end fails like ifstream does.
+    BOOST_CHECK(file.view(1) == 0L);
+    BOOST_CHECK(!file.good());
+
+    // Earlier pages were released from the mapping but still read back.
+    BOOST_REQUIRE(file.open(FILENAME));
+    BOOST_CHECK_EQUAL(*file.view(1), 0.0f);
+
+    remove(FILENAME.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( missingAndEmptyFiles )
+{
+    remove(FILENAME.c_str());
+    MappedFile file;
+    BOOST_CHECK(!file.open(FILENAME));
+    BOOST_CHECK(!file.good());
+    BOOST_CHECK(file.view(1) == 0L);
+
+    writeFloats(vector<float>());
+    BOOST_CHECK(file.open(FILENAME));
+    BOOST_CHECK(file.good());
+    BOOST_CHECK(file.view(1) == 0L);
+    BOOST_CHECK(!file.good());
+
+    remove(FILENAME.c_str());
+}
+
+
@@ -0,0 +1,129 @@
+// Test the poles of MultiPoleModel.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test MultiPole
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "MultiPoleModel.h"
+#include "PhysicalConstants.h"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const float DT = 1e-17f;
+
+// Run one pole with E = 1 from t = 0 until it settles, one cell at a time.
+static void
+settle(const DispersivePole & pole, int numTimesteps, float & J, float & P)
+{
+    J = 0.0f;
+    P = 0.0f;
+    for (int nn = 0; nn < numTimesteps; nn++)
+    {
+        J = pole.cJ()*J + pole.cP()*P + pole.cE()*1.0f;
+        P = P + DT*J;
+    }
+}
+
+static bool
+close(double a, double b, double tolerance)
+{
+    return fabs(a - b) <= tolerance*fabs(b);
+}
+
+BOOST_AUTO_TEST_CASE( readParams )
+{
+    Map<string, string> params;
+    params["pole1"] = "Drude";
+    params["omegap1"] = "1.37e16";
+    params["gamma1"] = "1e14";
+    params["pole2"] = "Lorentz";
+    params["deltaeps2"] = "1.5";
+    params["omega2"] = "4e15";
+    params["pole4"] = "Debye";
+    BOOST_CHECK_EQUAL(DispersivePole::numPoles(params), 2);
+
+    // Same constants as DrudeModel1, with tauc = 1/gamma.
+    DispersivePole drude(DispersivePole::read(params, 1, DT));
+    BOOST_CHECK(drude.type() == DispersivePole::kDrude);
+    double tauc = 1e-14, omegap = 1.37e16;
+    BOOST_CHECK(close(drude.cJ(), (2*tauc - DT)/(2*tauc + DT), 1e-6));
+    BOOST_CHECK(close(drude.cE(),
+        2*tauc*DT*omegap*omegap*Constants::eps0/(DT + 2*tauc), 1e-5));
+    BOOST_CHECK_EQUAL(drude.cP(), 0.0f);
+
+    // Missing gamma2, unknown type.
+    BOOST_CHECK_THROW(DispersivePole::read(params, 2, DT), Exception);
+    params["pole3"] = "Sellmeier";
+    BOOST_CHECK_THROW(DispersivePole::read(params, 3, DT), Exception);
+    BOOST_CHECK_THROW(DispersivePole::read(params, 5, DT), Exception);
+}
+
+BOOST_AUTO_TEST_CASE( staticResponse )
+{
+    // Under a constant E each pole settles to its DC response: a Drude pole
+    // carries J = eps0*omegap^2/gamma*E, and Lorentz and Debye poles hold
+    // P = eps0*deltaeps*E.
+    float J, P;
+    DispersivePole drude(DispersivePole::kDrude, 0.0f, 1.37e16f, 1e15f, 0.0f,
+        DT);
+    settle(drude, 20000, J, P);
+    BOOST_CHECK(close(J, Constants::eps0*1.37e16*1.37e16/1e15, 1e-3));
+
+    DispersivePole lorentz(DispersivePole::kLorentz, 2.0f, 4e15f, 1e15f, 0.0f,
+        DT);
+    settle(lorentz, 20000, J, P);
+    BOOST_CHECK(close(P, Constants::eps0*2.0, 1e-3));
+    BOOST_CHECK(fabs(J) < 1e-6*Constants::eps0*2.0/DT);
+
+    DispersivePole debye(DispersivePole::kDebye, 3.0f, 0.0f, 0.0f, 1e-15f,
+        DT);
+    BOOST_CHECK_EQUAL(debye.cJ(), 0.0f);
+    settle(debye, 20000, J, P);
+    BOOST_CHECK(close(P, Constants::eps0*3.0, 1e-3));
+}
+
+BOOST_AUTO_TEST_CASE( blockUpdate )
+{
+    // The vector kernel does the same as the per-cell update in
+    // MultiPoleModel::beforeUpdateE.  An odd number of cells, so the scalar
+    // tail runs too.
+    const int NUMCELLS = 4*TROGDOR_VECTOR_WIDTH + 3;
+    DispersivePole lorentz(DispersivePole::kLorentz, 2.0f, 4e15f, 1e15f, 0.0f,
+        DT);
+
+    vector<float> J(NUMCELLS), P(NUMCELLS), E(NUMCELLS), sumJ(NUMCELLS);
+    for (int nn = 0; nn < NUMCELLS; nn++)
+    {
+        J[nn] = float(rand())/RAND_MAX - 0.5f;
+        P[nn] = 1e-17f*(float(rand())/RAND_MAX - 0.5f);
+        E[nn] = float(rand())/RAND_MAX - 0.5f;
+        sumJ[nn] = float(nn);
+    }
+    vector<float> J2(J), P2(P), sumJ2(sumJ);
+
+    VectorKernels::poleUpdate(&J[0], &P[0], &E[0], lorentz.cJ(), lorentz.cP(),
+        lorentz.cE(), DT, &sumJ[0], NUMCELLS);
+
+    bool allClose = 1;
+    for (int nn = 0; nn < NUMCELLS; nn++)
+    {
+        float Jnew = lorentz.cJ()*J2[nn] + lorentz.cP()*P2[nn] +
+            lorentz.cE()*E[nn];
+        P2[nn] = P2[nn] + DT*Jnew;
+        sumJ2[nn] += Jnew;
+        if (!close(J[nn], Jnew, 1e-5) || !close(P[nn], P2[nn], 1e-5) ||
+            !close(sumJ[nn], sumJ2[nn], 1e-5))
+            allClose = 0;
+    }
+    BOOST_CHECK(allClose);
+}
+
+
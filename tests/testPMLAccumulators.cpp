@@ -0,0 +1,84 @@
+// Compare a whole simulation with the PML accumulators stored only where the
+// PML term is nonzero against the same simulation with them stored densely.
+//
+// The PML profile is zero on the inner half of its depth on every face and
+// zero everywhere on the +y face.  Runlines go along x, so they run along the
+// PML direction on the x faces and across it on the y and z faces.  Half the
+// grid is StaticDielectric, which takes the block update, and half is
+// StaticLossyDielectric, which takes the per-cell update.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test PML accumulators
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "SimulationFixture.h"
+#include "CFSRIPML.h"
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+static const int NUMCELLS = 32;
+
+// Run the simulation and return E and H everywhere at the last timestep.
+static vector<float>
+runSimulation(bool sparse)
+{
+    ostringstream xml;
+    xml << "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"120\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Material name=\"Lossless\" model=\"StaticLossyDielectric\">"
+        "<Params epsr=\"1\" sigma=\"0\"/></Material>\n"
+        "<Grid name=\"Main\" nx=\"32\" ny=\"32\" nz=\"32\" "
+        "nonPML=\"8 8 8 23 23 23\">\n"
+        "<PML sigma=\"(2*max(d-0.5,0))^3*0.8*4/(((mu0/eps0)^0.5)*dx)\" "
+        "kappa=\"1+4*(2*max(d-0.5,0))^3\"/>\n"
+        "<PML direction=\"0 1 0\" sigma=\"0\" kappa=\"1\"/>\n"
+        "<AdditiveSource fields=\"ex ey ez\" "
+        "formula=\"exp(-1*((n-20)/6)^2)\">"
+        "<Region yeeCells=\"14 15 13 14 15 13\"/></AdditiveSource>\n"
+        "<FieldOutput fields=\"electric magnetic\" file=\"pmlAccumulators.EH\">"
+        "<Region yeeCells=\"0 0 0 31 31 31\"/>"
+        "<Duration timestep=\"119\"/></FieldOutput>\n"
+        "<Assembly>"
+        "<Block yeeCells=\"0 0 0 31 31 31\" material=\"Vacuum\"/>"
+        "<Block yeeCells=\"0 0 16 31 31 31\" material=\"Lossless\"/>"
+        "</Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n";
+
+    CFSRIPMLBase::setSparseAccumulators(sparse);
+    vector<float> values = SimulationFixture::run(xml.str(),
+        "pmlAccumulators.EH", 6*NUMCELLS*NUMCELLS*NUMCELLS);
+    CFSRIPMLBase::setSparseAccumulators(1);
+    return values;
+}
+
+BOOST_AUTO_TEST_CASE( sparseMatchesDense )
+{
+    vector<float> dense = runSimulation(0);
+    vector<float> sparse = runSimulation(1);
+
+    // The pulse has reached the PML on every side, including its outer half.
+    const int n = NUMCELLS;
+    const long ez = 2L*n*n*n;
+    BOOST_CHECK(dense[ez + (16*n + 16)*n + 2] != 0.0f);
+    BOOST_CHECK(dense[ez + (16*n + 16)*n + 29] != 0.0f);
+    BOOST_CHECK(dense[ez + (16*n + 2)*n + 16] != 0.0f);
+    BOOST_CHECK(dense[ez + (16*n + 29)*n + 16] != 0.0f);
+    BOOST_CHECK(dense[ez + (2*n + 16)*n + 16] != 0.0f);
+    BOOST_CHECK(dense[ez + (29*n + 16)*n + 16] != 0.0f);
+
+    long numDifferent = 0;
+    for (long nn = 0; nn < dense.size(); nn++)
+    if (memcmp(&dense[nn], &sparse[nn], sizeof(float)) != 0)
+        numDifferent++;
+    BOOST_CHECK_EQUAL(numDifferent, 0);
+}
@@ -0,0 +1,115 @@
+// Test the PML block kernels in VectorKernels.h against the per-cell update.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test PML kernels
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "VectorKernels.h"
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+// An odd number of cells, so the scalar tail runs too.
+static const int NUMCELLS = 4*TROGDOR_VECTOR_WIDTH + 3;
+
+static float
+randomFloat()
+{
+    return float(rand())/RAND_MAX - 0.5f;
+}
+
+static vector<float>
+randomVector()
+{
+    vector<float> v(NUMCELLS);
+    for (int nn = 0; nn < NUMCELLS; nn++)
+        v[nn] = randomFloat();
+    return v;
+}
+
+// One term of the per-cell update in CFSRIPML-inl.h.
+static float
+cellTerm(float & accum, float cCurl, float cAccumCurl, float cAccumJ,
+    float d)
+{
+    float Jnew = cCurl*d + accum;
+    accum += (cAccumCurl*d - cAccumJ*Jnew);
+    return Jnew;
+}
+
+static bool
+close(const vector<float> & a, const vector<float> & b)
+{
+    for (int nn = 0; nn < a.size(); nn++)
+    if (fabs(a[nn] - b[nn]) > 1e-6*(1.0 + fabs(b[nn])))
+        return 0;
+    return 1;
+}
+
+BOOST_AUTO_TEST_CASE( oneTerm )
+{
+    // Coefficients varying per cell, as along the attenuated direction.
+    vector<float> accum(randomVector()), cCurl(randomVector()),
+        cAccumCurl(randomVector()), cAccumJ(randomVector()),
+        dField(randomVector());
+    vector<float> expectedAccum(accum), expectedJ(NUMCELLS), J(NUMCELLS);
+    for (int nn = 0; nn < NUMCELLS; nn++)
+        expectedJ[nn] = -cellTerm(expectedAccum[nn], cCurl[nn],
+            cAccumCurl[nn], cAccumJ[nn], dField[nn]);
+    
+    float* pAccum = &accum[0];
+    const float* pCurl = &cCurl[0];
+    const float* pAccumCurl = &cAccumCurl[0];
+    const float* pAccumJ = &cAccumJ[0];
+    VectorKernels::pmlUpdate(pAccum, pCurl, pAccumCurl, pAccumJ, &dField[0],
+        -1.0f, &J[0], NUMCELLS);
+    
+    BOOST_CHECK(close(J, expectedJ));
+    BOOST_CHECK(close(accum, expectedAccum));
+    BOOST_CHECK(pAccum == &accum[0] + NUMCELLS);
+    BOOST_CHECK(pCurl == &cCurl[0] + NUMCELLS);
+}
+
+BOOST_AUTO_TEST_CASE( twoTerms )
+{
+    // Constant coefficients along j, varying along k, as in a PML edge.
+    float cCurlJ = randomFloat(), cAccumCurlJ = randomFloat(),
+        cAccumJJ = randomFloat();
+    vector<float> accumJ(randomVector()), dFieldJ(randomVector());
+    vector<float> accumK(randomVector()), cCurlK(randomVector()),
+        cAccumCurlK(randomVector()), cAccumJK(randomVector()),
+        dFieldK(randomVector());
+    
+    vector<float> expectedAccumJ(accumJ), expectedAccumK(accumK),
+        expectedJ(NUMCELLS), J(NUMCELLS);
+    for (int nn = 0; nn < NUMCELLS; nn++)
+    {
+        expectedJ[nn] = -cellTerm(expectedAccumJ[nn], cCurlJ, cAccumCurlJ,
+            cAccumJJ, dFieldJ[nn]) + cellTerm(expectedAccumK[nn], cCurlK[nn],
+            cAccumCurlK[nn], cAccumJK[nn], dFieldK[nn]);
+    }
+    
+    float* pAccumJ = &accumJ[0];
+    float* pAccumK = &accumK[0];
+    const float* pCurlK = &cCurlK[0];
+    const float* pAccumCurlK = &cAccumCurlK[0];
+    const float* pAccumJK = &cAccumJK[0];
+    VectorKernels::pmlUpdatePair(pAccumJ, cCurlJ, cAccumCurlJ, cAccumJJ,
+        &dFieldJ[0], -1.0f, pAccumK, pCurlK, pAccumCurlK, pAccumJK,
+        &dFieldK[0], 1.0f, &J[0], NUMCELLS);
+    
+    BOOST_CHECK(close(J, expectedJ));
+    BOOST_CHECK(close(accumJ, expectedAccumJ));
+    BOOST_CHECK(close(accumK, expectedAccumK));
+    BOOST_CHECK(pAccumJ == &accumJ[0] + NUMCELLS);
+    BOOST_CHECK(pAccumK == &accumK[0] + NUMCELLS);
+    BOOST_CHECK(pAccumJK == &cAccumJK[0] + NUMCELLS);
+}
+
+
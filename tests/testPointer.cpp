@@ -0,0 +1,106 @@
+// Test Pointer.h
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test Pointer
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "Pointer.h"
+#include <boost/thread/thread.hpp>
+#include <vector>
+
+using namespace std;
+
+// Counts live instances so the tests can see when things get deleted.
+class Counted
+{
+public:
+    Counted() { sNumLive++; }
+    ~Counted() { sNumLive--; }
+    static int sNumLive;
+};
+int Counted::sNumLive = 0;
+typedef Pointer<Counted> CountedPtr;
+
+// Link in a list, holding the only Pointer to the next link.
+class Link
+{
+public:
+    Counted mCounted;
+    Pointer<Link> mNext;
+};
+
+BOOST_AUTO_TEST_CASE( counting )
+{
+    {
+        CountedPtr p1(new Counted);
+        BOOST_CHECK_EQUAL(p1.refcount(), 1);
+        {
+            CountedPtr p2(p1);
+            CountedPtr p3;
+            BOOST_CHECK_EQUAL(p3.refcount(), 0);
+            p3 = p2;
+            BOOST_CHECK_EQUAL(p1.refcount(), 3);
+            p3 = p3;
+            BOOST_CHECK_EQUAL(p1.refcount(), 3);
+        }
+        BOOST_CHECK_EQUAL(p1.refcount(), 1);
+        BOOST_CHECK_EQUAL(Counted::sNumLive, 1);
+        
+        p1 = CountedPtr(new Counted);
+        BOOST_CHECK_EQUAL(Counted::sNumLive, 1);
+        p1 = 0;
+        BOOST_CHECK(p1 == 0L);
+        BOOST_CHECK_EQUAL(Counted::sNumLive, 0);
+    }
+    BOOST_CHECK_EQUAL(Counted::sNumLive, 0);
+}
+
+BOOST_AUTO_TEST_CASE( assignFromMember )
+{
+    // Stepping along the list deletes the old link, and with it the Pointer
+    // being assigned from.
+    Pointer<Link> link(new Link);
+    link->mNext = Pointer<Link>(new Link);
+    link->mNext->mNext = Pointer<Link>(new Link);
+    BOOST_CHECK_EQUAL(Counted::sNumLive, 3);
+    
+    link = link->mNext;
+    BOOST_CHECK_EQUAL(Counted::sNumLive, 2);
+    BOOST_CHECK_EQUAL(link.refcount(), 1);
+    link = link->mNext;
+    BOOST_CHECK_EQUAL(Counted::sNumLive, 1);
+    link = link->mNext;
+    BOOST_CHECK_EQUAL(Counted::sNumLive, 0);
+}
+
+static void
+copyManyTimes(CountedPtr* p)
+{
+    for (int nn = 0; nn < 100000; nn++)
+    {
+        CountedPtr copy(*p);
+        CountedPtr another;
+        another = copy;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( threads )
+{
+    CountedPtr p(new Counted);
+    vector<boost::thread*> threads;
+    for (int nn = 0; nn < 4; nn++)
+        threads.push_back(new boost::thread(copyManyTimes, &p));
+    for (int nn = 0; nn < threads.size(); nn++)
+    {
+        threads[nn]->join();
+        delete threads[nn];
+    }
+    BOOST_CHECK_EQUAL(p.refcount(), 1);
+    BOOST_CHECK_EQUAL(Counted::sNumLive, 1);
+}
+
+
@@ -0,0 +1,170 @@
+// Test the flux and energy outputs of ReductionOutput.cpp on whole
+// simulations run through FDTDApplication.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test ReductionOutput
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "SimulationFixture.h"
+#include "PhysicalConstants.h"
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+static const double DX = 5e-9;
+
+BOOST_AUTO_TEST_CASE( planeWave )
+{
+    // A pulse from a sheet of Ez at x = 20 runs along x in a grid that is
+    // periodic in y and z.  Downstream, the flux through one plane is
+    // Ez^2/eta per unit area, and the net flux out of a closed box that the
+    // whole pulse passes through adds up to nothing.  The pulse is strong
+    // enough that its spectral flux, in J/Hz, is well within float range.
+    const int NUMT = 360;
+    SimulationFixture::run(
+        "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"360\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Grid name=\"Main\" nx=\"80\" ny=\"6\" nz=\"6\" "
+        "nonPML=\"10 0 0 69 5 5\">\n"
+        "<AdditiveSource fields=\"ez\" formula=\"1e8*exp(-1*((n-60)/20)^2)\">"
+        "<Region yeeCells=\"20 0 0 20 5 5\"/></AdditiveSource>\n"
+        "<FieldOutput reduce=\"flux\" file=\"fluxPlane\" "
+        "frequencies=\"2e14 8e14\">"
+        "<Region yeeCells=\"40 1 1 40 3 3\"/></FieldOutput>\n"
+        "<FieldOutput reduce=\"flux\" file=\"fluxBox\">"
+        "<Region yeeCells=\"30 1 1 50 3 3\"/></FieldOutput>\n"
+        "<FieldOutput fields=\"ez\" file=\"fluxEz\">"
+        "<Region yeeCells=\"40 2 2 40 2 2\"/></FieldOutput>\n"
+        "<Assembly><Block yeeCells=\"0 0 0 79 5 5\" material=\"Vacuum\"/>"
+        "</Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n",
+        "planeWave");
+
+    vector<float> plane = SimulationFixture::read("fluxPlane", NUMT);
+    vector<float> box = SimulationFixture::read("fluxBox", NUMT);
+    vector<float> ez = SimulationFixture::read("fluxEz", NUMT);
+
+    const double eta = sqrt(Constants::mu0/Constants::eps0);
+    const double area = 9*DX*DX;
+    double planeSum = 0.0, boxSum = 0.0, expectedSum = 0.0;
+    for (int nn = 0; nn < NUMT; nn++)
+    {
+        planeSum += plane[nn];
+        boxSum += box[nn];
+        expectedSum += ez[nn]*ez[nn]*area/eta;
+    }
+
+    BOOST_TEST_MESSAGE("Plane " << planeSum << " expected " << expectedSum
+        << " box " << boxSum);
+    BOOST_CHECK(expectedSum > 0.0);
+    BOOST_CHECK(fabs(planeSum - expectedSum) < 0.02*expectedSum);
+    BOOST_CHECK(fabs(boxSum) < 1e-3*expectedSum);
+
+    // When the peak reaches the plane in the middle of the box, more of the
+    // pulse has flowed in than out.
+    int peak = 0;
+    for (int nn = 0; nn < NUMT; nn++)
+    if (plane[nn] > plane[peak])
+        peak = nn;
+    double boxSoFar = 0.0;
+    for (int nn = 0; nn <= peak; nn++)
+        boxSoFar += box[nn];
+    BOOST_CHECK(boxSoFar < -0.1*expectedSum);
+
+    // The spectral flux is |Ez(f)|^2/eta per unit area too.
+    const double dt = 9e-18;
+    const double frequencies[] = { 2e14, 8e14 };
+    vector<float> spectrum = SimulationFixture::read("fluxPlane.spectrum", 2);
+    for (int ff = 0; ff < 2; ff++)
+    {
+        double re = 0.0, im = 0.0;
+        for (int nn = 0; nn < NUMT; nn++)
+        {
+            double phase = 2.0*M_PI*frequencies[ff]*nn*dt;
+            re += ez[nn]*cos(phase)*dt;
+            im -= ez[nn]*sin(phase)*dt;
+        }
+        double expected = (re*re + im*im)*area/eta;
+        BOOST_TEST_MESSAGE("Spectrum " << spectrum[ff] << " expected " <<
+            expected);
+        BOOST_CHECK(fabs(spectrum[ff] - expected) < 0.02*expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( cavityEnergy )
+{
+    // A periodic box of vacuum with no PML keeps all the energy the source
+    // puts in.
+    const int NUMT = 400;
+    vector<float> energy = SimulationFixture::run(
+        "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"400\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Grid name=\"Main\" nx=\"20\" ny=\"20\" nz=\"20\" "
+        "nonPML=\"0 0 0 19 19 19\">\n"
+        "<AdditiveSource fields=\"ez\" formula=\"exp(-1*((n-20)/5)^2)\">"
+        "<Region yeeCells=\"10 10 10 10 10 10\"/></AdditiveSource>\n"
+        "<FieldOutput reduce=\"energy\" file=\"cavityEnergy\">"
+        "<Region yeeCells=\"0 0 0 19 19 19\"/></FieldOutput>\n"
+        "<Assembly><Block yeeCells=\"0 0 0 19 19 19\" material=\"Vacuum\"/>"
+        "</Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n",
+        "cavityEnergy", NUMT);
+
+    // The source is off (below 1e-30) after timestep 60.
+    const float reference = energy[60];
+    BOOST_CHECK(reference > 0.0f);
+    float worst = 0.0f;
+    for (int nn = 60; nn < NUMT; nn++)
+        worst = max(worst, float(fabs(energy[nn] - reference)));
+    BOOST_TEST_MESSAGE("Energy " << reference << " varies by " << worst);
+    BOOST_CHECK(worst < 1e-4f*reference);
+}
+
+
+BOOST_AUTO_TEST_CASE( dielectricCavityEnergy )
+{
+    // The same box, half of it glass and a slab of it magnetic, still keeps
+    // the energy if each field point is weighted by its own eps and mu.
+    const int NUMT = 400;
+    vector<float> energy = SimulationFixture::run(
+        "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"400\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Material name=\"Glass\" model=\"StaticDielectric\">"
+        "<Params epsr=\"4\"/></Material>\n"
+        "<Material name=\"Ferrite\" model=\"StaticLossyDielectric\">"
+        "<Params epsr=\"2\" mur=\"3\" sigma=\"0\"/></Material>\n"
+        "<Grid name=\"Main\" nx=\"20\" ny=\"20\" nz=\"20\" "
+        "nonPML=\"0 0 0 19 19 19\">\n"
+        "<AdditiveSource fields=\"ez\" formula=\"exp(-1*((n-20)/5)^2)\">"
+        "<Region yeeCells=\"5 10 10 5 10 10\"/></AdditiveSource>\n"
+        "<FieldOutput reduce=\"energy\" file=\"dielectricCavityEnergy\">"
+        "<Region yeeCells=\"0 0 0 19 19 19\"/></FieldOutput>\n"
+        "<Assembly><Block yeeCells=\"0 0 0 19 19 19\" material=\"Vacuum\"/>"
+        "<Block yeeCells=\"10 0 0 19 19 19\" material=\"Glass\"/>"
+        "<Block yeeCells=\"0 0 2 19 19 6\" material=\"Ferrite\"/>"
+        "</Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n",
+        "dielectricCavityEnergy", NUMT);
+
+    const float reference = energy[60];
+    BOOST_CHECK(reference > 0.0f);
+    float worst = 0.0f;
+    for (int nn = 60; nn < NUMT; nn++)
+        worst = max(worst, float(fabs(energy[nn] - reference)));
+    BOOST_TEST_MESSAGE("Energy " << reference << " varies by " << worst);
+    BOOST_CHECK(worst < 1e-4f*reference);
+}
@@ -0,0 +1,129 @@
+// Compare a whole simulation with half-size field storage against float.
+//
+// The same file is built once per storage type (see tests/CMakeLists.txt).
+// The float build runs a pulse into a Drude/Lorentz metal surrounded by PML
+// and saves the fields as the reference; the bfloat16 and half builds run the
+// same simulation through the real update equations and compare with it, so
+// run testStorageAccuracy first, in the same directory.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test storage accuracy
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "SimulationFixture.h"
+#include "FieldStorage.h"
+#include "VectorKernels.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+static const char* REFERENCE_FILE = "storageAccuracy.reference";
+
+// Run the simulation and return E on a plane through the metal at the last
+// timestep.
+static vector<float>
+runSimulation()
+{
+    return SimulationFixture::run(
+        "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"200\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Material name=\"Metal\" model=\"MultiPole\">"
+        "<Params epsinf=\"2\" pole1=\"Drude\" omegap1=\"1.37e16\" "
+        "gamma1=\"1e14\" pole2=\"Lorentz\" deltaeps2=\"1.5\" omega2=\"4e15\" "
+        "gamma2=\"1e15\"/></Material>\n"
+        "<Grid name=\"Main\" nx=\"40\" ny=\"40\" nz=\"40\" "
+        "nonPML=\"8 8 8 31 31 31\">\n"
+        "<AdditiveSource fields=\"ez\" formula=\"exp(-1*((n-30)/10)^2)\">"
+        "<Region yeeCells=\"12 20 20 12 20 20\"/></AdditiveSource>\n"
+        "<FieldOutput fields=\"electric\" file=\"storageAccuracy.E\">"
+        "<Region yeeCells=\"0 0 20 39 39 20\"/>"
+        "<Duration timestep=\"199\"/></FieldOutput>\n"
+        "<Assembly>"
+        "<Block yeeCells=\"0 0 0 39 39 39\" material=\"Vacuum\"/>"
+        "<Block yeeCells=\"16 14 14 23 25 25\" material=\"Metal\"/>"
+        "</Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n",
+        "storageAccuracy.E", 3*40*40);
+}
+
+BOOST_AUTO_TEST_CASE( vectorConversions )
+{
+    // The block kernels convert FieldStorage a register at a time; they must
+    // round exactly as the scalar conversion does, including values that are
+    // out of range for half and NaN.
+    const int NUMCELLS = 4*TROGDOR_VECTOR_WIDTH + 3;
+    vector<float> a(NUMCELLS), b(NUMCELLS), zero(NUMCELLS, 0.0f);
+    vector<FieldStorage> field(NUMCELLS), expected(NUMCELLS);
+    for (int nn = 0; nn < NUMCELLS; nn++)
+    {
+        a[nn] = (float(rand())/RAND_MAX - 0.5f)*pow(10.0f, nn%12 - 6);
+        b[nn] = 0.0f;
+        field[nn] = float(rand())/RAND_MAX;
+    }
+    a[1] = 1e6f;
+    a[2] = -1e-9f;
+    a[3] = sqrt(-1.0f);
+
+    for (int nn = 0; nn < NUMCELLS; nn++)
+        expected[nn] = field[nn] + 1.0f*(a[nn] - b[nn] - zero[nn]);
+    VectorKernels::staticUpdate(&field[0], 1.0f, &a[0], &b[0], &zero[0],
+        NUMCELLS);
+
+    for (int nn = 0; nn < NUMCELLS; nn++)
+    {
+        float got = field[nn], want = expected[nn];
+        if (want != want)
+            BOOST_CHECK(got != got);
+        else
+            BOOST_CHECK_EQUAL(got, want);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( fullUpdate )
+{
+    vector<float> E = runSimulation();
+
+    double norm2 = 0.0;
+    for (int nn = 0; nn < E.size(); nn++)
+        norm2 += E[nn]*E[nn];
+    BOOST_CHECK(norm2 == norm2); // not NaN
+    BOOST_CHECK(norm2 > 0.0);
+
+#if defined(TROGDOR_STORAGE_BF16) || defined(TROGDOR_STORAGE_FP16)
+    ifstream refFile(REFERENCE_FILE, ios::binary);
+    BOOST_REQUIRE_MESSAGE(refFile.good(),
+        "Run testStorageAccuracy (float) first to make the reference.");
+    vector<float> reference(E.size());
+    refFile.read((char*)&reference[0], reference.size()*sizeof(float));
+    BOOST_REQUIRE(refFile.good());
+
+    double error2 = 0.0, reference2 = 0.0;
+    for (int nn = 0; nn < E.size(); nn++)
+    {
+        error2 += (E[nn] - reference[nn])*(E[nn] - reference[nn]);
+        reference2 += reference[nn]*reference[nn];
+    }
+    double relativeError = sqrt(error2/reference2);
+    BOOST_TEST_MESSAGE(TROGDOR_STORAGE_NAME << " relative error " <<
+        relativeError);
+#if defined(TROGDOR_STORAGE_BF16)
+    BOOST_CHECK(relativeError < 2e-2);
+#else
+    BOOST_CHECK(relativeError < 2e-3);
+#endif
+#else
+    ofstream refFile(REFERENCE_FILE, ios::binary);
+    refFile.write((char*)&E[0], E.size()*sizeof(float));
+#endif
+}
+
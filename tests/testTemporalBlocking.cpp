@@ -0,0 +1,106 @@
+// Compare a whole simulation updated several timesteps at a time, between
+// sources and outputs, against the same simulation stepped one timestep at a
+// time.
+//
+// The source is on for the first 30 timesteps and a point output samples
+// every 17, so the run is cut into blocks of different lengths.  The grid is
+// periodic along z, the slowest memory direction, where the blocks wrap
+// around, and has PML along x and y.  Vacuum and a Drude/Lorentz metal take
+// the block update, a StaticLossyDielectric block takes the per-cell update,
+// and a perfect conductor has no update at all.  With three threads the
+// planes are split into three segments, each with its own seam.
+
+// these two defines tell Boost to provide a main() function.  GRRRRR WHY
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Test temporal blocking
+
+// my main() is defined in boost/test/unit_test.hpp.
+#include <boost/test/unit_test.hpp>
+
+#include "SimulationFixture.h"
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+static const int NX = 24, NY = 20, NZ = 40;
+
+// Run the simulation and return E and H everywhere at the last timestep.
+static vector<float>
+runSimulation(int timeBlock, int numThreads, bool fuse)
+{
+    ostringstream xml;
+    xml << "<Simulation version=\"5.0\" dx=\"5e-9\" dy=\"5e-9\" dz=\"5e-9\" "
+        "dt=\"9e-18\" numT=\"120\">\n"
+        "<Material name=\"Vacuum\" model=\"StaticDielectric\">"
+        "<Params epsr=\"1\"/></Material>\n"
+        "<Material name=\"Lossy\" model=\"StaticLossyDielectric\">"
+        "<Params epsr=\"2\" sigma=\"1e5\"/></Material>\n"
+        "<Material name=\"Metal\" model=\"MultiPole\">"
+        "<Params epsinf=\"2\" pole1=\"Drude\" omegap1=\"1.37e16\" "
+        "gamma1=\"1e14\" pole2=\"Lorentz\" deltaeps2=\"1.5\" omega2=\"4e15\" "
+        "gamma2=\"1e15\"/></Material>\n"
+        "<Material name=\"PEC\" model=\"PerfectConductor\"/>\n"
+        "<Grid name=\"Main\" nx=\"24\" ny=\"20\" nz=\"40\" "
+        "nonPML=\"5 5 0 18 14 39\">\n"
+        "<AdditiveSource fields=\"ex ey ez\" "
+        "formula=\"exp(-1*((n-15)/5)^2)\">"
+        "<Region yeeCells=\"10 9 2 10 9 2\"/>"
+        "<Duration firstTimestep=\"0\" lastTimestep=\"30\"/>"
+        "</AdditiveSource>\n"
+        "<FieldOutput fields=\"ez\" file=\"temporalBlockingPoint\">"
+        "<Region yeeCells=\"12 10 30 12 10 30\"/>"
+        "<Duration period=\"17\"/></FieldOutput>\n"
+        "<FieldOutput fields=\"electric magnetic\" file=\"temporalBlocking.EH\">"
+        "<Region yeeCells=\"0 0 0 23 19 39\"/>"
+        "<Duration timestep=\"119\"/></FieldOutput>\n"
+        "<Assembly>"
+        "<Block yeeCells=\"0 0 0 23 19 39\" material=\"Vacuum\"/>"
+        "<Ellipsoid yeeCells=\"8 6 10 16 14 18\" material=\"Metal\"/>"
+        "<Block yeeCells=\"6 4 24 17 15 27\" material=\"Lossy\"/>"
+        "<Block yeeCells=\"11 5 34 12 14 36\" material=\"PEC\"/>"
+        "</Assembly>\n"
+        "</Grid>\n"
+        "</Simulation>\n";
+
+    SimulationPreferences prefs;
+    prefs.timeBlockTimesteps = timeBlock;
+    prefs.numThreads = numThreads;
+    prefs.fuseComponents = fuse;
+    return SimulationFixture::run(xml.str(), "temporalBlocking.EH",
+        6*NX*NY*NZ, prefs);
+}
+
+static long
+numDifferent(const vector<float> & a, const vector<float> & b)
+{
+    long count = 0;
+    for (long nn = 0; nn < a.size(); nn++)
+    if (memcmp(&a[nn], &b[nn], sizeof(float)) != 0)
+        count++;
+    return count;
+}
+
+BOOST_AUTO_TEST_CASE( blockedMatchesStepped )
+{
+    vector<float> stepped = runSimulation(0, 1, 0);
+    vector<float> blocked = runSimulation(8, 1, 0);
+
+    double norm2 = 0.0;
+    for (long nn = 0; nn < stepped.size(); nn++)
+        norm2 += stepped[nn]*stepped[nn];
+    BOOST_CHECK(norm2 == norm2); // not NaN
+    BOOST_CHECK(norm2 > 0.0);
+
+    BOOST_CHECK_EQUAL(numDifferent(stepped, blocked), 0);
+}
+
+BOOST_AUTO_TEST_CASE( threadedBlockedMatchesStepped )
+{
+    vector<float> stepped = runSimulation(0, 1, 1);
+    vector<float> blocked = runSimulation(6, 3, 1);
+
+    BOOST_CHECK_EQUAL(numDifferent(stepped, blocked), 0);
+}
@@ -0,0 +1,99 @@
+/*
+ *  trogdorChunks.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+// Reader for chunked output files (trogdor --chunked).
+//
+//  trogdor_chunks data
+//      Print the spec embedded in the file and the size of every sample.
+//
+//  trogdor_chunks data out [firstSample [lastSample [firstValue numValues]]]
+//      Write samples firstSample to lastSample to out as raw floats, the same
+//      as an unchunked data file.  With firstValue and numValues only those
+//      floats of each sample are written, and only the chunks that hold them
+//      are decompressed.
+
+#include "ChunkedFile.h"
+#include "Exception.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static void
+usage()
+{
+    cerr << "usage: trogdor_chunks data [out [firstSample [lastSample "
+        "[firstValue numValues]]]]\n";
+    exit(1);
+}
+
+static void
+printInfo(const ChunkedFileReader & reader)
+{
+    cout << reader.metadata();
+    cout << "chunkLength " << reader.chunkLength() << "\n";
+    cout << "numSamples " << reader.numSamples() << "\n";
+    for (long nn = 0; nn < reader.numSamples(); nn++)
+        cout << "sample " << nn << " " << reader.sampleLength(nn) << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc == 6 || argc > 7)
+        usage();
+
+    try
+    {
+        ChunkedFileReader reader(argv[1]);
+        if (argc == 2)
+        {
+            printInfo(reader);
+            return 0;
+        }
+
+        long firstSample = 0;
+        long lastSample = reader.numSamples()-1;
+        if (argc > 3)
+            firstSample = atol(argv[3]);
+        if (argc > 4)
+            lastSample = atol(argv[4]);
+        if (firstSample < 0 || lastSample >= reader.numSamples())
+        {
+            cerr << "The file has samples 0 to " << reader.numSamples()-1
+                << ".\n";
+            return 1;
+        }
+
+        ofstream out(argv[2], ios::out | ios::binary);
+        vector<float> values;
+        for (long nn = firstSample; nn <= lastSample; nn++)
+        {
+            if (argc == 7)
+                reader.read(nn, atol(argv[5]), atol(argv[6]), values);
+            else
+                reader.readSample(nn, values);
+            if (values.size() > 0)
+                out.write((const char*)&values[0],
+                    values.size()*sizeof(float));
+        }
+        if (!out.good())
+        {
+            cerr << "Could not write " << argv[2] << ".\n";
+            return 1;
+        }
+    }
+    catch (const Exception & e)
+    {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -9,7 +9,7 @@
 
 #include "BufferedCurrent.h"
 
-const float ONE = 1.0; // we'll access this through a pointer often.
+const FieldStorage ONE = 1.0f; // we'll access this through a pointer often.
 
 inline void BufferedCurrent::
 initLocalE(LocalDataE & data, int dir0)
@@ -36,6 +36,15 @@ initLocalE(LocalDataE & data, int dir0)
     data.polarizationFactor = mPolarizationVector[dir0];
 }
 
+// Used by threads that start partway through the runlines: move J ahead as
+// though afterUpdateE() had been called numCells times.
+inline void BufferedCurrent::
+skipCellsE(LocalDataE & data, long numCells)
+{
+    data.J += numCells*data.stride;
+    data.mask += numCells*data.maskStride;
+}
+
 inline void BufferedCurrent::
 onStartRunlineE(LocalDataE & data, const SimpleRunline & rl)
 {
@@ -88,6 +97,13 @@ initLocalH(LocalDataH & data, int dir0)
     data.polarizationFactor = mPolarizationVector[dir0];
 }
 
+inline void BufferedCurrent::
+skipCellsH(LocalDataH & data, long numCells)
+{
+    data.K += numCells*data.stride;
+    data.mask += numCells*data.maskStride;
+}
+
 inline void BufferedCurrent::
 onStartRunlineH(LocalDataH & data, const SimpleRunline & rl)
 {
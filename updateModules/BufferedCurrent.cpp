@@ -62,7 +62,7 @@ setCurrentSource(CurrentSource* sourceOfData, int myMaterialID)
     else
         mStrideMask = 0;
     
-    if (sourceOfData->description()->isSpaceVarying())
+    if (sourceOfData->isSpaceVarying())
         mStride = 1;
     else
         mStride = 0;
@@ -20,17 +20,19 @@ class BufferedCurrent
 public:
     BufferedCurrent(std::vector<long> numCellsE, std::vector<long> numCellsH);
     
+    static const bool VECTORIZED = false;
+    
     struct LocalDataE {
-        float* J;
-        const float* mask;
+        FieldStorage* J;
+        const FieldStorage* mask;
         float polarizationFactor;
         long stride;
         long maskStride;
     };
     
     struct LocalDataH {
-        float* K;
-        const float* mask;
+        FieldStorage* K;
+        const FieldStorage* mask;
         float polarizationFactor;
         long stride;
         long maskStride;
@@ -40,6 +42,7 @@ public:
     void allocateAuxBuffers();
     
     void initLocalE(LocalDataE & data, int dir0);
+    void skipCellsE(LocalDataE & data, long numCells);
     void onStartRunlineE(LocalDataE & data, const SimpleRunline & rl);
     void beforeUpdateE(LocalDataE & data, float Ei, float dHj, float dHk);
     float updateJ(LocalDataE & data, float Ei, float dHj, float dHk,
@@ -47,6 +50,7 @@ public:
     void afterUpdateE(LocalDataE & data, float Ei, float dHj, float dHk);
     
     void initLocalH(LocalDataH & data, int dir0);
+    void skipCellsH(LocalDataH & data, long numCells);
     void onStartRunlineH(LocalDataH & data, const SimpleRunline & rl);
     void beforeUpdateH(LocalDataH & data, float Hi, float dEj, float dEk);
     float updateK(LocalDataH & data, float Hi, float dEj, float dEk,
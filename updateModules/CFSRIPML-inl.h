@@ -34,7 +34,7 @@ onStartRunlineE(LocalDataE<0> & data,
     */
     if (J_ATTEN)
     {
-        data.Phi_ij = &(mAccumEj[dir0][rl.auxIndex]);
+        data.Phi_ij = accumulator(mAccumEj[dir0], rl.accumIndex[0]);
         data.c_JijH = mC_JjH[dir0][rl.pmlIndex[dir1]];
         data.c_Phi_ijH = mC_PhijH[dir0][rl.pmlIndex[dir1]];
         data.c_Phi_ijJ = mC_PhijJ[dir0][rl.pmlIndex[dir1]];
@@ -42,7 +42,7 @@ onStartRunlineE(LocalDataE<0> & data,
     
     if (K_ATTEN)
     {
-        data.Phi_ik = &mAccumEk[dir0][rl.auxIndex];
+        data.Phi_ik = accumulator(mAccumEk[dir0], rl.accumIndex[1]);
         data.c_JikH = mC_JkH[dir0][rl.pmlIndex[dir2]];
         data.c_Phi_ikH = mC_PhikH[dir0][rl.pmlIndex[dir2]];
         data.c_Phi_ikJ = mC_PhikJ[dir0][rl.pmlIndex[dir2]];
@@ -56,7 +56,7 @@ onStartRunlineE(LocalDataE<1> & data,
 {
     if (K_ATTEN)
     {
-        data.Phi_ij = &mAccumEj[dir0][rl.auxIndex];
+        data.Phi_ij = accumulator(mAccumEj[dir0], rl.accumIndex[0]);
         data.c_JijH = mC_JjH[dir0][rl.pmlIndex[dir1]];
         data.c_Phi_ijH = mC_PhijH[dir0][rl.pmlIndex[dir1]];
         data.c_Phi_ijJ = mC_PhijJ[dir0][rl.pmlIndex[dir1]];
@@ -64,7 +64,7 @@ onStartRunlineE(LocalDataE<1> & data,
     
     if (I_ATTEN)
     {
-        data.Phi_ik = &mAccumEk[dir0][rl.auxIndex];
+        data.Phi_ik = accumulator(mAccumEk[dir0], rl.accumIndex[1]);
         data.c_JikH = &mC_JkH[dir0][rl.pmlIndex[dir2]];
         data.c_Phi_ikH = &mC_PhikH[dir0][rl.pmlIndex[dir2]];
         data.c_Phi_ikJ = &mC_PhikJ[dir0][rl.pmlIndex[dir2]];
@@ -78,7 +78,7 @@ onStartRunlineE(LocalDataE<2> & data,
 {
     if (I_ATTEN)
     {
-        data.Phi_ij = &mAccumEj[dir0][rl.auxIndex];
+        data.Phi_ij = accumulator(mAccumEj[dir0], rl.accumIndex[0]);
         data.c_JijH = &mC_JjH[dir0][rl.pmlIndex[dir1]];
         data.c_Phi_ijH = &mC_PhijH[dir0][rl.pmlIndex[dir1]];
         data.c_Phi_ijJ = &mC_PhijJ[dir0][rl.pmlIndex[dir1]];
@@ -86,7 +86,7 @@ onStartRunlineE(LocalDataE<2> & data,
     
     if (J_ATTEN)
     {
-        data.Phi_ik = &mAccumEk[dir0][rl.auxIndex];
+        data.Phi_ik = accumulator(mAccumEk[dir0], rl.accumIndex[1]);
         data.c_JikH = mC_JkH[dir0][rl.pmlIndex[dir2]];
         data.c_Phi_ikH = mC_PhikH[dir0][rl.pmlIndex[dir2]];
         data.c_Phi_ikJ = mC_PhikJ[dir0][rl.pmlIndex[dir2]];
@@ -98,16 +98,16 @@ template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 inline float CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
 updateJ(LocalDataE<0> & data, float Ei, float dHj, float dHk)
 {
-    float Jij, Jik;
+    float Jij = 0.0f, Jik = 0.0f;
     
-    if (J_ATTEN)
+    if (J_ATTEN && data.Phi_ij != 0L)
     {
         Jij = data.c_JijH*dHk + *data.Phi_ij;
         *data.Phi_ij += (data.c_Phi_ijH*dHk - data.c_Phi_ijJ*Jij);
         data.Phi_ij++;
     }
     
-    if (K_ATTEN)
+    if (K_ATTEN && data.Phi_ik != 0L)
     {
         Jik = data.c_JikH*dHj + *data.Phi_ik;
         *data.Phi_ik += (data.c_Phi_ikH*dHj - data.c_Phi_ikJ*Jik);
@@ -128,16 +128,16 @@ template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 inline float CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
 updateJ(LocalDataE<1> & data, float Ei, float dHj, float dHk)
 {
-    float Jij, Jik;
+    float Jij = 0.0f, Jik = 0.0f;
     
-    if (K_ATTEN)
+    if (K_ATTEN && data.Phi_ij != 0L)
     {
         Jij = data.c_JijH*dHk + *data.Phi_ij;
         *data.Phi_ij += (data.c_Phi_ijH*dHk - data.c_Phi_ijJ*Jij);
         data.Phi_ij++;
     }
     
-    if (I_ATTEN)
+    if (I_ATTEN && data.Phi_ik != 0L)
     {
         Jik = *data.c_JikH*dHj + *data.Phi_ik;
         *data.Phi_ik += (*data.c_Phi_ikH*dHj - *data.c_Phi_ikJ*Jik);
@@ -161,9 +161,9 @@ inline float CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
 updateJ(LocalDataE<2> & data, float Ei, float dHj, float dHk)
 {
     // Be careful here.  We return -Jij, not Jij.
-    float Jij, Jik;
+    float Jij = 0.0f, Jik = 0.0f;
     
-    if (I_ATTEN)
+    if (I_ATTEN && data.Phi_ij != 0L)
     {
         Jij = *data.c_JijH*dHk + *data.Phi_ij;
         *data.Phi_ij += (*data.c_Phi_ijH*dHk - *data.c_Phi_ijJ*Jij);
@@ -173,7 +173,7 @@ updateJ(LocalDataE<2> & data, float Ei, float dHj, float dHk)
         data.c_Phi_ijJ++;
     }
     
-    if (J_ATTEN)
+    if (J_ATTEN && data.Phi_ik != 0L)
     {
         Jik = data.c_JikH*dHj + *data.Phi_ik;
         *data.Phi_ik += (data.c_Phi_ikH*dHj - data.c_Phi_ikJ*Jik);
@@ -193,6 +193,79 @@ updateJ(LocalDataE<2> & data, float Ei, float dHj, float dHk)
 
 
 
+// The block updates do the same arithmetic as the per-cell updates above, for
+// len cells at once.  Cells attenuated along both directions perpendicular to
+// the field (the edges and corners of the PML) take both terms in one pass.
+// A term whose accumulator isn't stored for the runline (see
+// CFSRIPMLBase::allocateAuxBuffers()) is zero and is left out.
+
+template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
+inline void CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
+updateJ(LocalDataE<0> & data, const float* dHj, const float* dHk, float* Ji,
+    int len)
+{
+    bool j = J_ATTEN && data.Phi_ij != 0L;
+    bool k = K_ATTEN && data.Phi_ik != 0L;
+    if (j && k)
+        VectorKernels::pmlUpdatePair(data.Phi_ij, data.c_JijH,
+            data.c_Phi_ijH, data.c_Phi_ijJ, dHk, -1.0f,
+            data.Phi_ik, data.c_JikH, data.c_Phi_ikH,
+            data.c_Phi_ikJ, dHj, 1.0f, Ji, len);
+    else if (j)
+        VectorKernels::pmlUpdate(data.Phi_ij, data.c_JijH, data.c_Phi_ijH,
+            data.c_Phi_ijJ, dHk, -1.0f, Ji, len);
+    else if (k)
+        VectorKernels::pmlUpdate(data.Phi_ik, data.c_JikH, data.c_Phi_ikH,
+            data.c_Phi_ikJ, dHj, 1.0f, Ji, len);
+    else
+        VectorKernels::zero(Ji, len);
+}
+
+template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
+inline void CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
+updateJ(LocalDataE<1> & data, const float* dHj, const float* dHk, float* Ji,
+    int len)
+{
+    bool j = K_ATTEN && data.Phi_ij != 0L;
+    bool k = I_ATTEN && data.Phi_ik != 0L;
+    if (j && k)
+        VectorKernels::pmlUpdatePair(data.Phi_ij, data.c_JijH,
+            data.c_Phi_ijH, data.c_Phi_ijJ, dHk, -1.0f,
+            data.Phi_ik, data.c_JikH, data.c_Phi_ikH,
+            data.c_Phi_ikJ, dHj, 1.0f, Ji, len);
+    else if (j)
+        VectorKernels::pmlUpdate(data.Phi_ij, data.c_JijH, data.c_Phi_ijH,
+            data.c_Phi_ijJ, dHk, -1.0f, Ji, len);
+    else if (k)
+        VectorKernels::pmlUpdate(data.Phi_ik, data.c_JikH, data.c_Phi_ikH,
+            data.c_Phi_ikJ, dHj, 1.0f, Ji, len);
+    else
+        VectorKernels::zero(Ji, len);
+}
+
+template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
+inline void CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
+updateJ(LocalDataE<2> & data, const float* dHj, const float* dHk, float* Ji,
+    int len)
+{
+    bool j = I_ATTEN && data.Phi_ij != 0L;
+    bool k = J_ATTEN && data.Phi_ik != 0L;
+    if (j && k)
+        VectorKernels::pmlUpdatePair(data.Phi_ij, data.c_JijH,
+            data.c_Phi_ijH, data.c_Phi_ijJ, dHk, -1.0f,
+            data.Phi_ik, data.c_JikH, data.c_Phi_ikH,
+            data.c_Phi_ikJ, dHj, 1.0f, Ji, len);
+    else if (j)
+        VectorKernels::pmlUpdate(data.Phi_ij, data.c_JijH, data.c_Phi_ijH,
+            data.c_Phi_ijJ, dHk, -1.0f, Ji, len);
+    else if (k)
+        VectorKernels::pmlUpdate(data.Phi_ik, data.c_JikH, data.c_Phi_ikH,
+            data.c_Phi_ikJ, dHj, 1.0f, Ji, len);
+    else
+        VectorKernels::zero(Ji, len);
+}
+
+
 template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 void CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
 onStartRunlineH(LocalDataH<0> & data,
@@ -200,7 +273,7 @@ onStartRunlineH(LocalDataH<0> & data,
 {
     if (J_ATTEN)
     {
-        data.Psi_ij = &mAccumHj[dir0][rl.auxIndex];
+        data.Psi_ij = accumulator(mAccumHj[dir0], rl.accumIndex[0]);
         data.c_MijE = mC_MjE[dir0][rl.pmlIndex[dir1]];
         data.c_Psi_ijE = mC_PsijE[dir0][rl.pmlIndex[dir1]];
         data.c_Psi_ijM = mC_PsijM[dir0][rl.pmlIndex[dir1]];
@@ -208,7 +281,7 @@ onStartRunlineH(LocalDataH<0> & data,
     
     if (K_ATTEN)
     {
-        data.Psi_ik = &mAccumHk[dir0][rl.auxIndex];
+        data.Psi_ik = accumulator(mAccumHk[dir0], rl.accumIndex[1]);
         data.c_MikE = mC_MkE[dir0][rl.pmlIndex[dir2]];
         data.c_Psi_ikE = mC_PsikE[dir0][rl.pmlIndex[dir2]];
         data.c_Psi_ikM = mC_PsikM[dir0][rl.pmlIndex[dir2]];
@@ -222,7 +295,7 @@ onStartRunlineH(LocalDataH<1> & data,
 {
     if (K_ATTEN)
     {
-        data.Psi_ij = &mAccumHj[dir0][rl.auxIndex];
+        data.Psi_ij = accumulator(mAccumHj[dir0], rl.accumIndex[0]);
         data.c_MijE = mC_MjE[dir0][rl.pmlIndex[dir1]];
         data.c_Psi_ijE = mC_PsijE[dir0][rl.pmlIndex[dir1]];
         data.c_Psi_ijM = mC_PsijM[dir0][rl.pmlIndex[dir1]];
@@ -230,7 +303,7 @@ onStartRunlineH(LocalDataH<1> & data,
     
     if (I_ATTEN)
     {
-        data.Psi_ik = &mAccumHk[dir0][rl.auxIndex];
+        data.Psi_ik = accumulator(mAccumHk[dir0], rl.accumIndex[1]);
         data.c_MikE = &mC_MkE[dir0][rl.pmlIndex[dir2]];
         data.c_Psi_ikE = &mC_PsikE[dir0][rl.pmlIndex[dir2]];
         data.c_Psi_ikM = &mC_PsikM[dir0][rl.pmlIndex[dir2]];
@@ -244,7 +317,7 @@ onStartRunlineH(LocalDataH<2> & data,
 {
     if (I_ATTEN)
     {
-        data.Psi_ij = &mAccumHj[dir0][rl.auxIndex];
+        data.Psi_ij = accumulator(mAccumHj[dir0], rl.accumIndex[0]);
         data.c_MijE = &mC_MjE[dir0][rl.pmlIndex[dir1]];
         data.c_Psi_ijE = &mC_PsijE[dir0][rl.pmlIndex[dir1]];
         data.c_Psi_ijM = &mC_PsijM[dir0][rl.pmlIndex[dir1]];
@@ -252,7 +325,7 @@ onStartRunlineH(LocalDataH<2> & data,
     
     if (J_ATTEN)
     {
-        data.Psi_ik = &mAccumHk[dir0][rl.auxIndex];
+        data.Psi_ik = accumulator(mAccumHk[dir0], rl.accumIndex[1]);
         data.c_MikE = mC_MkE[dir0][rl.pmlIndex[dir2]];
         data.c_Psi_ikE = mC_PsikE[dir0][rl.pmlIndex[dir2]];
         data.c_Psi_ikM = mC_PsikM[dir0][rl.pmlIndex[dir2]];
@@ -263,15 +336,15 @@ template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 inline float CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
 updateK(LocalDataH<0> & data, float Hi, float dEj, float dEk)
 {
-    float Mij, Mik;
-    if (J_ATTEN)
+    float Mij = 0.0f, Mik = 0.0f;
+    if (J_ATTEN && data.Psi_ij != 0L)
     {
         Mij = data.c_MijE*dEk + *data.Psi_ij;
         *data.Psi_ij += (data.c_Psi_ijE*dEk - data.c_Psi_ijM*Mij);
         data.Psi_ij++;
     }
     
-    if (K_ATTEN)
+    if (K_ATTEN && data.Psi_ik != 0L)
     {
         Mik = data.c_MikE*dEj + *data.Psi_ik;
         *data.Psi_ik += (data.c_Psi_ikE*dEj - data.c_Psi_ikM*Mik);
@@ -291,16 +364,16 @@ template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 inline float CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
 updateK(LocalDataH<1> & data, float Hi, float dEj, float dEk)
 {
-    float Mij, Mik;
+    float Mij = 0.0f, Mik = 0.0f;
     
-    if (K_ATTEN)
+    if (K_ATTEN && data.Psi_ij != 0L)
     {
         Mij = data.c_MijE*dEk + *data.Psi_ij;
         *data.Psi_ij += (data.c_Psi_ijE*dEk - data.c_Psi_ijM*Mij);
         data.Psi_ij++;
     }
     
-    if (I_ATTEN)
+    if (I_ATTEN && data.Psi_ik != 0L)
     {
         Mik = *data.c_MikE*dEj + *data.Psi_ik;
         *data.Psi_ik += (*data.c_Psi_ikE*dEj - *data.c_Psi_ikM*Mik);
@@ -323,9 +396,9 @@ template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 inline float CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
 updateK(LocalDataH<2> & data, float Hi, float dEj, float dEk)
 {
-    float Mij, Mik;
+    float Mij = 0.0f, Mik = 0.0f;
     
-    if (I_ATTEN)
+    if (I_ATTEN && data.Psi_ij != 0L)
     {
         Mij = *data.c_MijE*dEk + *data.Psi_ij;
         *data.Psi_ij += (*data.c_Psi_ijE*dEk - *data.c_Psi_ijM*Mij);
@@ -335,7 +408,7 @@ updateK(LocalDataH<2> & data, float Hi, float dEj, float dEk)
         data.Psi_ij++;
     }
     
-    if (J_ATTEN)
+    if (J_ATTEN && data.Psi_ik != 0L)
     {
         Mik = data.c_MikE*dEj + *data.Psi_ik;
         *data.Psi_ik += (data.c_Psi_ikE*dEj - data.c_Psi_ikM*Mik);
@@ -351,3 +424,68 @@ updateK(LocalDataH<2> & data, float Hi, float dEj, float dEk)
     return 0.0;
 }
 
+template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
+inline void CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
+updateK(LocalDataH<0> & data, const float* dEj, const float* dEk, float* Ki,
+    int len)
+{
+    bool j = J_ATTEN && data.Psi_ij != 0L;
+    bool k = K_ATTEN && data.Psi_ik != 0L;
+    if (j && k)
+        VectorKernels::pmlUpdatePair(data.Psi_ij, data.c_MijE,
+            data.c_Psi_ijE, data.c_Psi_ijM, dEk, 1.0f,
+            data.Psi_ik, data.c_MikE, data.c_Psi_ikE,
+            data.c_Psi_ikM, dEj, -1.0f, Ki, len);
+    else if (j)
+        VectorKernels::pmlUpdate(data.Psi_ij, data.c_MijE, data.c_Psi_ijE,
+            data.c_Psi_ijM, dEk, 1.0f, Ki, len);
+    else if (k)
+        VectorKernels::pmlUpdate(data.Psi_ik, data.c_MikE, data.c_Psi_ikE,
+            data.c_Psi_ikM, dEj, -1.0f, Ki, len);
+    else
+        VectorKernels::zero(Ki, len);
+}
+
+template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
+inline void CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
+updateK(LocalDataH<1> & data, const float* dEj, const float* dEk, float* Ki,
+    int len)
+{
+    bool j = K_ATTEN && data.Psi_ij != 0L;
+    bool k = I_ATTEN && data.Psi_ik != 0L;
+    if (j && k)
+        VectorKernels::pmlUpdatePair(data.Psi_ij, data.c_MijE,
+            data.c_Psi_ijE, data.c_Psi_ijM, dEk, 1.0f,
+            data.Psi_ik, data.c_MikE, data.c_Psi_ikE,
+            data.c_Psi_ikM, dEj, -1.0f, Ki, len);
+    else if (j)
+        VectorKernels::pmlUpdate(data.Psi_ij, data.c_MijE, data.c_Psi_ijE,
+            data.c_Psi_ijM, dEk, 1.0f, Ki, len);
+    else if (k)
+        VectorKernels::pmlUpdate(data.Psi_ik, data.c_MikE, data.c_Psi_ikE,
+            data.c_Psi_ikM, dEj, -1.0f, Ki, len);
+    else
+        VectorKernels::zero(Ki, len);
+}
+
+template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
+inline void CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::
+updateK(LocalDataH<2> & data, const float* dEj, const float* dEk, float* Ki,
+    int len)
+{
+    bool j = I_ATTEN && data.Psi_ij != 0L;
+    bool k = J_ATTEN && data.Psi_ik != 0L;
+    if (j && k)
+        VectorKernels::pmlUpdatePair(data.Psi_ij, data.c_MijE,
+            data.c_Psi_ijE, data.c_Psi_ijM, dEk, 1.0f,
+            data.Psi_ik, data.c_MikE, data.c_Psi_ikE,
+            data.c_Psi_ikM, dEj, -1.0f, Ki, len);
+    else if (j)
+        VectorKernels::pmlUpdate(data.Psi_ij, data.c_MijE, data.c_Psi_ijE,
+            data.c_Psi_ijM, dEk, 1.0f, Ki, len);
+    else if (k)
+        VectorKernels::pmlUpdate(data.Psi_ik, data.c_MikE, data.c_Psi_ikE,
+            data.c_Psi_ikM, dEj, -1.0f, Ki, len);
+    else
+        VectorKernels::zero(Ki, len);
+}
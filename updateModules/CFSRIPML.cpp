@@ -17,6 +17,10 @@
 #include "YeeUtilities.h"
 #include "Map.h"
 
+#include <boost/thread/mutex.hpp>
+#include <iomanip>
+#include <sstream>
+
 using namespace std;
 using namespace YeeUtilities;
 
@@ -66,14 +70,117 @@ calcC_PhiJ(const vector<float> & kappa,
     return c;
 }
 
+static float
+evaluatePMLParameter(calc_defs::Calculator<float> & calculator,
+    const string & formula)
+{
+    bool parseError = calculator.parse(formula);
+    if (parseError)
+    {
+        calculator.report_error(cerr);
+        exit(1);
+    }
+    return calculator.get_value();
+}
+
+#pragma mark *** CFSRIPMLProfile ***
+
+// Profiles made so far, by the key made in get().  They are small and live
+// until the program ends.
+static Map<string, CFSRIPMLProfilePtr> sProfiles;
+static boost::mutex sProfilesMutex;
+
+CFSRIPMLProfilePtr CFSRIPMLProfile::
+get(int faceNum, const Rect3i & halfCellsOnSide, int octant,
+    const Map<string, string> & pmlParams, float dx, float dt)
+{
+    // The profile depends on the slab only through its extent along the
+    // PML axis and on the field only through its offset along that axis.
+    int axis = faceNum/2;
+    ostringstream key;
+    key << setprecision(10) << faceNum << " " << halfCellsOnSide.p1[axis]
+        << " " << halfCellsOnSide.p2[axis] << " "
+        << halfCellOffset(octant)[axis] << " " << dx << " " << dt << "\n"
+        << pmlParams["sigma"] << "\n" << pmlParams["kappa"] << "\n"
+        << pmlParams["alpha"];
+    
+    boost::mutex::scoped_lock lock(sProfilesMutex);
+    CFSRIPMLProfilePtr & profile = sProfiles[key.str()];
+    if (profile == 0L)
+    {
+        profile = CFSRIPMLProfilePtr(new CFSRIPMLProfile(faceNum,
+            halfCellsOnSide, octant, pmlParams, dx, dt));
+    }
+    return profile;
+}
+
+CFSRIPMLProfile::
+CFSRIPMLProfile(int faceNum, const Rect3i & halfCellsOnSide,
+    int octant, const Map<string, string> & pmlParams, float dx,
+    float dt)
+{
+    const int ONE = 1; // if I set it to 0, the PML layer includes depth==0.
+    int axis = faceNum/2;
+    float pmlDepthHalf = halfCellsOnSide.size(axis)+1;
+    
+    calc_defs::Calculator<float> calculator;
+    calculator.set("eps0", Constants::eps0);
+    calculator.set("mu0", Constants::mu0);
+    calculator.set("L", pmlDepthHalf*dx);
+    calculator.set("dx", dx);
+    
+    Rect3i pmlYee = halfToYee(halfCellsOnSide, octant);
+    int pmlDepthYee = pmlYee.size(axis)+1;
+    vector<float> sigma(pmlDepthYee), kappa(pmlDepthYee), alpha(pmlDepthYee);
+    
+    // the first half cell of the current octant.  we jump through hoops
+    // to make sure that it has the right half cell offset.
+    int nHalf0 = yeeToHalf(pmlYee, octant).p1[axis];
+    
+    int nYee, nHalf;
+    for (nYee = 0, nHalf = nHalf0; nYee < pmlDepthYee; nYee++, nHalf += 2)
+    {
+        float depthHalf;
+        if (faceNum%2 == 0) // going left/down etc. (negative direction)
+            depthHalf = float(halfCellsOnSide.p2[axis]-nHalf+ONE);
+        else
+            depthHalf = float(nHalf-halfCellsOnSide.p1[axis]+ONE);
+        calculator.set("d", depthHalf / pmlDepthHalf);
+        
+        sigma[nYee] = evaluatePMLParameter(calculator, pmlParams["sigma"]);
+        kappa[nYee] = evaluatePMLParameter(calculator, pmlParams["kappa"]);
+        alpha[nYee] = evaluatePMLParameter(calculator, pmlParams["alpha"]);
+    }
+    
+    // The magnetic constants are of the same form as the electric ones, so
+    // the same profile serves both.
+    mC_JH = calcC_JH(kappa, sigma, alpha, dt);
+    mC_PhiH = calcC_PhiH(kappa, sigma, alpha, dt);
+    mC_PhiJ = calcC_PhiJ(kappa, sigma, alpha, dt);
+    
+    // Without sigma or kappa the current is exactly zero, which the constants
+    // should say exactly too, so that cells with and without accumulators
+    // agree.
+    mActive.resize(pmlDepthYee);
+    for (nYee = 0; nYee < pmlDepthYee; nYee++)
+    {
+        mActive[nYee] = (sigma[nYee] != 0.0f || kappa[nYee] != 1.0f);
+        if (!mActive[nYee])
+            mC_JH[nYee] = mC_PhiH[nYee] = 0.0f;
+    }
+}
+
 #pragma mark *** CFSRIPMLBase ***
 
+bool CFSRIPMLBase::sSparseAccumulators = 1;
+
 CFSRIPMLBase::
 CFSRIPMLBase(Paint* parentPaint, std::vector<long> numCellsE,
         std::vector<long> numCellsH, std::vector<Rect3i> pmlHalfCells,
         Map<Vector3i, Map<std::string,std::string> > pmlParams, Vector3f dxyz,
         float dt, int runlineDirection ) :
     mPMLParams(pmlParams),
+    mMaterialName(parentPaint->bulkMaterial()->name()),
     mPMLDirection(parentPaint->pmlDirections()),
     mDxyz(dxyz),
     mDt(dt),
@@ -91,79 +198,35 @@ CFSRIPMLBase(Paint* parentPaint, std::vector<long> numCellsE,
         setPMLHalfCells(xyz, pmlHalfCells[xyz], parentPaint);
     }
     
-//    LOG << "------- " << mPMLDirection << "\n";
-        
-    // Allocate and calculate update constants.
+    // Point the update constants into the shared profiles.
     for (int fieldDir = 0; fieldDir < 3; fieldDir++)
     {
         int jDir = (fieldDir+1)%3;
         int kDir = (fieldDir+2)%3;
         
+        mC_JjH[fieldDir] = mC_PhijH[fieldDir] = mC_PhijJ[fieldDir] = 0L;
+        mC_MjE[fieldDir] = mC_PsijE[fieldDir] = mC_PsijM[fieldDir] = 0L;
+        mC_JkH[fieldDir] = mC_PhikH[fieldDir] = mC_PhikJ[fieldDir] = 0L;
+        mC_MkE[fieldDir] = mC_PsikE[fieldDir] = mC_PsikM[fieldDir] = 0L;
+        
         if (mPMLDirection[jDir] != 0)
         {
-            mC_JjH[fieldDir] = calcC_JH(mKappaE[fieldDir][jDir],
-                mSigmaE[fieldDir][jDir], mAlphaE[fieldDir][jDir],
-                dt);
-            mC_PhijH[fieldDir] = calcC_PhiH(mKappaE[fieldDir][jDir],
-                mSigmaE[fieldDir][jDir], mAlphaE[fieldDir][jDir],
-                dt);
-            mC_PhijJ[fieldDir] = calcC_PhiJ(mKappaE[fieldDir][jDir],
-                mSigmaE[fieldDir][jDir], mAlphaE[fieldDir][jDir],
-                dt);
-            
-            // the magnetic coefficients are of the same form as the electric
-            // ones and can be handled with the same functions 
-            mC_MjE[fieldDir] = calcC_JH(mKappaH[fieldDir][jDir],
-                mSigmaH[fieldDir][jDir], mAlphaH[fieldDir][jDir],
-                dt);
-            mC_PsijE[fieldDir] = calcC_PhiH(mKappaH[fieldDir][jDir],
-                mSigmaH[fieldDir][jDir], mAlphaH[fieldDir][jDir],
-                dt);
-            mC_PsijM[fieldDir] = calcC_PhiJ(mKappaH[fieldDir][jDir],
-                mSigmaH[fieldDir][jDir], mAlphaH[fieldDir][jDir],
-                dt);
-            
-//            LOG << mC_JjH[fieldDir] << "\n";
-//            LOG << mC_PhijH[fieldDir] << "\n";
-//            LOG << mC_PhijJ[fieldDir] << "\n";
-//            LOG << mC_MjE[fieldDir] << "\n";
-//            LOG << mC_PsijE[fieldDir] << "\n";
-//            LOG << mC_PsijM[fieldDir] << "\n";
-            
+            mC_JjH[fieldDir] = mProfileE[fieldDir][jDir]->c_JH();
+            mC_PhijH[fieldDir] = mProfileE[fieldDir][jDir]->c_PhiH();
+            mC_PhijJ[fieldDir] = mProfileE[fieldDir][jDir]->c_PhiJ();
+            mC_MjE[fieldDir] = mProfileH[fieldDir][jDir]->c_JH();
+            mC_PsijE[fieldDir] = mProfileH[fieldDir][jDir]->c_PhiH();
+            mC_PsijM[fieldDir] = mProfileH[fieldDir][jDir]->c_PhiJ();
         }
         
         if (mPMLDirection[kDir] != 0)
         {
-            mC_JkH[fieldDir] = calcC_JH(mKappaE[fieldDir][kDir],
-                mSigmaE[fieldDir][kDir], mAlphaE[fieldDir][kDir],
-                dt);
-            mC_PhikH[fieldDir] = calcC_PhiH(mKappaE[fieldDir][kDir],
-                mSigmaE[fieldDir][kDir], mAlphaE[fieldDir][kDir],
-                dt);
-            mC_PhikJ[fieldDir] = calcC_PhiJ(mKappaE[fieldDir][kDir],
-                mSigmaE[fieldDir][kDir], mAlphaE[fieldDir][kDir],
-                dt);
-            
-            // the magnetic coefficients are of the same form as the electric
-            // ones and can be handled with the same functions 
-            mC_MkE[fieldDir] = calcC_JH(mKappaH[fieldDir][kDir],
-                mSigmaH[fieldDir][kDir], mAlphaH[fieldDir][kDir],
-                dt);
-            mC_PsikE[fieldDir] = calcC_PhiH(mKappaH[fieldDir][kDir],
-                mSigmaH[fieldDir][kDir], mAlphaH[fieldDir][kDir],
-                dt);
-            mC_PsikM[fieldDir] = calcC_PhiJ(mKappaH[fieldDir][kDir],
-                mSigmaH[fieldDir][kDir], mAlphaH[fieldDir][kDir],
-                dt);
-            
-            
-//            LOG << mC_JkH[fieldDir] << "\n";
-//            LOG << mC_PhikH[fieldDir] << "\n";
-//            LOG << mC_PhikJ[fieldDir] << "\n";
-//            LOG << mC_MkE[fieldDir] << "\n";
-//            LOG << mC_PsikE[fieldDir] << "\n";
-//            LOG << mC_PsikM[fieldDir] << "\n";
-            
+            mC_JkH[fieldDir] = mProfileE[fieldDir][kDir]->c_JH();
+            mC_PhikH[fieldDir] = mProfileE[fieldDir][kDir]->c_PhiH();
+            mC_PhikJ[fieldDir] = mProfileE[fieldDir][kDir]->c_PhiJ();
+            mC_MkE[fieldDir] = mProfileH[fieldDir][kDir]->c_JH();
+            mC_PsikE[fieldDir] = mProfileH[fieldDir][kDir]->c_PhiH();
+            mC_PsikM[fieldDir] = mProfileH[fieldDir][kDir]->c_PhiJ();
         }
     }
 }
@@ -222,155 +285,72 @@ setPMLHalfCells(int faceNum, Rect3i halfCellsOnSide,
     if (dot(pmlDir, cardinal(faceNum)) <= 0) // check which side it is
         return;
     
-    Rect3i pmlYee;
-    int pmlDepthYee;
-    int nYee, nHalf, nHalf0;
-    int fieldDir;
-    float depthHalf, depthFrac;
-    float pmlDepthHalf = halfCellsOnSide.size(faceNum/2)+1;
-    string alphaStr, kappaStr, sigmaStr;
-    
-    const int ONE = 1; // if I set it to 0, the PML layer includes depth==0.
-    
-    //LOG << "------------ " << parentPaint->pmlDirections() << "\n";
-    
-    calc_defs::Calculator<float> calculator;
-    calculator.set("eps0", Constants::eps0);
-    calculator.set("mu0", Constants::mu0);
-    calculator.set("L", pmlDepthHalf*mDxyz[faceNum/2]);
-    calculator.set("dx", mDxyz[faceNum/2]);
-    
-    for (fieldDir = 0; fieldDir < 3; fieldDir++)
+    for (int fieldDir = 0; fieldDir < 3; fieldDir++)
     if (fieldDir != faceNum/2)
     {
-        // E field auxiliary constants
-        pmlYee = halfToYee(halfCellsOnSide, octantE(fieldDir));
-        pmlDepthYee = pmlYee.size(faceNum/2)+1;
-        mSigmaE[fieldDir][faceNum/2].resize(pmlDepthYee, 0.0);
-        mAlphaE[fieldDir][faceNum/2].resize(pmlDepthYee, 0.0);
-        mKappaE[fieldDir][faceNum/2].resize(pmlDepthYee, 0.0);
-        
-        // the first half cell of the current octant.  we jump through hoops
-        // to make sure that it has the right half cell offset.
-        nHalf0 = yeeToHalf(pmlYee, octantE(fieldDir)).p1[faceNum/2];
-        
-        alphaStr = mPMLParams[cardinal(faceNum)]["alpha"];
-        kappaStr = mPMLParams[cardinal(faceNum)]["kappa"];
-        sigmaStr = mPMLParams[cardinal(faceNum)]["sigma"];
-        /*
-        LOG << "Alpha: " << alphaStr << "\n"
-            << "Kappa: " << kappaStr << "\n"
-            << "Sigma: " << sigmaStr << "\n";
-        */
-        for (nYee = 0, nHalf=nHalf0; nYee < pmlDepthYee; nYee++, nHalf+=2)
-        {
-            if (faceNum%2 == 0) // going left/down etc. (negative direction)
-                depthHalf = float(halfCellsOnSide.p2[faceNum/2]-nHalf+ONE);
-            else
-                depthHalf = float(nHalf-halfCellsOnSide.p1[faceNum/2]+ONE);
-            depthFrac = depthHalf / pmlDepthHalf;
-            calculator.set("d", depthFrac);
-            
-//            LOG << "nYee " << nYee << " nHalf " << nHalf << " within "
-//                << halfCellsOnSide << " depth " << depthFrac << "\n";
-            
-            bool parseError = calculator.parse(sigmaStr);
-            if (parseError)
-            {
-                calculator.report_error(cerr);
-                exit(1);
-            }
-            mSigmaE[fieldDir][faceNum/2][nYee] = calculator.get_value();
-            parseError = calculator.parse(kappaStr);
-            if (parseError)
-            {
-                calculator.report_error(cerr);
-                exit(1);
-            }
-            mKappaE[fieldDir][faceNum/2][nYee] = calculator.get_value();
-            parseError = calculator.parse(alphaStr);
-            if (parseError)
-            {
-                calculator.report_error(cerr);
-                exit(1);
-            }
-            mAlphaE[fieldDir][faceNum/2][nYee] = calculator.get_value();
-        }
-        
-//        LOG << "E: field " << fieldDir << " faceNum " << faceNum << " num "
-//            << pmlDepthYee << "\n";
-//        LOGMORE << "Sigma " << sigmaStr << "\n" <<
-//            mSigmaE[fieldDir][faceNum/2] << endl;
-//        LOGMORE << "Alpha " << alphaStr << "\n" <<
-//            mAlphaE[fieldDir][faceNum/2] << endl;
-//        LOGMORE << "Kappa " << kappaStr << "\n" <<
-//            mKappaE[fieldDir][faceNum/2] << endl;
+        mProfileE[fieldDir][faceNum/2] = CFSRIPMLProfile::get(faceNum,
+            halfCellsOnSide, octantE(fieldDir), mPMLParams[cardinal(faceNum)],
+            mDxyz[faceNum/2], mDt);
+        mProfileH[fieldDir][faceNum/2] = CFSRIPMLProfile::get(faceNum,
+            halfCellsOnSide, octantH(fieldDir), mPMLParams[cardinal(faceNum)],
+            mDxyz[faceNum/2], mDt);
+    }
+}
 
-        // H field auxiliary constants
-        pmlYee = halfToYee(halfCellsOnSide, octantH(fieldDir));
-        pmlDepthYee = pmlYee.size(faceNum/2)+1;
-        mSigmaH[fieldDir][faceNum/2].resize(pmlDepthYee, 0.0);
-        mAlphaH[fieldDir][faceNum/2].resize(pmlDepthYee, 0.0);
-        mKappaH[fieldDir][faceNum/2].resize(pmlDepthYee, 0.0);
+
+// Give each runline that needs an accumulator for the given term (0 for j,
+// 1 for k) a place in it, and return the number of cells needed.  The term
+// is zero all along a runline if the profile is inactive at every depth the
+// runline passes: one depth if it runs across the PML direction, one per
+// cell if it runs along it.
+long CFSRIPMLBase::
+numberRunlines(vector<SimpleAuxPMLRunline> & runlines, int term, int pmlDir,
+    const CFSRIPMLProfile & profile) const
+{
+    long numCells = 0;
+    for (long nn = 0; nn < runlines.size(); nn++)
+    {
+        SimpleAuxPMLRunline & rl(runlines[nn]);
+        long firstDepth = rl.pmlIndex[pmlDir];
+        long lastDepth = firstDepth;
+        if (pmlDir == mRunlineDirection)
+            lastDepth += rl.length - 1;
         
-        nHalf0 = yeeToHalf(pmlYee, octantH(fieldDir)).p1[faceNum/2];
+        bool isActive = 0;
+        for (long depth = firstDepth; depth <= lastDepth && !isActive; depth++)
+            isActive = profile.isActive(depth);
         
-        for (nYee = 0, nHalf=nHalf0; nYee < pmlDepthYee; nYee++, nHalf+=2)
+        if (isActive || !sSparseAccumulators)
         {
-            if (faceNum%2 == 0) // going left/down etc. (negative direction)
-                depthHalf = float(halfCellsOnSide.p2[faceNum/2]-nHalf+ONE);
-            else
-                depthHalf = float(nHalf-halfCellsOnSide.p1[faceNum/2]+ONE);
-            depthFrac = depthHalf / pmlDepthHalf;
-            calculator.set("d", depthFrac);
-            
-//            LOG << "nYee " << nYee << " nHalf " << nHalf << " within "
-//                << halfCellsOnSide << " depth " << depthFrac << "\n";
-            
-            bool parseError = calculator.parse(sigmaStr);
-            if (parseError)
-            {
-                calculator.report_error(cerr);
-                exit(1);
-            }
-            mSigmaH[fieldDir][faceNum/2][nYee] = calculator.get_value();
-            parseError = calculator.parse(kappaStr);
-            if (parseError)
-            {
-                calculator.report_error(cerr);
-                exit(1);
-            }
-            mKappaH[fieldDir][faceNum/2][nYee] = calculator.get_value();
-            parseError = calculator.parse(alphaStr);
-            if (parseError)
-            {
-                calculator.report_error(cerr);
-                exit(1);
-            }
-            mAlphaH[fieldDir][faceNum/2][nYee] = calculator.get_value();
+            rl.accumIndex[term] = numCells;
+            numCells += rl.length;
         }
-//        LOG << "H: field " << fieldDir << " faceNum " << faceNum << " num "
-//            << pmlDepthYee << "\n";
-//        LOGMORE << "Sigma " << sigmaStr << "\n" <<
-//            mSigmaH[fieldDir][faceNum/2] << endl;
-//        LOGMORE << "Alpha " << alphaStr << "\n" <<
-//            mAlphaH[fieldDir][faceNum/2] << endl;
-//        LOGMORE << "Kappa " << kappaStr << "\n" <<
-//            mKappaH[fieldDir][faceNum/2] << endl;
+        else
+            rl.accumIndex[term] = -1;
     }
-    
-    if (ONE != 1)
-        LOG << "Warning: ONE is not 1.\n";
+    return numCells;
 }
 
+static void
+allocateAccumulator(AuxArray & accum, MemoryBufferPtr & buffer,
+    long numCells, long & numCellsStored, long & numCellsDense)
+{
+    numCellsDense += buffer->length();
+    numCellsStored += numCells;
+    
+    buffer = MemoryBufferPtr(new MemoryBuffer(buffer->description(),
+        numCells, buffer->stride()));
+    accum.resize(numCells);
+    if (numCells > 0)
+        buffer->setHeadPointer(&(accum[0]));
+}
 
 void CFSRIPMLBase::
-allocateAuxBuffers()
+allocateAuxBuffers(vector<SimpleAuxPMLRunline> runlinesE[3],
+    vector<SimpleAuxPMLRunline> runlinesH[3])
 {
-    Vector3i rotatedPMLDir = cyclicPermute(mPMLDirection,
-        (3-mRunlineDirection)%3);
-    // Allocate auxiliary variables
-    MemoryBufferPtr p;
+    long numCellsStored = 0, numCellsDense = 0;
+    
     for (int fieldDir = 0; fieldDir < 3; fieldDir++)
     {
         int jDir = (fieldDir+1)%3;
@@ -378,24 +358,31 @@ allocateAuxBuffers()
         
         if (mPMLDirection[jDir] != 0)
         {
-            p = mBufAccumEj[fieldDir];
-            mAccumEj[fieldDir].resize(p->length());
-            p->setHeadPointer(&(mAccumEj[fieldDir][0]));
-            
-            p = mBufAccumHj[fieldDir];
-            mAccumHj[fieldDir].resize(p->length());
-            p->setHeadPointer(&(mAccumHj[fieldDir][0]));
+            allocateAccumulator(mAccumEj[fieldDir], mBufAccumEj[fieldDir],
+                numberRunlines(runlinesE[fieldDir], 0, jDir,
+                    *mProfileE[fieldDir][jDir]),
+                numCellsStored, numCellsDense);
+            allocateAccumulator(mAccumHj[fieldDir], mBufAccumHj[fieldDir],
+                numberRunlines(runlinesH[fieldDir], 0, jDir,
+                    *mProfileH[fieldDir][jDir]),
+                numCellsStored, numCellsDense);
         }
         
         if (mPMLDirection[kDir] != 0)
         {
-            p = mBufAccumEk[fieldDir];
-            mAccumEk[fieldDir].resize(p->length());
-            p->setHeadPointer(&(mAccumEk[fieldDir][0]));
-            
-            p = mBufAccumHk[fieldDir];
-            mAccumHk[fieldDir].resize(p->length());
-            p->setHeadPointer(&(mAccumHk[fieldDir][0]));
+            allocateAccumulator(mAccumEk[fieldDir], mBufAccumEk[fieldDir],
+                numberRunlines(runlinesE[fieldDir], 1, kDir,
+                    *mProfileE[fieldDir][kDir]),
+                numCellsStored, numCellsDense);
+            allocateAccumulator(mAccumHk[fieldDir], mBufAccumHk[fieldDir],
+                numberRunlines(runlinesH[fieldDir], 1, kDir,
+                    *mProfileH[fieldDir][kDir]),
+                numCellsStored, numCellsDense);
         }
     }
+    
+    LOGF << "PML accumulators for " << mMaterialName << ": "
+        << numCellsStored << " of " << numCellsDense << " cells stored, "
+        << (numCellsDense - numCellsStored)*sizeof(AuxStorage)
+        << " bytes saved.\n";
 }
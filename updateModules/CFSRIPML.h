@@ -18,9 +18,40 @@
 #include <string>
 #include "MemoryUtilities.h"
 #include "Runline.h"
+#include "VectorKernels.h"
 
 class Paint;
 
+// Update constants of the CFS-RIPML at each depth into one side of the PML,
+// for the field components at one half-cell offset along the PML axis.  Every
+// material that extends into the same PML slab needs the same constants, so
+// profiles are made once by get() and shared by all the CFSRIPMLs.
+class CFSRIPMLProfile
+{
+public:
+    static Pointer<CFSRIPMLProfile> get(int faceNum,
+        const Rect3i & halfCellsOnSide, int octant,
+        const Map<std::string, std::string> & pmlParams, float dx, float dt);
+    
+    // One constant per Yee cell of depth, from the inside of the slab out.
+    const float* c_JH() const { return &mC_JH[0]; }
+    const float* c_PhiH() const { return &mC_PhiH[0]; }
+    const float* c_PhiJ() const { return &mC_PhiJ[0]; }
+    
+    // False at depths where sigma is 0 and kappa is 1.  There the convolution
+    // term stays zero, and no accumulator is needed.
+    bool isActive(int depth) const { return mActive[depth]; }
+    
+private:
+    CFSRIPMLProfile(int faceNum, const Rect3i & halfCellsOnSide,
+        int octant,
+        const Map<std::string, std::string> & pmlParams, float dx, float dt);
+    
+    std::vector<float> mC_JH, mC_PhiH, mC_PhiJ;
+    std::vector<bool> mActive;
+};
+typedef Pointer<CFSRIPMLProfile> CFSRIPMLProfilePtr;
+
 // This class handles everything that's in common between the various templated
 // PML update classes; the templates just add direction-specific update
 // equations.
@@ -36,10 +67,19 @@ public:
     
     std::string modelName() const;
     
-    virtual void allocateAuxBuffers();
+    // Allocate the accumulators, only for runlines where the PML term is not
+    // zero all along, and set the runlines' accumIndex to match.
+    void allocateAuxBuffers(std::vector<SimpleAuxPMLRunline> runlinesE[3],
+        std::vector<SimpleAuxPMLRunline> runlinesH[3]);
     
     Vector3i pmlDirection() const { return mPMLDirection; }
     
+    // Choose whether PMLs allocated from now on leave out the accumulators
+    // where the PML term is zero all along a runline (the default), or store
+    // them densely.  The fields come out the same either way.
+    static void setSparseAccumulators(bool sparse)
+        { sSparseAccumulators = sparse; }
+    
 protected:
     // three setup functions
     void setNumCellsE(int fieldDir, int numCells, Paint* parentPaint);
@@ -47,27 +87,30 @@ protected:
     void setPMLHalfCells(int pmlDir, Rect3i halfCellsOnSide,
         Paint* parentPaint);
     
-    // Formerly setup things:
-    std::vector<float> mSigmaE[3][3];
-    std::vector<float> mSigmaH[3][3];
-    std::vector<float> mAlphaE[3][3];
-    std::vector<float> mAlphaH[3][3];
-    std::vector<float> mKappaE[3][3];
-    std::vector<float> mKappaH[3][3];
+    long numberRunlines(std::vector<SimpleAuxPMLRunline> & runlines,
+        int term, int pmlDir, const CFSRIPMLProfile & profile) const;
+    
+    static AuxStorage* accumulator(AuxArray & accum, long index)
+        { return (index < 0) ? 0L : &accum[index]; }
+    
+    // Shared update constants, by field direction and PML direction.
+    CFSRIPMLProfilePtr mProfileE[3][3];
+    CFSRIPMLProfilePtr mProfileH[3][3];
     
     std::vector<Rect3i> mPMLHalfCells;
     Map<Vector3i, Map<std::string, std::string> > mPMLParams;
+    std::string mMaterialName;
     
-    // These vectors are the actual location of the allocated fields and
-    // update constants.
-    std::vector<float> mAccumEj[3], mAccumEk[3],
+    // These vectors are the actual location of the allocated fields; the
+    // update constants point into the profiles.
+    AuxArray mAccumEj[3], mAccumEk[3],
         mAccumHj[3], mAccumHk[3];
-    std::vector<float> mC_JjH[3], mC_JkH[3],
-        mC_PhijH[3], mC_PhikH[3],
-        mC_PhijJ[3], mC_PhikJ[3];
-    std::vector<float> mC_MjE[3], mC_MkE[3],
-        mC_PsijE[3], mC_PsikE[3],
-        mC_PsijM[3], mC_PsikM[3];
+    const float *mC_JjH[3], *mC_JkH[3],
+        *mC_PhijH[3], *mC_PhikH[3],
+        *mC_PhijJ[3], *mC_PhikJ[3];
+    const float *mC_MjE[3], *mC_MkE[3],
+        *mC_PsijE[3], *mC_PsikE[3],
+        *mC_PsijM[3], *mC_PsikM[3];
     
     MemoryBufferPtr mBufAccumEj[3], mBufAccumEk[3],
         mBufAccumHj[3], mBufAccumHk[3];
@@ -77,6 +120,8 @@ protected:
     float mDt;
     
     int mRunlineDirection;
+    
+    static bool sSparseAccumulators;
 };
 
 // Completes the implementation of the PML interface.
@@ -91,6 +136,8 @@ public:
         Map<Vector3i, Map<std::string,std::string> > pmlParams, Vector3f dxyz,
         float dt, int runlineDirection );
     
+    static const bool VECTORIZED = true;
+    
     // This will be specialized below.  The DOESNOTHING parameter is here for
     // a REALLY DUMB C++ REASON.  If it's not there, this won't compile.  I am
     // consequently mad at the C++ language.
@@ -110,6 +157,14 @@ public:
     float updateJ(LocalDataE<1> & data, float Ei, float dHj, float dHk);
     float updateJ(LocalDataE<2> & data, float Ei, float dHj, float dHk);
     
+    // Block versions: write the PML current for len cells into Ji.
+    void updateJ(LocalDataE<0> & data, const float* dHj, const float* dHk,
+        float* Ji, int len);
+    void updateJ(LocalDataE<1> & data, const float* dHj, const float* dHk,
+        float* Ji, int len);
+    void updateJ(LocalDataE<2> & data, const float* dHj, const float* dHk,
+        float* Ji, int len);
+    
     
     void onStartRunlineH(LocalDataH<0> & data, const SimpleAuxPMLRunline & rl,
         int dir0, int dir1, int dir2);
@@ -121,13 +176,20 @@ public:
     float updateK(LocalDataH<0> & data, float Hi, float dEj, float dEk);
     float updateK(LocalDataH<1> & data, float Hi, float dEj, float dEk);
     float updateK(LocalDataH<2> & data, float Hi, float dEj, float dEk);
+    
+    void updateK(LocalDataH<0> & data, const float* dEj, const float* dEk,
+        float* Ki, int len);
+    void updateK(LocalDataH<1> & data, const float* dEj, const float* dEk,
+        float* Ki, int len);
+    void updateK(LocalDataH<2> & data, const float* dEj, const float* dEk,
+        float* Ki, int len);
 };
 
 template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 template<int DOESNOTHING>
 struct CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::LocalDataE<0, DOESNOTHING>
 {
-    float* Phi_ij, *Phi_ik;         // e.g. Phi_xy, Phi_xz
+    AuxStorage *Phi_ij, *Phi_ik;        // e.g. Phi_xy, Phi_xz
     float c_JijH, c_JikH;
     float c_Phi_ijH, c_Phi_ikH;
     float c_Phi_ijJ, c_Phi_ikJ;
@@ -137,20 +199,26 @@ template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 template<int DOESNOTHING>
 struct CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::LocalDataE<1, DOESNOTHING>
 {
-    float *Phi_ij, *Phi_ik;         // e.g. Phi_xy, Phi_xz
-    float c_JijH, *c_JikH;
-    float c_Phi_ijH, *c_Phi_ikH;
-    float c_Phi_ijJ, *c_Phi_ikJ;
+    AuxStorage *Phi_ij, *Phi_ik;        // e.g. Phi_xy, Phi_xz
+    float c_JijH;
+    const float* c_JikH;
+    float c_Phi_ijH;
+    const float* c_Phi_ikH;
+    float c_Phi_ijJ;
+    const float* c_Phi_ikJ;
 };
 
 template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 template<int DOESNOTHING>
 struct CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::LocalDataE<2, DOESNOTHING>
 {
-    float* Phi_ij, *Phi_ik;         // e.g. Phi_xy, Phi_xz
-    float *c_JijH, c_JikH;
-    float *c_Phi_ijH, c_Phi_ikH;
-    float *c_Phi_ijJ, c_Phi_ikJ;
+    AuxStorage *Phi_ij, *Phi_ik;        // e.g. Phi_xy, Phi_xz
+    const float* c_JijH;
+    float c_JikH;
+    const float* c_Phi_ijH;
+    float c_Phi_ikH;
+    const float* c_Phi_ijJ;
+    float c_Phi_ikJ;
 };
 
 
@@ -158,7 +226,7 @@ template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 template<int DOESNOTHING>
 struct CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::LocalDataH<0, DOESNOTHING>
 {
-    float* Psi_ij, *Psi_ik;         // e.g. Phi_xy, Phi_xz
+    AuxStorage *Psi_ij, *Psi_ik;        // e.g. Phi_xy, Phi_xz
     float c_MijE, c_MikE;           // constants
     float c_Psi_ijE, c_Psi_ikE;     // also constant, hoorah!
     float c_Psi_ijM, c_Psi_ikM;     // and still constant!
@@ -168,20 +236,26 @@ template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 template<int DOESNOTHING>
 struct CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::LocalDataH<1, DOESNOTHING>
 {
-    float* Psi_ij, *Psi_ik;         // e.g. Phi_xy, Phi_xz
-    float c_MijE, *c_MikE;
-    float c_Psi_ijE, *c_Psi_ikE;     // also constant, hoorah!
-    float c_Psi_ijM, *c_Psi_ikM;     // and still constant!
+    AuxStorage *Psi_ij, *Psi_ik;        // e.g. Phi_xy, Phi_xz
+    float c_MijE;
+    const float* c_MikE;
+    float c_Psi_ijE;
+    const float* c_Psi_ikE;
+    float c_Psi_ijM;
+    const float* c_Psi_ikM;
 };
 
 template <bool I_ATTEN, bool J_ATTEN, bool K_ATTEN>
 template<int DOESNOTHING>
 struct CFSRIPML<I_ATTEN, J_ATTEN, K_ATTEN>::LocalDataH<2, DOESNOTHING>
 {
-    float* Psi_ij, *Psi_ik;         // e.g. Phi_xy, Phi_xz
-    float *c_MijE, c_MikE;           // constants
-    float *c_Psi_ijE, c_Psi_ikE;     // also constant, hoorah!
-    float *c_Psi_ijM, c_Psi_ikM;     // and still constant!
+    AuxStorage *Psi_ij, *Psi_ik;        // e.g. Phi_xy, Phi_xz
+    const float* c_MijE;
+    float c_MikE;
+    const float* c_Psi_ijE;
+    float c_Psi_ikE;
+    const float* c_Psi_ijM;
+    float c_Psi_ikM;
 };
 
 
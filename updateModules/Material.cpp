@@ -21,7 +21,7 @@ Material::
 
 void Material::
 writeJ(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     float zero = 0.0f;
     for (long nn = 0; nn < length; nn++)
@@ -30,7 +30,7 @@ writeJ(int direction, std::ostream & binaryStream, long startingIndex,
 
 void Material::
 writeP(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     float zero = 0.0f;
     for (long nn = 0; nn < length; nn++)
@@ -39,7 +39,7 @@ writeP(int direction, std::ostream & binaryStream, long startingIndex,
 
 void Material::
 writeK(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     float zero = 0.0f;
     for (long nn = 0; nn < length; nn++)
@@ -48,7 +48,7 @@ writeK(int direction, std::ostream & binaryStream, long startingIndex,
 
 void Material::
 writeM(int direction, std::ostream & binaryStream, long startingIndex,
-    const float* startingField, long length) const
+    const FieldStorage* startingField, long length) const
 {
     float zero = 0.0f;
     for (long nn = 0; nn < length; nn++)
@@ -11,6 +11,7 @@
 #define _MATERIAL_
 
 #include <iostream>
+#include "FieldStorage.h"
 
 class Material
 {
@@ -18,15 +19,24 @@ public:
     Material();
     virtual ~Material();
     
+    // Materials that provide block versions of updateE and updateH (see
+    // StaticDielectric) set this to true in their own class, and
+    // ModularUpdateEquation will use the vector kernels on long runlines.
+    static const bool VECTORIZED = false;
+    
     void writeJ(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     void writeP(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     
     void writeK(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
     void writeM(int direction, std::ostream & binaryStream,
-        long startingIndex, const float* startingField, long length) const;
+        long startingIndex, const FieldStorage* startingField,
+        long length) const;
 };
 
 
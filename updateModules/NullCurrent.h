@@ -16,6 +16,8 @@ class NullCurrent
 {
 public:
     NullCurrent(std::vector<long> numCellsE, std::vector<long> numCellsH) {}
+    
+    static const bool VECTORIZED = true; // nothing to add to J or K
     struct LocalDataE {};
     struct LocalDataH {};   
     
@@ -23,6 +25,7 @@ public:
     void allocateAuxBuffers() {}
     
     void initLocalE(LocalDataE & data, int dir0) {}
+    void skipCellsE(LocalDataE & data, long numCells) {}
     void onStartRunlineE(LocalDataE & data, const SimpleRunline & rl) {}
     void beforeUpdateE(LocalDataE & data, float Ei, float dHj, float dHk) {}    
     float updateJ(LocalDataE & data, float Ei, float dHj, float dHk,
@@ -32,6 +35,7 @@ public:
     void afterUpdateE(LocalDataE & data, float Ei, float dHj, float dHk) {}
     
     void initLocalH(LocalDataH & data, int dir0) {}
+    void skipCellsH(LocalDataH & data, long numCells) {}
     void onStartRunlineH(LocalDataH & data, const SimpleRunline & rl) {}
     void beforeUpdateH(LocalDataH & data, float Hi, float dEj, float dEk) {}  
     float updateK(LocalDataH & data, float Hi, float dEj, float dEk,
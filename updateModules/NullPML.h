@@ -10,11 +10,14 @@
 #ifndef _NULLPML_
 #define _NULLPML_
 
+#include "VectorKernels.h"
+#include <vector>
 
 
 class NullPML
 {
 public:
+    static const bool VECTORIZED = true;
     
     template<int MEMORYDIRECTION>
     struct LocalDataE
@@ -39,6 +42,11 @@ public:
     float updateJ(LocalDataE<2> & data, float Ei, float dHj, float dHk)
         { return 0.0; }
     
+    template<int MEMORYDIRECTION>
+    void updateJ(LocalDataE<MEMORYDIRECTION> & data, const float* dHj,
+        const float* dHk, float* Ji, int len)
+        { VectorKernels::zero(Ji, len); }
+    
     void onStartRunlineH(LocalDataH<0> & data, const SimpleRunline & rl,
         int dir0, int dir1, int dir2) {}
     void onStartRunlineH(LocalDataH<1> & data, const SimpleRunline & rl,
@@ -53,7 +61,14 @@ public:
     float updateK(LocalDataH<2> & data, float Hi, float dEj, float dEk)
         { return 0.0; }
     
-    void allocateAuxBuffers() {}
+    template<int MEMORYDIRECTION>
+    void updateK(LocalDataH<MEMORYDIRECTION> & data, const float* dEj,
+        const float* dEk, float* Ki, int len)
+        { VectorKernels::zero(Ki, len); }
+    
+    template<class RunlineT>
+    void allocateAuxBuffers(std::vector<RunlineT> runlinesE[3],
+        std::vector<RunlineT> runlinesH[3]) {}
 };
 
 
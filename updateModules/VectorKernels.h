@@ -0,0 +1,475 @@
+/*
+ *  VectorKernels.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _VECTORKERNELS_
+#define _VECTORKERNELS_
+
+// Inner loops for the block update path of ModularUpdateEquation.  Each
+// kernel works on len consecutive cells of a runline.  The instruction set is
+// chosen by the compiler flags: AVX-512, then AVX, then SSE, and plain scalar
+// code if none of them are enabled (build with -march=native to get the
+// widest one).  Every kernel finishes the last few cells with scalar code, so
+// no alignment or padding is required.
+//
+// Coefficients may be a single float for the whole block or a pointer to one
+// float per cell; the PML uses both.  Pointer arguments passed by reference are
+// advanced past the block, just like the per-cell update functions do.
+//
+// Fields are FieldStorage, which may be narrower than float (see
+// FieldStorage.h); they are widened to float on loading and rounded back on
+// storing, with the conversion instructions where there are any.  The
+// auxiliary variables of materials and the PML are AuxStorage, which is
+// never narrower than float.  The
+// temporaries are always float.
+//
+// Double storage uses the scalar loops, which accumulate in double; the
+// compiler vectorizes them as well as it can.  The float registers here would
+// round every field to float on each timestep.
+
+#if defined(TROGDOR_STORAGE_DOUBLE)
+#define TROGDOR_VECTOR_WIDTH 1
+#elif defined(__AVX512F__)
+#include <immintrin.h>
+#define TROGDOR_VECTOR_WIDTH 16
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define TROGDOR_VECTOR_WIDTH 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(TROGDOR_STORAGE_FP16) && defined(__F16C__)
+#include <immintrin.h>
+#endif
+#define TROGDOR_VECTOR_WIDTH 4
+#else
+#define TROGDOR_VECTOR_WIDTH 1
+#endif
+
+#include "FieldStorage.h"
+
+namespace VectorKernels
+{
+
+// Runlines shorter than this take the per-cell path; the block path has a
+// little setup cost per block.
+static const int MIN_RUNLINE_LENGTH = 2*TROGDOR_VECTOR_WIDTH;
+
+// Number of cells in one block of temporaries (dH, J and so on).  The
+// temporaries sit on the stack, so keep this small enough to stay in L1.
+static const int BLOCK_LENGTH = 256;
+
+// Tag type for choosing between the block path and the per-cell path at
+// compile time, so the block path is only instantiated where it exists.
+template<bool USE_VECTORS>
+struct Path {};
+
+inline float at(float c, int mm) { return c; }
+inline float at(const float* c, int mm) { return c[mm]; }
+
+inline void advance(float & c, int len) {}
+template<class T>
+inline void advance(T* & c, int len) { c += len; }
+
+#if TROGDOR_VECTOR_WIDTH == 16
+typedef __m512 Vec;
+inline Vec load(const float* p) { return _mm512_loadu_ps(p); }
+inline void store(float* p, Vec v) { _mm512_storeu_ps(p, v); }
+inline Vec splat(float c) { return _mm512_set1_ps(c); }
+inline Vec add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+#elif TROGDOR_VECTOR_WIDTH == 8
+typedef __m256 Vec;
+inline Vec load(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+inline Vec splat(float c) { return _mm256_set1_ps(c); }
+inline Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+#elif TROGDOR_VECTOR_WIDTH == 4
+typedef __m128 Vec;
+inline Vec load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+inline Vec splat(float c) { return _mm_set1_ps(c); }
+inline Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+#endif
+
+#if TROGDOR_VECTOR_WIDTH > 1
+// Other storage types without conversion instructions below go through a
+// float buffer one register at a time.
+template<class T>
+inline Vec load(const T* p)
+{
+    float widened[TROGDOR_VECTOR_WIDTH];
+    for (int nn = 0; nn < TROGDOR_VECTOR_WIDTH; nn++)
+        widened[nn] = p[nn];
+    return load(widened);
+}
+
+template<class T>
+inline void store(T* p, Vec v)
+{
+    float narrowed[TROGDOR_VECTOR_WIDTH];
+    store(narrowed, v);
+    for (int nn = 0; nn < TROGDOR_VECTOR_WIDTH; nn++)
+        p[nn] = narrowed[nn];
+}
+
+#if defined(TROGDOR_STORAGE_BF16)
+// bfloat16 is the top half of a float: widen by shifting it up 16 bits, and
+// narrow by rounding to nearest even and shifting down, as BFloat16 does.
+// NaN stays NaN.
+#if TROGDOR_VECTOR_WIDTH == 16
+inline Vec load(const BFloat16* p)
+{
+    __m512i bits = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)p));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(bits, 16));
+}
+
+inline void store(BFloat16* p, Vec v)
+{
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16),
+        _mm512_set1_epi32(1));
+    __m512i rounded = _mm512_srli_epi32(_mm512_add_epi32(bits,
+        _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7fff))), 16);
+    __m512i quiet = _mm512_or_si512(_mm512_srli_epi32(bits, 16),
+        _mm512_set1_epi32(0x0040));
+    rounded = _mm512_mask_mov_epi32(rounded,
+        _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q), quiet);
+    _mm256_storeu_si256((__m256i*)p, _mm512_cvtepi32_epi16(rounded));
+}
+#else
+// SSE2 on four floats at a time; AVX without AVX2 has no 256-bit integer
+// instructions, so it does two halves.
+inline __m128 loadBF16x4(const BFloat16* p)
+{
+    __m128i h = _mm_loadl_epi64((const __m128i*)p);
+    return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), h));
+}
+
+// Returns the four bfloat16s in the low 16 bits of each 32-bit lane.
+inline __m128i roundBF16x4(__m128 v)
+{
+    __m128i bits = _mm_castps_si128(v);
+    __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+    __m128i rounded = _mm_srli_epi32(_mm_add_epi32(bits,
+        _mm_add_epi32(lsb, _mm_set1_epi32(0x7fff))), 16);
+    __m128i quiet = _mm_or_si128(_mm_srli_epi32(bits, 16),
+        _mm_set1_epi32(0x0040));
+    __m128i isNaN = _mm_castps_si128(_mm_cmpunord_ps(v, v));
+    return _mm_or_si128(_mm_and_si128(isNaN, quiet),
+        _mm_andnot_si128(isNaN, rounded));
+}
+
+// Packs two sets of four from roundBF16x4; the shifts sign-extend each lane
+// so the signed saturating pack keeps all 16 bits.
+inline __m128i packBF16(__m128i lo, __m128i hi)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16),
+        _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16));
+}
+
+#if TROGDOR_VECTOR_WIDTH == 8
+inline Vec load(const BFloat16* p)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(loadBF16x4(p)),
+        loadBF16x4(p+4), 1);
+}
+
+inline void store(BFloat16* p, Vec v)
+{
+    _mm_storeu_si128((__m128i*)p,
+        packBF16(roundBF16x4(_mm256_castps256_ps128(v)),
+            roundBF16x4(_mm256_extractf128_ps(v, 1))));
+}
+#else
+inline Vec load(const BFloat16* p) { return loadBF16x4(p); }
+
+inline void store(BFloat16* p, Vec v)
+{
+    __m128i packed = packBF16(roundBF16x4(v), _mm_setzero_si128());
+    _mm_storel_epi64((__m128i*)p, packed);
+}
+#endif
+#endif
+
+#elif defined(TROGDOR_STORAGE_FP16) && defined(__F16C__)
+// F16C converts IEEE half, rounding to nearest even as Half does.
+#if TROGDOR_VECTOR_WIDTH == 16
+inline Vec load(const Half* p)
+{
+    return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)p));
+}
+
+inline void store(Half* p, Vec v)
+{
+    _mm256_storeu_si256((__m256i*)p,
+        _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+}
+#elif TROGDOR_VECTOR_WIDTH == 8
+inline Vec load(const Half* p)
+{
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+}
+
+inline void store(Half* p, Vec v)
+{
+    _mm_storeu_si128((__m128i*)p,
+        _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+}
+#else
+inline Vec load(const Half* p)
+{
+    return _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)p));
+}
+
+inline void store(Half* p, Vec v)
+{
+    _mm_storel_epi64((__m128i*)p, _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+}
+#endif
+#endif
+
+inline Vec vecAt(float c, int mm) { return splat(c); }
+inline Vec vecAt(const float* c, int mm) { return load(c+mm); }
+#endif
+
+// out = (high - low)*scale, the curl term along one axis.
+template<class T>
+inline void
+difference(const T* low, const T* high, float scale, float* out, int len)
+{
+    int mm = 0;
+#if TROGDOR_VECTOR_WIDTH > 1
+    Vec vScale = splat(scale);
+    for (; mm + TROGDOR_VECTOR_WIDTH <= len; mm += TROGDOR_VECTOR_WIDTH)
+        store(out+mm, mul(sub(load(high+mm), load(low+mm)), vScale));
+#endif
+    for (; mm < len; mm++)
+        out[mm] = (high[mm] - low[mm])*scale;
+}
+
+inline void
+zero(float* out, int len)
+{
+    for (int mm = 0; mm < len; mm++)
+        out[mm] = 0.0f;
+}
+
+// field += c*(a - b - source), the lossless update for E and H.
+template<class T>
+inline void
+staticUpdate(T* field, float c, const float* a, const float* b,
+    const float* source, int len)
+{
+    int mm = 0;
+#if TROGDOR_VECTOR_WIDTH > 1
+    Vec vc = splat(c);
+    for (; mm + TROGDOR_VECTOR_WIDTH <= len; mm += TROGDOR_VECTOR_WIDTH)
+    {
+        Vec curl = sub(sub(load(a+mm), load(b+mm)), load(source+mm));
+        store(field+mm, add(load(field+mm), mul(vc, curl)));
+    }
+#endif
+    for (; mm < len; mm++)
+        field[mm] = field[mm] + c*(a[mm] - b[mm] - source[mm]);
+}
+
+// One pole of a dispersive material (see DispersivePole in MultiPoleModel.h),
+// given the field E before its update:
+//      J = cJ*J + cP*P + cE*E
+//      P += dt*J
+//      sumJ += J
+// J and P are auxiliary variables, which may be stored wider than E.
+template<class A, class T>
+inline void
+poleUpdate(A* J, A* P, const T* E, float cJ, float cP, float cE, float dt,
+    float* sumJ, int len)
+{
+    int mm = 0;
+#if TROGDOR_VECTOR_WIDTH > 1
+    Vec vcJ = splat(cJ), vcP = splat(cP), vcE = splat(cE), vdt = splat(dt);
+    for (; mm + TROGDOR_VECTOR_WIDTH <= len; mm += TROGDOR_VECTOR_WIDTH)
+    {
+        Vec p = load(P+mm);
+        Vec j = add(add(mul(vcJ, load(J+mm)), mul(vcP, p)),
+            mul(vcE, load(E+mm)));
+        store(J+mm, j);
+        store(P+mm, add(p, mul(vdt, j)));
+        store(sumJ+mm, add(load(sumJ+mm), j));
+    }
+#endif
+    for (; mm < len; mm++)
+    {
+        float j = cJ*J[mm] + cP*P[mm] + cE*E[mm];
+        J[mm] = j;
+        P[mm] = P[mm] + dt*j;
+        sumJ[mm] += j;
+    }
+}
+
+// One CFS-RIPML convolution term at cell mm, given the curl term d there:
+//      J' = cCurl*d + accum
+//      accum += cAccumCurl*d - cAccumJ*J'
+// returning J'.
+#if TROGDOR_VECTOR_WIDTH > 1
+template<class CoeffT, class T>
+inline Vec
+pmlTerm(T* accum, CoeffT cCurl, CoeffT cAccumCurl, CoeffT cAccumJ, Vec d,
+    int mm)
+{
+    Vec a = load(accum+mm);
+    Vec Jnew = add(mul(vecAt(cCurl, mm), d), a);
+    store(accum+mm, add(a, sub(mul(vecAt(cAccumCurl, mm), d),
+        mul(vecAt(cAccumJ, mm), Jnew))));
+    return Jnew;
+}
+#endif
+
+template<class CoeffT, class T>
+inline float
+pmlTerm(T* accum, CoeffT cCurl, CoeffT cAccumCurl, CoeffT cAccumJ, float d,
+    int mm)
+{
+    float Jnew = at(cCurl, mm)*d + accum[mm];
+    accum[mm] += (at(cAccumCurl, mm)*d - at(cAccumJ, mm)*Jnew);
+    return Jnew;
+}
+
+// PML current where one direction perpendicular to the field is attenuated:
+//      J = sign*J'
+// Along the attenuated direction the coefficients are a pointer to one float
+// per cell; across it they are the same float for the whole runline.
+template<class CoeffT, class T>
+inline void
+pmlUpdate(T* & accum, CoeffT & cCurl, CoeffT & cAccumCurl,
+    CoeffT & cAccumJ, const float* dField, float sign, float* J, int len)
+{
+    int mm = 0;
+#if TROGDOR_VECTOR_WIDTH > 1
+    Vec vSign = splat(sign);
+    for (; mm + TROGDOR_VECTOR_WIDTH <= len; mm += TROGDOR_VECTOR_WIDTH)
+    {
+        store(J+mm, mul(vSign, pmlTerm(accum, cCurl, cAccumCurl, cAccumJ,
+            load(dField+mm), mm)));
+    }
+#endif
+    for (; mm < len; mm++)
+        J[mm] = sign*pmlTerm(accum, cCurl, cAccumCurl, cAccumJ, dField[mm], mm);
+
+    advance(accum, len);
+    advance(cCurl, len);
+    advance(cAccumCurl, len);
+    advance(cAccumJ, len);
+}
+
+// PML current on the edges and in the corners of the PML, where both
+// directions perpendicular to the field are attenuated:
+//      J = signJ*J'_j + signK*J'_k
+// Both terms are done in one pass, so J is written once and not zeroed first.
+// At most one of the two sets of coefficients varies along the runline.
+template<class CoeffJ, class CoeffK, class T>
+inline void
+pmlUpdatePair(T* & accumJ, CoeffJ & cCurlJ, CoeffJ & cAccumCurlJ,
+    CoeffJ & cAccumJJ, const float* dFieldJ, float signJ,
+    T* & accumK, CoeffK & cCurlK, CoeffK & cAccumCurlK,
+    CoeffK & cAccumJK, const float* dFieldK, float signK, float* J, int len)
+{
+    int mm = 0;
+#if TROGDOR_VECTOR_WIDTH > 1
+    Vec vSignJ = splat(signJ);
+    Vec vSignK = splat(signK);
+    for (; mm + TROGDOR_VECTOR_WIDTH <= len; mm += TROGDOR_VECTOR_WIDTH)
+    {
+        Vec Jj = pmlTerm(accumJ, cCurlJ, cAccumCurlJ, cAccumJJ,
+            load(dFieldJ+mm), mm);
+        Vec Jk = pmlTerm(accumK, cCurlK, cAccumCurlK, cAccumJK,
+            load(dFieldK+mm), mm);
+        store(J+mm, add(mul(vSignJ, Jj), mul(vSignK, Jk)));
+    }
+#endif
+    for (; mm < len; mm++)
+    {
+        float Jj = pmlTerm(accumJ, cCurlJ, cAccumCurlJ, cAccumJJ,
+            dFieldJ[mm], mm);
+        float Jk = pmlTerm(accumK, cCurlK, cAccumCurlK, cAccumJK,
+            dFieldK[mm], mm);
+        J[mm] = signJ*Jj + signK*Jk;
+    }
+
+    advance(accumJ, len);
+    advance(cCurlJ, len);
+    advance(cAccumCurlJ, len);
+    advance(cAccumJJ, len);
+    advance(accumK, len);
+    advance(cCurlK, len);
+    advance(cAccumCurlK, len);
+    advance(cAccumJK, len);
+}
+
+// real += c*values, imag += s*values: one frequency of a running DFT.  Not
+// part of the update; the frequency-domain outputs use it.  The sums are
+// double: a run of many thousands of samples adds up terms much smaller than
+// the total, which float would round away.  The values are widened to double
+// half a register at a time.
+inline void
+dftAccumulate(const float* values, double c, double s, double* real,
+    double* imag, int len)
+{
+    int mm = 0;
+#if TROGDOR_VECTOR_WIDTH == 16
+    __m512d vc = _mm512_set1_pd(c), vs = _mm512_set1_pd(s);
+    for (; mm + 8 <= len; mm += 8)
+    {
+        __m512d v = _mm512_cvtps_pd(_mm256_loadu_ps(values+mm));
+        _mm512_storeu_pd(real+mm,
+            _mm512_fmadd_pd(vc, v, _mm512_loadu_pd(real+mm)));
+        _mm512_storeu_pd(imag+mm,
+            _mm512_fmadd_pd(vs, v, _mm512_loadu_pd(imag+mm)));
+    }
+#elif TROGDOR_VECTOR_WIDTH == 8
+    __m256d vc = _mm256_set1_pd(c), vs = _mm256_set1_pd(s);
+    for (; mm + 4 <= len; mm += 4)
+    {
+        __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(values+mm));
+#if defined(__FMA__)
+        _mm256_storeu_pd(real+mm,
+            _mm256_fmadd_pd(vc, v, _mm256_loadu_pd(real+mm)));
+        _mm256_storeu_pd(imag+mm,
+            _mm256_fmadd_pd(vs, v, _mm256_loadu_pd(imag+mm)));
+#else
+        _mm256_storeu_pd(real+mm,
+            _mm256_add_pd(_mm256_loadu_pd(real+mm), _mm256_mul_pd(vc, v)));
+        _mm256_storeu_pd(imag+mm,
+            _mm256_add_pd(_mm256_loadu_pd(imag+mm), _mm256_mul_pd(vs, v)));
+#endif
+    }
+#elif TROGDOR_VECTOR_WIDTH == 4
+    __m128d vc = _mm_set1_pd(c), vs = _mm_set1_pd(s);
+    for (; mm + 2 <= len; mm += 2)
+    {
+        __m128d v = _mm_cvtps_pd(_mm_loadl_pi(_mm_setzero_ps(),
+            (const __m64*)(values+mm)));
+        _mm_storeu_pd(real+mm,
+            _mm_add_pd(_mm_loadu_pd(real+mm), _mm_mul_pd(vc, v)));
+        _mm_storeu_pd(imag+mm,
+            _mm_add_pd(_mm_loadu_pd(imag+mm), _mm_mul_pd(vs, v)));
+    }
+#endif
+    for (; mm < len; mm++)
+    {
+        real[mm] += c*values[mm];
+        imag[mm] += s*values[mm];
+    }
+}
+
+} // namespace VectorKernels
+
+#endif
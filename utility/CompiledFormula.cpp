@@ -0,0 +1,767 @@
+/*
+ *  CompiledFormula.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "CompiledFormula.h"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+static double sMax(double a, double b) { return a > b ? a : b; }
+static double sMin(double a, double b) { return a < b ? a : b; }
+
+/**
+ * Recursive descent compiler for the grammar of calc.hh.  Each Gn() emits
+ * the code for what calc.hh's Gn() evaluates, so the two agree on
+ * precedence and on what is an error.
+ */
+class FormulaCompiler
+{
+public:
+    FormulaCompiler(CompiledFormula & formula,
+        const vector<string> & inputNames);
+
+    void compile() throw(Exception);
+
+private:
+    enum TokenType
+    {
+        kNumber, kName, kPlus, kMinus, kTimes, kDivide, kPower,
+        kOpenParen, kCloseParen, kAssign, kComma, kUnrecognized,
+        kEndOfStatement, kEndOfString
+    };
+
+    void nextToken();
+    void fail(const string & message) throw(Exception);
+
+    void G0();
+    void G1();
+    void G2();
+    void G3();
+    void G4();
+    void G5();
+
+    void emit(CompiledFormula::Opcode op, int argument = 0);
+
+    CompiledFormula & mFormula;
+    const char* mPosition;
+    TokenType mToken;
+    string mTokenString;
+
+    map<string, int> mVariableSlots;
+    map<string, CompiledFormula::UnaryFunction> mUnaryFunctions;
+    map<string, CompiledFormula::BinaryFunction> mBinaryFunctions;
+    int mStackDepth;
+};
+
+FormulaCompiler::
+FormulaCompiler(CompiledFormula & formula, const vector<string> & inputNames) :
+    mFormula(formula),
+    mStackDepth(0)
+{
+    mUnaryFunctions["cos"] = cos;
+    mUnaryFunctions["sin"] = sin;
+    mUnaryFunctions["tan"] = tan;
+    mUnaryFunctions["acos"] = acos;
+    mUnaryFunctions["asin"] = asin;
+    mUnaryFunctions["atan"] = atan;
+    mUnaryFunctions["cosh"] = cosh;
+    mUnaryFunctions["sinh"] = sinh;
+    mUnaryFunctions["tanh"] = tanh;
+    mUnaryFunctions["exp"] = exp;
+    mUnaryFunctions["log"] = log;
+    mUnaryFunctions["log10"] = log10;
+    mUnaryFunctions["sqrt"] = sqrt;
+    mUnaryFunctions["ceil"] = ceil;
+    mUnaryFunctions["floor"] = floor;
+
+    mBinaryFunctions["atan2"] = atan2;
+    mBinaryFunctions["pow"] = pow;
+    mBinaryFunctions["max"] = sMax;
+    mBinaryFunctions["min"] = sMin;
+
+    // The inputs take the first variable slots, then the constants, which
+    // formulas may reassign as in calc.hh.
+    for (int nn = 0; nn < inputNames.size(); nn++)
+    {
+        mVariableSlots[inputNames[nn]] = nn;
+        mFormula.mInitialVariables.push_back(0.0);
+    }
+    mVariableSlots["pi"] = mFormula.mInitialVariables.size();
+    mFormula.mInitialVariables.push_back(3.14159265358979323846);
+    mVariableSlots["e"] = mFormula.mInitialVariables.size();
+    mFormula.mInitialVariables.push_back(2.71828182845904523536);
+}
+
+void FormulaCompiler::
+compile() throw(Exception)
+{
+    mPosition = mFormula.mText.c_str();
+    do { nextToken(); } while (mToken == kEndOfStatement);
+    while (mToken != kEndOfString)
+    {
+        G0();
+        emit(CompiledFormula::kEndStatement);
+        while (mToken == kEndOfStatement)
+            nextToken();
+    }
+}
+
+void FormulaCompiler::
+fail(const string & message) throw(Exception)
+{
+    ostringstream str;
+    str << message << " at character "
+        << (mPosition - mFormula.mText.c_str()) << " of \""
+        << mFormula.mText << "\"";
+    throw(Exception(str.str()));
+}
+
+void FormulaCompiler::
+emit(CompiledFormula::Opcode op, int argument)
+{
+    mFormula.mProgram.push_back(CompiledFormula::Instruction(op, argument));
+
+    switch (op)
+    {
+        case CompiledFormula::kPushConstant:
+        case CompiledFormula::kPushVariable:
+            mStackDepth++;
+            break;
+        case CompiledFormula::kAdd:
+        case CompiledFormula::kSubtract:
+        case CompiledFormula::kMultiply:
+        case CompiledFormula::kDivide:
+        case CompiledFormula::kPower:
+        case CompiledFormula::kBinaryFunction:
+        case CompiledFormula::kEndStatement:
+            mStackDepth--;
+            break;
+        default:
+            break;
+    }
+    if (mStackDepth > mFormula.mMaxStackDepth)
+        mFormula.mMaxStackDepth = mStackDepth;
+}
+
+// Statement: an assignment or an expression
+void FormulaCompiler::
+G0()
+{
+    if (mToken == kEndOfStatement || mToken == kEndOfString)
+    {
+        mFormula.mConstants.push_back(0.0);
+        emit(CompiledFormula::kPushConstant, mFormula.mConstants.size()-1);
+        return;
+    }
+
+    const char* savedPosition = mPosition;
+    string name = mTokenString;
+    TokenType token = mToken;
+
+    if (mToken == kName)
+    {
+        nextToken();
+        if (mToken == kAssign)
+        {
+            nextToken();
+            G1();
+            if (mVariableSlots.count(name) == 0)
+            {
+                mVariableSlots[name] = mFormula.mInitialVariables.size();
+                mFormula.mInitialVariables.push_back(0.0);
+            }
+            emit(CompiledFormula::kStore, mVariableSlots[name]);
+            return;
+        }
+    }
+
+    mPosition = savedPosition;
+    mTokenString = name;
+    mToken = token;
+    G1();
+}
+
+// Binary + and -
+void FormulaCompiler::
+G1()
+{
+    G2();
+    while (mToken == kPlus || mToken == kMinus)
+    {
+        bool isPlus = (mToken == kPlus);
+        nextToken();
+        G2();
+        emit(isPlus ? CompiledFormula::kAdd : CompiledFormula::kSubtract);
+    }
+}
+
+// * and /
+void FormulaCompiler::
+G2()
+{
+    G3();
+    while (mToken == kTimes || mToken == kDivide)
+    {
+        bool isTimes = (mToken == kTimes);
+        nextToken();
+        G3();
+        emit(isTimes ? CompiledFormula::kMultiply : CompiledFormula::kDivide);
+    }
+}
+
+// ^, which calc.hh doesn't chain
+void FormulaCompiler::
+G3()
+{
+    G4();
+    if (mToken == kPower)
+    {
+        nextToken();
+        G4();
+        emit(CompiledFormula::kPower);
+    }
+}
+
+// Unary + and -
+void FormulaCompiler::
+G4()
+{
+    if (mToken == kMinus)
+    {
+        nextToken();
+        G5();
+        emit(CompiledFormula::kNegate);
+        return;
+    }
+    if (mToken == kPlus)
+        nextToken();
+    G5();
+}
+
+// Numbers, variables, functions and parentheses
+void FormulaCompiler::
+G5()
+{
+    if (mToken == kOpenParen)
+    {
+        nextToken();
+        G0();
+        if (mToken != kCloseParen)
+            fail(string("Expected ) but found ") + mTokenString);
+        nextToken();
+        return;
+    }
+
+    if (mToken == kNumber)
+    {
+        double value;
+        istringstream str(mTokenString);
+        str >> value;
+        mFormula.mConstants.push_back(value);
+        emit(CompiledFormula::kPushConstant, mFormula.mConstants.size()-1);
+        nextToken();
+        return;
+    }
+
+    if (mToken == kName)
+    {
+        if (mVariableSlots.count(mTokenString))
+        {
+            emit(CompiledFormula::kPushVariable, mVariableSlots[mTokenString]);
+            nextToken();
+            return;
+        }
+
+        if (mUnaryFunctions.count(mTokenString))
+        {
+            CompiledFormula::UnaryFunction function =
+                mUnaryFunctions[mTokenString];
+            nextToken();
+            if (mToken != kOpenParen)
+                fail(string("Expected ( but found ") + mTokenString);
+            nextToken();
+            G0();
+            if (mToken != kCloseParen)
+                fail(string("Expected ) but found ") + mTokenString);
+            nextToken();
+
+            mFormula.mUnaryFunctions.push_back(function);
+            emit(CompiledFormula::kUnaryFunction,
+                mFormula.mUnaryFunctions.size()-1);
+            return;
+        }
+
+        if (mBinaryFunctions.count(mTokenString))
+        {
+            CompiledFormula::BinaryFunction function =
+                mBinaryFunctions[mTokenString];
+            nextToken();
+            if (mToken != kOpenParen)
+                fail(string("Expected ( but found ") + mTokenString);
+            nextToken();
+            G0();
+            if (mToken != kComma)
+                fail(string("Expected , but found ") + mTokenString);
+            nextToken();
+            G0();
+            if (mToken != kCloseParen)
+                fail(string("Expected ) but found ") + mTokenString);
+            nextToken();
+
+            mFormula.mBinaryFunctions.push_back(function);
+            emit(CompiledFormula::kBinaryFunction,
+                mFormula.mBinaryFunctions.size()-1);
+            return;
+        }
+
+        fail(string("Unknown variable ") + mTokenString);
+    }
+    fail(string("Bad position for ") + mTokenString);
+}
+
+void FormulaCompiler::
+nextToken()
+{
+    mToken = kEndOfStatement;
+    mTokenString = "";
+
+    while (isspace(*mPosition))
+        mPosition++;
+
+    if (*mPosition == '#')
+    {
+        while (*mPosition != '\n' && *mPosition != '\0')
+            mPosition++;
+        return;
+    }
+
+    if (isalpha(*mPosition))
+    {
+        mToken = kName;
+        do { mTokenString += *mPosition++; }
+        while (isalnum(*mPosition) || *mPosition == '_');
+        return;
+    }
+
+    if (isdigit(*mPosition))
+    {
+        mToken = kNumber;
+        do { mTokenString += *mPosition++; } while (isdigit(*mPosition));
+        if (*mPosition == '.')
+        {
+            do { mTokenString += *mPosition++; } while (isdigit(*mPosition));
+        }
+        if (*mPosition == 'e' || *mPosition == 'E')
+        {
+            mTokenString += *mPosition++;
+            if (*mPosition == '+' || *mPosition == '-')
+                mTokenString += *mPosition++;
+            if (isdigit(*mPosition))
+            {
+                do { mTokenString += *mPosition++; }
+                while (isdigit(*mPosition));
+            }
+            else
+                mToken = kUnrecognized;
+        }
+        return;
+    }
+
+    char c = *mPosition;
+    if (c != '\0')
+        mPosition++;
+    mTokenString = c;
+    switch (c)
+    {
+        case '+': mToken = kPlus; break;
+        case '-': mToken = kMinus; break;
+        case '*': mToken = kTimes; break;
+        case '/': mToken = kDivide; break;
+        case '^': mToken = kPower; break;
+        case '(': mToken = kOpenParen; break;
+        case ')': mToken = kCloseParen; break;
+        case '=': mToken = kAssign; break;
+        case ',': mToken = kComma; break;
+        case '\0':
+            mToken = kEndOfString;
+            mTokenString = "end of formula";
+            break;
+        case ';': mToken = kEndOfStatement; break;
+        default: mToken = kUnrecognized; break;
+    }
+}
+
+#pragma mark *** CompiledFormula ***
+
+CompiledFormula::
+CompiledFormula() :
+    mNumInputs(0),
+    mMaxStackDepth(0),
+    mNumOutputs(0)
+{
+}
+
+void CompiledFormula::
+compile(const string & formula, const vector<string> & inputNames)
+    throw(Exception)
+{
+    mText = formula;
+    mNumInputs = inputNames.size();
+    mProgram.clear();
+    mConstants.clear();
+    mInitialVariables.clear();
+    mUnaryFunctions.clear();
+    mBinaryFunctions.clear();
+    mMaxStackDepth = 0;
+    mNumOutputs = 0;
+
+    FormulaCompiler compiler(*this, inputNames);
+    try {
+        compiler.compile();
+    } catch (Exception & e) {
+        mProgram.clear();
+        throw;
+    }
+
+    mStack.resize(mMaxStackDepth + 1);
+    mVariables.resize(mInitialVariables.size());
+}
+
+double CompiledFormula::
+evaluate(const double* inputValues) const
+{
+    double* stack = &mStack[0];
+    double* variables = &mVariables[0];
+    int top = -1;
+    double lastValue = 0.0;
+
+    for (int nn = 0; nn < mInitialVariables.size(); nn++)
+        variables[nn] = (nn < mNumInputs) ? inputValues[nn] :
+            mInitialVariables[nn];
+
+    const int numInstructions = mProgram.size();
+    for (int ii = 0; ii < numInstructions; ii++)
+    {
+        const Instruction & in(mProgram[ii]);
+        switch (in.opcode)
+        {
+            case kPushConstant:
+                stack[++top] = mConstants[in.argument];
+                break;
+            case kPushVariable:
+                stack[++top] = variables[in.argument];
+                break;
+            case kStore:
+                variables[in.argument] = stack[top];
+                break;
+            case kAdd:
+                stack[top-1] += stack[top];
+                top--;
+                break;
+            case kSubtract:
+                stack[top-1] -= stack[top];
+                top--;
+                break;
+            case kMultiply:
+                stack[top-1] *= stack[top];
+                top--;
+                break;
+            case kDivide:
+                stack[top-1] /= stack[top];
+                top--;
+                break;
+            case kPower:
+                stack[top-1] = pow(stack[top-1], stack[top]);
+                top--;
+                break;
+            case kNegate:
+                stack[top] = -stack[top];
+                break;
+            case kUnaryFunction:
+                stack[top] = mUnaryFunctions[in.argument](stack[top]);
+                break;
+            case kBinaryFunction:
+                stack[top-1] = mBinaryFunctions[in.argument](stack[top-1],
+                    stack[top]);
+                top--;
+                break;
+            case kOutput:
+                break;
+            case kEndStatement:
+                lastValue = stack[top--];
+                break;
+        }
+    }
+    assert(top == -1);
+    return lastValue;
+}
+
+void CompiledFormula::
+evaluate(long count, const double* const* inputs, const int* inputStrides,
+    double* values, double* const* outputs) const
+{
+    const int numVariables = mInitialVariables.size();
+    mBlockStack.resize((mMaxStackDepth + 1)*BLOCKSIZE);
+    mBlockVariables.resize(numVariables*BLOCKSIZE);
+    double* stack = &mBlockStack[0];
+    double* variables = &mBlockVariables[0];
+    const int numInstructions = mProgram.size();
+
+    for (long first = 0; first < count; first += BLOCKSIZE)
+    {
+        const int num = int(min(count - first, long(BLOCKSIZE)));
+
+        for (int vv = 0; vv < numVariables; vv++)
+        {
+            double* v = variables + vv*BLOCKSIZE;
+            if (vv >= mNumInputs)
+                fill(v, v + num, mInitialVariables[vv]);
+            else if (inputStrides[vv] == 0)
+                fill(v, v + num, inputs[vv][0]);
+            else
+                copy(inputs[vv] + first, inputs[vv] + first + num, v);
+        }
+        if (values != 0L)
+            fill(values + first, values + first + num, 0.0);
+
+        // The stack holds one block of values per entry.
+        double* top = stack;
+        int depth = 0;
+        for (int ii = 0; ii < numInstructions; ii++)
+        {
+            const Instruction & in(mProgram[ii]);
+            double* a = top - BLOCKSIZE; // next to top, for binary ops
+            int nn;
+            switch (in.opcode)
+            {
+                case kPushConstant:
+                    top = stack + (depth++)*BLOCKSIZE;
+                    fill(top, top + num, mConstants[in.argument]);
+                    break;
+                case kPushVariable:
+                    top = stack + (depth++)*BLOCKSIZE;
+                    copy(variables + in.argument*BLOCKSIZE,
+                        variables + in.argument*BLOCKSIZE + num, top);
+                    break;
+                case kStore:
+                    copy(top, top + num, variables + in.argument*BLOCKSIZE);
+                    break;
+                case kAdd:
+                    for (nn = 0; nn < num; nn++)
+                        a[nn] += top[nn];
+                    top = a;
+                    depth--;
+                    break;
+                case kSubtract:
+                    for (nn = 0; nn < num; nn++)
+                        a[nn] -= top[nn];
+                    top = a;
+                    depth--;
+                    break;
+                case kMultiply:
+                    for (nn = 0; nn < num; nn++)
+                        a[nn] *= top[nn];
+                    top = a;
+                    depth--;
+                    break;
+                case kDivide:
+                    for (nn = 0; nn < num; nn++)
+                        a[nn] /= top[nn];
+                    top = a;
+                    depth--;
+                    break;
+                case kPower:
+                    for (nn = 0; nn < num; nn++)
+                        a[nn] = pow(a[nn], top[nn]);
+                    top = a;
+                    depth--;
+                    break;
+                case kNegate:
+                    for (nn = 0; nn < num; nn++)
+                        top[nn] = -top[nn];
+                    break;
+                case kUnaryFunction:
+                {
+                    UnaryFunction f = mUnaryFunctions[in.argument];
+                    for (nn = 0; nn < num; nn++)
+                        top[nn] = f(top[nn]);
+                    break;
+                }
+                case kBinaryFunction:
+                {
+                    BinaryFunction f = mBinaryFunctions[in.argument];
+                    for (nn = 0; nn < num; nn++)
+                        a[nn] = f(a[nn], top[nn]);
+                    top = a;
+                    depth--;
+                    break;
+                }
+                case kOutput:
+                    if (outputs != 0L)
+                        copy(top, top + num, outputs[in.argument] + first);
+                    break;
+                case kEndStatement:
+                    if (values != 0L)
+                        copy(top, top + num, values + first);
+                    top = a;
+                    depth--;
+                    break;
+            }
+        }
+        assert(depth == 0);
+    }
+}
+
+// Where each operand on the stack starts in the program, and whether it
+// depends on no input, only on static inputs, or on the others.
+enum OperandKind
+{
+    kConstantOperand,
+    kStaticOperand,
+    kDynamicOperand
+};
+struct SplitOperand
+{
+    SplitOperand(int firstInstruction, OperandKind operandKind) :
+        first(firstInstruction), kind(operandKind) {}
+    int first;
+    OperandKind kind;
+};
+
+void CompiledFormula::
+split(const vector<bool> & isStaticInput, CompiledFormula & staticPart,
+    CompiledFormula & dynamicPart) const
+{
+    assert(isStaticInput.size() == mNumInputs);
+    assert(mNumOutputs == 0);
+
+    // Run through the program keeping track of what each operand depends
+    // on.  The program has no branches, so a variable depends on whatever
+    // was last stored in it.  Static operands are hoisted where they meet a
+    // dynamic one or end a statement.
+    vector<OperandKind> variableKinds(mInitialVariables.size(),
+        kConstantOperand);
+    for (int nn = 0; nn < mNumInputs; nn++)
+        variableKinds[nn] = isStaticInput[nn] ? kStaticOperand :
+            kDynamicOperand;
+
+    vector<SplitOperand> operands;
+    vector<int> hoistedFirst(mProgram.size(), -1); // indexed by last instr.
+
+    for (int ii = 0; ii < mProgram.size(); ii++)
+    {
+        const Instruction & in(mProgram[ii]);
+        switch (in.opcode)
+        {
+            case kPushConstant:
+                operands.push_back(SplitOperand(ii, kConstantOperand));
+                break;
+            case kPushVariable:
+                operands.push_back(SplitOperand(ii,
+                    variableKinds[in.argument]));
+                break;
+            case kStore:
+                variableKinds[in.argument] = operands.back().kind;
+                break;
+            case kNegate:
+            case kUnaryFunction:
+                break;
+            case kEndStatement:
+                if (operands.back().kind == kStaticOperand)
+                    hoistedFirst[ii-1] = operands.back().first;
+                operands.pop_back();
+                break;
+            case kOutput:
+                assert(!"Can't split a formula that was already split.");
+                break;
+            default: // binary operations
+            {
+                SplitOperand b = operands.back();
+                operands.pop_back();
+                SplitOperand a = operands.back();
+                operands.pop_back();
+                OperandKind kind = max(a.kind, b.kind);
+                if (kind == kDynamicOperand)
+                {
+                    if (a.kind == kStaticOperand)
+                        hoistedFirst[b.first-1] = a.first;
+                    if (b.kind == kStaticOperand)
+                        hoistedFirst[ii-1] = b.first;
+                }
+                operands.push_back(SplitOperand(a.first, kind));
+                break;
+            }
+        }
+    }
+
+    // The static part is the whole program, writing the hoisted values out
+    // as it goes.  It works out dynamic values too, but only once.
+    staticPart = *this;
+    staticPart.mProgram.clear();
+    vector<int> outputIndex(mProgram.size(), -1);
+    for (int ii = 0; ii < mProgram.size(); ii++)
+    {
+        staticPart.mProgram.push_back(mProgram[ii]);
+        if (hoistedFirst[ii] != -1)
+        {
+            outputIndex[ii] = staticPart.mNumOutputs;
+            staticPart.mProgram.push_back(Instruction(kOutput,
+                staticPart.mNumOutputs++));
+        }
+    }
+
+    // The dynamic part reads the hoisted values from new inputs, which go
+    // between the old inputs and the other variables.
+    const int numOutputs = staticPart.mNumOutputs;
+    dynamicPart = *this;
+    dynamicPart.mProgram.clear();
+    dynamicPart.mNumInputs = mNumInputs + numOutputs;
+    dynamicPart.mInitialVariables.insert(
+        dynamicPart.mInitialVariables.begin() + mNumInputs, numOutputs, 0.0);
+
+    vector<int> hoistedLast(mProgram.size(), -1);
+    for (int ii = 0; ii < mProgram.size(); ii++)
+    if (hoistedFirst[ii] != -1)
+        hoistedLast[hoistedFirst[ii]] = ii;
+
+    for (int ii = 0; ii < mProgram.size(); ii++)
+    {
+        if (hoistedLast[ii] != -1)
+        {
+            dynamicPart.mProgram.push_back(Instruction(kPushVariable,
+                mNumInputs + outputIndex[hoistedLast[ii]]));
+            ii = hoistedLast[ii];
+            continue;
+        }
+        Instruction in(mProgram[ii]);
+        if ((in.opcode == kPushVariable || in.opcode == kStore) &&
+            in.argument >= mNumInputs)
+            in.argument += numOutputs;
+        dynamicPart.mProgram.push_back(in);
+    }
+    dynamicPart.mStack.resize(mMaxStackDepth + 1);
+    dynamicPart.mVariables.resize(dynamicPart.mInitialVariables.size());
+}
+
+bool CompiledFormula::
+dependsOn(int inputIndex) const
+{
+    assert(inputIndex >= 0 && inputIndex < mNumInputs);
+    for (int ii = 0; ii < mProgram.size(); ii++)
+    if (mProgram[ii].opcode == kPushVariable &&
+        mProgram[ii].argument == inputIndex)
+        return 1;
+    return 0;
+}
+
+
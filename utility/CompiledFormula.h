@@ -0,0 +1,143 @@
+/*
+ *  CompiledFormula.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _COMPILEDFORMULA_
+#define _COMPILEDFORMULA_
+
+#include "Exception.h"
+#include <string>
+#include <vector>
+
+/**
+ * Arithmetic formula in the syntax of calc.hh, compiled once into a program
+ * for a little stack machine so it can be evaluated over and over without
+ * parsing it again.
+ *
+ * The syntax is calc.hh's: numbers, + - * / ^, unary + and -, parentheses,
+ * the functions cos, sin, tan, acos, asin, atan, cosh, sinh, tanh, exp,
+ * log, log10, sqrt, ceil, floor, atan2, pow, max and min, the
+ * constants pi and e, assignments "a = ...", statements separated by ";"
+ * and comments from "#" to the end of the line.  The value of the formula is
+ * the value of its last statement.  Values are doubles.
+ *
+ * The inputs are the variables named when the formula is compiled, e.g. n
+ * and t for source waveforms; their values are passed to evaluate().
+ */
+class CompiledFormula
+{
+public:
+    CompiledFormula();
+
+    /**
+     * Compile the formula.  Throws an Exception saying what went wrong and
+     * where if the formula can't be parsed.
+     *
+     * @param formula       the formula text
+     * @param inputNames    names of the inputs, in the order evaluate() takes
+     *                      their values
+     */
+    void compile(const std::string & formula,
+        const std::vector<std::string> & inputNames) throw(Exception);
+
+    /**
+     * @param inputValues   one value per input name
+     * @returns the value of the formula
+     */
+    double evaluate(const double* inputValues) const;
+
+    /**
+     * Evaluate the formula at many points at once.  Each instruction runs
+     * over a block of points before the next, so the interpreter overhead is
+     * paid once per block and the arithmetic loops can be vectorized.
+     *
+     * @param count         number of points
+     * @param inputs        input i at point j is inputs[i][j*inputStrides[i]]
+     * @param inputStrides  1, or 0 if an input is the same at every point
+     * @param values        room for count values of the formula, or 0L
+     * @param outputs       room for count values of each output (see
+     *                      split()), or 0L
+     */
+    void evaluate(long count, const double* const* inputs,
+        const int* inputStrides, double* values,
+        double* const* outputs = 0L) const;
+
+    /**
+     * Separate the parts of the formula that depend on the static inputs
+     * (e.g. position) from the parts that depend on the rest (e.g. time).
+     * Each largest subexpression that uses a static input and no other input
+     * is written by staticPart to an output of its own.  dynamicPart takes
+     * these outputs as extra inputs after the original ones, and works out
+     * the value of the formula without using the static inputs again.
+     *
+     * @param isStaticInput one flag per input
+     * @param staticPart    has the same inputs as this formula
+     * @param dynamicPart   has the same inputs, then staticPart's outputs
+     */
+    void split(const std::vector<bool> & isStaticInput,
+        CompiledFormula & staticPart, CompiledFormula & dynamicPart) const;
+
+    /**
+     * @returns true if the value of the formula can depend on this input
+     */
+    bool dependsOn(int inputIndex) const;
+
+    const std::string & text() const { return mText; }
+    int numInputs() const { return mNumInputs; }
+    int numOutputs() const { return mNumOutputs; }
+
+    // Program instructions; public for the compiler in CompiledFormula.cpp.
+    enum Opcode
+    {
+        kPushConstant,
+        kPushVariable,
+        kStore,
+        kAdd,
+        kSubtract,
+        kMultiply,
+        kDivide,
+        kPower,
+        kNegate,
+        kUnaryFunction,
+        kBinaryFunction,
+        kOutput,
+        kEndStatement
+    };
+    struct Instruction
+    {
+        Instruction(Opcode op, int arg = 0) : opcode(op), argument(arg) {}
+        Opcode opcode;
+        int argument;
+    };
+
+    typedef double (*UnaryFunction)(double);
+    typedef double (*BinaryFunction)(double, double);
+
+private:
+    std::string mText;
+    int mNumInputs;
+    std::vector<Instruction> mProgram;
+    std::vector<double> mConstants;
+    std::vector<double> mInitialVariables;
+    std::vector<UnaryFunction> mUnaryFunctions;
+    std::vector<BinaryFunction> mBinaryFunctions;
+    int mMaxStackDepth;
+    int mNumOutputs;
+
+    // Scratch space for evaluate().
+    mutable std::vector<double> mStack;
+    mutable std::vector<double> mVariables;
+    mutable std::vector<double> mBlockStack;
+    mutable std::vector<double> mBlockVariables;
+
+    static const int BLOCKSIZE = 256;
+
+    friend class FormulaCompiler;
+};
+
+
+#endif
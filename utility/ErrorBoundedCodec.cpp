@@ -0,0 +1,492 @@
+/*
+ *  ErrorBoundedCodec.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "ErrorBoundedCodec.h"
+#include "LZCodec.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+typedef unsigned int uint32;
+typedef unsigned long long uint64;
+
+static const uint32 EXACT = 0xffffffffu;
+static const double MAX_QUANTA = 1073741824.0; // 2^30, so codes fit 31 bits
+static const int BLOCK_LENGTH = 32;
+static const long HEADER_BYTES = sizeof(double) + 3*sizeof(uint32);
+static const long SEGMENT_BYTES = 4*sizeof(uint32);
+
+static inline bool
+isFinite(float value)
+{
+    return value == value && fabs(value) <= FLT_MAX;
+}
+
+// The encoder and decoder both predict and reconstruct through these two
+// functions so they round identically.
+//
+// Lorenzo prediction: add the neighbors one step back along each direction
+// used, subtract those two steps back, add the one three steps back.  Each
+// extra direction cancels more of the field's variation but adds more of
+// the earlier values' quantization error, so at large error bounds fewer
+// directions can do better; compress() picks the number of directions for
+// each block.  segmentStart points to the first value of the segment and mm
+// is the index in the segment.
+static const int NUM_PREDICTORS = 3; // x, y and z; x and y; x
+
+static inline double
+predict(const float* segmentStart, long mm,
+    const ErrorBoundedCodec::Segment & segment, int predictor)
+{
+    const long rowLength = segment.rowLength;
+    const long sliceLength = segment.sliceLength;
+    const long index = segment.firstIndex + mm;
+    const float* p = segmentStart + mm;
+
+    bool useX = index % rowLength > 0 && mm >= 1;
+    bool useY = predictor < 2 && (index % sliceLength) >= rowLength &&
+        mm >= rowLength;
+    bool useZ = predictor < 1 && index >= sliceLength && mm >= sliceLength;
+
+    if (useX && useY && useZ)
+    {
+        return (double)p[-1] + p[-rowLength] + p[-sliceLength]
+            - p[-1-rowLength] - p[-1-sliceLength] - p[-rowLength-sliceLength]
+            + p[-1-rowLength-sliceLength];
+    }
+    else if (!useX && !useY && !useZ)
+        return mm > 0 ? p[-1] : 0.0;
+
+    double prediction = 0.0;
+    for (int dirs = 1; dirs < 8; dirs++)
+    {
+        if (((dirs & 1) && !useX) || ((dirs & 2) && !useY) ||
+            ((dirs & 4) && !useZ))
+            continue;
+        long offset = ((dirs & 1) ? 1 : 0) + ((dirs & 2) ? rowLength : 0) +
+            ((dirs & 4) ? sliceLength : 0);
+        int numDirs = (dirs & 1) + ((dirs >> 1) & 1) + ((dirs >> 2) & 1);
+        if (numDirs % 2 == 1)
+            prediction += p[-offset];
+        else
+            prediction -= p[-offset];
+    }
+    return prediction;
+}
+
+static inline float
+reconstruct(double prediction, double quanta, double quantum)
+{
+    return (float)(prediction + quanta*quantum);
+}
+
+// Zigzag coding puts small negative counts next to small positive ones.
+static inline uint32
+encodeQuanta(long quanta)
+{
+    return quanta >= 0 ? 2*quanta : -2*quanta - 1;
+}
+
+static inline double
+decodeQuanta(uint32 code)
+{
+    return (code & 1) ? -(double)(code >> 1) - 1.0 : (double)(code >> 1);
+}
+
+// Bits go into bytes least significant first.
+class BitWriter
+{
+public:
+    BitWriter(vector<unsigned char> & bytes) :
+        mBytes(bytes), mAccumulator(0), mNumBits(0) {}
+    
+    void put(uint32 bits, int numBits)
+    {
+        mAccumulator |= (uint64)bits << mNumBits;
+        mNumBits += numBits;
+        for (; mNumBits >= 8; mNumBits -= 8, mAccumulator >>= 8)
+            mBytes.push_back((unsigned char)(mAccumulator & 0xff));
+    }
+    
+    void flush()
+    {
+        if (mNumBits > 0)
+            mBytes.push_back((unsigned char)mAccumulator);
+        mAccumulator = 0;
+        mNumBits = 0;
+    }
+private:
+    vector<unsigned char> & mBytes;
+    uint64 mAccumulator;
+    int mNumBits;
+};
+
+class BitReader
+{
+public:
+    BitReader(const vector<unsigned char> & bytes) :
+        mBytes(bytes), mPosition(0), mAccumulator(0), mNumBits(0) {}
+    
+    // Returns false past the end of the bytes.
+    bool get(uint32 & bits, int numBits)
+    {
+        for (; mNumBits < numBits; mNumBits += 8)
+        {
+            if (mPosition >= mBytes.size())
+                return 0;
+            mAccumulator |= (uint64)mBytes[mPosition++] << mNumBits;
+        }
+        bits = (uint32)(mAccumulator & ((1ULL << numBits) - 1));
+        mAccumulator >>= numBits;
+        mNumBits -= numBits;
+        return 1;
+    }
+    
+    void skipToByte() { mAccumulator = 0; mNumBits = 0; }
+    bool atEnd() const { return mPosition == mBytes.size(); }
+private:
+    const vector<unsigned char> & mBytes;
+    long mPosition;
+    uint64 mAccumulator;
+    int mNumBits;
+};
+
+// Rice coding: code >> k in unary (that many 1s and a 0), then the low k bits
+// of the code.  MAX_UNARY 1s escape to the code in 32 plain bits.
+static const uint32 MAX_UNARY = 32;
+
+static inline long
+riceBits(uint32 code, int k)
+{
+    uint32 high = code >> k;
+    return high < MAX_UNARY ? high + 1 + k : MAX_UNARY + 32;
+}
+
+// Quantize values [first, last) of a segment with the given predictor,
+// filling in decoded and codes.  Exact values and the largest error are
+// only collected if exact and maxError aren't null.
+static void
+quantizeBlock(const float* in, float* decoded,
+    const ErrorBoundedCodec::Segment & segment, long first, long last,
+    int predictor, double errorBound, uint32* codes, vector<float>* exact,
+    double* maxError)
+{
+    const double quantum = 2.0*errorBound;
+    for (long mm = first; mm < last; mm++)
+    {
+        double prediction = predict(decoded, mm, segment, predictor);
+        double quanta = floor((in[mm] - prediction)/quantum + 0.5);
+
+        // Rounding to float can add error beyond the bound for values much
+        // bigger than the quantum, so check the value the reader will get.
+        if (isFinite(in[mm]) && fabs(quanta) < MAX_QUANTA)
+        {
+            float value = reconstruct(prediction, quanta, quantum);
+            double error = fabs((double)value - in[mm]);
+            if (error <= errorBound)
+            {
+                codes[mm-first] = encodeQuanta((long)quanta);
+                decoded[mm] = value;
+                if (maxError != 0L && error > *maxError)
+                    *maxError = error;
+                continue;
+            }
+        }
+        codes[mm-first] = EXACT;
+        decoded[mm] = in[mm];
+        if (exact != 0L)
+            exact->push_back(in[mm]);
+    }
+}
+
+// @returns the fewest bits to Rice code the block, and the k that does it
+static long
+blockBits(const uint32* codes, long count, int & bestK)
+{
+    long bestBits = -1;
+    for (int k = 0; k < 32; k++)
+    {
+        long numBits = 0;
+        for (long nn = 0; nn < count; nn++)
+            numBits += riceBits(codes[nn], k);
+        if (bestBits < 0 || numBits < bestBits)
+        {
+            bestK = k;
+            bestBits = numBits;
+        }
+    }
+    return bestBits;
+}
+
+// Each block starts on a byte holding its k and predictor.
+static void
+writeBlock(BitWriter & writer, const uint32* codes, long count, int k,
+    int predictor)
+{
+    writer.put(k | (predictor << 5), 8);
+    for (long nn = 0; nn < count; nn++)
+    {
+        uint32 high = codes[nn] >> k;
+        if (high < MAX_UNARY)
+        {
+            writer.put((1u << high) - 1, high + 1);
+            if (k > 0)
+                writer.put(codes[nn] & ((1u << k) - 1), k);
+        }
+        else
+        {
+            writer.put(0xffffffffu, MAX_UNARY);
+            writer.put(codes[nn], 32);
+        }
+    }
+    writer.flush();
+}
+
+static bool
+readBlock(BitReader & reader, uint32* codes, long count, int & predictor)
+{
+    uint32 header;
+    if (!reader.get(header, 8) || (header >> 5) >= NUM_PREDICTORS)
+        return 0;
+    int k = header & 31;
+    predictor = header >> 5;
+
+    for (long nn = 0; nn < count; nn++)
+    {
+        uint32 high = 0, bit = 1, low = 0;
+        while (high < MAX_UNARY)
+        {
+            if (!reader.get(bit, 1))
+                return 0;
+            if (bit == 0)
+                break;
+            high++;
+        }
+        if (high < MAX_UNARY)
+        {
+            if (k > 0 && !reader.get(low, k))
+                return 0;
+            codes[nn] = (high << k) | low;
+        }
+        else if (!reader.get(codes[nn], 32))
+            return 0;
+    }
+    reader.skipToByte();
+    return 1;
+}
+
+static inline void
+put32(unsigned char* & op, long value)
+{
+    uint32 v = (uint32)value;
+    memcpy(op, &v, sizeof(uint32));
+    op += sizeof(uint32);
+}
+
+static inline long
+get32(const unsigned char* & ip)
+{
+    uint32 v;
+    memcpy(&v, ip, sizeof(uint32));
+    ip += sizeof(uint32);
+    return (long)v;
+}
+
+long ErrorBoundedCodec::
+maxCompressedBytes(long numValues, long numSegments)
+{
+    long numBlocks = numValues/BLOCK_LENGTH + 1;
+    return HEADER_BYTES + numSegments*SEGMENT_BYTES +
+        numValues*sizeof(float) +
+        LZCodec::maxCompressedBytes(numBlocks*(1 + BLOCK_LENGTH*8));
+}
+
+long ErrorBoundedCodec::
+compress(const float* in, long numValues, double errorBound,
+    unsigned char* out, long maxOutBytes, double & maxError)
+{
+    long rowLength = numValues > 0 ? numValues : 1;
+    vector<Segment> segments(1, Segment(numValues, rowLength, rowLength, 0));
+    return compress(in, segments, errorBound, out, maxOutBytes, maxError);
+}
+
+long ErrorBoundedCodec::
+compress(const float* in, const vector<Segment> & segments,
+    double errorBound, unsigned char* out, long maxOutBytes,
+    double & maxError)
+{
+    assert(errorBound > 0);
+
+    long numValues = 0;
+    for (int ss = 0; ss < segments.size(); ss++)
+    {
+        assert(segments[ss].rowLength > 0);
+        assert(segments[ss].sliceLength % segments[ss].rowLength == 0);
+        numValues += segments[ss].numValues;
+    }
+
+    vector<float> decoded(numValues);
+    vector<float> exact;
+    vector<unsigned char> packed;
+    BitWriter writer(packed);
+    uint32 codes[BLOCK_LENGTH];
+    maxError = 0.0;
+
+    // Code each block with the predictor that takes the fewest bits.
+    long segmentStart = 0;
+    for (int ss = 0; ss < segments.size(); ss++)
+    {
+        const Segment & segment(segments[ss]);
+        const float* segmentIn = in + segmentStart;
+        float* segmentDecoded = &decoded[0] + segmentStart;
+        for (long first = 0; first < segment.numValues; first += BLOCK_LENGTH)
+        {
+            long last = min(first + BLOCK_LENGTH, segment.numValues);
+            int bestPredictor = 0, k;
+            long bestBits = -1;
+            for (int pp = 0; pp < NUM_PREDICTORS; pp++)
+            {
+                quantizeBlock(segmentIn, segmentDecoded, segment, first, last,
+                    pp, errorBound, codes, 0L, 0L);
+                long numBits = blockBits(codes, last - first, k);
+                if (bestBits < 0 || numBits < bestBits)
+                {
+                    bestPredictor = pp;
+                    bestBits = numBits;
+                }
+            }
+            quantizeBlock(segmentIn, segmentDecoded, segment, first, last,
+                bestPredictor, errorBound, codes, &exact, &maxError);
+            blockBits(codes, last - first, k);
+            writeBlock(writer, codes, last - first, k, bestPredictor);
+        }
+        segmentStart += segment.numValues;
+    }
+
+    long exactBytes = exact.size()*sizeof(float);
+    if (HEADER_BYTES + segments.size()*SEGMENT_BYTES + exactBytes >=
+        maxOutBytes)
+        return 0;
+
+    uint32 numExact = exact.size();
+    uint32 packedBytes = packed.size();
+    unsigned char* op = out;
+    memcpy(op, &errorBound, sizeof(double));
+    op += sizeof(double);
+    put32(op, segments.size());
+    for (int ss = 0; ss < segments.size(); ss++)
+    {
+        put32(op, segments[ss].numValues);
+        put32(op, segments[ss].rowLength);
+        put32(op, segments[ss].sliceLength);
+        put32(op, segments[ss].firstIndex);
+    }
+    memcpy(op, &numExact, sizeof(uint32));
+    op += sizeof(uint32);
+    memcpy(op, &packedBytes, sizeof(uint32));
+    op += sizeof(uint32);
+    if (exactBytes > 0)
+        memcpy(op, &exact[0], exactBytes);
+    op += exactBytes;
+
+    long lzBytes = LZCodec::compress(packed.size() ? &packed[0] : 0L,
+        packed.size(), op, maxOutBytes - (op - out));
+    if (lzBytes == 0)
+        return 0;
+    return (op - out) + lzBytes;
+}
+
+bool ErrorBoundedCodec::
+decompress(const unsigned char* in, long inBytes, float* out, long numValues)
+{
+    if (inBytes < HEADER_BYTES)
+        return 0;
+
+    double errorBound;
+    uint32 numExact, packedBytes;
+    const unsigned char* ip = in;
+    memcpy(&errorBound, ip, sizeof(double));
+    ip += sizeof(double);
+
+    long numSegments = get32(ip);
+    if (numSegments > (inBytes - HEADER_BYTES)/SEGMENT_BYTES)
+        return 0;
+    vector<Segment> segments(numSegments);
+    long totalValues = 0;
+    for (int ss = 0; ss < numSegments; ss++)
+    {
+        segments[ss].numValues = get32(ip);
+        segments[ss].rowLength = get32(ip);
+        segments[ss].sliceLength = get32(ip);
+        segments[ss].firstIndex = get32(ip);
+        if (segments[ss].rowLength <= 0 ||
+            segments[ss].sliceLength % segments[ss].rowLength != 0)
+            return 0;
+        totalValues += segments[ss].numValues;
+    }
+    if (totalValues != numValues)
+        return 0;
+
+    memcpy(&numExact, ip, sizeof(uint32));
+    ip += sizeof(uint32);
+    memcpy(&packedBytes, ip, sizeof(uint32));
+    ip += sizeof(uint32);
+
+    if (!(errorBound > 0) || numExact > numValues ||
+        (long)(numExact*sizeof(float)) > inBytes - (ip - in))
+        return 0;
+    const unsigned char* exact = ip;
+    ip += numExact*sizeof(float);
+
+    vector<unsigned char> packed(packedBytes);
+    if (!LZCodec::decompress(ip, inBytes - (ip - in),
+        packedBytes ? &packed[0] : 0L, packedBytes))
+        return 0;
+
+    const double quantum = 2.0*errorBound;
+    BitReader reader(packed);
+    uint32 codes[BLOCK_LENGTH];
+    long nextExact = 0;
+    long segmentStart = 0;
+    for (int ss = 0; ss < numSegments; ss++)
+    {
+        const Segment & segment(segments[ss]);
+        float* segmentOut = out + segmentStart;
+        for (long first = 0; first < segment.numValues; first += BLOCK_LENGTH)
+        {
+            long last = min(first + BLOCK_LENGTH, segment.numValues);
+            int predictor;
+            if (!readBlock(reader, codes, last - first, predictor))
+                return 0;
+            for (long mm = first; mm < last; mm++)
+            {
+                if (codes[mm-first] == EXACT)
+                {
+                    if (nextExact == numExact)
+                        return 0;
+                    memcpy(&segmentOut[mm], exact + nextExact*sizeof(float),
+                        sizeof(float));
+                    nextExact++;
+                }
+                else
+                    segmentOut[mm] = reconstruct(
+                        predict(segmentOut, mm, segment, predictor),
+                        decodeQuanta(codes[mm-first]), quantum);
+            }
+        }
+        segmentStart += segment.numValues;
+    }
+    return nextExact == numExact && reader.atEnd();
+}
+
@@ -0,0 +1,98 @@
+/*
+ *  ErrorBoundedCodec.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _ERRORBOUNDEDCODEC_
+#define _ERRORBOUNDEDCODEC_
+
+#include <vector>
+
+/**
+ * Lossy compressor for floats that keeps every value within a given absolute
+ * error, in the style of SZ.
+ *
+ * The input is one or more segments of 3D arrays stored x fastest.  Each
+ * value is predicted from its neighbors before it, as they will be
+ * decompressed, by the Lorenzo predictor in x, y and z (exact for fields
+ * that are linear in each direction), in x and y, or in x alone, whichever
+ * suits each block of 32 values best.  The difference is rounded to a whole
+ * number of quanta (twice the error bound); smooth fields give mostly zero
+ * quanta.  The quantum counts are Rice coded, each block with its own
+ * parameter, and the coded stream goes through LZCodec, which squeezes the
+ * runs of zeros where the field is flat.  Values that can't be coded this
+ * way (too far off, infinite or NaN) are stored exactly.
+ *
+ * The block is:
+ *      double error bound
+ *      uint32 number of segments, then per segment uint32 values, row
+ *          length, slice length and first index
+ *      uint32 number of exact values, uint32 coded bytes
+ *      the exact values, as floats
+ *      the coded quantum counts, compressed by LZCodec
+ */
+class ErrorBoundedCodec
+{
+private:
+    ErrorBoundedCodec() {}
+public:
+    /**
+     * Consecutive values of an array with rows of rowLength values and
+     * slices of sliceLength values, starting at index firstIndex of the
+     * array.  Only neighbors in the same segment are used for prediction.
+     */
+    struct Segment
+    {
+        Segment() {}
+        Segment(long numValues, long rowLength, long sliceLength,
+            long firstIndex) :
+            numValues(numValues),
+            rowLength(rowLength),
+            sliceLength(sliceLength),
+            firstIndex(firstIndex) {}
+        
+        long numValues;
+        long rowLength;
+        long sliceLength;
+        long firstIndex;
+    };
+    
+    /**
+     * @returns the most bytes compress() can need for numValues floats in
+     *  numSegments segments
+     */
+    static long maxCompressedBytes(long numValues, long numSegments = 1);
+
+    /**
+     * Compress the segments' floats into out, which has room for
+     * maxOutBytes, so that each decompresses to within errorBound.
+     * errorBound must be positive.  maxError is set to the largest error
+     * actually made.
+     *
+     * @returns the compressed size, or 0 if it would not fit
+     */
+    static long compress(const float* in,
+        const std::vector<Segment> & segments, double errorBound,
+        unsigned char* out, long maxOutBytes, double & maxError);
+    
+    /**
+     * Compress numValues floats as a single row.
+     */
+    static long compress(const float* in, long numValues, double errorBound,
+        unsigned char* out, long maxOutBytes, double & maxError);
+
+    /**
+     * Decompress a block into exactly numValues floats.
+     *
+     * @returns false if the block is corrupt
+     */
+    static bool decompress(const unsigned char* in, long inBytes, float* out,
+        long numValues);
+};
+
+
+
+#endif
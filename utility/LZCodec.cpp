@@ -0,0 +1,209 @@
+/*
+ *  LZCodec.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "LZCodec.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+static const int MIN_MATCH = 4;
+static const long MAX_DISTANCE = 65535;
+static const int HASH_BITS = 14;
+
+static inline unsigned int
+read32(const unsigned char* p)
+{
+    unsigned int value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+static inline unsigned int
+hash32(unsigned int value)
+{
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Write the rest of a length whose nibble was 15.  Returns false if there's
+// no room.
+static inline bool
+writeLength(long length, unsigned char* & op, const unsigned char* oend)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (op >= oend)
+            return 0;
+        *op++ = 255;
+    }
+    if (op >= oend)
+        return 0;
+    *op++ = (unsigned char)length;
+    return 1;
+}
+
+static inline bool
+readLength(long & length, const unsigned char* & ip, const unsigned char* iend)
+{
+    unsigned char b;
+    do
+    {
+        if (ip >= iend)
+            return 0;
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return 1;
+}
+
+// One sequence: literals, then (unless matchLength is 0) a match.
+static bool
+writeSequence(const unsigned char* literals, long numLiterals,
+    long distance, long matchLength, unsigned char* & op,
+    const unsigned char* oend)
+{
+    if (op >= oend)
+        return 0;
+    unsigned char* token = op++;
+
+    *token = (unsigned char)((numLiterals < 15 ? numLiterals : 15) << 4);
+    if (numLiterals >= 15 && !writeLength(numLiterals-15, op, oend))
+        return 0;
+    if (op + numLiterals > oend)
+        return 0;
+    memcpy(op, literals, numLiterals);
+    op += numLiterals;
+
+    if (matchLength == 0)
+        return 1;
+
+    if (op + 2 > oend)
+        return 0;
+    *op++ = (unsigned char)(distance & 0xff);
+    *op++ = (unsigned char)(distance >> 8);
+
+    long code = matchLength - MIN_MATCH;
+    *token |= (unsigned char)(code < 15 ? code : 15);
+    if (code >= 15 && !writeLength(code-15, op, oend))
+        return 0;
+    return 1;
+}
+
+long LZCodec::
+maxCompressedBytes(long inBytes)
+{
+    return inBytes + inBytes/255 + 16;
+}
+
+long LZCodec::
+compress(const unsigned char* in, long inBytes, unsigned char* out,
+    long maxOutBytes)
+{
+    vector<long> lastPosition(1 << HASH_BITS, -1);
+    unsigned char* op = out;
+    const unsigned char* oend = out + maxOutBytes;
+    long anchor = 0;
+    long ip = 0;
+
+    while (ip + MIN_MATCH <= inBytes)
+    {
+        unsigned int value = read32(in + ip);
+        unsigned int h = hash32(value);
+        long candidate = lastPosition[h];
+        lastPosition[h] = ip;
+
+        if (candidate < 0 || ip - candidate > MAX_DISTANCE ||
+            read32(in + candidate) != value)
+        {
+            ip++;
+            continue;
+        }
+
+        long length = MIN_MATCH;
+        while (ip + length < inBytes && in[candidate+length] == in[ip+length])
+            length++;
+
+        if (!writeSequence(in + anchor, ip - anchor, ip - candidate, length,
+            op, oend))
+            return 0;
+        ip += length;
+        anchor = ip;
+    }
+
+    if (!writeSequence(in + anchor, inBytes - anchor, 0, 0, op, oend))
+        return 0;
+    return op - out;
+}
+
+bool LZCodec::
+decompress(const unsigned char* in, long inBytes, unsigned char* out,
+    long outBytes)
+{
+    const unsigned char* ip = in;
+    const unsigned char* iend = in + inBytes;
+    unsigned char* op = out;
+    unsigned char* oend = out + outBytes;
+
+    while (ip < iend)
+    {
+        unsigned char token = *ip++;
+
+        long numLiterals = token >> 4;
+        if (numLiterals == 15 && !readLength(numLiterals, ip, iend))
+            return 0;
+        if (ip + numLiterals > iend || op + numLiterals > oend)
+            return 0;
+        memcpy(op, ip, numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+
+        if (ip == iend) // the last sequence has no match
+            break;
+
+        if (ip + 2 > iend)
+            return 0;
+        long distance = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (distance == 0 || distance > op - out)
+            return 0;
+
+        long length = token & 15;
+        if (length == 15 && !readLength(length, ip, iend))
+            return 0;
+        length += MIN_MATCH;
+        if (op + length > oend)
+            return 0;
+
+        // Matches may overlap their own output, so copy forward bytewise.
+        const unsigned char* match = op - distance;
+        for (long nn = 0; nn < length; nn++)
+            op[nn] = match[nn];
+        op += length;
+    }
+    return op == oend;
+}
+
+void LZCodec::
+shuffle(const unsigned char* in, long numValues, int valueBytes,
+    unsigned char* out)
+{
+    for (int bb = 0; bb < valueBytes; bb++)
+    for (long nn = 0; nn < numValues; nn++)
+        out[bb*numValues + nn] = in[nn*valueBytes + bb];
+}
+
+void LZCodec::
+unshuffle(const unsigned char* in, long numValues, int valueBytes,
+    unsigned char* out)
+{
+    for (int bb = 0; bb < valueBytes; bb++)
+    for (long nn = 0; nn < numValues; nn++)
+        out[nn*valueBytes + bb] = in[bb*numValues + nn];
+}
+
@@ -0,0 +1,69 @@
+/*
+ *  LZCodec.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _LZCODEC_
+#define _LZCODEC_
+
+/**
+ * Small, fast lossless compressor in the style of LZ4, for output files.
+ *
+ * The compressed block is a series of sequences.  Each sequence is a token
+ * byte, whose high nibble is the number of literal bytes and low nibble the
+ * match length minus four; then the literals; then a two-byte little-endian
+ * distance back to the match.  A nibble of 15 means more length follows in
+ * bytes of 255 and a final byte under 255.  The last sequence has only
+ * literals.
+ *
+ * Floats compress much better after shuffle(), which groups the first bytes
+ * of all values together, then the second bytes and so on, so the sign and
+ * exponent bytes of smooth fields sit next to each other.
+ */
+class LZCodec
+{
+private:
+    LZCodec() {}
+public:
+    /**
+     * @returns the most bytes compress() can need for inBytes of input
+     */
+    static long maxCompressedBytes(long inBytes);
+
+    /**
+     * Compress inBytes of input into out, which has room for maxOutBytes.
+     *
+     * @returns the compressed size, or 0 if it would not fit
+     */
+    static long compress(const unsigned char* in, long inBytes,
+        unsigned char* out, long maxOutBytes);
+
+    /**
+     * Decompress a block into exactly outBytes of output.
+     *
+     * @returns false if the block is corrupt or does not decompress to
+     *  outBytes
+     */
+    static bool decompress(const unsigned char* in, long inBytes,
+        unsigned char* out, long outBytes);
+
+    /**
+     * Transpose numValues values of valueBytes bytes each, so out holds byte
+     * 0 of every value, then byte 1 of every value, and so on.
+     */
+    static void shuffle(const unsigned char* in, long numValues,
+        int valueBytes, unsigned char* out);
+
+    /**
+     * Undo shuffle().
+     */
+    static void unshuffle(const unsigned char* in, long numValues,
+        int valueBytes, unsigned char* out);
+};
+
+
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ *  MappedFile.cpp
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+MappedFile::
+MappedFile() :
+    mData(0L),
+    mBytes(0),
+    mPosition(0),
+    mNextAdvice(0),
+    mReleasedBytes(0),
+    mIsOpen(0),
+    mFailed(0)
+{
+}
+
+MappedFile::
+~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::
+open(const string & fileName)
+{
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd == -1)
+        return 0;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        ::close(fd);
+        return 0;
+    }
+    mBytes = fileStat.st_size;
+
+    // An empty file is open but has nothing to map.
+    if (mBytes > 0)
+    {
+        void* mapping = mmap(0L, mBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            ::close(fd);
+            mBytes = 0;
+            return 0;
+        }
+        mData = (const char*)mapping;
+        madvise(mapping, mBytes, MADV_SEQUENTIAL);
+    }
+    ::close(fd); // the mapping keeps the file
+
+    mPosition = 0;
+    mNextAdvice = 0;
+    mReleasedBytes = 0;
+    mIsOpen = 1;
+    mFailed = 0;
+    advise();
+    return 1;
+}
+
+void MappedFile::
+close()
+{
+    if (mData != 0L)
+        munmap((void*)mData, mBytes);
+    mData = 0L;
+    mBytes = 0;
+    mPosition = 0;
+    mIsOpen = 0;
+    mFailed = 0;
+}
+
+bool MappedFile::
+read(float* values, long numFloats)
+{
+    const float* data = view(numFloats);
+    if (data == 0L)
+        return 0;
+    if (numFloats > 0)
+        memcpy(values, data, numFloats*sizeof(float));
+    return 1;
+}
+
+void MappedFile::
+advise()
+{
+    if (mData == 0L)
+        return;
+    const long pageBytes = sysconf(_SC_PAGESIZE);
+
+    // Ask for the window after the read position...
+    long first = pageBytes*(mPosition/pageBytes);
+    long last = min(mBytes, mPosition + WINDOW_BYTES);
+    if (last > first)
+        madvise((void*)(mData + first), last - first, MADV_WILLNEED);
+    mNextAdvice = mPosition + WINDOW_BYTES/2;
+
+    // ... and let go of whatever is more than a window behind it.
+    long releaseEnd = pageBytes*((mPosition - WINDOW_BYTES)/pageBytes);
+    if (releaseEnd > mReleasedBytes)
+    {
+        madvise((void*)(mData + mReleasedBytes), releaseEnd - mReleasedBytes,
+            MADV_DONTNEED);
+        mReleasedBytes = releaseEnd;
+    }
+}
+
+
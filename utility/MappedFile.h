@@ -0,0 +1,98 @@
+/*
+ *  MappedFile.h
+ *  TROGDOR
+ *
+ *  Copyright 2009 Stanford University. All rights reserved.
+ *
+ */
+
+#ifndef _MAPPEDFILE_
+#define _MAPPEDFILE_
+
+#include <string>
+
+/**
+ * Read-only memory map of a binary file of floats that is read front to
+ * back, as source data files are.  view() hands out pointers straight into
+ * the mapping, so reading costs no system calls and no copies.
+ *
+ * The kernel is told the access is sequential so it reads ahead
+ * aggressively.  As the read position moves along, the next window of the
+ * file is requested ahead of time and pages more than a window behind are
+ * dropped from the mapping, so a file of many gigabytes never sits in the
+ * process's memory all at once.
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /**
+     * Map the file.  A file that can't be opened leaves this closed.
+     *
+     * @returns true if the file is open
+     */
+    bool open(const std::string & fileName);
+    void close();
+
+    bool isOpen() const { return mIsOpen; }
+
+    /**
+     * @returns false if the file isn't open or if view() has run off the
+     *  end, like ifstream::good()
+     */
+    bool good() const { return mIsOpen && !mFailed; }
+
+    long bytes() const { return mBytes; }
+    long position() const { return mPosition; }
+
+    /**
+     * Read numFloats floats without copying them.  The pointer is good until
+     * the file is closed, but pages more than a window behind the read
+     * position may have to be read from disk again.
+     *
+     * @returns pointer to the next numFloats floats, or 0L if there aren't
+     *  that many left (and then good() becomes false)
+     */
+    const float* view(long numFloats)
+    {
+        long numBytes = numFloats*sizeof(float);
+        if (!mIsOpen || mPosition + numBytes > mBytes)
+        {
+            mFailed = 1;
+            return 0L;
+        }
+        const float* data = (const float*)(mData + mPosition);
+        mPosition += numBytes;
+        if (mPosition >= mNextAdvice)
+            advise();
+        return data;
+    }
+
+    /**
+     * Read numFloats floats into values.
+     *
+     * @returns false if there aren't that many left
+     */
+    bool read(float* values, long numFloats);
+
+    static const long WINDOW_BYTES = 32*1024*1024;
+private:
+    MappedFile(const MappedFile & copyMe);
+    MappedFile & operator=(const MappedFile & rhs);
+
+    void advise();
+
+    const char* mData;
+    long mBytes;
+    long mPosition;
+    long mNextAdvice;
+    long mReleasedBytes;
+    bool mIsOpen;
+    bool mFailed;
+};
+
+
+
+#endif
@@ -20,14 +20,49 @@
 #include <iomanip>
 #include <cassert>
 #include <cstdlib>
-#include "Map.h"
 
+#include <boost/detail/atomic_count.hpp>
+
+#ifndef NDEBUG
+#include <set>
+#include <boost/thread/mutex.hpp>
+#endif
+
+// The reference count lives in a little block allocated alongside the object
+// the first time it is handed to a Pointer, and copies of the Pointer share
+// the block.  Copying or releasing a Pointer is an atomic increment or
+// decrement of that count: no lookup, no allocation and no lock, so Pointers
+// may be copied from several threads at once (e.g. when grids are updated
+// concurrently).
+//
+// As before, a raw pointer must be handed to the Pointer system only once.
+// Two Pointers made from the same raw pointer would keep separate counts and
+// delete the object twice.  Debug builds keep the set of raw pointers that
+// Pointers own and assert on the second handover.
+
+#ifndef NDEBUG
+namespace PointerDebug
+{
+// Never destroyed, so Pointers released during static destruction are fine.
+inline boost::mutex & liveMutex()
+{
+    static boost::mutex* m = new boost::mutex;
+    return *m;
+}
+
+inline std::set<const void*> & livePointers()
+{
+    static std::set<const void*>* s = new std::set<const void*>;
+    return *s;
+}
+}
+#endif
 
 template <typename T>
 class Pointer
 {
 public:
-    Pointer() : mPtr(0L) { }
+    Pointer() : mPtr(0L), mCount(0L) { }
     explicit Pointer(T* inPtr);
 	
 	// this is a bad idea!  (see explanation below in implementation.)
@@ -54,23 +89,17 @@ public:
 	operator T*() const { return mPtr; } // for the odd desmartinization need
 	
     int refcount() const;
-	static const Map<T*,int> & map() { return mReferenceCounts; }
     
     template<typename T1, typename T2>
     friend bool operator<(const Pointer<T1> & lhs, const Pointer<T2> & rhs);
     
-    static void print();
 protected:
     T* mPtr;
+    boost::detail::atomic_count* mCount; // shared by all copies; 0L if null
     
-    static Map<T*, int> mReferenceCounts;
-    
-    void decrementPointer();
+    static void release(T* ptr, boost::detail::atomic_count* count);
 };
 
-template<typename T>
-Map<T*, int> Pointer<T>::mReferenceCounts;
-
 template<typename T1, typename T2>
 bool operator<(const Pointer<T1> & lhs, const Pointer<T2> & rhs)
 {
@@ -80,22 +109,29 @@ bool operator<(const Pointer<T1> & lhs, const Pointer<T2> & rhs)
 template <typename T>
 Pointer<T>::
 Pointer(T* inPtr) :
-    mPtr(inPtr)
+    mPtr(inPtr),
+    mCount(0L)
 {
     if (mPtr != 0L)
     {
-        // This assertion is not a guard against immediately dangerous behavior,
-        // but it does encourage the user to comply with the very good rule that
-        // once a pointer is handed over to the shared Pointer system, it will
-        // not be exposed again as a raw pointer.
-        // The assertion can fail if an object creates a smart pointer to itself
-        // its own constructor.
-        assert(mReferenceCounts[inPtr] == 0);
-        mReferenceCounts[inPtr]++;
+#ifndef NDEBUG
+        {
+            boost::mutex::scoped_lock lock(PointerDebug::liveMutex());
+            bool isNew = PointerDebug::livePointers().insert(inPtr).second;
+            assert(isNew && "Raw pointer handed to Pointer twice.");
+        }
+#endif
+        try {
+            mCount = new boost::detail::atomic_count(1);
+        } catch (...) {
+#ifndef NDEBUG
+            boost::mutex::scoped_lock lock(PointerDebug::liveMutex());
+            PointerDebug::livePointers().erase(inPtr);
+#endif
+            delete inPtr;
+            throw;
+        }
     }
-    //LOG << "constructor " << std::hex << inPtr << std::dec << " refcount "
-    //    << mReferenceCounts[inPtr] << "\n";
-    //LOG << "total pointers: " << mReferenceCounts.size() << std::endl;
 }
 // this is a bad idea because the new pointer maintains its own ref count, 
 // and so on casts, you can end up deallocating things twice
@@ -117,52 +153,37 @@ template <typename T>
 Pointer<T>::
 ~Pointer()
 {
-    //LOG << "destructor " << std::hex << mPtr << std::dec << " refcount first ";
-    //LOGMORE << mReferenceCounts[mPtr] << "...\n";
-    decrementPointer();
+    release(mPtr, mCount);
 }
 
 template <typename T>
 Pointer<T>::
 Pointer(const Pointer<T> & src)
-    : mPtr(src.mPtr)
+    : mPtr(src.mPtr),
+    mCount(src.mCount)
 {
-    if (mPtr != 0L)
-        mReferenceCounts[mPtr]++;
-    //LOG << "copy constructor " << std::hex << mPtr << std::dec
-    //    << " (new refcount ";
-    //LOGMORE << mReferenceCounts[mPtr] << ")\n";
-    //LOG << "total pointers: " << mReferenceCounts.size() << std::endl;
+    if (mCount != 0L)
+        ++(*mCount);
 }
 
 template <typename T>
 Pointer<T>& Pointer<T>::
 operator=(const Pointer<T> & rhs)
 {
-    //LOG << "total pointers: " << mReferenceCounts.size() << std::endl;
-    
-    //LOG << "operator " << std::hex << mPtr << " = " << rhs.mPtr << std::dec
-    //    << " refcounts " << mReferenceCounts[mPtr] << " and ";
-    //LOGMORE << mReferenceCounts[rhs.mPtr] << "\n" << std::flush;
-    if ( &rhs == this )
-    {
-        //LOG << "case 1...\n";
-        return *this;
-    }
-    if ( rhs.mPtr == mPtr )
-    {
-        //LOG << "case 2, pointers " << std::hex << mPtr << std::dec << " ...\n";
+    if (rhs.mCount == mCount)
         return *this;
-    }
     
-    decrementPointer();
+    // Take the new reference before dropping the old one, and drop the old
+    // one only once this Pointer is consistent again: deleting the old object
+    // may release Pointers, perhaps even the one rhs belongs to.
+    if (rhs.mCount != 0L)
+        ++(*rhs.mCount);
     
+    T* oldPtr = mPtr;
+    boost::detail::atomic_count* oldCount = mCount;
     mPtr = rhs.mPtr;
-    if (mPtr != 0L)
-        mReferenceCounts[mPtr]++;
-    //LOG << "operator= " << std::hex << mPtr << std::dec
-    //    << " (new refcount ";
-    //LOGMORE << mReferenceCounts[mPtr] << ")\n";
+    mCount = rhs.mCount;
+    release(oldPtr, oldCount);
     
     return *this;
 }
@@ -232,7 +253,9 @@ const T& Pointer<T>::operator*() const
 template<typename T>
 int Pointer<T>::refcount() const
 {
-    return mReferenceCounts[mPtr];
+    if (mCount == 0L)
+        return 0;
+    return int(long(*mCount));
 }
 
 
@@ -249,48 +272,25 @@ const T* Pointer<T>::operator->() const
 }
 
 template <typename T>
-void Pointer<T>::decrementPointer()
+void Pointer<T>::release(T* ptr, boost::detail::atomic_count* count)
 {
-    if (mPtr != 0L)
+    if (count != 0L)
     {
-        int & count = mReferenceCounts[mPtr];
-        count--;
-        if (count == 0)
-        {
-            //LOG << "decrementing and deleting " << std::hex
-            //    << mPtr << std::dec << std::endl;
-            delete mPtr;
-        }
-        else if (count > 0)
+        long newCount = --(*count);
+        assert(newCount >= 0 && "Bicycle race.");
+        if (newCount == 0)
         {
-            //LOG << "decrementing " << std::hex << mPtr << std::dec
-            //    << " (new refcount " << count << ")\n";
-        }
-        else
-        {
-            //LOG << "Dagnabbit!  " << std::hex << mPtr << std::dec
-            //    << " Refcount " << count << "\n";
-            assert(!"Bicycle race.");
+#ifndef NDEBUG
+            {
+                boost::mutex::scoped_lock lock(PointerDebug::liveMutex());
+                PointerDebug::livePointers().erase(ptr);
+            }
+#endif
+            delete ptr;
+            delete count;
         }
-        assert(count == mReferenceCounts[mPtr]);
     }
-    
-    //LOG << "total pointers: " << mReferenceCounts.size() << std::endl;
-}
-
-template <typename T>
-void Pointer<T>::print()
-{
-    LOG << mReferenceCounts.size() << " pointer records.\n";
-    /*
-    Map<T*, int>::iterator itr;
-    for (itr = mReferenceCounts.begin(); itr != mReferenceCounts.end(); itr++)
-    {
-        LOG << "pointer " << std::hex << (*itr).first << std::dec << " count "
-            << (*itr).second << "\n";
-    }*/
 }
 
 
 #endif
-
@@ -249,6 +249,12 @@ Rect<T> clip( const Rect<T> & rectToClip, const Rect<T> & clipRect)
 	return out;
 }
 
+template<typename T>
+Rect<T> intersection( const Rect<T> & lhs, const Rect<T> & rhs)
+{
+    return Rect<T>(vec_max(lhs.p1, rhs.p1), vec_min(lhs.p2, rhs.p2));
+}
+
 template<typename T>
 Rect<T> cyclicPermute(const Rect<T> & r, unsigned int nn)
 {
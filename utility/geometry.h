@@ -131,6 +131,12 @@ template<typename T>
 Rect<T>
 clip( const Rect<T> & rectToClip, const Rect<T> & clipRect);
 
+// Unlike clip(), rects that do not overlap give an empty rect (p2 < p1 along
+// some axis) rather than a slab on the edge of the other.
+template<typename T>
+Rect<T>
+intersection( const Rect<T> & lhs, const Rect<T> & rhs);
+
 template<typename T>
 Rect<T>
 cyclicPermute(const Rect<T> & r, unsigned int nn);